@@ -0,0 +1,337 @@
+#!/usr/bin/env python3
+# Builds the GLSL programs of the app framework.
+#
+# Every program listed in shaders/shaders.csv is validated with glslangValidator, together with every
+# combination of its variant flags. Its includes are resolved, comments and indentation are stripped and the
+# result is written to include/app_framework/shader/<name>_<stage>_program.h. The std140 layout of its uniform
+# blocks and its samplers go to src/render/precompiled_shaders.cpp, so Program doesn't have to query them.
+#
+# The outputs are checked in, run this after editing a shader. --check fails if they are out of date.
+import argparse
+import csv
+import glob
+import itertools
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+vi = sys.version_info
+if (vi.major, vi.minor) < (3, 5):
+    print("Please run this script with Python 3.5 or newer")
+    exit(1)
+
+ABSOLUTE_PATH = os.path.dirname(os.path.realpath(__file__))
+SHADERS_PATH = os.path.join(ABSOLUTE_PATH, 'shaders')
+HEADERS_PATH = os.path.join(ABSOLUTE_PATH, 'include', 'app_framework', 'shader')
+REFLECTION_PATH = os.path.join(ABSOLUTE_PATH, 'src', 'render', 'precompiled_shaders.cpp')
+
+BANNER = '''//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+'''
+
+STAGES = {
+    'vert': ('vs', 'GL_VERTEX_SHADER'),
+    'geom': ('gs', 'GL_GEOMETRY_SHADER'),
+    'frag': ('fs', 'GL_FRAGMENT_SHADER'),
+}
+
+# GL type, base alignment and size of the std140 types
+TYPES = {
+    'bool': ('GL_BOOL', 4, 4),
+    'int': ('GL_INT', 4, 4),
+    'uint': ('GL_UNSIGNED_INT', 4, 4),
+    'float': ('GL_FLOAT', 4, 4),
+    'vec2': ('GL_FLOAT_VEC2', 8, 8),
+    'vec3': ('GL_FLOAT_VEC3', 16, 12),
+    'vec4': ('GL_FLOAT_VEC4', 16, 16),
+    'ivec2': ('GL_INT_VEC2', 8, 8),
+    'ivec3': ('GL_INT_VEC3', 16, 12),
+    'ivec4': ('GL_INT_VEC4', 16, 16),
+    'mat2': ('GL_FLOAT_MAT2', 16, 32),
+    'mat3': ('GL_FLOAT_MAT3', 16, 48),
+    'mat4': ('GL_FLOAT_MAT4', 16, 64),
+}
+
+SAMPLER_TYPES = {
+    'sampler2D': 'GL_SAMPLER_2D',
+    'sampler2DArray': 'GL_SAMPLER_2D_ARRAY',
+    'sampler3D': 'GL_SAMPLER_3D',
+    'samplerCube': 'GL_SAMPLER_CUBE',
+    'samplerBuffer': 'GL_SAMPLER_BUFFER',
+    'usamplerBuffer': 'GL_UNSIGNED_INT_SAMPLER_BUFFER',
+    # Not in the desktop GL headers
+    'samplerExternalOES': '0x8D66 /* GL_SAMPLER_EXTERNAL_OES */',
+}
+
+
+class Shader:
+    def __init__(self, row):
+        self.file = row[0]
+        self.variable = row[1]
+        self.variant_defines = row[2].split() if len(row) > 2 else []
+        self.variant_flags = row[3].split() if len(row) > 3 else []
+        base, extension = os.path.splitext(self.file)
+        if extension[1:] not in STAGES:
+            raise ValueError('{}: unknown shader stage'.format(self.file))
+        suffix, self.gl_stage = STAGES[extension[1:]]
+        self.header = '{}_{}_program.h'.format(base, suffix)
+
+
+def align(offset, alignment):
+    return (offset + alignment - 1) // alignment * alignment
+
+
+def strip_comments(code):
+    code = re.sub(r'/\*.*?\*/', ' ', code, flags=re.S)
+    return re.sub(r'//[^\n]*', '', code)
+
+
+def resolve_includes(path, seen=None):
+    seen = seen or []
+    if path in seen:
+        raise ValueError('{}: recursive #include'.format(path))
+    lines = []
+    with open(path) as source:
+        for line in source:
+            match = re.match(r'\s*#\s*include\s+"([^"]+)"', line)
+            if match:
+                lines.append(resolve_includes(os.path.join(os.path.dirname(path), match.group(1)), seen + [path]))
+            else:
+                lines.append(line)
+    return ''.join(lines)
+
+
+def minify(code):
+    lines = (line.strip() for line in strip_comments(code).splitlines())
+    return '\n'.join(line for line in lines if line)
+
+
+class Layout:
+    """std140 layout of the uniform blocks and the samplers of a program, named the way GL reflects them"""
+
+    def __init__(self, code):
+        code = strip_comments(code)
+        self.constants = {m.group(1): int(m.group(2)) for m in re.finditer(r'#\s*define\s+(\w+)\s+(\d+)\s*$', code,
+                                                                             flags=re.M)}
+        self.structs = {}
+        for match in re.finditer(r'struct\s+(\w+)\s*\{([^}]*)\}\s*;', code):
+            self.structs[match.group(1)] = self.parse_members(match.group(2))
+
+        self.blocks = []
+        for match in re.finditer(r'layout\s*\(\s*std140\s*\)\s*uniform\s+(\w+)\s*\{([^}]*)\}\s*(\w*)\s*;', code):
+            name = match.group(1)
+            members = []
+            end = self.layout_members(self.parse_members(match.group(2)), 0, '', members)
+            self.blocks.append((name, align(end, 16), members))
+
+        self.uniforms = []
+        for match in re.finditer(r'^\s*uniform\s+(?:(?:lowp|mediump|highp)\s+)?(\w+)\s+(\w+)\s*(?:\[\s*(\w+)\s*\])?\s*;',
+                                 code, flags=re.M):
+            if match.group(1) not in SAMPLER_TYPES:
+                raise ValueError('uniform {} is outside of a std140 block'.format(match.group(2)))
+            self.uniforms.append((match.group(2), SAMPLER_TYPES[match.group(1)], self.array_size(match.group(3)), 0))
+
+    def array_size(self, size):
+        if size is None:
+            return 1
+        return int(size) if size.isdigit() else self.constants[size]
+
+    def parse_members(self, declarations):
+        members = []
+        for declaration in declarations.split(';'):
+            declaration = declaration.strip()
+            if not declaration:
+                continue
+            match = re.match(r'(?:(?:lowp|mediump|highp)\s+)?(\w+)\s+(\w+)\s*(?:\[\s*(\w+)\s*\])?$', declaration)
+            if not match:
+                raise ValueError('unsupported uniform declaration "{}"'.format(declaration))
+            members.append((match.group(1), match.group(2), match.group(3)))
+        return members
+
+    def get_alignment(self, type_name):
+        if type_name in self.structs:
+            return align(max(self.get_alignment(m[0]) for m in self.structs[type_name]), 16)
+        return TYPES[type_name][1]
+
+    def get_size(self, type_name):
+        if type_name in self.structs:
+            return align(self.layout_members(self.structs[type_name], 0, '', []), self.get_alignment(type_name))
+        return TYPES[type_name][2]
+
+    def layout_members(self, members, offset, prefix, out):
+        for type_name, name, size in members:
+            count = self.array_size(size)
+            alignment = self.get_alignment(type_name)
+            if size is not None:
+                alignment = align(alignment, 16)
+            offset = align(offset, alignment)
+            stride = align(self.get_size(type_name), alignment)
+            if type_name in self.structs:
+                for i in range(count):
+                    element = '{}{}[{}].'.format(prefix, name, i) if size is not None else prefix + name + '.'
+                    self.layout_members(self.structs[type_name], offset + i * stride, element, out)
+            else:
+                out.append((prefix + name + ('[0]' if size is not None else ''), TYPES[type_name][0], count, offset))
+            offset += stride * count if size is not None else self.get_size(type_name)
+        return offset
+
+
+def find_glslang(path):
+    if path:
+        return path
+    candidates = glob.glob(os.path.join(ABSOLUTE_PATH, 'external', 'package', '*', 'bin', 'glslangValidator*'))
+    if candidates:
+        return candidates[0]
+    return shutil.which('glslangValidator')
+
+
+def validate(glslang, shader, code):
+    variants = [[]]
+    if shader.variant_defines or shader.variant_flags:
+        variants += [['-D{}'.format(define) for define in shader.variant_defines] +
+                     ['-D{}={}'.format(flag, 'true' if value else 'false')
+                      for flag, value in zip(shader.variant_flags, values)]
+                     for values in itertools.product([False, True], repeat=len(shader.variant_flags))]
+
+    # glslangValidator picks the stage from the extension
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, os.path.basename(shader.file))
+        with open(path, 'w') as source:
+            source.write(code)
+        for defines in variants:
+            result = subprocess.run([glslang] + defines + [path], stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+            if result.returncode != 0:
+                print('{} {}:\n{}'.format(shader.file, ' '.join(defines), result.stdout.decode('utf-8')))
+                return False
+    return True
+
+
+def generate_header(shader, code):
+    return '''{banner}// Generated by compile_shaders.py from shaders/{file}, do not edit.
+#pragma once
+
+namespace ml {{
+namespace app_framework {{
+
+static const char *{variable} = R"GLSL(
+{code}
+)GLSL";
+}}
+}}
+'''.format(banner=BANNER, file=shader.file, variable=shader.variable, code=code)
+
+
+def format_uniforms(name, uniforms):
+    lines = ['const ShaderUniformReflection {}[] = {{'.format(name)]
+    for uniform_name, gl_type, count, offset in uniforms:
+        lines.append('    {{"{}", {}, {}, {}}},'.format(uniform_name, gl_type, count, offset))
+    lines.append('};')
+    return lines
+
+
+def generate_reflection(shaders, layouts):
+    includes = ['#include <app_framework/shader/{}>'.format(shader.header) for shader in shaders]
+    tables = []
+    entries = []
+    for shader, layout in zip(shaders, layouts):
+        blocks = 'nullptr'
+        if layout.blocks:
+            blocks = shader.variable + 'Blocks'
+            block_lines = ['const ShaderBlockReflection {}[] = {{'.format(blocks)]
+            for name, size, members in layout.blocks:
+                members_name = '{}{}Members'.format(shader.variable, name)
+                tables += format_uniforms(members_name, members) + ['']
+                block_lines.append('    {{"{}", {}, {}, {}}},'.format(name, size, members_name, len(members)))
+            tables += block_lines + ['};', '']
+        uniforms = 'nullptr'
+        if layout.uniforms:
+            uniforms = shader.variable + 'Uniforms'
+            tables += format_uniforms(uniforms, layout.uniforms) + ['']
+        entries.append('    {{{}, {}, {}, {}, {}, {}}},'.format(shader.variable, shader.gl_stage, blocks,
+                                                               len(layout.blocks), uniforms, len(layout.uniforms)))
+
+    return '''{banner}// Generated by compile_shaders.py, do not edit.
+#include "shader_reflection.h"
+
+{includes}
+
+namespace ml {{
+namespace app_framework {{
+
+namespace {{
+
+{tables}
+}}  // namespace
+
+const ShaderReflection kPrecompiledShaders[] = {{
+{entries}
+}};
+const size_t kPrecompiledShaderCount = sizeof(kPrecompiledShaders) / sizeof(kPrecompiledShaders[0]);
+
+}}  // namespace app_framework
+}}  // namespace ml
+'''.format(banner=BANNER, includes='\n'.join(includes), tables='\n'.join(tables), entries='\n'.join(entries))
+
+
+def write(path, content, check):
+    current = None
+    if os.path.isfile(path):
+        with open(path) as existing:
+            current = existing.read()
+    if current == content:
+        return True
+    if check:
+        print('{} is out of date, run compile_shaders.py'.format(os.path.relpath(path, ABSOLUTE_PATH)))
+        return False
+    with open(path, 'w') as output:
+        output.write(content)
+    print('Wrote {}'.format(os.path.relpath(path, ABSOLUTE_PATH)))
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Validate the GLSL programs and generate their headers')
+    parser.add_argument('--check', action='store_true',
+                        help='''fail if a generated file is out of date instead of writing it''')
+    parser.add_argument('--glslang', default=None,
+                        help='''path of glslangValidator, by default the one built by build_external.py or on the
+                        PATH''')
+    parser.add_argument('--require-glslang', dest='require_glslang', action='store_true',
+                        help='''fail instead of skipping the validation if glslangValidator isn't found''')
+    args = parser.parse_args()
+
+    with open(os.path.join(SHADERS_PATH, 'shaders.csv')) as csv_file:
+        shaders = [Shader(row) for row in csv.reader(csv_file, delimiter=',') if row]
+
+    glslang = find_glslang(args.glslang)
+    if not glslang:
+        if args.require_glslang:
+            print('glslangValidator not found')
+            exit(1)
+        print('glslangValidator not found, the shaders are not validated. Run build_external.py to build it.')
+
+    ok = True
+    layouts = []
+    for shader in shaders:
+        code = resolve_includes(os.path.join(SHADERS_PATH, shader.file))
+        if glslang and not validate(glslang, shader, code):
+            ok = False
+        layouts.append(Layout(code))
+        ok = write(os.path.join(HEADERS_PATH, shader.header), generate_header(shader, minify(code)), args.check) and ok
+    ok = write(REFLECTION_PATH, generate_reflection(shaders, layouts), args.check) and ok
+
+    if not ok:
+        exit(1)
+
+
+if __name__ == '__main__':
+    main()
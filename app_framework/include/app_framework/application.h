@@ -18,9 +18,12 @@
 #include <mutex>
 #include <queue>
 
+#include <app_framework/frame_pacer.h>
 #include <app_framework/graphics_context.h>
+#include <app_framework/job_system.h>
 
 #include <app_framework/node.h>
+#include <app_framework/render/dynamic_resolution.h>
 #include <app_framework/render/renderer.h>
 
 #include <app_framework/components/camera_component.h>
@@ -117,15 +120,30 @@ protected:
     return graphics_context_.get();
   }
 
+  /*! The job system, also reachable through Registry::GetJobSystem */
+  JobSystem *GetJobSystem() {
+    return job_system_.get();
+  }
+
+  /*! Frame timing hint decisions and frame cost telemetry. Null when running without the ML graphics client. */
+  const FramePacer *GetFramePacer() const {
+    return frame_pacer_.get();
+  }
+
 private:
   void Initialize();
   void InitializeLifecycle();
   void InitializeLifecycleSelfInfo();
   void InitializePerception();
   void InitializeGraphics();
+  void InitializeGraphicsClient();
+  void InitializeHeadlessRenderTargets();
   void InitializeSignalHandler();
+  void InitializePerceptionRecorder();
+  void InitializeJobSystem();
 
   void Terminate();
+  void TerminateJobSystem();
   void TerminateLifecycle();
   void TerminatePerception();
   void TerminateGraphics();
@@ -149,6 +167,7 @@ private:
   std::condition_variable sleep_cv_;
   static std::atomic<bool> exit_signal_;
   std::string window_title_;
+  std::unique_ptr<JobSystem> job_system_;
 
   // Graphics
   std::unique_ptr<GraphicsContext> graphics_context_;
@@ -157,6 +176,13 @@ private:
   MLHandle graphics_client_;
   MLGraphicsFrameParamsEx frame_params_;
   size_t dropped_frames_ = 0;
+  std::unique_ptr<FramePacer> frame_pacer_;
+  std::unique_ptr<DynamicResolution> dynamic_resolution_;
+
+  // Headless rendering, stands in for the ML graphics client and its render targets
+  bool headless_ = false;
+  MLHandle headless_color_id_ = 0;
+  void BeginHeadlessFrame(MLGraphicsFrameInfo &frame_info);
 
   // Lifecycle
   std::atomic<ApplicationStatus> lifecycle_status_;
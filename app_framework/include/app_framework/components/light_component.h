@@ -7,6 +7,9 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
+#include <algorithm>
+#include <cmath>
+
 #include <app_framework/common.h>
 #include <app_framework/render/texture.h>
 #include <app_framework/component.h>
@@ -23,10 +26,11 @@ enum class LightType {
 class LightComponent final : public Component {
   RUNTIME_TYPE_REGISTER(LightComponent)
 public:
-  constexpr static const int MAXIMUM_LIGHTS = 32;
+  // Lights past this are ignored by the light clustering, which indexes them with 16 bits
+  constexpr static const int MAXIMUM_LIGHTS = 4096;
 
   LightComponent()
-    : direction_(glm::normalize(glm::vec3(0, -1, -1))), light_type_(LightType::Point), light_strength_(1.0f), color_(1.0, 1.0, 1.0) {};
+    : direction_(glm::normalize(glm::vec3(0, -1, -1))), light_type_(LightType::Point), light_strength_(1.0f), light_range_(0.f), color_(1.0, 1.0, 1.0) {};
   ~LightComponent() = default;
 
   void SetDirection(const glm::vec3 &direction) {
@@ -63,11 +67,26 @@ public:
     return light_type_;
   }
 
+  // Distance past which a point light has no effect. 0, the default, derives it from the strength and the color:
+  // the distance where the inverse square falloff drops below 1/256.
+  void SetLightRange(float range) {
+    light_range_ = range;
+  }
+
+  float GetLightRange() const {
+    if (light_range_ > 0.f) {
+      return light_range_;
+    }
+    const float intensity = light_strength_ * std::max(color_.x, std::max(color_.y, color_.z));
+    return std::sqrt(std::max(intensity, 0.f) * 256.f);
+  }
+
 private:
   glm::vec3 color_;
   glm::vec3 direction_;
   LightType light_type_;
   float light_strength_;
+  float light_range_;
 };
 
 }
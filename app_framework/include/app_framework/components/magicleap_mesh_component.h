@@ -9,9 +9,13 @@
 #pragma once
 #include <app_framework/common.h>
 #include <app_framework/render/mesh.h>
+#include <app_framework/render/mesh_optimizer.h>
 #include <app_framework/render/program.h>
 #include <app_framework/render/vertex_buffer.h>
 
+#include <limits>
+#include <vector>
+
 namespace ml {
 namespace app_framework {
 
@@ -19,9 +23,14 @@ namespace app_framework {
 class MagicLeapMeshComponent : public Component {
   RUNTIME_TYPE_REGISTER(MagicLeapMeshComponent)
 public:
-  MagicLeapMeshComponent() {
+  // Float positions and octahedral encoded normals by default, the meshes are rebuilt often and world space
+  // positions don't quantize well
+  explicit MagicLeapMeshComponent(const VertexLayout &vertex_layout = VertexLayout(
+      VertexLayout::PositionFormat::kFloat3, VertexLayout::NormalFormat::kOctahedral16,
+      VertexLayout::TexCoordFormat::kNone))
+      : vertex_layout_(vertex_layout) {
     confidence_buffer_ = std::make_shared<VertexBuffer>(Buffer::Category::Dynamic, GL_FLOAT, 1);
-    mesh_ = std::make_shared<Mesh>(Buffer::Category::Dynamic, GL_UNSIGNED_SHORT);
+    mesh_ = std::make_shared<Mesh>(Buffer::Category::Dynamic, GL_UNSIGNED_SHORT, vertex_layout);
     mesh_->SetCustomBuffer(attribute_locations::kConfidence, confidence_buffer_);
   }
 
@@ -31,9 +40,32 @@ public:
     return mesh_;
   }
 
+  // Simplifies every update of the block into this many levels of detail, each with half the triangles of the
+  // previous one, for RenderableComponent::SetLods. The block meshes are rebuilt often, so this trades CPU time at
+  // every update for fewer triangles drawn. A level that can't be generated gets an infinite error and is never
+  // drawn. 0 by default.
+  void SetLodCount(size_t lod_count) {
+    lods_.resize(lod_count);
+    for (auto &lod : lods_) {
+      if (!lod.mesh) {
+        lod.confidence_buffer = std::make_shared<VertexBuffer>(Buffer::Category::Dynamic, GL_FLOAT, 1);
+        lod.mesh = std::make_shared<Mesh>(Buffer::Category::Dynamic, GL_UNSIGNED_SHORT, vertex_layout_);
+        lod.mesh->SetCustomBuffer(attribute_locations::kConfidence, lod.confidence_buffer);
+        lod.mesh->SetSimplificationError(std::numeric_limits<float>::infinity());
+      }
+    }
+  }
+
+  std::vector<std::shared_ptr<Mesh>> GetLodMeshes() const {
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    for (const auto &lod : lods_) {
+      meshes.push_back(lod.mesh);
+    }
+    return meshes;
+  }
+
   void UpdateMeshWithConfidence(glm::vec3 const *vertices, glm::vec3 const *normals, float const *confidences,
                                 size_t num_vertices, uint16_t const *indices, size_t num_indices) {
-    mesh_->UpdateMesh(vertices, normals, num_vertices, indices, num_indices);
     auto buffer = confidences;
     if (!buffer) {
       if (dummy_buffer_.size() < num_vertices) {
@@ -41,13 +73,57 @@ public:
       }
       buffer = dummy_buffer_.data();
     }
-    confidence_buffer_->UpdateBuffer((char *)buffer, num_vertices * sizeof(float));
+    // Staged with the geometry so the block never draws with the confidences of another update
+    std::vector<UploadManager::BufferCopy> copies(1);
+    copies[0].buffer = confidence_buffer_;
+    copies[0].data.assign((const char *)buffer, (const char *)(buffer + num_vertices));
+    mesh_->UpdateMeshStaged(vertices, normals, num_vertices, indices, num_indices, std::move(copies));
+    UpdateLods(vertices, normals, buffer, num_vertices, indices, num_indices);
   }
 
 private:
+  struct Lod {
+    std::shared_ptr<Mesh> mesh;
+    std::shared_ptr<VertexBuffer> confidence_buffer;
+  };
+
+  void UpdateLods(glm::vec3 const *vertices, glm::vec3 const *normals, float const *confidences, size_t num_vertices,
+                  uint16_t const *indices, size_t num_indices) {
+    if (lods_.empty()) {
+      return;
+    }
+    const std::vector<uint32_t> full_indices(indices, indices + (indices ? num_indices : 0));
+    float ratio = 1.f;
+    bool simplified = !full_indices.empty();
+    for (auto &lod : lods_) {
+      ratio *= 0.5f;
+      MeshLod mesh_lod;
+      simplified = simplified && GenerateLod(full_indices, vertices, num_vertices, ratio, mesh_lod);
+      if (!simplified) {
+        lod.mesh->SetSimplificationError(std::numeric_limits<float>::infinity());
+        continue;
+      }
+      const auto lod_vertices = RemapVertices(vertices, num_vertices, mesh_lod.remap, mesh_lod.vertex_count);
+      const auto lod_normals = normals ? RemapVertices(normals, num_vertices, mesh_lod.remap, mesh_lod.vertex_count)
+                                       : std::vector<glm::vec3>();
+      const auto lod_confidences = RemapVertices(confidences, num_vertices, mesh_lod.remap, mesh_lod.vertex_count);
+      const std::vector<uint16_t> lod_indices(mesh_lod.indices.begin(), mesh_lod.indices.end());
+
+      std::vector<UploadManager::BufferCopy> copies(1);
+      copies[0].buffer = lod.confidence_buffer;
+      copies[0].data.assign((const char *)lod_confidences.data(),
+                            (const char *)(lod_confidences.data() + lod_confidences.size()));
+      lod.mesh->UpdateMeshStaged(lod_vertices.data(), normals ? lod_normals.data() : nullptr, mesh_lod.vertex_count,
+                                 lod_indices.data(), lod_indices.size(), std::move(copies));
+      lod.mesh->SetSimplificationError(mesh_lod.error);
+    }
+  }
+
+  VertexLayout vertex_layout_;
   std::shared_ptr<VertexBuffer> confidence_buffer_;
   std::vector<float> dummy_buffer_;
   std::shared_ptr<Mesh> mesh_;
+  std::vector<Lod> lods_;
 };
 
 }  // namespace app_framework
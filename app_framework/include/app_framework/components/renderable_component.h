@@ -12,6 +12,8 @@
 #include <app_framework/render/mesh.h>
 #include <app_framework/component.h>
 
+#include <vector>
+
 namespace ml {
 namespace app_framework {
 
@@ -47,10 +49,43 @@ public:
     return material_;
   }
 
+  // Simplified versions of the mesh, coarser with every level, for the Renderer to draw when it's far enough that
+  // the difference stays under its error threshold. Level 0 is the mesh itself.
+  void SetLods(std::vector<std::shared_ptr<Mesh>> lods) {
+    lods_ = std::move(lods);
+    lod_levels_.clear();
+  }
+
+  const std::vector<std::shared_ptr<Mesh>> &GetLods() const {
+    return lods_;
+  }
+
+  size_t GetLodCount() const {
+    return lods_.size() + 1;
+  }
+
+  const std::shared_ptr<Mesh> &GetLodMesh(size_t level) const {
+    return level ? lods_[level - 1] : mesh_;
+  }
+
+  // Level drawn last for the camera, the Renderer keeps it until the error crosses the threshold by a margin
+  size_t GetLodLevel(size_t camera_index) const {
+    return camera_index < lod_levels_.size() ? lod_levels_[camera_index] : 0;
+  }
+
+  void SetLodLevel(size_t camera_index, size_t level) {
+    if (camera_index >= lod_levels_.size()) {
+      lod_levels_.resize(camera_index + 1, 0);
+    }
+    lod_levels_[camera_index] = static_cast<uint8_t>(level);
+  }
+
 private:
   bool visible_;
   std::shared_ptr<Mesh> mesh_;
   std::shared_ptr<Material> material_;
+  std::vector<std::shared_ptr<Mesh>> lods_;
+  std::vector<uint8_t> lod_levels_;
 };
 
 }
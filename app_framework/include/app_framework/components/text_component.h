@@ -24,7 +24,7 @@ class TextComponent final : public Component {
   RUNTIME_TYPE_REGISTER(TextComponent)
 public:
   TextComponent() {
-    mesh_ = std::make_shared<Mesh>(Buffer::Category::Dynamic, GL_UNSIGNED_SHORT);
+    mesh_ = std::make_shared<Mesh>(Buffer::Category::Dynamic, GL_UNSIGNED_SHORT, VertexLayout::Positions());
   }
   ~TextComponent() = default;
 
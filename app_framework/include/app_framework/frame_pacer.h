@@ -0,0 +1,79 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+
+#include <ml_api.h>
+#include <ml_graphics.h>
+
+#include <chrono>
+#include <cstdint>
+
+namespace ml {
+namespace app_framework {
+
+// Picks the frame timing hint from the measured frame cost and paces the main loop when the compositor is not
+// ready for a new frame.
+//
+// Every evaluation window the pacer compares the average CPU and GPU frame durations and the dropped frame rate
+// against the 120 Hz frame budget. It drops to 60 Hz as soon as a window is over budget, and only goes back up
+// once several consecutive windows fit comfortably, so a single spike does not cause the rate to flip back and
+// forth. When MLGraphicsBeginFrameEx returns Pending or Timeout, WaitAfterDroppedFrame blocks the calling thread
+// with an exponential backoff bounded by a quarter of the frame period instead of letting the loop spin.
+class FramePacer final {
+public:
+  struct Stats {
+    MLGraphicsFrameTimingHint hint = MLGraphicsFrameTimingHint_Unspecified;
+    float cpu_frame_ms = 0.f;      // average over the last window
+    float gpu_frame_ms = 0.f;      // average over the last window
+    float dropped_frame_rate = 0.f;  // dropped / (submitted + dropped) over the last window
+    uint32_t hint_switches = 0;
+    std::chrono::microseconds total_wait{0};
+  };
+
+  // max_hint is the fastest rate the pacer will use. Without adaptive, the hint stays at max_hint and only the
+  // wait strategy is used.
+  FramePacer(MLHandle graphics_client, MLGraphicsFrameTimingHint max_hint, bool adaptive);
+
+  void OnFrameSubmitted();
+  void OnFrameDropped();
+  void WaitAfterDroppedFrame();
+
+  const Stats &GetStats() const {
+    return stats_;
+  }
+
+  void LogStats() const;
+
+  float GetFramePeriodMs() const {
+    return GetFramePeriod().count() / 1000.f;
+  }
+
+private:
+  void Evaluate();
+  void SetHint(MLGraphicsFrameTimingHint hint);
+  std::chrono::microseconds GetFramePeriod() const;
+
+  MLHandle graphics_client_;
+  MLGraphicsFrameTimingHint max_hint_;
+  bool adaptive_;
+  Stats stats_;
+
+  // Current evaluation window
+  uint32_t window_submitted_ = 0;
+  uint32_t window_dropped_ = 0;
+  uint64_t window_cpu_ns_ = 0;
+  uint64_t window_gpu_ns_ = 0;
+  uint32_t windows_under_budget_ = 0;
+  std::chrono::steady_clock::time_point last_switch_;
+
+  std::chrono::microseconds backoff_{0};
+};
+
+}  // namespace app_framework
+}  // namespace ml
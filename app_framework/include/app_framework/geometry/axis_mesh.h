@@ -38,7 +38,7 @@ class Axis final : public Mesh {
   }};
 
 public:
-  Axis() : Mesh(Buffer::Category::Static) {
+  Axis() : Mesh(Buffer::Category::Static, GL_UNSIGNED_INT, VertexLayout::Positions()) {
     color_buffer_ = std::make_shared<VertexBuffer>(Buffer::Category::Static, GL_FLOAT, 4);
     color_buffer_->UpdateBuffer((char *)g_vertex_colors.data(), sizeof(g_vertex_colors));
 
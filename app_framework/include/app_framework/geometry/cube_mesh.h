@@ -60,7 +60,7 @@ static const std::array<std::array<GLushort, 2>, 12> g_indices = {{
 class CubeMesh final : public Mesh {
   RUNTIME_TYPE_REGISTER(CubeMesh)
 public:
-  CubeMesh() : Mesh(Buffer::Category::Static, GL_UNSIGNED_SHORT) {
+  CubeMesh() : Mesh(Buffer::Category::Static, GL_UNSIGNED_SHORT, VertexLayout::Positions()) {
     color_buffer_ = std::make_shared<VertexBuffer>(Buffer::Category::Static, GL_FLOAT, 4);
     color_buffer_->UpdateBuffer((char *)g_vertex_colors.data(), sizeof(g_vertex_colors));
 
@@ -37,9 +37,12 @@ class QuadMesh final : public Mesh {
   }};
 
 public:
-  QuadMesh() : Mesh(Buffer::Category::Static, GL_UNSIGNED_SHORT) {
-    UpdateMesh(g_vertex_positions.data(), nullptr, g_vertex_positions.size(), (uint16_t *)g_indices.data(), g_indices[0].size() * g_indices.size());
-    UpdateTexCoordsBuffer(g_tex_coords.data());
+  QuadMesh()
+      : Mesh(Buffer::Category::Static, GL_UNSIGNED_SHORT,
+             VertexLayout(VertexLayout::PositionFormat::kFloat3, VertexLayout::NormalFormat::kNone,
+                          VertexLayout::TexCoordFormat::kHalf2)) {
+    UpdateVertices(g_vertex_positions.data(), nullptr, g_tex_coords.data(), g_vertex_positions.size());
+    UpdateIndices(g_indices.data(), g_indices[0].size() * g_indices.size());
   }
   ~QuadMesh() = default;
 };
@@ -30,6 +30,21 @@ public:
                   int32_t window_height = 1);
   ~GraphicsContext();
 
+#if !ML_LUMIN
+  // Creates a context that renders offscreen only, without a window or a display server. It uses an EGL
+  // surfaceless display, so it also works on machines without a GPU through a software rasterizer (e.g. Mesa
+  // llvmpipe). Only supported on Linux.
+  static GraphicsContext *CreateHeadless(int32_t width, int32_t height);
+  bool IsHeadless() const {
+    return egl_context_ != nullptr;
+  }
+#endif
+
+  // Creates a context that shares GL objects with this one, to be made current on another thread, e.g. to
+  // compile shaders in the background. Call it on the thread this context is current on. Returns null if the
+  // platform can't create one.
+  GraphicsContext *CreateSharedContext();
+
   void MakeCurrent();
   void SwapBuffers();
   void UnMakeCurrent();
@@ -42,12 +57,26 @@ public:
   static gl_proc_t GetProcAddress(char const *procname);
 
 private:
+#if !ML_LUMIN
+  struct HeadlessTag {};
+  GraphicsContext(HeadlessTag, int32_t width, int32_t height);
+#endif
+  struct SharedTag {};
+  GraphicsContext(SharedTag, const GraphicsContext &parent);
+
   std::function<void(void)> close_callback_ = nullptr;
+  // Shared contexts don't own the display and are released by UnMakeCurrent
+  bool shared_ = false;
 #if ML_LUMIN
   void *display_handle_;
+  void *config_handle_;
   void *context_handle_;
 #else
-  GLFWwindow *window_handle_;
+  GLFWwindow *window_handle_ = nullptr;
+  void *egl_display_ = nullptr;
+  void *egl_config_ = nullptr;
+  void *egl_context_ = nullptr;
+  static bool sHeadless;
 #endif
   std::pair<int32_t, int32_t> frame_buffer_dimensions_;
   friend class GraphicsContextCallbacks;
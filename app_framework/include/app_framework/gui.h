@@ -52,6 +52,9 @@ public:
   }
 
   bool GetShowImgui();
+
+  // Collapsible section of the GpuMemoryTracker totals, by category and label, for the window being built
+  void DrawGpuMemoryPanel();
 private:
   Gui();
   Gui(const Gui& other) = delete;
@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Counts the jobs that still have to finish before its continuations run.
+class JobCounter final {
+public:
+  uint32_t GetPending() const {
+    return pending_.load(std::memory_order_acquire);
+  }
+
+  bool IsDone() const {
+    return GetPending() == 0;
+  }
+
+private:
+  friend class JobSystem;
+  struct Continuation {
+    std::function<void()> function;
+    std::shared_ptr<JobCounter> counter;
+    bool main_thread;
+  };
+
+  std::atomic<uint32_t> pending_{0};
+  std::mutex mutex_;
+  std::vector<Continuation> continuations_;
+};
+
+// Work-stealing job scheduler.
+//
+// Every worker thread owns a deque. Workers push and pop their own jobs at the back, and steal from the front of
+// the other deques when their own is empty. Jobs submitted from other threads are spread round-robin over the
+// workers. Jobs that have to run on the main thread, e.g. because they make GL calls, go into a separate queue
+// that the Application drains once per frame. A JobCounter tracks a group of jobs, and continuations added with
+// RunAfter are scheduled once all jobs of the group have finished.
+class JobSystem final {
+public:
+  using Job = std::function<void()>;
+
+  // worker_count 0 uses one worker per hardware thread, minus the main thread
+  explicit JobSystem(uint32_t worker_count = 0);
+  ~JobSystem();
+
+  // Schedules a job on a worker. If counter is null a new one is created. Returns the counter of the job.
+  std::shared_ptr<JobCounter> Run(Job job, std::shared_ptr<JobCounter> counter = nullptr);
+  // Schedules a job on the main thread, it runs during the next ExecuteMainThreadJobs or Wait on the main thread.
+  std::shared_ptr<JobCounter> RunOnMainThread(Job job, std::shared_ptr<JobCounter> counter = nullptr);
+  // Schedules a job once all jobs counted by dependency have finished
+  std::shared_ptr<JobCounter> RunAfter(const std::shared_ptr<JobCounter> &dependency, Job job,
+                                       bool main_thread = false, std::shared_ptr<JobCounter> counter = nullptr);
+
+  // Calls body(chunk_begin, chunk_end) over [begin, end) split into chunks of grain_size items. A grain_size of 0
+  // splits the range into a few chunks per worker.
+  std::shared_ptr<JobCounter> ParallelFor(size_t begin, size_t end, size_t grain_size,
+                                          std::function<void(size_t, size_t)> body);
+
+  // Executes jobs on the calling thread until the counter reaches zero
+  void Wait(const std::shared_ptr<JobCounter> &counter);
+
+  // Runs the main thread jobs queued so far. Called by the Application every frame.
+  void ExecuteMainThreadJobs();
+
+  uint32_t GetWorkerCount() const {
+    return uint32_t(workers_.size());
+  }
+
+  bool IsMainThread() const {
+    return std::this_thread::get_id() == main_thread_id_;
+  }
+
+  uint64_t GetExecutedJobCount() const {
+    return executed_jobs_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetStolenJobCount() const {
+    return stolen_jobs_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct QueuedJob {
+    Job function;
+    std::shared_ptr<JobCounter> counter;
+  };
+
+  struct Worker {
+    std::thread thread;
+    std::mutex mutex;
+    std::deque<QueuedJob> jobs;
+  };
+
+  void WorkerLoop(uint32_t worker_index);
+  void Schedule(QueuedJob job, bool main_thread);
+  bool TryExecuteJob(int32_t worker_index);
+  bool PopJob(int32_t worker_index, QueuedJob &job);
+  void Execute(QueuedJob &job);
+  void Finish(const std::shared_ptr<JobCounter> &counter);
+  int32_t GetCurrentWorkerIndex() const;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::thread::id main_thread_id_;
+  std::atomic<uint32_t> next_worker_{0};
+  std::atomic<bool> stop_{false};
+
+  // Number of jobs sitting in the worker deques, workers sleep while it is zero
+  std::atomic<uint32_t> queued_jobs_{0};
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+
+  std::mutex main_thread_mutex_;
+  std::deque<QueuedJob> main_thread_jobs_;
+
+  std::atomic<uint64_t> executed_jobs_{0};
+  std::atomic<uint64_t> stolen_jobs_{0};
+};
+
+}  // namespace app_framework
+}  // namespace ml
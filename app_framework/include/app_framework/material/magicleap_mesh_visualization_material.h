@@ -17,13 +17,14 @@
 namespace ml {
 namespace app_framework {
 
-// Magic Leap Mesh component for mesh visualization
+// Magic Leap Mesh component for mesh visualization. The shaders compile in the background, meshes are drawn with
+// the renderer's fallback material until then.
 class MagicLeapMeshVisualizationMaterial final : public Material {
 public:
   MagicLeapMeshVisualizationMaterial() : Material() {
-    SetVertexProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<VertexProgram>(kMagicLeapMeshVertexShader));
-    SetFragmentProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<FragmentProgram>(kSolidColorFragmentShader));
-    SetGeometryProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<GeometryProgram>(kMagicLeapMeshGeometryShader));
+    SetVertexProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCodeAsync<VertexProgram>(kMagicLeapMeshVertexShader));
+    SetFragmentProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCodeAsync<FragmentProgram>(kSolidColorFragmentShader));
+    SetGeometryProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCodeAsync<GeometryProgram>(kMagicLeapMeshGeometryShader));
     SetOverrideVertexColor(false);
   }
   ~MagicLeapMeshVisualizationMaterial() = default;
@@ -7,6 +7,9 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
+#include <string>
+#include <vector>
+
 #include <app_framework/common.h>
 #include <app_framework/registry.h>
 #include <app_framework/shader/pbr_fs_program.h>
@@ -16,14 +19,94 @@
 namespace ml {
 namespace app_framework {
 
+// The Has* flags pick a variant of the fragment shader with the unused features compiled out. The variant is
+// chosen when the material is rendered, until then (or when variants are disabled) the generic shader that tests
+// the flags at runtime is used, so every variable of the material can be set in any order. All of them compile in
+// the background, the material keeps its current program until the variant it asked for is ready.
 class PBRMaterial final : public Material {
 public:
+  enum Feature : uint32_t {
+    kFeatureNormals = 1 << 0,
+    kFeatureAlbedo = 1 << 1,
+    kFeatureNormalMap = 1 << 2,
+    kFeatureMetallic = 1 << 3,
+    kFeatureRoughness = 1 << 4,
+    kFeatureAmbientOcclusion = 1 << 5,
+    kFeatureEmissive = 1 << 6,
+  };
+
   PBRMaterial() {
-    SetVertexProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<VertexProgram>(kPBRVertexShader));
-    SetFragmentProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCode<FragmentProgram>(kPBRFragmentShader));
+    SetVertexProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCodeAsync<VertexProgram>(kPBRVertexShader));
+    SetFragmentProgram(Registry::GetInstance()->GetResourcePool()->LoadShaderFromCodeAsync<FragmentProgram>(kPBRFragmentShader));
   }
   ~PBRMaterial() = default;
 
+  // Enables the compile-time variants for all PBR materials, on by default
+  static void SetShaderVariantsEnabled(bool enabled) {
+    ShaderVariantsEnabled() = enabled;
+  }
+
+  static bool GetShaderVariantsEnabled() {
+    return ShaderVariantsEnabled();
+  }
+
+  uint32_t GetFeatures() const {
+    uint32_t features = 0u;
+    features |= GetHasNormals() ? static_cast<uint32_t>(kFeatureNormals) : 0u;
+    features |= GetHasAlbedo() ? static_cast<uint32_t>(kFeatureAlbedo) : 0u;
+    features |= GetHasNormalMap() ? static_cast<uint32_t>(kFeatureNormalMap) : 0u;
+    features |= GetHasMetallic() ? static_cast<uint32_t>(kFeatureMetallic) : 0u;
+    features |= GetHasRoughness() ? static_cast<uint32_t>(kFeatureRoughness) : 0u;
+    features |= GetHasAmbientOcclusion() ? static_cast<uint32_t>(kFeatureAmbientOcclusion) : 0u;
+    features |= GetHasEmissive() ? static_cast<uint32_t>(kFeatureEmissive) : 0u;
+    return features;
+  }
+
+  void ResolveProgram() override {
+    if (dirty_ || variants_enabled_ != GetShaderVariantsEnabled()) {
+      variants_enabled_ = GetShaderVariantsEnabled();
+      const uint32_t features = variants_enabled_ ? GetFeatures() : kGenericFeatures;
+      if (features != features_) {
+        pending_fragment_program_ = LoadFragmentProgram(features);
+        features_ = features;
+      }
+    }
+    if (pending_fragment_program_ && pending_fragment_program_->IsReady()) {
+      SetFragmentProgram(pending_fragment_program_);
+      pending_fragment_program_.reset();
+    }
+  }
+
+  // Starts compiling the variants of the given feature sets, see ResourcePool::WarmUpShader
+  static void WarmUpShaderVariants(const std::vector<uint32_t> &feature_sets) {
+    auto &resource_pool = Registry::GetInstance()->GetResourcePool();
+    resource_pool->WarmUpShader<VertexProgram>(kPBRVertexShader);
+    resource_pool->WarmUpShader<FragmentProgram>(kPBRFragmentShader);
+    for (uint32_t features : feature_sets) {
+      resource_pool->WarmUpShader<FragmentProgram>(GetFragmentShaderVariant(features),
+                                                   GetFragmentShaderVariantIdentifier(features));
+    }
+  }
+
+  static std::string GetFragmentShaderVariant(uint32_t features) {
+    std::vector<std::string> defines = {"PBR_SHADER_VARIANT"};
+    defines.push_back(std::string("HAS_NORMALS ") + ((features & kFeatureNormals) ? "true" : "false"));
+    defines.push_back(std::string("HAS_ALBEDO ") + ((features & kFeatureAlbedo) ? "true" : "false"));
+    defines.push_back(std::string("HAS_NORMAL_MAP ") + ((features & kFeatureNormalMap) ? "true" : "false"));
+    defines.push_back(std::string("HAS_METALLIC ") + ((features & kFeatureMetallic) ? "true" : "false"));
+    defines.push_back(std::string("HAS_ROUGHNESS ") + ((features & kFeatureRoughness) ? "true" : "false"));
+    defines.push_back(std::string("HAS_AMBIENT_OCCLUSION ") +
+                      ((features & kFeatureAmbientOcclusion) ? "true" : "false"));
+    defines.push_back(std::string("HAS_EMISSIVE ") + ((features & kFeatureEmissive) ? "true" : "false"));
+    return AddShaderDefines(kPBRFragmentShader, defines);
+  }
+
+  static std::string GetFragmentShaderVariantIdentifier(uint32_t features) {
+    return "pbr_fs_variant_" + std::to_string(features);
+  }
+
+  // The samplers are sampler2DArray, only layers of texture arrays (see ResourcePool::LoadTextureLayer) are accepted. Other
+  // textures are rejected with an error and the previous texture is kept.
   MATERIAL_VARIABLE_DECLARE(std::shared_ptr<Texture>, Albedo);
 
   MATERIAL_VARIABLE_DECLARE(std::shared_ptr<Texture>, Metallic);
@@ -53,6 +136,28 @@ public:
   MATERIAL_VARIABLE_DECLARE(bool, HasAmbientOcclusion);
 
   MATERIAL_VARIABLE_DECLARE(bool, HasEmissive);
+
+private:
+  static constexpr uint32_t kGenericFeatures = ~0u;
+
+  static bool &ShaderVariantsEnabled() {
+    static bool enabled = true;
+    return enabled;
+  }
+
+  static std::shared_ptr<FragmentProgram> LoadFragmentProgram(uint32_t features) {
+    auto &resource_pool = Registry::GetInstance()->GetResourcePool();
+    if (features == kGenericFeatures) {
+      return resource_pool->LoadShaderFromCodeAsync<FragmentProgram>(kPBRFragmentShader);
+    }
+    return resource_pool->LoadShaderFromCodeAsync<FragmentProgram>(GetFragmentShaderVariant(features),
+                                                                    GetFragmentShaderVariantIdentifier(features));
+  }
+
+  // Features of the program the material asked for last, it may still be compiling
+  uint32_t features_ = kGenericFeatures;
+  std::shared_ptr<FragmentProgram> pending_fragment_program_;
+  bool variants_enabled_ = false;
 };
 }
 }
@@ -0,0 +1,145 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+
+#include <ml_api.h>
+#include <ml_graphics.h>
+#include <ml_hand_tracking.h>
+#include <ml_input.h>
+#include <ml_meshing2.h>
+#include <ml_planes.h>
+#include <ml_snapshot.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Captures the per frame results of the perception calls made by the framework and the samples into a compact
+// binary log, and feeds them back on a later run so that the same session can be re-run as a benchmark.
+//
+// The wrappers below have the same signature as the ML calls they stand in for. While recording, they call
+// through and log the result. While replaying, they return the result recorded for the same frame. Calls that
+// were not recorded for the frame fall back to the last recorded value for the same query, or to the live API
+// if there is none. Pointers returned from a replayed call stay valid until the next call of the same wrapper.
+class PerceptionRecorder final {
+public:
+  enum class Mode { Off, Record, Replay };
+
+  static PerceptionRecorder &GetInstance() {
+    static PerceptionRecorder recorder;
+    return recorder;
+  }
+
+  bool StartRecording(const std::string &path);
+  // realtime replays frames at the recorded pace, otherwise frames are replayed as fast as possible
+  bool StartReplay(const std::string &path, bool realtime);
+  void Stop();
+
+  Mode GetMode() const {
+    return mode_;
+  }
+
+  // Called once per frame by the Application before OnUpdate. Returns the delta time the frame should use,
+  // which is the recorded one while replaying.
+  float BeginFrame(float delta_time);
+
+  // True once the last recorded frame has been replayed
+  bool IsReplayFinished() const {
+    return mode_ == Mode::Replay && current_frame_ >= frames_.size();
+  }
+
+  // Records, or replaces with the recorded ones, the head driven camera poses returned by MLGraphicsBeginFrameEx
+  void SyncCameraPoses(MLGraphicsFrameInfo &frame_info);
+
+  MLResult GetTransform(const MLSnapshot *snapshot, const MLCoordinateFrameUID *id, MLTransform *out_transform);
+  MLResult GetControllerState(MLHandle input, MLInputControllerState out_state[MLInput_MaxControllers]);
+  MLResult GetHandTrackingData(MLHandle hand_tracker, MLHandTrackingDataEx *out_data);
+  MLResult GetMeshInfoResult(MLHandle meshing_client, MLHandle request, MLMeshingMeshInfo *out_mesh_info);
+  MLResult GetMeshResult(MLHandle meshing_client, MLHandle request, MLMeshingMesh *out_mesh);
+  MLResult GetPlanesResults(MLHandle planes_tracker, MLHandle request, MLPlane *out_results,
+                            uint32_t *out_num_results, MLPlaneBoundariesList *out_boundaries);
+  // Use instead of MLPlanesReleaseBoundariesList for lists returned by GetPlanesResults
+  MLResult ReleasePlaneBoundaries(MLHandle planes_tracker, MLPlaneBoundariesList *boundaries);
+
+private:
+  enum class RecordType : uint32_t {
+    Frame,
+    CameraPoses,
+    Transform,
+    ControllerState,
+    HandTrackingData,
+    MeshInfoResult,
+    MeshResult,
+    PlanesResults,
+  };
+
+  struct RecordHeader {
+    RecordType type;
+    uint32_t size;
+    MLResult result;
+    uint32_t frame;
+    uint64_t key;
+  };
+
+  struct Frame {
+    float delta_time;
+    std::chrono::duration<double> timestamp;
+    std::vector<size_t> records;
+    std::vector<bool> consumed;
+  };
+
+  PerceptionRecorder() = default;
+  PerceptionRecorder(const PerceptionRecorder &other) = delete;
+  PerceptionRecorder(PerceptionRecorder &&other) = delete;
+  PerceptionRecorder &operator=(const PerceptionRecorder &other) = delete;
+  PerceptionRecorder &operator=(PerceptionRecorder &&other) = delete;
+  ~PerceptionRecorder();
+
+  void WriteRecord(RecordType type, uint64_t key, MLResult result, const std::vector<uint8_t> &payload);
+  void FlushFrame();
+  // Returns the next unconsumed record of this type and key in the current frame, or nullptr. With
+  // allow_previous_frames the last record replayed for the same query is returned instead of nullptr.
+  const RecordHeader *FindRecord(RecordType type, uint64_t key, bool allow_previous_frames);
+  const uint8_t *GetPayload(const RecordHeader *header) const {
+    return reinterpret_cast<const uint8_t *>(header) + sizeof(RecordHeader);
+  }
+
+  Mode mode_ = Mode::Off;
+  std::string path_;
+
+  // Recording
+  std::FILE *file_ = nullptr;
+  std::vector<uint8_t> frame_buffer_;
+  std::chrono::steady_clock::time_point start_time_;
+  uint32_t recorded_frames_ = 0;
+  size_t recorded_bytes_ = 0;
+
+  // Replay, the log is kept in 8 byte aligned storage so that the arrays in it can be handed out directly
+  std::vector<uint64_t> log_;
+  std::vector<Frame> frames_;
+  std::map<std::pair<RecordType, uint64_t>, const RecordHeader *> last_records_;
+  size_t current_frame_ = 0;
+  bool realtime_ = false;
+  std::chrono::steady_clock::time_point replay_start_;
+  std::vector<MLMeshingBlockMesh> replay_blocks_;
+  std::vector<MLMeshingBlockInfo> replay_block_infos_;
+  std::vector<MLPlaneBoundaries> replay_plane_boundaries_;
+  std::vector<MLPlaneBoundary> replay_boundaries_;
+  std::vector<MLPolygon> replay_polygons_;
+};
+
+}  // namespace app_framework
+}  // namespace ml
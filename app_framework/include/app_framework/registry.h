@@ -8,6 +8,15 @@
 // %BANNER_END%
 #pragma once
 #include "common.h"
+#include "job_system.h"
+#include "render/geometry_arena.h"
+#include "render/gl_deletion_queue.h"
+#include "render/gpu_memory_tracker.h"
+#include "render/material_parameter_arena.h"
+#include "render/pipeline_state.h"
+#include "render/render_target_pool.h"
+#include "render/texture_bindings.h"
+#include "render/upload_manager.h"
 #include "resource_pool.h"
 
 namespace ml {
@@ -26,8 +35,61 @@ public:
   const std::unique_ptr<ResourcePool>& GetResourcePool() const {
     return pool_;
   }
+
+  // Owned by the Application, null outside of its lifetime
+  JobSystem *GetJobSystem() const {
+    return job_system_;
+  }
+
+  void SetJobSystem(JobSystem *job_system) {
+    job_system_ = job_system;
+  }
+
+  MaterialParameterArena &GetMaterialParameterArena() {
+    return material_parameter_arena_;
+  }
+
+  PipelineStateCache &GetPipelineStateCache() {
+    return pipeline_state_cache_;
+  }
+
+  TextureBindingCache &GetTextureBindingCache() {
+    return texture_binding_cache_;
+  }
+
+  GLDeletionQueue &GetGLDeletionQueue() {
+    return gl_deletion_queue_;
+  }
+
+  UploadManager &GetUploadManager() {
+    return upload_manager_;
+  }
+
+  GeometryArena &GetGeometryArena() {
+    return geometry_arena_;
+  }
+
+  RenderTargetPool &GetRenderTargetPool() {
+    return render_target_pool_;
+  }
+
+  GpuMemoryTracker &GetGpuMemoryTracker() {
+    return gpu_memory_tracker_;
+  }
 private:
+  // Declared before everything holding GL memory, their destructors release it here
+  GpuMemoryTracker gpu_memory_tracker_;
+  // Declared before everything that enqueues GL objects, so the ones they release are still deleted
+  GLDeletionQueue gl_deletion_queue_;
+  // Declared before the pool so they outlive the materials and programs cached there
+  MaterialParameterArena material_parameter_arena_;
+  PipelineStateCache pipeline_state_cache_;
+  TextureBindingCache texture_binding_cache_;
+  UploadManager upload_manager_;
+  GeometryArena geometry_arena_;
+  RenderTargetPool render_target_pool_;
   std::unique_ptr<ResourcePool> pool_;
+  JobSystem *job_system_ = nullptr;
 };
 }
 }
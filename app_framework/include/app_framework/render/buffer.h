@@ -9,9 +9,14 @@
 #pragma once
 #include <app_framework/common.h>
 
+#include <string>
+
 namespace ml {
 namespace app_framework {
 
+// GL buffer object whose storage is only reallocated when an update doesn't fit in it. Dynamic buffers grow their
+// capacity geometrically and orphan it on every update, so a mesh changing a little every frame neither reallocates
+// nor stalls on the draws still reading the previous contents. Static buffers are sized to their data.
 class Buffer {
 public:
   enum class Category {
@@ -25,16 +30,43 @@ public:
   Category GetCategory() const {
     return category_;
   }
+  // Bytes of the last update
   uint64_t GetSize() const {
     return size_;
   }
 
+  // Bytes allocated, at least the size
+  uint64_t GetCapacity() const {
+    return capacity_;
+  }
+
+  // Number of times the storage of this buffer was (re)allocated
+  uint64_t GetReallocationCount() const {
+    return reallocation_cnt_;
+  }
+
+  // Updates and (re)allocations of every buffer so far
+  static uint64_t GetTotalUpdateCount();
+  static uint64_t GetTotalReallocationCount();
+
   GLuint GetGLBuffer() const {
     return buffer_;
   }
 
+  // What the storage of this buffer is accounted to in the GpuMemoryTracker
+  void SetMemoryLabel(const std::string &label);
+
   virtual void UpdateBuffer(const char *data, uint64_t size);
 
+  // Makes room for size bytes without writing them. The contents are lost and the size is 0 if the storage has to
+  // grow.
+  void Reserve(uint64_t size);
+
+  // Size of contents written to the buffer without UpdateBuffer, see UploadManager. Has to fit in the capacity.
+  void SetSize(uint64_t size) {
+    size_ = size;
+  }
+
   GLint GetGLBufferType() const {
     return gl_buffer_type_;
   }
@@ -57,6 +89,8 @@ private:
   GLint gl_buffer_type_;
   GLint gl_buffer_category_;
   uint64_t size_;
+  uint64_t capacity_;
+  uint64_t reallocation_cnt_;
 };
 }
 }
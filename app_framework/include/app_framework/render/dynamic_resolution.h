@@ -0,0 +1,61 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+#include "gpu_timer.h"
+
+namespace ml {
+namespace app_framework {
+
+// Picks the fraction of the render target size to render at from the measured GPU frame time.
+//
+// The GPU time is smoothed with an exponential moving average and compared against the frame budget. Since GPU
+// cost is roughly proportional to the pixel count, the scale moves towards scale * sqrt(budget / gpu_time), by
+// the smoothing factor each frame. The scale is quantized so that small fluctuations do not resize the viewport
+// every frame.
+class DynamicResolution final {
+public:
+  DynamicResolution(float min_scale, float max_scale, float smoothing);
+
+  void SetFrameBudget(float budget_ms) {
+    budget_ms_ = budget_ms;
+  }
+
+  // Brackets the GPU work of a frame
+  void BeginFrame();
+  void EndFrame();
+
+  float GetScale() const {
+    return scale_;
+  }
+
+  float GetGpuTimeMs() const {
+    return gpu_ms_;
+  }
+
+  uint32_t GetScaleChanges() const {
+    return scale_changes_;
+  }
+
+private:
+  void Update(float gpu_ms);
+
+  GpuTimer timer_;
+  float min_scale_;
+  float max_scale_;
+  float smoothing_;
+  float budget_ms_ = 1000.f / 60.f;
+  float gpu_ms_ = 0.f;
+  float target_scale_;
+  float scale_;
+  uint32_t scale_changes_ = 0;
+};
+
+}  // namespace app_framework
+}  // namespace ml
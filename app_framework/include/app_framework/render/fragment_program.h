@@ -17,7 +17,7 @@ namespace app_framework {
 class FragmentProgram final : public Program {
 public:
   // Initialize the program with null-terminated code string
-  FragmentProgram(const char *code) : Program(code, GL_FRAGMENT_SHADER) {}
+  FragmentProgram(const char *code, bool async = false) : Program(code, GL_FRAGMENT_SHADER, async) {}
   virtual ~FragmentProgram() = default;
 };
 }
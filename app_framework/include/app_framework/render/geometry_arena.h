@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+#include "buffer.h"
+#include "vertex_layout.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Free list over a range of size units: allocations take the smallest free range they fit in, and freed ranges
+// are merged with their free neighbors
+class RangeAllocator final {
+public:
+  explicit RangeAllocator(uint32_t size);
+
+  // Finds count free units ending at or before limit, returns false if there are none
+  bool Allocate(uint32_t count, uint32_t &offset, uint32_t limit = UINT32_MAX);
+  void Free(uint32_t offset, uint32_t count);
+
+  uint32_t GetSize() const {
+    return size_;
+  }
+
+  uint32_t GetFreeCount() const {
+    return free_count_;
+  }
+
+  uint32_t GetFreeRangeCount() const {
+    return static_cast<uint32_t>(free_ranges_.size());
+  }
+
+  uint32_t GetLargestFreeRange() const;
+
+private:
+  uint32_t size_;
+  uint32_t free_count_;
+  // Offset to size of every free range
+  std::map<uint32_t, uint32_t> free_ranges_;
+};
+
+// Large vertex and index buffers shared by the static meshes of the same vertex layout.
+//
+// A Mesh in the arena is a range of vertices and a range of indices of a page: a vertex buffer, an index buffer and
+// a vertex array reading them. It is drawn with a base vertex from the vertex array of its page, so consecutive
+// draws of meshes in the same page don't bind anything. The pages are sub-allocated with a RangeAllocator each, a
+// new page is added when a mesh fits in none of them.
+//
+// Freed ranges leave holes. Defragment, called once per frame, moves the last meshes of the pages into the holes
+// before them with GPU copies, a few at a time, so the free space of a page gathers at its end and large meshes
+// fit again. Empty pages are released.
+class GeometryArena final {
+public:
+  static constexpr uint64_t kPageVertexBytes = 16 * 1024 * 1024;
+  static constexpr uint64_t kPageIndexBytes = 8 * 1024 * 1024;
+  static constexpr uint64_t kDefaultDefragmentBudget = 1024 * 1024;
+
+  struct Page;
+
+  // Where the geometry of a mesh is, in vertices and indices. Updated by Defragment.
+  struct Allocation {
+    Page *page;
+    uint32_t first_vertex;
+    uint32_t vertex_count;
+    uint32_t first_index;
+    uint32_t index_count;
+  };
+
+  struct Page {
+    VertexLayout vertex_layout;
+    uint32_t attribute_mask;
+    GLenum index_type;
+    uint32_t index_size;
+    std::shared_ptr<Buffer> vertex_buffer;
+    std::shared_ptr<Buffer> index_buffer;
+    GLuint vertex_array;
+    RangeAllocator vertices;
+    RangeAllocator indices;
+    std::set<Allocation *> allocations;
+  };
+
+  struct Statistics {
+    size_t page_count = 0;
+    size_t allocation_count = 0;
+    uint64_t capacity_bytes = 0;
+    uint64_t used_bytes = 0;
+    // Free ranges of all the buffers, and the bytes of the largest one of each buffer summed
+    size_t free_range_count = 0;
+    uint64_t largest_free_bytes = 0;
+    // Bytes moved by Defragment so far
+    uint64_t moved_bytes = 0;
+
+    // 0 when the free space of every buffer is one range, close to 1 when it's scattered in small holes
+    float GetFragmentation() const {
+      const uint64_t free_bytes = capacity_bytes - used_bytes;
+      return free_bytes ? 1.f - static_cast<float>(largest_free_bytes) / free_bytes : 0.f;
+    }
+  };
+
+  GeometryArena() = default;
+  ~GeometryArena();
+
+  // This class should neither be copyable or movable
+  GeometryArena(const GeometryArena &) = delete;
+  GeometryArena(GeometryArena &&) = delete;
+  GeometryArena &operator=(const GeometryArena &) = delete;
+  GeometryArena &operator=(GeometryArena &&) = delete;
+
+  // Room for the vertices and indices of a mesh with the attributes of the layout passed as true enabled, freed
+  // when the allocation is destroyed. Indices are 16 bit for up to 65536 vertices and 32 bit above. Null if the
+  // mesh is larger than a page.
+  std::shared_ptr<Allocation> Allocate(const VertexLayout &vertex_layout, bool positions, bool normals,
+                                       bool tex_coords, uint32_t vertex_count, uint32_t index_count);
+
+  // Writes the vertices, packed in the layout of the page, and the indices of an allocation
+  void Write(const Allocation &allocation, const char *vertex_data, const uint32_t *indices);
+
+  // Bytes Defragment copies per call at most
+  void SetDefragmentBudget(uint64_t bytes) {
+    defragment_budget_ = bytes;
+  }
+
+  // Called once per frame by the render thread
+  void Defragment();
+
+  Statistics GetStatistics();
+
+private:
+  void Free(Allocation *allocation);
+  // Moves allocations of a page to lower free ranges, returns the bytes copied
+  uint64_t Compact(Page &page, uint64_t budget);
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Page>> pages_;
+  uint64_t defragment_budget_ = kDefaultDefragmentBudget;
+  uint64_t moved_bytes_ = 0;
+};
+
+}  // namespace app_framework
+}  // namespace ml
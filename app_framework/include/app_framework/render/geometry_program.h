@@ -17,12 +17,11 @@ namespace app_framework {
 class GeometryProgram final : public Program {
 public:
   // Initialize the program with null-terminated code string
-  GeometryProgram(const char *code);
+  GeometryProgram(const char *code, bool async = false);
   virtual ~GeometryProgram() = default;
 
-  inline GLint GetInputPrimitiveType() {
-    return type_;
-  }
+  // GL_NONE until the program is ready
+  GLint GetInputPrimitiveType();
 
 private:
   GLint type_;
@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// GL objects whose last owner is gone, deleted once the GPU is done with the frames that may still use them.
+//
+// The destructors of Buffer, Texture, TextureArray, Mesh, Program and RenderTarget enqueue their names instead of
+// deleting them wherever the last reference drops, which can be a worker thread or the middle of a frame. At the
+// end of every frame the render thread fences the names enqueued so far, and deletes the batches whose fences have
+// signaled with one glDelete* call per object type.
+class GLDeletionQueue final {
+public:
+  enum class ObjectType {
+    kBuffer,
+    kTexture,
+    kVertexArray,
+    kFramebuffer,
+    kProgram,
+    kCount,
+  };
+
+  GLDeletionQueue() = default;
+  ~GLDeletionQueue();
+
+  // This class should neither be copyable or movable
+  GLDeletionQueue(const GLDeletionQueue &) = delete;
+  GLDeletionQueue(GLDeletionQueue &&) = delete;
+  GLDeletionQueue &operator=(const GLDeletionQueue &) = delete;
+  GLDeletionQueue &operator=(GLDeletionQueue &&) = delete;
+
+  // Can be called from any thread, name 0 is ignored
+  void Enqueue(ObjectType type, GLuint name);
+
+  // Called by the render thread after the commands of a frame
+  void EndFrame();
+
+  // Waits for the GPU and deletes every object enqueued so far, before the GL context goes away
+  void Flush();
+
+  // Objects enqueued and not deleted yet
+  size_t GetBacklog() const {
+    return backlog_;
+  }
+
+  // Objects deleted by the last EndFrame and the time it took
+  size_t GetLastDeletedCount() const {
+    return last_deleted_count_;
+  }
+
+  float GetLastDeletionMs() const {
+    return last_deletion_ms_;
+  }
+
+private:
+  struct Batch {
+    GLsync fence = nullptr;
+    std::array<std::vector<GLuint>, static_cast<size_t>(ObjectType::kCount)> names;
+    size_t count = 0;
+  };
+
+  // Takes the names enqueued so far as a new batch, fenced after the commands issued until now
+  void FenceEnqueued();
+  // Returns the number of objects deleted
+  size_t Delete(Batch &batch, bool release);
+
+  std::mutex mutex_;
+  Batch enqueued_;
+  // Render thread only, oldest first
+  std::deque<Batch> batches_;
+  std::atomic<size_t> backlog_{0};
+  size_t last_deleted_count_ = 0;
+  float last_deletion_ms_ = 0.f;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -30,8 +30,11 @@ static inline uint64_t GetGLTypeSize(GLint type) {
     case GL_FLOAT_VEC2: size = 8; break;
     case GL_FLOAT_VEC3: size = 12; break;
     case GL_FLOAT_VEC4: size = 16; break;
+    case GL_INT_VEC4: size = 16; break;
     case GL_FLOAT_MAT4: size = 64; break;
     case GL_SAMPLER_2D: size = 0; break;
+    case GL_SAMPLER_BUFFER: size = 0; break;
+    case GL_UNSIGNED_INT_SAMPLER_BUFFER: size = 0; break;
 #ifdef ML_LUMIN
     case GL_SAMPLER_EXTERNAL_OES: size = 0; break;
 #endif
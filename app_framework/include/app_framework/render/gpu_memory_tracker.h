@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Bytes of GPU memory held by the GL objects of the framework, by category and by label.
+//
+// Every wrapper of a GL object with storage reports its size when it (re)allocates and releases it in its
+// destructor, keyed by its own address. A label attributes an object to what it belongs to, e.g. the path of the
+// asset a mesh was loaded from or the node of a sample, objects without one count as unlabeled.
+//
+// An optional budget turns the totals into a signal: features register callbacks at fractions of the budget, called
+// when the usage crosses them in either direction, so they can shed quality instead of running out of memory. The
+// sizes are what was asked of GL, the driver may pad or keep orphaned storage a little longer.
+class GpuMemoryTracker final {
+public:
+  enum class Category { kVertexBuffer, kIndexBuffer, kUniformBuffer, kTexture, kRenderTarget, kStaging, kOther, kCount };
+
+  // Called with the usage and the budget when the usage goes over the threshold of the callback, exceeded true, or
+  // back under it, exceeded false
+  using ThresholdCallback = std::function<void(bool exceeded, uint64_t usage, uint64_t budget)>;
+
+  GpuMemoryTracker() = default;
+  ~GpuMemoryTracker() = default;
+
+  // This class should neither be copyable or movable
+  GpuMemoryTracker(const GpuMemoryTracker &) = delete;
+  GpuMemoryTracker(GpuMemoryTracker &&) = delete;
+  GpuMemoryTracker &operator=(const GpuMemoryTracker &) = delete;
+  GpuMemoryTracker &operator=(GpuMemoryTracker &&) = delete;
+
+  static const char *GetCategoryName(Category category);
+
+  // Sets the bytes an object holds, replacing what it reported before. Thread safe, like the other methods.
+  void Update(const void *owner, Category category, uint64_t bytes);
+  // Forgets an object and its label
+  void Release(const void *owner);
+  void SetLabel(const void *owner, const std::string &label);
+
+  uint64_t GetUsage(Category category);
+  uint64_t GetTotalUsage();
+  // Bytes of every label, largest first
+  std::vector<std::pair<std::string, uint64_t>> GetLabelUsage();
+
+  // 0 for no budget, the default. The callbacks only run with a budget.
+  void SetBudget(uint64_t bytes);
+  uint64_t GetBudget();
+  // Bytes left under the budget, 0 when over it or when there is no budget
+  uint64_t GetHeadroom();
+
+  // Calls callback when the usage crosses fraction of the budget, returns an ID for RemoveThresholdCallback
+  uint32_t AddThresholdCallback(float fraction, ThresholdCallback callback);
+  void RemoveThresholdCallback(uint32_t id);
+  // Runs the callbacks of the thresholds crossed since the last call. Called once per frame by the Application.
+  void DispatchCallbacks();
+
+  // Usage by category and label, one line each
+  std::string Dump();
+
+private:
+  struct Allocation {
+    Category category = Category::kOther;
+    uint64_t bytes = 0;
+    std::string label;
+  };
+
+  struct Threshold {
+    uint32_t id;
+    float fraction;
+    ThresholdCallback callback;
+    bool exceeded;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<const void *, Allocation> allocations_;
+  uint64_t category_usage_[static_cast<size_t>(Category::kCount)] = {};
+  uint64_t total_usage_ = 0;
+  uint64_t budget_ = 0;
+  std::vector<Threshold> thresholds_;
+  uint32_t next_threshold_id_ = 1;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,39 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <array>
+
+namespace ml {
+namespace app_framework {
+
+// Measures GPU time of a span of GL commands with GL_TIME_ELAPSED queries. Queries are kept in a small ring so
+// that reading a result never stalls on the GPU; results arrive a few frames late.
+class GpuTimer final {
+public:
+  GpuTimer();
+  ~GpuTimer();
+
+  void Begin();
+  void End();
+
+  // Returns true and the most recent finished measurement, if one became available since the last call
+  bool Poll(uint64_t &elapsed_ns);
+
+private:
+  static constexpr size_t kQueryCount = 4;
+  std::array<GLuint, kQueryCount> queries_;
+  size_t next_query_ = 0;
+  size_t pending_ = 0;
+  bool active_ = false;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,22 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+
+#include <cstddef>
+
+namespace ml {
+namespace app_framework {
+
+// Mixes the hash of one more member into the hash of a description, as boost::hash_combine does
+inline void HashCombine(size_t &seed, size_t value) {
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -16,7 +16,7 @@ namespace app_framework {
 class IndexBuffer final : public Buffer {
 public:
   IndexBuffer(Buffer::Category category, GLint type)
-      : Buffer(category, GL_ELEMENT_ARRAY_BUFFER), type_(type), index_cnt_(0) {
+      : Buffer(category, GL_ELEMENT_ARRAY_BUFFER), type_(type) {
     switch (type) {
       case GL_UNSIGNED_BYTE: index_size_ = 1; break;
       case GL_UNSIGNED_SHORT: index_size_ = 2; break;
@@ -26,11 +26,6 @@ public:
   }
   ~IndexBuffer() = default;
 
-  void UpdateBuffer(const char *data, uint64_t size) override {
-    Buffer::UpdateBuffer(data, size);
-    index_cnt_ = size / index_size_;
-  }
-
   GLint GetIndexType() const {
     return type_;
   }
@@ -40,13 +35,12 @@ public:
   }
 
   uint64_t GetIndexCount() const {
-    return index_cnt_;
+    return GetSize() / index_size_;
   }
 
 private:
   GLint type_;
   uint64_t index_size_;
-  uint64_t index_cnt_;
 };
 }
 }
@@ -0,0 +1,154 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <memory>
+#include <vector>
+
+#include <app_framework/common.h>
+#include <app_framework/components/camera_component.h>
+#include <app_framework/components/light_component.h>
+#include "program.h"
+
+namespace ml {
+namespace app_framework {
+
+// Light as the shaders read it, three texels of the ClusterLights texture buffer
+struct Light {
+  Light() {}
+  Light(
+    const glm::vec3& in_light_position,
+    const glm::vec3& in_light_color,
+    const glm::vec3& in_light_direction,
+    LightType type,
+    float strength,
+    float range)
+    : light_position(in_light_position),
+      light_strength(strength),
+      light_direction(in_light_direction),
+      light_type((float)type),
+      light_color(in_light_color),
+      light_range(range) {}
+  glm::vec3 light_position;
+  float light_strength;
+  glm::vec3 light_direction;
+  float light_type;
+  glm::vec3 light_color;
+  // Distance at which a point light fades out, its influence is windowed to zero there
+  float light_range;
+};
+
+// Clusters uniform block, the view of the camera and how fragments map to clusters
+struct ClustersUBO {
+  glm::mat4 view;
+  glm::vec4 viewport;
+  // x: slice scale, y: slice bias. The slice of a view depth d is log(d) * scale + bias.
+  glm::vec4 depth_params;
+  // x, y: tiles, z: depth slices, w: number of directional lights
+  glm::ivec4 grid;
+};
+
+// Clustered forward light assignment.
+//
+// The view frustum of every camera is split into kTilesX * kTilesY screen tiles and kSlices exponential depth
+// slices. Each frame the point lights are tested against the bounding boxes of the clusters on the CPU, four
+// lights at a time with SIMD and one depth slice per job of the job system. The result is a compact list of light
+// indices per cluster, so a fragment only loops over the lights that can reach it. Directional lights reach every
+// cluster, they are stored first in the light list and not assigned.
+//
+// The lights, the cluster ranges and the light indices are texture buffers, bound to the last texture units so
+// they don't collide with the material textures.
+class LightClusters final {
+public:
+  static constexpr uint32_t kTilesX = 16;
+  static constexpr uint32_t kTilesY = 8;
+  static constexpr uint32_t kSlices = 24;
+  static constexpr uint32_t kClusterCount = kTilesX * kTilesY * kSlices;
+
+  LightClusters();
+  ~LightClusters();
+
+  // This class should neither be copyable or movable
+  LightClusters(const LightClusters&) = delete;
+  LightClusters(LightClusters&&) = delete;
+  LightClusters& operator=(const LightClusters&) = delete;
+  LightClusters& operator=(LightClusters&&) = delete;
+
+  // View depth range the slices cover. Fragments outside of it use the first or the last slice.
+  void SetDepthRange(float near_depth, float far_depth);
+
+  float GetNearDepth() const {
+    return near_depth_;
+  }
+
+  float GetFarDepth() const {
+    return far_depth_;
+  }
+
+  // Assigns the lights to the clusters of every camera, on the job system when there is one. Doesn't make GL calls.
+  void Assign(const std::vector<std::shared_ptr<CameraComponent>> &cameras, const std::vector<Light> &lights);
+  // Uploads the lights and the clusters of every camera assigned last
+  void Upload();
+
+  // Binds the Clusters block and the cluster textures of a camera to the program, if it uses them
+  void Bind(const Program &program, size_t camera_index) const;
+
+  // Light indices of every cluster of a camera, i.e. the sum of the lights per cluster
+  size_t GetLightIndexCount(size_t camera_index) const;
+
+private:
+  // Point lights of a depth slice, in view space. The arrays are padded to a multiple of 4 lights.
+  struct SliceLights {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius_sq;
+    std::vector<uint16_t> index;
+  };
+
+  struct CameraClusters {
+    ClustersUBO ubo;
+    // View space direction through every tile corner, scaled to a view depth of 1
+    std::vector<glm::vec3> corner_rays;
+    // Offset and count of the light indices of each cluster
+    std::vector<glm::uvec2> ranges;
+    std::vector<uint16_t> indices;
+    std::vector<SliceLights> slice_lights;
+    std::vector<std::vector<uint16_t>> slice_indices;
+
+    GLuint uniform_buffer = 0;
+    GLuint range_buffer = 0;
+    GLuint range_texture = 0;
+    GLuint index_buffer = 0;
+    GLuint index_texture = 0;
+    size_t index_capacity = 0;
+  };
+
+  void PrepareCamera(const CameraComponent &camera, CameraClusters &clusters);
+  void AssignSlice(CameraClusters &clusters, uint32_t slice);
+  float GetSliceDepth(uint32_t slice) const;
+
+  float near_depth_;
+  float far_depth_;
+
+  std::vector<std::unique_ptr<CameraClusters>> cameras_;
+  size_t camera_count_;
+
+  std::vector<Light> lights_;
+  // Point lights in world space, after the directional ones in lights_
+  std::vector<glm::vec4> point_lights_;
+  uint32_t directional_light_count_;
+
+  GLuint light_buffer_;
+  GLuint light_texture_;
+  size_t light_capacity_;
+  GLint texture_unit_base_;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -7,72 +7,179 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
+#include <cstring>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include <app_framework/common.h>
 #include "fragment_program.h"
 #include "geometry_program.h"
-#include "variable.h"
+#include "material_template.h"
+#include "texture.h"
 #include "vertex_program.h"
 
 namespace ml {
 namespace app_framework {
 
-#define MATERIAL_VARIABLE_DECLARE(type, name) \
-  inline void Set##name(const type &value) {  \
-    auto variable = GetVariable(#name);       \
-    if (variable) variable->SetValue(value);  \
-    dirty_ = true;                            \
-  }                                           \
-  inline type Get##name() const {             \
-    auto variable = GetVariable(#name);       \
-    if (!variable) return type();             \
-    return variable->GetValue<type>();        \
+// Declares Set<name>/Get<name> for a parameter of the material. The parameter is looked up by name on first use
+// and whenever the material switches to a program with another layout, every other access goes straight to its
+// offset in the material's parameter block. Parameters the template doesn't have, including all of them while its
+// programs are compiling, are kept by name.
+#define MATERIAL_VARIABLE_DECLARE(type, name)                                     \
+  inline void Set##name(const type &value) {                                      \
+    SetParameter(ResolveParameter(name##_parameter_, #name), #name, value);       \
+  }                                                                               \
+  inline type Get##name() const {                                                 \
+    return GetParameter<type>(ResolveParameter(name##_parameter_, #name), #name); \
+  }                                                                               \
+  mutable MaterialParameter name##_parameter_
+
+// Handle to a parameter of a material: the byte offset of a member of its std140 Material block, or the texture
+// slot of a sampler, tagged with the GL type the program declares it with
+struct MaterialParameter {
+  uint32_t offset = 0;
+  GLenum type = GL_NONE;
+  // Layout of the material the handle was resolved against
+  uint32_t layout = 0;
+
+  bool IsValid() const {
+    return type != GL_NONE;
   }
+};
+
+// GL type of the C++ types that parameters can be set with
+template <typename ValueType>
+struct MaterialParameterType;
 
-// The shading information that is required for rendering
+#define MATERIAL_PARAMETER_TYPE_DECLARE(value_type, gl_type) \
+  template <>                                                \
+  struct MaterialParameterType<value_type> {                 \
+    static GLenum GetGLType() {                              \
+      return gl_type;                                        \
+    }                                                        \
+  };
+
+MATERIAL_PARAMETER_TYPE_DECLARE(bool, GL_BOOL)
+MATERIAL_PARAMETER_TYPE_DECLARE(float, GL_FLOAT)
+MATERIAL_PARAMETER_TYPE_DECLARE(int32_t, GL_INT)
+MATERIAL_PARAMETER_TYPE_DECLARE(glm::vec2, GL_FLOAT_VEC2)
+MATERIAL_PARAMETER_TYPE_DECLARE(glm::vec3, GL_FLOAT_VEC3)
+MATERIAL_PARAMETER_TYPE_DECLARE(glm::vec4, GL_FLOAT_VEC4)
+MATERIAL_PARAMETER_TYPE_DECLARE(glm::mat4, GL_FLOAT_MAT4)
+
+// The shading information that is required for rendering. A material is an instance of a MaterialTemplate: it
+// only owns its parameter values, its range of the MaterialParameterArena and its textures, so creating or copying
+// one allocates no GL objects.
 class Material {
 public:
   Material() : dirty_(true) {}
+  explicit Material(std::shared_ptr<MaterialTemplate> material_template);
   Material(const Material& rhs);
   virtual ~Material();
 
+  std::shared_ptr<MaterialTemplate> GetTemplate() const {
+    return template_;
+  }
+
   std::shared_ptr<VertexProgram> GetVertexProgram() const {
-    return vert_;
+    return template_ ? template_->GetVertexProgram() : nullptr;
   }
   std::shared_ptr<GeometryProgram> GetGeometryProgram() const {
-    return geom_;
+    return template_ ? template_->GetGeometryProgram() : nullptr;
   }
   std::shared_ptr<FragmentProgram> GetFragmentProgram() const {
-    return frag_;
+    return template_ ? template_->GetFragmentProgram() : nullptr;
+  }
+
+  // Returns false while the programs of the template are compiling, the renderer draws with a fallback material
+  // meanwhile. The first call that finds them ready builds the parameter block from the values set so far.
+  bool IsReady();
+
+  // Generic material property interface. Resolve a parameter once and keep the handle, it stays valid until the
+  // material switches to another template. Parameters the program doesn't use, or all of them while the material
+  // isn't ready, give an invalid handle, setting it does nothing.
+  MaterialParameter FindParameter(const std::string &name) const;
+
+  inline const MaterialParameter &ResolveParameter(MaterialParameter &cached, const char *name) const {
+    if (cached.layout != GetLayout()) {
+      cached = FindParameter(name);
+    }
+    return cached;
   }
 
-  // Generic material property interface
-  inline std::shared_ptr<Variable> GetVariable(const std::string &name) const {
-    auto it = variables_by_name_.find(name);
-    if (it == variables_by_name_.end()) {
-      return nullptr;
+  template <typename ValueType>
+  void SetParameter(const MaterialParameter &parameter, const ValueType &value) {
+    if (!parameter.IsValid()) {
+      return;
     }
-    return it->second;
+    CheckParameter(parameter, MaterialParameterType<ValueType>::GetGLType(), sizeof(ValueType));
+    memcpy(parameters_.data() + parameter.offset, &value, sizeof(ValueType));
+    dirty_ = true;
   }
 
-  void SetVertexProgram(std::shared_ptr<VertexProgram> program) {
-    vert_ = program;
+  void SetParameter(const MaterialParameter &parameter, const std::shared_ptr<Texture> &texture);
+
+  template <typename ValueType>
+  ValueType GetParameter(const MaterialParameter &parameter) const {
+    ValueType value{};
+    if (parameter.IsValid()) {
+      CheckParameter(parameter, MaterialParameterType<ValueType>::GetGLType(), sizeof(ValueType));
+      memcpy(&value, parameters_.data() + parameter.offset, sizeof(ValueType));
+    }
+    return value;
   }
-  void SetGeometryProgram(std::shared_ptr<GeometryProgram> program) {
-    geom_ = program;
+
+  // Same as above, but an invalid handle keeps the value by name until a template has the parameter
+  template <typename ValueType>
+  void SetParameter(const MaterialParameter &parameter, const char *name, const ValueType &value) {
+    if (parameter.IsValid()) {
+      SetParameter(parameter, value);
+    } else {
+      SetInactiveParameter(name, MaterialParameterType<ValueType>::GetGLType(), &value, sizeof(ValueType));
+    }
   }
-  void SetFragmentProgram(std::shared_ptr<FragmentProgram> program) {
-    frag_ = program;
-    BuildVariables();
+
+  void SetParameter(const MaterialParameter &parameter, const char *name, const std::shared_ptr<Texture> &texture);
+
+  template <typename ValueType>
+  ValueType GetParameter(const MaterialParameter &parameter, const char *name) const {
+    if (parameter.IsValid()) {
+      return GetParameter<ValueType>(parameter);
+    }
+    ValueType value{};
+    GetInactiveParameter(name, MaterialParameterType<ValueType>::GetGLType(), &value, sizeof(ValueType));
+    return value;
   }
 
+  // Switching the template keeps the values of the parameters, including the ones the new template doesn't use,
+  // so a material can move between variants of a shader without losing its properties
+  void SetTemplate(std::shared_ptr<MaterialTemplate> material_template);
+
+  // Switch to the template of the current programs with one of them replaced
+  void SetVertexProgram(std::shared_ptr<VertexProgram> program);
+  void SetGeometryProgram(std::shared_ptr<GeometryProgram> program);
+  void SetFragmentProgram(std::shared_ptr<FragmentProgram> program);
+
+  // Called by the renderer before the programs of the material are bound, materials that pick a shader variant
+  // from their properties do so here
+  virtual void ResolveProgram() {}
+
+  void MarkDirty() {
+    dirty_ = true;
+  }
+
+  // Copies the parameter block into the material's range of the MaterialParameterArena, if it changed
   void UpdateMaterialUniformBuffer();
   void UpdateMaterialUniforms();
 
-  GLuint GetGLUniformBuffer() {
-    return uniform_buffer_;
+  // Range of the MaterialParameterArena buffer holding the Material block, size is 0 without a Material block
+  uint32_t GetParameterOffset() const {
+    return parameter_offset_;
+  }
+
+  uint32_t GetParameterSize() const {
+    return parameter_size_;
   }
 
   GLenum GetPolygonMode() {
@@ -80,7 +187,9 @@ public:
   }
 
   GLenum SetPolygonMode(GLenum polygon_mode) {
-    return polygon_mode_ = polygon_mode;
+    polygon_mode_ = polygon_mode;
+    UpdatePipelineState();
+    return polygon_mode_;
   }
 
   bool AlphaBlendingEnabled() {
@@ -88,26 +197,114 @@ public:
   }
 
   bool EnableAlphaBlending(bool enabled) {
-    return alpha_blending_enabled_ = enabled;
+    alpha_blending_enabled_ = enabled;
+    UpdatePipelineState();
+    return alpha_blending_enabled_;
+  }
+
+  bool DepthWriteEnabled() const {
+    return depth_write_enabled_;
+  }
+
+  bool EnableDepthWrite(bool enabled) {
+    depth_write_enabled_ = enabled;
+    UpdatePipelineState();
+    return depth_write_enabled_;
+  }
+
+  // ID in the PipelineStateCache of the programs and the raster, blend and depth state of the material, updated
+  // whenever one of them changes. Materials with the same ID can be drawn without any state change in between.
+  uint32_t GetPipelineState() const {
+    return pipeline_state_;
   }
 
 protected:
   bool dirty_;
 private:
-  void BuildVariables();
+  // Value of a parameter that the current template doesn't have, restored if a later template has it again
+  struct InactiveParameter {
+    GLenum type;
+    std::vector<char> value;
+    std::shared_ptr<Texture> texture;
+  };
+
+  // Layout the parameter block was built for, 0 until the template is ready
+  uint32_t GetLayout() const {
+    return layout_;
+  }
 
-  std::shared_ptr<FragmentProgram> frag_;
-  std::shared_ptr<GeometryProgram> geom_;
-  std::shared_ptr<VertexProgram> vert_;
+  void UpdatePipelineState();
+  // Sets the <sampler>Layer member of the Material block, if there is one, to the layer of the texture of a unit
+  void UpdateTextureLayer(size_t unit);
+  void CheckParameter(const MaterialParameter &parameter, GLenum type, size_t size) const;
+  void SetInactiveParameter(const char *name, GLenum type, const void *value, size_t size);
+  void GetInactiveParameter(const char *name, GLenum type, void *value, size_t size) const;
+  // Builds the parameter block and the texture units of a ready template from the inactive parameters
+  void RestoreParameters();
 
-  std::unordered_map<std::string, std::shared_ptr<Variable>> variables_by_name_;
-  GLuint uniform_buffer_;
-  std::vector<char> ubo_cache_;
-  UniformBlockDescription blk_desc_;
-  std::vector<UniformDescription> textures_des_;
+  std::shared_ptr<MaterialTemplate> template_;
+  // CPU copy of the std140 Material block of the template
+  std::vector<char> parameters_;
+  // Texture of each texture unit of the template
+  std::vector<std::shared_ptr<Texture>> textures_;
+  std::unordered_map<std::string, InactiveParameter> inactive_parameters_;
+  uint32_t layout_ = 0;
+  uint32_t parameter_offset_ = 0;
+  uint32_t parameter_size_ = 0;
 
   bool alpha_blending_enabled_ = false;
+  bool depth_write_enabled_ = true;
   GLint polygon_mode_ = GL_FILL;
+  uint32_t pipeline_state_ = 0;
 };
+
+// std140 stores bools in 32 bits
+template <>
+inline void Material::SetParameter<bool>(const MaterialParameter &parameter, const bool &value) {
+  if (!parameter.IsValid()) {
+    return;
+  }
+  CheckParameter(parameter, GL_BOOL, sizeof(uint32_t));
+  uint32_t std140_value = value ? 1 : 0;
+  memcpy(parameters_.data() + parameter.offset, &std140_value, sizeof(std140_value));
+  dirty_ = true;
+}
+
+template <>
+inline bool Material::GetParameter<bool>(const MaterialParameter &parameter) const {
+  uint32_t std140_value = 0;
+  if (parameter.IsValid()) {
+    CheckParameter(parameter, GL_BOOL, sizeof(uint32_t));
+    memcpy(&std140_value, parameters_.data() + parameter.offset, sizeof(std140_value));
+  }
+  return std140_value != 0;
+}
+
+template <>
+inline void Material::SetParameter<bool>(const MaterialParameter &parameter, const char *name, const bool &value) {
+  if (parameter.IsValid()) {
+    SetParameter(parameter, value);
+  } else {
+    uint32_t std140_value = value ? 1 : 0;
+    SetInactiveParameter(name, GL_BOOL, &std140_value, sizeof(std140_value));
+  }
+}
+
+template <>
+inline bool Material::GetParameter<bool>(const MaterialParameter &parameter, const char *name) const {
+  if (parameter.IsValid()) {
+    return GetParameter<bool>(parameter);
+  }
+  uint32_t std140_value = 0;
+  GetInactiveParameter(name, GL_BOOL, &std140_value, sizeof(std140_value));
+  return std140_value != 0;
+}
+
+template <>
+std::shared_ptr<Texture> Material::GetParameter<std::shared_ptr<Texture>>(const MaterialParameter &parameter) const;
+
+template <>
+std::shared_ptr<Texture> Material::GetParameter<std::shared_ptr<Texture>>(const MaterialParameter &parameter,
+                                                                          const char *name) const;
 }
 }
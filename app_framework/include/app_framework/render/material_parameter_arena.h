@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// A single uniform buffer holding the Material blocks of all the materials. Every material owns a std140 range of
+// it, aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, and writes its parameters into the CPU copy. The ranges
+// written since the last Flush are tracked per alignment unit and uploaded together once per frame, the renderer
+// binds each material with glBindBufferRange.
+class MaterialParameterArena final {
+public:
+  MaterialParameterArena() = default;
+  ~MaterialParameterArena();
+
+  // This class should neither be copyable or movable
+  MaterialParameterArena(const MaterialParameterArena &) = delete;
+  MaterialParameterArena(MaterialParameterArena &&) = delete;
+  MaterialParameterArena &operator=(const MaterialParameterArena &) = delete;
+  MaterialParameterArena &operator=(MaterialParameterArena &&) = delete;
+
+  // Returns the offset of a new range of at least size bytes, the arena grows when it's full
+  uint32_t Allocate(uint32_t size);
+  void Free(uint32_t offset, uint32_t size);
+
+  char *GetData(uint32_t offset) {
+    return data_.data() + offset;
+  }
+
+  void MarkDirty(uint32_t offset, uint32_t size);
+
+  // Uploads the dirty ranges, to be called once all the materials of the frame are packed
+  void Flush();
+
+  GLuint GetGLBuffer() const {
+    return gl_buffer_;
+  }
+
+  uint32_t GetCapacity() const {
+    return static_cast<uint32_t>(data_.size());
+  }
+
+  // Bytes and ranges uploaded by the last Flush
+  uint32_t GetLastUploadBytes() const {
+    return last_upload_bytes_;
+  }
+
+  uint32_t GetLastUploadRanges() const {
+    return last_upload_ranges_;
+  }
+
+private:
+  struct FreeRange {
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  static constexpr uint32_t kInitialCapacity = 64 * 1024;
+
+  uint32_t GetAlignment();
+  void Grow(uint32_t min_capacity);
+
+  std::vector<char> data_;
+  std::vector<FreeRange> free_ranges_;
+  // One bit per alignment unit of data_
+  std::vector<uint64_t> dirty_bits_;
+  uint32_t alignment_ = 0;
+  GLuint gl_buffer_ = 0;
+  uint32_t gl_buffer_size_ = 0;
+  uint32_t last_upload_bytes_ = 0;
+  uint32_t last_upload_ranges_ = 0;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <app_framework/common.h>
+#include "fragment_program.h"
+#include "geometry_program.h"
+#include "vertex_program.h"
+
+namespace ml {
+namespace app_framework {
+
+// The part of a material shared by all the materials using the same programs: the programs, the layout of the
+// Material block and the texture unit of every sampler. Templates are cached by the ResourcePool, so the sampler
+// units are set up once per template and creating a material instance makes no GL calls.
+//
+// A template of programs that are still compiling asynchronously is pending: its layout is unknown until IsReady
+// returns true.
+class MaterialTemplate final {
+public:
+  struct TextureUnit {
+    std::string name;
+    GLenum type;
+  };
+
+  MaterialTemplate(std::shared_ptr<VertexProgram> vert, std::shared_ptr<GeometryProgram> geom,
+                   std::shared_ptr<FragmentProgram> frag);
+  ~MaterialTemplate() = default;
+
+  // This class should neither be copyable or movable
+  MaterialTemplate(const MaterialTemplate &) = delete;
+  MaterialTemplate(MaterialTemplate &&) = delete;
+  MaterialTemplate &operator=(const MaterialTemplate &) = delete;
+  MaterialTemplate &operator=(MaterialTemplate &&) = delete;
+
+  std::shared_ptr<VertexProgram> GetVertexProgram() const {
+    return vert_;
+  }
+  std::shared_ptr<GeometryProgram> GetGeometryProgram() const {
+    return geom_;
+  }
+  std::shared_ptr<FragmentProgram> GetFragmentProgram() const {
+    return frag_;
+  }
+
+  // Returns true once all the programs are ready, the first call that finds them ready reflects the layout
+  bool IsReady();
+
+  // Identifies the parameter layout, unique among all templates, 0 while the template is pending
+  uint32_t GetLayout() const {
+    return layout_;
+  }
+
+  const UniformBlockDescription &GetBlockDescription() const {
+    return blk_desc_;
+  }
+
+  const std::vector<TextureUnit> &GetTextureUnits() const {
+    return texture_units_;
+  }
+
+private:
+  void Reflect();
+
+  static std::atomic<uint32_t> sNextLayout;
+
+  std::shared_ptr<VertexProgram> vert_;
+  std::shared_ptr<GeometryProgram> geom_;
+  std::shared_ptr<FragmentProgram> frag_;
+  uint32_t layout_;
+  UniformBlockDescription blk_desc_;
+  std::vector<TextureUnit> texture_units_;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -10,9 +10,13 @@
 #include <unordered_map>
 
 #include <app_framework/common.h>
+#include <app_framework/render/geometry_arena.h>
 #include <app_framework/render/index_buffer.h>
+#include <app_framework/render/upload_manager.h>
 #include <app_framework/render/vertex_buffer.h>
+#include <app_framework/render/vertex_layout.h>
 
+#include <string>
 #include <vector>
 
 namespace ml {
@@ -20,11 +24,13 @@ namespace app_framework {
 
 class ResourcePool;
 
-// Geometry data
+// Geometry data. The positions, normals and texture coordinates are interleaved in one vertex buffer in the formats
+// of the VertexLayout, custom attributes have buffers of their own.
 class Mesh : public RuntimeType {
   RUNTIME_TYPE_REGISTER(Mesh)
 public:
-  Mesh(Buffer::Category buffer_category, GLenum index_buffer_element_type = GL_UNSIGNED_INT);
+  Mesh(Buffer::Category buffer_category, GLenum index_buffer_element_type = GL_UNSIGNED_INT,
+       const VertexLayout &vertex_layout = VertexLayout());
   Mesh(const Mesh &other) = delete;
   Mesh &operator=(const Mesh &other) = delete;
   virtual ~Mesh();
@@ -34,26 +40,105 @@ public:
   void UpdateMesh(glm::vec3 const *vertices, glm::vec3 const *normals, size_t num_vertices, void const *indices,
       size_t num_indices);
 
-  void UpdateTexCoordsBuffer(glm::vec2 const *tex_coords);
+  // Replaces all the vertices, the attributes passed as null are disabled
+  void UpdateVertices(glm::vec3 const *vertices, glm::vec3 const *normals, glm::vec2 const *tex_coords,
+                      size_t num_vertices);
+
+  void UpdateIndices(void const *indices, size_t num_indices);
+
+  // Like UpdateMesh, but the vertices and indices are copied by the UploadManager together with the other copies
+  // passed, and the mesh draws its previous geometry, with its previous bounding sphere, until they are. Buffers
+  // that have to grow are reallocated when the copies land. Quantized positions are updated right away, their
+  // dequantization has to change with the data.
+  void UpdateMeshStaged(glm::vec3 const *vertices, glm::vec3 const *normals, size_t num_vertices,
+                        void const *indices, size_t num_indices,
+                        std::vector<UploadManager::BufferCopy> copies = std::vector<UploadManager::BufferCopy>());
+
+  // Like UpdateVertices and UpdateIndices, but the geometry goes to the GeometryArena instead of the buffers of the
+  // mesh: it's drawn from the vertex array shared with the other meshes of its layout, with a base vertex. For
+  // geometry that doesn't change, custom buffers can't be added to the shared vertex array. Updating the geometry
+  // any other way moves the mesh back to its own buffers. Returns false, leaving the mesh as it was, if the arena has
+  // no room for it.
+  bool UpdateMeshInArena(glm::vec3 const *vertices, glm::vec3 const *normals, glm::vec2 const *tex_coords,
+                         size_t num_vertices, uint32_t const *indices, size_t num_indices);
+
+  bool IsInArena() const {
+    return arena_allocation_ != nullptr;
+  }
+
+  const VertexLayout &GetVertexLayout() const {
+    return vertex_layout_;
+  }
+
+  // Transform from the quantized positions to model space, to apply before the model transform. Identity
+  // unless the positions are quantized.
+  glm::mat4 GetPositionDequantization() const;
+
+  // Sphere around the positions last updated, center (xyz) and radius (w) in model space
+  const glm::vec4 &GetBoundingSphere() const {
+    return bounding_sphere_;
+  }
+
+  // How far the surface of a simplified level of detail may be from the original one, in model space
+  void SetSimplificationError(float simplification_error) {
+    simplification_error_ = simplification_error;
+  }
+
+  float GetSimplificationError() const {
+    return simplification_error_;
+  }
+
+  // What the buffers of this mesh, custom ones included, are accounted to in the GpuMemoryTracker
+  void SetMemoryLabel(const std::string &label);
+
+  bool HasOctahedralNormals() const {
+    return vertex_layout_.GetNormalFormat() == VertexLayout::NormalFormat::kOctahedral16;
+  }
+
+  // Bytes of the vertex and index buffers, or of the ranges of the arena, without the custom buffers
+  uint64_t GetBufferSize() const {
+    if (arena_allocation_) {
+      return static_cast<uint64_t>(arena_allocation_->vertex_count) * vertex_layout_.GetStride() +
+             static_cast<uint64_t>(arena_allocation_->index_count) * arena_allocation_->page->index_size;
+    }
+    return vertex_buffer_->GetSize() + index_buffer_->GetSize();
+  }
 
   bool UsesIndexedRendering() const {
-    return GL_POINTS == primitive_type_ || !index_buffer_ || index_buffer_->GetIndexCount() == 0;
+    return GL_POINTS == primitive_type_ || GetNumIndices() == 0;
   }
 
   GLuint GetNumVertices() const {
-    return num_vertices_;
+    if (arena_allocation_) {
+      return arena_allocation_->vertex_count;
+    }
+    return static_cast<GLuint>(vertex_buffer_->GetSize() / vertex_layout_.GetStride());
   }
 
-  GLuint GetNumIndices() {
+  GLuint GetNumIndices() const {
+    if (arena_allocation_) {
+      return arena_allocation_->index_count;
+    }
     return index_buffer_->GetIndexCount();
   }
 
   GLenum GetIndexType() const {
-    return index_buffer_->GetIndexType();
+    return arena_allocation_ ? arena_allocation_->page->index_type : index_buffer_->GetIndexType();
   }
 
-  GLuint GetVertexArrayObject() {
-    return gl_vertex_array_;
+  // Vertex the indices are relative to and byte offset of the first index, in the buffers of the vertex array
+  GLint GetBaseVertex() const {
+    return arena_allocation_ ? static_cast<GLint>(arena_allocation_->first_vertex) : 0;
+  }
+
+  uintptr_t GetIndexOffset() const {
+    return arena_allocation_ ? static_cast<uintptr_t>(arena_allocation_->first_index) *
+                                   arena_allocation_->page->index_size
+                             : 0;
+  }
+
+  GLuint GetVertexArrayObject() const {
+    return arena_allocation_ ? arena_allocation_->page->vertex_array : gl_vertex_array_;
   }
 
   GLint GetPrimitiveType() const {
@@ -73,17 +158,26 @@ public:
   }
 
 private:
-  std::shared_ptr<VertexBuffer> normal_buffer_;
+  void EnableAttributes(bool positions, bool normals, bool tex_coords);
+  static glm::vec4 ComputeBoundingSphere(glm::vec3 const *vertices, size_t num_vertices);
+
+  VertexLayout vertex_layout_;
+  std::shared_ptr<Buffer> vertex_buffer_;
   std::shared_ptr<IndexBuffer> index_buffer_;
-  std::shared_ptr<VertexBuffer> vert_buffer_;
-  std::shared_ptr<VertexBuffer> tex_coords_buffer_;
+  // Offset (xyz) and scale (w) of the quantized positions
+  glm::vec4 position_dequantization_;
+  glm::vec4 bounding_sphere_;
+  float simplification_error_ = 0.f;
   GLint primitive_type_ = GL_TRIANGLES;
   GLfloat point_size_ = 1.f;
 
   GLuint gl_vertex_array_ = 0;
-  GLsizeiptr num_vertices_ = 0;
 
   std::vector<std::shared_ptr<VertexBuffer>> custom_buffers_;
+  std::string memory_label_;
+  std::shared_ptr<GeometryArena::Allocation> arena_allocation_;
+  // Lets the staged updates that land after the mesh is deleted find out
+  std::shared_ptr<Mesh *> upload_target_;
 };
 }  // namespace app_framework
 }  // namespace ml
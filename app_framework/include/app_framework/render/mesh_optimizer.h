@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Load time optimizations of indexed triangle lists. They change the order of the triangles and of the vertices,
+// not the geometry, so they are meant for meshes loaded once and drawn many times.
+
+// Post-transform vertex cache efficiency of a triangle list, simulated with a FIFO cache
+struct VertexCacheStatistics {
+  size_t triangle_count = 0;
+  // Vertices referenced by the indices
+  size_t vertex_count = 0;
+  // Vertices transformed, i.e. cache misses
+  size_t transformed_count = 0;
+
+  // Average cache miss ratio, vertices transformed per triangle. 0.5 at best for a regular grid, 3 at worst.
+  float GetACMR() const {
+    return triangle_count ? static_cast<float>(transformed_count) / triangle_count : 0.f;
+  }
+
+  // Average transform to vertex ratio, how many times each vertex is transformed. 1 at best.
+  float GetATVR() const {
+    return vertex_count ? static_cast<float>(transformed_count) / vertex_count : 0.f;
+  }
+
+  VertexCacheStatistics &operator+=(const VertexCacheStatistics &rhs) {
+    triangle_count += rhs.triangle_count;
+    vertex_count += rhs.vertex_count;
+    transformed_count += rhs.transformed_count;
+    return *this;
+  }
+};
+
+// Statistics of the meshes of an asset, before and after the optimizations
+struct MeshOptimizationStatistics {
+  size_t mesh_count = 0;
+  VertexCacheStatistics original;
+  VertexCacheStatistics optimized;
+  // Triangles of every level of detail, over all meshes. The first is the full meshes.
+  std::vector<size_t> lod_triangle_counts;
+};
+
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertex_count,
+                                         uint32_t cache_size = 16);
+
+// Reorders the triangles so that consecutive ones share vertices, with Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation". The scoring doesn't assume a cache size, it works for the FIFO and LRU caches of any GPU.
+void OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertex_count);
+
+// Reorders the clusters of triangles the vertex cache order starts from a cold cache, the outward facing ones
+// first, so the mesh tends to be drawn front to back from any direction. Keeps the order within the clusters, the
+// cache efficiency is nearly unchanged. Run after OptimizeVertexCache.
+void OptimizeOverdraw(std::vector<uint32_t> &indices, const glm::vec3 *positions, size_t vertex_count);
+
+// Renumbers the vertices in the order the indices first reference them so vertex fetches are mostly sequential, and
+// drops the vertices no index references. Fills remap with the new index of every vertex, ~0u for the dropped ones,
+// and returns the new vertex count. Run last, see RemapVertices.
+size_t OptimizeVertexFetch(std::vector<uint32_t> &indices, size_t vertex_count, std::vector<uint32_t> &remap);
+
+template <typename Vertex>
+std::vector<Vertex> RemapVertices(const Vertex *vertices, size_t vertex_count, const std::vector<uint32_t> &remap,
+                                  size_t remapped_count) {
+  std::vector<Vertex> remapped(remapped_count);
+  for (size_t i = 0; i < vertex_count; ++i) {
+    if (remap[i] != ~0u) {
+      remapped[remap[i]] = vertices[i];
+    }
+  }
+  return remapped;
+}
+
+// Collapses edges in the order of the error they introduce, measured with quadrics ("Surface Simplification Using
+// Quadric Error Metrics", Garland and Heckbert), until at most target_index_count indices are left or no edge can be
+// collapsed without folding a triangle over. A vertex moves onto the other vertex of its edge, the result indexes
+// the same vertices. Vertices on borders and attribute seams, where vertices share a position, never move so the
+// outline is kept and neighbouring meshes don't crack. Returns the error of the worst collapse, the root mean square
+// distance of the moved vertex to the planes of the triangles around it.
+float SimplifyMesh(std::vector<uint32_t> &indices, const glm::vec3 *positions, size_t vertex_count,
+                   size_t target_index_count);
+
+// A level of detail of a mesh, ready to draw
+struct MeshLod {
+  // Indices of the compacted vertices, in vertex cache order
+  std::vector<uint32_t> indices;
+  // New index of every vertex of the full mesh, ~0u for the ones the level doesn't use, see RemapVertices
+  std::vector<uint32_t> remap;
+  size_t vertex_count = 0;
+  // Largest distance of its surface from the full mesh, in the units of the positions
+  float error = 0.f;
+};
+
+// Simplifies a mesh to ratio of its triangles with SimplifyMesh and optimizes the result for the vertex cache and
+// vertex fetch. Returns false if less than a fifth of the triangles could be removed, e.g. for meshes made of
+// seams, the level isn't worth drawing then.
+bool GenerateLod(const std::vector<uint32_t> &indices, const glm::vec3 *positions, size_t vertex_count, float ratio,
+                 MeshLod &lod);
+
+// GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, the smallest index type for this many vertices
+GLenum GetSmallestIndexType(size_t vertex_count);
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,104 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Everything a draw needs bound besides the material parameters and the geometry: the programs of each stage and
+// the raster, blend and depth state
+struct PipelineStateDescription {
+  GLuint vertex_program = 0;
+  GLuint geometry_program = 0;
+  GLuint fragment_program = 0;
+
+  GLenum polygon_mode = GL_FILL;
+
+  bool blend_enabled = false;
+  GLenum blend_source = GL_SRC_ALPHA;
+  GLenum blend_destination = GL_ONE_MINUS_SRC_ALPHA;
+
+  bool depth_test_enabled = true;
+  bool depth_write_enabled = true;
+  GLenum depth_function = GL_LESS;
+
+  bool operator==(const PipelineStateDescription &rhs) const;
+  bool operator!=(const PipelineStateDescription &rhs) const {
+    return !(*this == rhs);
+  }
+};
+
+struct PipelineStateDescriptionHash {
+  size_t operator()(const PipelineStateDescription &description) const;
+};
+
+// Immutable pipeline state objects. Every distinct description gets a small integer ID the first time it's asked
+// for, stable for the lifetime of the cache, so materials resolve their state once and the renderer can sort draws
+// by it. Binding an ID is an array lookup plus a diff against the state bound last, only the GL state that differs
+// is set.
+//
+// The GL program pipeline of a state is created the first time it's bound: the programs of a material compiling
+// asynchronously can't be attached before they are linked.
+class PipelineStateCache final {
+public:
+  // ID of no pipeline state, binding it does nothing
+  static constexpr uint32_t kInvalidId = 0;
+
+  PipelineStateCache();
+  ~PipelineStateCache();
+
+  // This class should neither be copyable or movable
+  PipelineStateCache(const PipelineStateCache &) = delete;
+  PipelineStateCache(PipelineStateCache &&) = delete;
+  PipelineStateCache &operator=(const PipelineStateCache &) = delete;
+  PipelineStateCache &operator=(PipelineStateCache &&) = delete;
+
+  // Returns the ID of the state with this description, creating it if there is none yet
+  uint32_t GetId(const PipelineStateDescription &description);
+
+  const PipelineStateDescription &GetDescription(uint32_t id) const {
+    return states_[id].description;
+  }
+
+  // Number of pipeline states, plus one for kInvalidId
+  size_t GetCount() const {
+    return states_.size();
+  }
+
+  void Bind(uint32_t id);
+
+  // Deletes the GL pipelines using a program that is being deleted. The IDs of their states stay reserved but are
+  // never handed out again, a new program reusing the GL name gets new states.
+  void ReleaseProgram(GLuint program);
+
+  // Forgets what is bound, the next Bind sets all of its state. For when GL state was changed outside of the cache.
+  void Invalidate();
+
+private:
+  struct PipelineState {
+    PipelineStateDescription description;
+    GLuint gl_pipeline = 0;
+  };
+
+  std::vector<PipelineState> states_;
+  std::unordered_map<PipelineStateDescription, uint32_t, PipelineStateDescriptionHash> ids_;
+
+  uint32_t bound_id_ = kInvalidId;
+  GLuint bound_pipeline_ = 0;
+  // The GL state as last set, the blend and depth functions of a state that disables them aren't applied
+  PipelineStateDescription bound_;
+  bool bound_valid_ = false;
+};
+
+}  // namespace app_framework
+}  // namespace ml
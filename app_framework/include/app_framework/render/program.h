@@ -7,6 +7,7 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
+#include <chrono>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -30,9 +31,11 @@ public:
   static const std::string kMaterial;
   static const std::string kCamera;
   static const std::string kModel;
-  static const std::string kLight;
+  static const std::string kClusters;
 };
 
+struct ShaderReflection;
+
 struct VertexAttributeDescription {
   VertexAttributeDescription() : index(0), size(0), element_cnt(0), location(0), type(0) {}
   std::string name;
@@ -66,10 +69,17 @@ struct UniformBlockDescription {
 // GL program
 class Program {
 public:
-  // Initialize the program with null-terminated code string
-  Program(const char *code, GLenum type);
+  // Initialize the program with null-terminated code string. An async program is compiled by the ShaderCompiler
+  // and can't be used before IsReady returns true.
+  Program(const char *code, GLenum type, bool async = false);
   virtual ~Program();
 
+  // Returns true once the program is linked and reflected. The first call that finds an async compilation
+  // complete reflects the program, so it has to be called on the render thread.
+  bool IsReady();
+  // Blocks until the program is ready
+  void WaitUntilReady();
+
   inline GLuint GetGLProgram() const {
     return program_;
   }
@@ -87,10 +97,21 @@ public:
   };
 
 private:
+  friend class ProgramCache;
+  void Compile(const char *code);
+  void CheckLinkStatus();
+  // Uses the reflection precomputed by compile_shaders.py when the code is one of the shipped shaders
+  void Reflect(const char *code);
+  void ReflectPrecomputed(const ShaderReflection &reflection, GLint binding);
+
   GLuint program_;
   GLenum type_;
   GLint uniform_cnt_;
   GLint uniform_blk_cnt_;
+  bool ready_;
+  // Source of a program the ShaderCompiler is still compiling, for the ProgramCache
+  std::string pending_code_;
+  std::chrono::steady_clock::time_point compile_start_;
 
   static GLint sMaxUniformBinding;
   static GLint sVertBindingLocation;
@@ -100,5 +121,9 @@ private:
   std::unordered_map<std::string, UniformBlockDescription> uniform_blocks_by_name_;
   std::unordered_map<std::string, UniformDescription> uniforms_by_name_;
 };
+
+// Returns the code with a "#define <define>" line per entry inserted right after the #version directive, used to
+// compile variants of a shader with features switched on or off at compile time
+std::string AddShaderDefines(const std::string &code, const std::vector<std::string> &defines);
 }
 }
@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <chrono>
+#include <string>
+
+namespace ml {
+namespace app_framework {
+
+class Program;
+
+// Persists linked programs across launches with glGetProgramBinary, together with their reflected uniform tables
+// so that neither compilation nor reflection queries are needed on a warm start.
+//
+// Entries are keyed by a hash of the source, the shader stage and the GL vendor/renderer/version strings, so a
+// driver update invalidates them. A binary the driver rejects is recompiled and overwritten.
+class ProgramCache final {
+public:
+  static ProgramCache &GetInstance() {
+    static ProgramCache cache;
+    return cache;
+  }
+
+  // Enables the cache, storing entries in directory. Needs a current GL context.
+  void Initialize(const std::string &directory);
+
+  bool IsEnabled() const {
+    return enabled_;
+  }
+
+  // Restores program from the cache, returns false on a miss or if the driver rejects the binary
+  bool Load(const char *code, GLenum type, Program &program);
+  // Saves a freshly compiled and reflected program, compile_time is what a later hit saves
+  void Store(const char *code, GLenum type, const Program &program, std::chrono::duration<double> compile_time);
+
+  void LogStats() const;
+
+private:
+  ProgramCache() = default;
+  ProgramCache(const ProgramCache &other) = delete;
+  ProgramCache(ProgramCache &&other) = delete;
+  ProgramCache &operator=(const ProgramCache &other) = delete;
+  ProgramCache &operator=(ProgramCache &&other) = delete;
+  ~ProgramCache() = default;
+
+  std::string GetPath(const char *code, GLenum type) const;
+
+  bool enabled_ = false;
+  std::string directory_;
+  std::string driver_;
+
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+  uint32_t rejected_ = 0;
+  std::chrono::duration<double> load_time_{0};
+  std::chrono::duration<double> compile_time_{0};
+  // Compile time recorded with the entries that were hit
+  std::chrono::duration<double> saved_compile_time_{0};
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+#include "render_target.h"
+
+#include <memory>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Size and attachment formats of a render target, GL_NONE for an attachment it doesn't have. With more than one
+// sample the attachments are multisampled textures.
+struct RenderTargetDescription {
+  int32_t width = 0;
+  int32_t height = 0;
+  GLenum color_format = GL_RGBA8;
+  GLenum depth_format = GL_DEPTH_COMPONENT24;
+  int32_t samples = 1;
+
+  bool operator==(const RenderTargetDescription &rhs) const;
+  bool operator!=(const RenderTargetDescription &rhs) const {
+    return !(*this == rhs);
+  }
+};
+
+// Render targets for the passes of a frame: post-processes, off-screen passes and the like.
+//
+// Acquire hands out a target nobody else uses with the description asked for, creating it if the pool has none, and
+// the target goes back to the pool when it's released or at the end of the frame at the latest. Its contents are
+// undefined after that: released targets are invalidated with glInvalidateFramebuffer, so a tiled GPU neither writes
+// them back to memory nor loads them into tile memory on the next use. A target left unused for a few frames is
+// deleted.
+//
+// Not for what has to survive the frame, like the targets of the ML graphics client or the gui.
+class RenderTargetPool final {
+public:
+  // Frames a target stays in the pool unused before it's deleted
+  static constexpr uint32_t kMaxUnusedFrames = 3;
+
+  RenderTargetPool() = default;
+  ~RenderTargetPool() = default;
+
+  // This class should neither be copyable or movable
+  RenderTargetPool(const RenderTargetPool &) = delete;
+  RenderTargetPool(RenderTargetPool &&) = delete;
+  RenderTargetPool &operator=(const RenderTargetPool &) = delete;
+  RenderTargetPool &operator=(RenderTargetPool &&) = delete;
+
+  // Valid until Release or the end of the frame
+  std::shared_ptr<RenderTarget> Acquire(const RenderTargetDescription &description);
+  // Returns a target to the pool before the end of the frame, so later passes of the frame can use it
+  void Release(const std::shared_ptr<RenderTarget> &render_target);
+
+  // Called once per frame by the render thread, after the frame is rendered. Releases the targets still in use and
+  // deletes the ones unused for kMaxUnusedFrames frames.
+  void EndFrame();
+
+  // Targets in the pool, in use or not
+  size_t GetTargetCount() const {
+    return targets_.size();
+  }
+
+  size_t GetInUseCount() const;
+
+  // Targets created so far. Growing every frame means targets are created faster than they are recycled.
+  uint64_t GetCreatedCount() const {
+    return created_count_;
+  }
+
+private:
+  struct PooledTarget {
+    RenderTargetDescription description;
+    std::shared_ptr<RenderTarget> render_target;
+    bool in_use;
+    uint32_t unused_frames;
+  };
+
+  std::shared_ptr<RenderTarget> CreateRenderTarget(const RenderTargetDescription &description);
+  void Invalidate(PooledTarget &target);
+
+  std::vector<PooledTarget> targets_;
+  uint64_t created_count_ = 0;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -7,7 +7,6 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
-#include <tuple>
 #include <unordered_map>
 #include <functional>
 
@@ -18,23 +17,9 @@
 #include <app_framework/components/light_component.h>
 #include "fragment_program.h"
 #include "geometry_program.h"
+#include "light_clusters.h"
 #include "vertex_program.h"
 
-namespace ml {
-namespace app_framework {
-using ShaderKey = std::tuple<GLuint, GLuint, GLuint>;
-}
-}
-
-namespace std {
-template <>
-struct hash<ml::app_framework::ShaderKey> {
-  std::size_t operator()(const ml::app_framework::ShaderKey &key) const {
-    return (int)std::get<0>(key) << 16 & (int)std::get<1>(key) << 16 << (int)std::get<2>(key);
-  }
-};
-}
-
 namespace ml {
 namespace app_framework {
 
@@ -51,38 +36,12 @@ struct CameraUBO {
   float pad0;
 };
 
-struct Light {
-  Light() {}
-  Light(
-    const glm::vec3& in_light_position,
-    const glm::vec3& in_light_color,
-    const glm::vec3& in_light_direction,
-    LightType type,
-    float strength)
-    : light_position(in_light_position),
-      light_color(in_light_color),
-      light_direction(in_light_direction),
-      light_type((int)type),
-      light_strength(strength) {}
-  glm::vec3 light_position;
-  float light_strength;
-  glm::vec3 light_direction;
-  int32_t light_type;
-  glm::vec3 light_color;
-  float pad;
-};
-
-struct LightsUBO {
-  LightsUBO(
-    const std::vector<Light> &in_lights_array
-  ) {
-    int lightCnt = in_lights_array.size() > LightComponent::MAXIMUM_LIGHTS ? LightComponent::MAXIMUM_LIGHTS : in_lights_array.size();
-    memcpy(lights_array, in_lights_array.data(), sizeof(Light) * lightCnt);
-    number_of_lights = lightCnt;
-  }
-
-  Light lights_array[LightComponent::MAXIMUM_LIGHTS];
-  int32_t number_of_lights;
+// Model UBO, set for every renderable
+struct ModelUBO {
+  // Model transform, including the dequantization of the positions of the mesh
+  glm::mat4 transform;
+  // x: the normals of the mesh are octahedral encoded
+  glm::ivec4 vertex_format;
 };
 
 // Renderer, runtime rendering
@@ -126,10 +85,46 @@ public:
     return current_cam_;
   }
 
+  inline LightClusters &GetLightClusters() {
+    return light_clusters_;
+  }
+
+  // Largest projected error of the level of detail drawn, in pixels. 0 draws every mesh at full detail.
+  void SetLodErrorThreshold(float pixels) {
+    lod_error_threshold_ = pixels;
+  }
+
+  float GetLodErrorThreshold() const {
+    return lod_error_threshold_;
+  }
+
+  // Triangles drawn by the last Render, over every camera, and how many it would have been at full detail
+  uint64_t GetTriangleCount() const {
+    return triangle_count_;
+  }
+
+  uint64_t GetFullDetailTriangleCount() const {
+    return full_detail_triangle_count_;
+  }
+
 private:
+  // Picks the program of the material and packs its parameters, before any drawing of the frame. Returns the
+  // material to draw with: the fallback material while the programs of material are compiling, or null if that
+  // one isn't ready either.
+  Material* PrepareMaterial(Material& material);
+
+  // Binds the pipeline state of a material, and the per frame uniforms when its template changes. Then UseMaterial
+  // binds the parameters and textures of the instance.
+  void UsePipelineState(const Material& material);
+  void UseMaterialTemplate(const MaterialTemplate& material_template);
   void UseMaterial(Material& material);
 
-  void RenderRenderable(const RenderableComponent& renderable);
+  void RenderRenderable(RenderableComponent& renderable);
+
+  // Level of detail of the renderable to draw for the current camera: the coarsest one whose error projects to
+  // less than lod_error_threshold_ pixels at the bounding sphere of the mesh. Going coarser needs the error to be
+  // under kLodHysteresis of the threshold, so a renderable at the distance of a switch doesn't flicker between two.
+  Mesh& SelectLod(RenderableComponent& renderable);
 
   // TODO: Set uniform block bindings to constant binding points, so we don't have to look them up in shaders
   void BindCameraUniform(Program &program, const CameraUBO &camera_ubo);
@@ -149,27 +144,44 @@ private:
   std::function<void()> pre_render_callback_;
   std::function<void()> post_render_callback_;
 
-  void BindProgram(GLuint vert, GLuint geom, GLuint frag);
-
   using RenderableGraph = std::unordered_map<std::shared_ptr<Material>, std::vector<std::shared_ptr<RenderableComponent>>>;
+  // Renderables of an opaque material, sorted by pipeline state then material
+  struct OpaqueBatch {
+    uint64_t sort_key;
+    Material* material;
+    const std::vector<std::shared_ptr<RenderableComponent>>* renderables;
+  };
   RenderableGraph queued_opaque_renderables_;
+  std::vector<OpaqueBatch> opaque_batches_;
   std::vector<std::shared_ptr<RenderableComponent>> queued_transparent_renderables_;
+  // Material each transparent renderable is drawn with this frame
+  std::unordered_map<const RenderableComponent*, Material*> transparent_materials_;
+  // Drawn in place of the materials whose programs are compiling
+  std::shared_ptr<Material> fallback_material_;
   std::vector<std::shared_ptr<CameraComponent>> queued_cameras_;
   std::vector<std::shared_ptr<LightComponent>> queued_lights_;
   std::shared_ptr<CameraComponent> current_cam_;
+  size_t current_cam_index_ = 0;
+  // Vertex array bound by the last draw, 0 when unknown
+  GLuint bound_vertex_array_ = 0;
   std::shared_ptr<VertexProgram> current_vertex_program_;
   std::shared_ptr<FragmentProgram> current_frag_program_;
   std::shared_ptr<GeometryProgram> current_geom_program_;
-
-  GLuint program_pipeline_ = 0;
-  std::unordered_map<ShaderKey, GLuint> shader_program_cache_;
+  const MaterialTemplate* current_template_ = nullptr;
 
   GLuint camera_uniform_buffer_ = 0;
-  GLuint light_uniform_buffer_ = 0;
   GLuint model_uniform_buffer_ = 0;
 
   std::vector<Light> lights_;
+  LightClusters light_clusters_;
   bool camera_uniform_buffer_dirty_ = false;
+
+  static constexpr float kLodHysteresis = 0.8f;
+  float lod_error_threshold_ = 1.f;
+  // Pixels per model space unit at a distance of 1 for the current camera
+  float lod_pixel_scale_ = 0.f;
+  uint64_t triangle_count_ = 0;
+  uint64_t full_detail_triangle_count_ = 0;
 };
 
 }
@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include <app_framework/common.h>
+#include <app_framework/graphics_context.h>
+
+namespace ml {
+namespace app_framework {
+
+// Compiles programs without stalling the render thread.
+//
+// With GL_KHR_parallel_shader_compile the driver compiles on its own threads and the render thread polls the
+// completion status. Otherwise a worker thread compiles and links in a context sharing objects with the render
+// context. The render thread creates the program objects and reflects them once linked, see Program::IsReady.
+// Until Initialize is called, or if neither option is available, programs are compiled synchronously.
+class ShaderCompiler final {
+public:
+  static ShaderCompiler &GetInstance() {
+    static ShaderCompiler compiler;
+    return compiler;
+  }
+
+  // Needs the render context current, context is the one the worker context shares its objects with
+  void Initialize(GraphicsContext &context);
+  // Stops the worker, the programs it hasn't linked yet stay unlinked
+  void Terminate();
+
+  bool IsAsync() const {
+    return mode_ != Mode::kSync;
+  }
+
+  // Compiles code and links it into program, a separable program created by the render thread
+  void Submit(GLuint program, const char *code, GLenum type);
+  // Returns true once program is linked, or failed to link
+  bool IsComplete(GLuint program);
+  // Blocks until program is linked, or failed to link
+  void Wait(GLuint program);
+  // Forgets a program that is about to be deleted. Returns false if the worker is linking it right now, it
+  // deletes the program once done in that case.
+  bool Cancel(GLuint program);
+
+  // Compiles code into a shader, attaches it to program and links, without waiting for the result
+  static void CompileAndLink(GLuint program, const char *code, GLenum type);
+
+private:
+  enum class Mode { kSync, kParallel, kWorker };
+
+  struct Job {
+    GLuint program;
+    std::string code;
+    GLenum type;
+  };
+
+  ShaderCompiler() = default;
+  ShaderCompiler(const ShaderCompiler &other) = delete;
+  ShaderCompiler(ShaderCompiler &&other) = delete;
+  ShaderCompiler &operator=(const ShaderCompiler &other) = delete;
+  ShaderCompiler &operator=(ShaderCompiler &&other) = delete;
+  ~ShaderCompiler();
+
+  void WorkerLoop();
+
+  Mode mode_ = Mode::kSync;
+  std::unique_ptr<GraphicsContext> worker_context_;
+  std::thread worker_;
+
+  std::mutex mutex_;
+  std::condition_variable job_added_;
+  std::condition_variable job_completed_;
+  std::deque<Job> jobs_;
+  std::unordered_set<GLuint> completed_;
+  // Program the worker is linking, and whether it was cancelled meanwhile
+  GLuint linking_ = 0;
+  bool linking_cancelled_ = false;
+  bool stop_ = false;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,48 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include <app_framework/common.h>
+
+namespace ml {
+namespace app_framework {
+
+// Reflection data of the programs generated by compile_shaders.py, computed from the std140 rules at build time.
+// Program uses it instead of enumerating the uniforms of a freshly linked program.
+struct ShaderUniformReflection {
+  const char *name;
+  GLenum type;
+  uint32_t array_size;
+  // Offset in the block, 0 outside of blocks
+  uint32_t offset;
+};
+
+struct ShaderBlockReflection {
+  const char *name;
+  uint32_t size;
+  const ShaderUniformReflection *members;
+  size_t member_count;
+};
+
+struct ShaderReflection {
+  const char *code;
+  GLenum type;
+  const ShaderBlockReflection *blocks;
+  size_t block_count;
+  const ShaderUniformReflection *uniforms;
+  size_t uniform_count;
+};
+
+// Returns the reflection of a generated program, null for any other code
+const ShaderReflection *FindShaderReflection(const char *code, GLenum type);
+
+}  // namespace app_framework
+}  // namespace ml
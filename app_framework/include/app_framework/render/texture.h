@@ -7,7 +7,13 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #pragma once
+#include <memory>
+#include <string>
+
 #include <app_framework/common.h>
+#include "gpu_memory_tracker.h"
+#include "texture_array.h"
+#include "texture_image.h"
 
 namespace ml {
 namespace app_framework {
@@ -21,6 +27,10 @@ public:
         width_(width),
         height_(height) {}
 
+  // A layer of a texture array, the layer is returned to the array when the texture is destroyed. The storage of the
+  // layer is accounted to the texture while it's allocated.
+  Texture(std::shared_ptr<TextureArray> array, int32_t layer);
+
   Texture() : Texture(GL_TEXTURE_2D, 0, 0, 0, false) {}
   ~Texture();
 
@@ -48,12 +58,53 @@ public:
     return texture_;
   }
 
+  // Layer of the texture array the image is in, 0 for textures that aren't in an array
+  int32_t GetLayer() const {
+    return layer_;
+  }
+
+  // Format and mip levels of the storage, GL_NONE for the textures created without telling. The storage of an owned
+  // texture is accounted to category in the GpuMemoryTracker.
+  void SetFormat(GLenum internal_format, int32_t level_count,
+                 GpuMemoryTracker::Category category = GpuMemoryTracker::Category::kTexture);
+
+  GLenum GetInternalFormat() const {
+    return internal_format_;
+  }
+
+  int32_t GetLevelCount() const {
+    return level_count_;
+  }
+
+  // Bytes of the storage of the image with all of its levels, of its layer for a layer of an array
+  uint64_t GetByteSize() const {
+    return internal_format_ != GL_NONE ? GetTextureSize(internal_format_, width_, height_, level_count_) : 0;
+  }
+
+  // Sampler object bound with the texture, see TextureBindingCache. With 0 the texture is sampled with its own
+  // parameters.
+  GLuint GetSampler() const {
+    return sampler_;
+  }
+
+  void SetSampler(GLuint sampler) {
+    sampler_ = sampler;
+  }
+
+  // What the storage of this texture is accounted to in the GpuMemoryTracker
+  void SetMemoryLabel(const std::string &label);
+
 private:
   GLuint texture_;
   GLint texture_type_;
   int32_t width_;
   int32_t height_;
   bool owned_;
+  std::shared_ptr<TextureArray> array_;
+  int32_t layer_ = 0;
+  GLenum internal_format_ = GL_NONE;
+  int32_t level_count_ = 1;
+  GLuint sampler_ = 0;
 };
 }
 }
@@ -0,0 +1,76 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Images of the same size and format packed into the layers of one GL_TEXTURE_2D_ARRAY, so the materials using
+// any of them bind the same texture. Layers are handed out and returned one at a time, see Texture. The allocated
+// layers are accounted to their textures in the GpuMemoryTracker, the free ones to the array.
+class TextureArray final {
+public:
+  TextureArray(int32_t width, int32_t height, GLenum internal_format, int32_t layer_count, int32_t level_count = 1);
+  ~TextureArray();
+
+  // This class should neither be copyable or movable
+  TextureArray(const TextureArray &) = delete;
+  TextureArray(TextureArray &&) = delete;
+  TextureArray &operator=(const TextureArray &) = delete;
+  TextureArray &operator=(TextureArray &&) = delete;
+
+  GLuint GetGLTexture() const {
+    return texture_;
+  }
+
+  int32_t GetWidth() const {
+    return width_;
+  }
+
+  int32_t GetHeight() const {
+    return height_;
+  }
+
+  GLenum GetInternalFormat() const {
+    return internal_format_;
+  }
+
+  int32_t GetLayerCount() const {
+    return layer_count_;
+  }
+
+  int32_t GetLevelCount() const {
+    return level_count_;
+  }
+
+  bool IsFull() const {
+    return free_layers_.empty();
+  }
+
+  // Returns a free layer, or -1 if the array is full
+  int32_t AllocateLayer();
+  void FreeLayer(int32_t layer);
+
+private:
+  void UpdateMemoryUsage();
+
+  GLuint texture_;
+  int32_t width_;
+  int32_t height_;
+  GLenum internal_format_;
+  int32_t layer_count_;
+  int32_t level_count_;
+  std::vector<int32_t> free_layers_;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Filtering and wrapping of a sampler object
+struct SamplerDescription {
+  GLenum min_filter = GL_LINEAR;
+  GLenum mag_filter = GL_LINEAR;
+  GLenum wrap_s = GL_REPEAT;
+  GLenum wrap_t = GL_REPEAT;
+
+  bool operator==(const SamplerDescription &rhs) const {
+    return min_filter == rhs.min_filter && mag_filter == rhs.mag_filter && wrap_s == rhs.wrap_s &&
+           wrap_t == rhs.wrap_t;
+  }
+};
+
+struct SamplerDescriptionHash {
+  size_t operator()(const SamplerDescription &description) const;
+};
+
+// The textures and sampler objects bound to each texture unit, as last set through the cache. Binding what is
+// already bound makes no GL call, so consecutive materials sharing a texture array only bind it once. Sampler
+// objects are shared by every texture with the same description instead of each texture carrying its own
+// parameters.
+//
+// Units bound outside of the cache aren't seen by it, call Invalidate after changing them.
+class TextureBindingCache final {
+public:
+  TextureBindingCache() = default;
+  ~TextureBindingCache();
+
+  // This class should neither be copyable or movable
+  TextureBindingCache(const TextureBindingCache &) = delete;
+  TextureBindingCache(TextureBindingCache &&) = delete;
+  TextureBindingCache &operator=(const TextureBindingCache &) = delete;
+  TextureBindingCache &operator=(TextureBindingCache &&) = delete;
+
+  // Returns the sampler object with this description, creating it if there is none yet
+  GLuint GetSampler(const SamplerDescription &description);
+
+  // Binds a texture and a sampler to a unit, sampler 0 samples with the parameters of the texture
+  void Bind(GLuint unit, GLenum target, GLuint texture, GLuint sampler);
+
+  // Forgets a texture that is being deleted, GL unbinds it from every unit
+  void ReleaseTexture(GLuint texture);
+
+  // Unbinds the sampler objects, so code binding textures outside of the cache samples them with their own
+  // parameters again, and forgets what is bound
+  void Reset();
+
+  // Forgets what is bound, the next Bind of every unit makes the GL calls
+  void Invalidate();
+
+private:
+  struct Binding {
+    GLenum target = GL_NONE;
+    GLuint texture = 0;
+    GLuint sampler = 0;
+    // False when the unit may have been changed outside of the cache
+    bool valid = false;
+  };
+
+  std::unordered_map<SamplerDescription, GLuint, SamplerDescriptionHash> samplers_;
+  std::vector<Binding> units_;
+};
+
+}  // namespace app_framework
+}  // namespace ml
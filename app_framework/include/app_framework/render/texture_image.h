@@ -0,0 +1,54 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// An image and its mip levels in memory, as glTexSubImage2D or glCompressedTexSubImage2D take them: RGBA8 pixels
+// unless the internal format is compressed, then the blocks of the format.
+struct TextureImage {
+  GLenum internal_format = GL_RGBA8;
+  int32_t width = 0;
+  int32_t height = 0;
+  std::vector<std::vector<char>> levels;
+};
+
+bool IsCompressedFormat(GLenum internal_format);
+
+// Whether the GL context samples the format from its compressed blocks. ETC2 and EAC are core since GL 4.3, ASTC
+// needs GL_KHR_texture_compression_astc_ldr. Call on the render thread.
+bool IsFormatSupported(GLenum internal_format);
+
+// Size of level of an image, with the partial blocks at the edges of compressed levels counted whole
+uint64_t GetTextureLevelSize(GLenum internal_format, int32_t width, int32_t height, int32_t level);
+
+// Sum of GetTextureLevelSize over the levels
+uint64_t GetTextureSize(GLenum internal_format, int32_t width, int32_t height, int32_t level_count);
+
+// Levels down to 1x1
+int32_t GetMipLevelCount(int32_t width, int32_t height);
+
+// Replaces the levels after the first of an RGBA8 image with the full chain, each level a 2x2 box filter of the
+// previous one. The color of sRGB images is averaged in linear space.
+void GenerateMipmaps(TextureImage &image);
+
+// Parses a KTX 1.1 container of a 2D texture. Every level stored is kept, files without mipmaps have one level.
+bool LoadKtx(const void *data, size_t size, TextureImage &image);
+
+// Decodes an ETC2 RGB or RGBA (EAC alpha) image to RGBA8, or its sRGB variant to GL_SRGB8_ALPHA8, for contexts that
+// don't support it. Returns false for the other formats.
+bool TranscodeToRgba8(TextureImage &image);
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,151 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+#include "buffer.h"
+#include "texture.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Copies geometry and images to GL objects through a staging ring buffer, so the render thread never waits for the
+// driver to copy the source data.
+//
+// Uploads can be submitted from any thread, the data is moved in and nothing is read from the caller afterwards.
+// Once per frame the render thread writes the uploads waiting, oldest first, to free regions of the ring with
+// unsynchronized maps, records a copy from the ring to each destination and fences the regions. A region is reused
+// once its fence has signaled. The uploads of a frame are capped at a byte budget so a large texture doesn't cause a
+// hitch, an upload that doesn't fit in the budget or in the free part of the ring waits for a later frame.
+//
+// The destinations keep their previous contents until then, an image texture created empty is sampled as whatever
+// its storage was initialized with.
+class UploadManager final {
+public:
+  // Replaces the contents of a buffer, it takes the size of the data once copied. A buffer too small for the data is
+  // reallocated then, it keeps its previous contents until the copy.
+  struct BufferCopy {
+    std::shared_ptr<Buffer> buffer;
+    std::vector<char> data;
+  };
+
+  // Replaces a level of a 2D texture or of the layer of a texture array with an image of the same size, RGBA8
+  // pixels or the blocks of the compressed format of the texture
+  struct TextureCopy {
+    std::shared_ptr<Texture> texture;
+    std::vector<char> data;
+    int32_t level = 0;
+  };
+
+  static constexpr uint64_t kRingSize = 16 * 1024 * 1024;
+  static constexpr uint64_t kDefaultFrameBudget = 4 * 1024 * 1024;
+
+  UploadManager() = default;
+  ~UploadManager();
+
+  // This class should neither be copyable or movable
+  UploadManager(const UploadManager &) = delete;
+  UploadManager(UploadManager &&) = delete;
+  UploadManager &operator=(const UploadManager &) = delete;
+  UploadManager &operator=(UploadManager &&) = delete;
+
+  // The copies of one submission are all recorded in the same frame, in order. on_uploaded is called on the render
+  // thread right after, what is drawn from then on sees the new contents.
+  void Submit(std::vector<BufferCopy> buffer_copies, std::vector<TextureCopy> texture_copies,
+              std::function<void()> on_uploaded = nullptr);
+  void UploadBuffer(std::shared_ptr<Buffer> buffer, std::vector<char> data);
+  void UploadTexture(std::shared_ptr<Texture> texture, std::vector<char> data, int32_t level = 0);
+  // Uploads every level of an image in one submission
+  void UploadTexture(std::shared_ptr<Texture> texture, TextureImage image);
+
+  // Bytes uploaded per frame. At least one submission is uploaded each frame if the ring has room for it.
+  void SetFrameBudget(uint64_t bytes) {
+    frame_budget_ = bytes;
+  }
+
+  uint64_t GetFrameBudget() const {
+    return frame_budget_;
+  }
+
+  // Called once per frame by the render thread, before the frame is rendered
+  void Process();
+
+  // Bytes submitted and not uploaded yet
+  uint64_t GetPendingBytes();
+
+  // Bytes uploaded by the last Process and the time it took
+  uint64_t GetLastFrameBytes() const {
+    return last_frame_bytes_;
+  }
+
+  float GetLastFrameMs() const {
+    return last_frame_ms_;
+  }
+
+  // Frames that left uploads for later because of the budget, and because the GPU was still reading the ring
+  uint64_t GetBudgetDeferredFrameCount() const {
+    return budget_deferred_frames_;
+  }
+
+  uint64_t GetRingStallFrameCount() const {
+    return ring_stall_frames_;
+  }
+
+  // Submissions larger than the ring, copied straight from memory by the driver instead
+  uint64_t GetDirectUploadCount() const {
+    return direct_uploads_;
+  }
+
+private:
+  struct Submission {
+    std::vector<BufferCopy> buffer_copies;
+    std::vector<TextureCopy> texture_copies;
+    std::function<void()> on_uploaded;
+    uint64_t size = 0;
+  };
+
+  // Regions of the ring written in a frame, in ring order
+  struct Region {
+    GLsync fence = nullptr;
+    uint64_t size = 0;
+  };
+
+  // Releases the regions the GPU is done with
+  void Retire();
+  // Returns the offset of size free bytes of the ring or kRingSize if there is no room
+  uint64_t Allocate(uint64_t size);
+  void Upload(Submission &submission, uint64_t offset);
+  void UploadDirect(Submission &submission);
+
+  std::mutex mutex_;
+  std::deque<Submission> submissions_;
+  uint64_t pending_bytes_ = 0;
+
+  // Render thread only
+  GLuint ring_ = 0;
+  uint64_t head_ = 0;
+  uint64_t used_ = 0;
+  std::deque<Region> regions_;
+  uint64_t frame_used_ = 0;
+
+  uint64_t frame_budget_ = kDefaultFrameBudget;
+  uint64_t last_frame_bytes_ = 0;
+  float last_frame_ms_ = 0.f;
+  uint64_t budget_deferred_frames_ = 0;
+  uint64_t ring_stall_frames_ = 0;
+  uint64_t direct_uploads_ = 0;
+};
+
+}  // namespace app_framework
+}  // namespace ml
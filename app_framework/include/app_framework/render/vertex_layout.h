@@ -0,0 +1,113 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+#include <app_framework/common.h>
+
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+// Attribute of an interleaved vertex, the arguments of its glVertexAttribPointer
+struct VertexAttribute {
+  GLuint location;
+  GLenum type;
+  GLint count;
+  GLboolean normalized;
+  uint32_t offset;
+};
+
+// How the positions, normals and texture coordinates of a Mesh are stored. They are interleaved in one vertex
+// buffer, so a vertex is fetched from a single stream, and each of them can be quantized:
+//  - positions as 16 bit unsigned normalized integers over the bounding cube of the mesh. The mesh keeps the
+//    transform back to model space, the renderer applies it with the model transform.
+//  - normals as 16 bit signed normalized integers, or octahedral encoded in two of them
+//  - texture coordinates as half floats
+// Shaders read all of them as floats, only octahedral normals have to be decoded: the Model block tells the
+// vertex shader when they are.
+class VertexLayout final {
+public:
+  enum class PositionFormat {
+    kFloat3,
+    kUnorm16,
+  };
+
+  enum class NormalFormat {
+    kNone,
+    kFloat3,
+    kSnorm16,
+    kOctahedral16,
+  };
+
+  enum class TexCoordFormat {
+    kNone,
+    kFloat2,
+    kHalf2,
+  };
+
+  // Unquantized positions, normals and texture coordinates
+  VertexLayout() : VertexLayout(PositionFormat::kFloat3, NormalFormat::kFloat3, TexCoordFormat::kFloat2) {}
+  VertexLayout(PositionFormat position_format, NormalFormat normal_format, TexCoordFormat tex_coord_format);
+
+  // Float positions only, for lines and meshes colored by custom attributes
+  static VertexLayout Positions() {
+    return VertexLayout(PositionFormat::kFloat3, NormalFormat::kNone, TexCoordFormat::kNone);
+  }
+
+  // The smallest formats: 16 bytes per vertex instead of 32
+  static VertexLayout Quantized() {
+    return VertexLayout(PositionFormat::kUnorm16, NormalFormat::kOctahedral16, TexCoordFormat::kHalf2);
+  }
+
+  PositionFormat GetPositionFormat() const {
+    return position_format_;
+  }
+
+  NormalFormat GetNormalFormat() const {
+    return normal_format_;
+  }
+
+  TexCoordFormat GetTexCoordFormat() const {
+    return tex_coord_format_;
+  }
+
+  const std::vector<VertexAttribute> &GetAttributes() const {
+    return attributes_;
+  }
+
+  uint32_t GetStride() const {
+    return stride_;
+  }
+
+  // Interleaves count vertices into out, GetStride() bytes each. Normals and texture coordinates passed as null,
+  // or that the layout doesn't have, are left out. Quantized positions are mapped from the bounding cube given by
+  // dequantization, see GetPositionDequantization.
+  void Pack(const glm::vec3 *positions, const glm::vec3 *normals, const glm::vec2 *tex_coords, size_t count,
+            const glm::vec4 &dequantization, char *out) const;
+
+  // Bounding cube of the positions: the corner with the smallest coordinates (xyz) and the edge length (w). A
+  // cube rather than a box keeps the dequantization a uniform scale, which doesn't change the direction of the
+  // transformed normals.
+  static glm::vec4 GetPositionDequantization(const glm::vec3 *positions, size_t count);
+
+  // Enables the attributes of the vertex array bound that are passed as true, and disables the others
+  void EnableAttributes(bool positions, bool normals, bool tex_coords) const;
+
+private:
+  PositionFormat position_format_;
+  NormalFormat normal_format_;
+  TexCoordFormat tex_coord_format_;
+  std::vector<VertexAttribute> attributes_;
+  uint32_t normal_offset_;
+  uint32_t tex_coord_offset_;
+  uint32_t stride_;
+};
+
+}  // namespace app_framework
+}  // namespace ml
@@ -17,7 +17,7 @@ namespace app_framework {
 class VertexProgram final : public Program {
 public:
   // Initialize the program with null-terminated code string
-  VertexProgram(const char *code) : Program(code, GL_VERTEX_SHADER) {}
+  VertexProgram(const char *code, bool async = false) : Program(code, GL_VERTEX_SHADER, async) {}
   virtual ~VertexProgram() = default;
 };
 }  // namespace app_framework
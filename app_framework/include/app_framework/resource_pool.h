@@ -9,10 +9,14 @@
 #pragma once
 
 #include "app_framework/common.h"
+#include "app_framework/render/mesh_optimizer.h"
+#include "app_framework/render/texture_image.h"
+#include "app_framework/render/vertex_layout.h"
 
 #include <algorithm>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 struct aiNode;
 struct aiScene;
@@ -24,12 +28,19 @@ namespace app_framework {
 class Node;
 class Mesh;
 class Material;
+class MaterialTemplate;
 class Program;
+class VertexProgram;
+class GeometryProgram;
+class FragmentProgram;
 class Texture;
+class TextureArray;
 
 struct Model {
   std::shared_ptr<Mesh> mesh;
   std::shared_ptr<Material> material;
+  // Simplified versions of mesh, see RenderableComponent::SetLods
+  std::vector<std::shared_ptr<Mesh>> lods;
 };
 
 class PBRMaterial;
@@ -37,6 +48,8 @@ class PBRMaterial;
 // Load and cache the resource instance
 class ResourcePool final {
 public:
+  static constexpr uint64_t kDefaultTextureArrayMaxBytes = 32 * 1024 * 1024;
+
   ResourcePool() = default;
   ~ResourcePool() = default;
 
@@ -50,9 +63,73 @@ public:
   // Load a model from a 3D file and cache it, the returned material instance will always be a new one
   std::shared_ptr<Node> LoadAsset(const std::string &path);
 
-  // Load a image as Texture and cache it
+  // Vertex layout of the meshes loaded by LoadAsset from now on, VertexLayout::Quantized() by default
+  void SetModelVertexLayout(const VertexLayout &vertex_layout) {
+    model_vertex_layout_ = vertex_layout;
+  }
+
+  const VertexLayout &GetModelVertexLayout() const {
+    return model_vertex_layout_;
+  }
+
+  // Whether LoadAsset merges the meshes of a node sharing a material and reorders the triangles and vertices of the
+  // meshes for the vertex cache, overdraw and vertex fetch, see mesh_optimizer.h. On by default.
+  void SetOptimizeModels(bool optimize) {
+    optimize_models_ = optimize;
+  }
+
+  bool GetOptimizeModels() const {
+    return optimize_models_;
+  }
+
+  // Whether LoadAsset puts the meshes of models in the GeometryArena, where the meshes of the same layout share
+  // their buffers and vertex array. The meshes too large for it get buffers of their own. On by default.
+  void SetUseGeometryArena(bool use_geometry_arena) {
+    use_geometry_arena_ = use_geometry_arena;
+  }
+
+  bool GetUseGeometryArena() const {
+    return use_geometry_arena_;
+  }
+
+  // Levels of detail LoadAsset generates for every mesh, each with half the triangles of the previous one. Fewer
+  // are generated when a mesh can't be simplified that far. 3 by default, 0 disables them.
+  void SetModelLodCount(size_t lod_count) {
+    model_lod_count_ = lod_count;
+  }
+
+  size_t GetModelLodCount() const {
+    return model_lod_count_;
+  }
+
+  // Whether the textures loaded from uncompressed images get a full mip chain. KTX files keep the levels they have.
+  // On by default.
+  void SetGenerateMipmaps(bool generate_mipmaps) {
+    generate_mipmaps_ = generate_mipmaps;
+  }
+
+  bool GetGenerateMipmaps() const {
+    return generate_mipmaps_;
+  }
+
+  // Largest texture array LoadTextureLayer allocates, an image larger than that gets an array of its own. The arrays
+  // of a size and format start at one layer, each new one has as many as the ones before it together.
+  void SetTextureArrayMaxBytes(uint64_t bytes) {
+    texture_array_max_bytes_ = bytes;
+  }
+
+  uint64_t GetTextureArrayMaxBytes() const {
+    return texture_array_max_bytes_;
+  }
+
+  // Load a image as Texture and cache it. KTX files (.ktx) are loaded in their own format, ASTC and ETC2 compressed
+  // ones included, the others are decoded to RGBA8 in gl_internal_format.
   std::shared_ptr<Texture> LoadTexture(const std::string &path, GLint gl_internal_format = GL_SRGB8_ALPHA8);
 
+  // Load a image into a layer of a texture array shared with the other images of its size and format, and cache
+  // it. The texture is a GL_TEXTURE_2D_ARRAY, for samplers declared as sampler2DArray.
+  std::shared_ptr<Texture> LoadTextureLayer(const std::string &path, GLint gl_internal_format = GL_SRGB8_ALPHA8);
+
   // Load a GLSL as Program and cache it
   template <typename ProgramType>
   std::shared_ptr<ProgramType> LoadShaderFromFile(const std::string &path);
@@ -63,6 +140,24 @@ public:
   template <typename ProgramType>
   std::shared_ptr<ProgramType> LoadShaderFromCode(const char* code, const std::string& identifier = std::string());
 
+  // Same as LoadShaderFromCode, but the program is compiled by the ShaderCompiler and isn't ready right away.
+  // Materials using it are drawn with a fallback material until it is.
+  template <typename ProgramType>
+  std::shared_ptr<ProgramType> LoadShaderFromCodeAsync(const std::string &code,
+                                                       const std::string &identifier = std::string());
+
+  // Starts compiling a program ahead of its first use, e.g. behind a loading screen. Later loads of the same code or
+  // identifier get the cached program.
+  template <typename ProgramType>
+  void WarmUpShader(const std::string &code, const std::string &identifier = std::string());
+  // Returns true once every program passed to WarmUpShader is ready, call it once per frame while waiting
+  bool IsWarmUpComplete();
+
+  // Get the template shared by the materials using these programs and cache it, geom may be null
+  std::shared_ptr<MaterialTemplate> GetMaterialTemplate(std::shared_ptr<VertexProgram> vert,
+                                                        std::shared_ptr<GeometryProgram> geom,
+                                                        std::shared_ptr<FragmentProgram> frag);
+
 private:
   template <typename Type, typename ParentType, typename... Args>
   std::shared_ptr<Type> GetOrCreateElement(std::unordered_map<std::string, std::shared_ptr<ParentType>> &cache,
@@ -75,15 +170,39 @@ private:
                                               const std::string &key) const;
 
   // Load a model from a 3D file and cache it, the returned material instance will always be a new one
-  Model LoadModel(const std::string &path, const aiScene *ai_scene, size_t mesh_index);
-  std::shared_ptr<Node> LoadNodeHierarchy(const std::string &path, const aiScene *ai_scene, const aiNode *ai_node);
+  Model LoadModel(const std::string &path, const aiScene *ai_scene, size_t mesh_index,
+                  MeshOptimizationStatistics &statistics);
+  std::shared_ptr<Node> LoadNodeHierarchy(const std::string &path, const aiScene *ai_scene, const aiNode *ai_node,
+                                          MeshOptimizationStatistics &statistics);
 
   std::shared_ptr<Texture> LoadAssimpEmbeddedTexture(const aiTexture *ai_tex, GLint gl_internal_format);
+  // Transcodes an image the GL context can't sample, generates its mipmaps and logs what it costs
+  bool PrepareImage(const std::string &name, TextureImage &image);
+  // Copies an image to a free layer of a texture array of its size, format and levels, allocating a new array when
+  // all of them are full
+  std::shared_ptr<Texture> CreateTextureLayer(TextureImage image);
+
+  template <typename ProgramType>
+  std::shared_ptr<ProgramType> LoadShader(const char *code, const std::string &identifier, bool async);
 
   std::unordered_map<std::string, std::shared_ptr<Program>> program_cache_;
+  std::vector<std::shared_ptr<Program>> warm_up_programs_;
+  std::unordered_map<std::string, std::shared_ptr<MaterialTemplate>> material_template_cache_;
   std::unordered_map<std::string, std::shared_ptr<Texture>> texture_cache_;
+  std::unordered_map<std::string, std::shared_ptr<Texture>> texture_layer_cache_;
+  // Arrays are freed once all of their layers are
+  std::vector<std::weak_ptr<TextureArray>> texture_arrays_;
   std::unordered_map<std::string, std::shared_ptr<Mesh>> mesh_cache_;
   std::unordered_map<std::string, std::shared_ptr<PBRMaterial>> static_material_cache_;
+  VertexLayout model_vertex_layout_ = VertexLayout::Quantized();
+  bool optimize_models_ = true;
+  bool use_geometry_arena_ = true;
+  size_t model_lod_count_ = 3;
+  bool generate_mipmaps_ = true;
+  uint64_t texture_array_max_bytes_ = kDefaultTextureArrayMaxBytes;
+  // Bytes of the textures loaded, and as RGBA8 without mipmaps
+  uint64_t texture_bytes_ = 0;
+  uint64_t texture_rgba8_bytes_ = 0;
 };
 }
 }
@@ -50,13 +50,35 @@ std::shared_ptr<ProgramType> ResourcePool::LoadShaderFromCode(const std::string
 
 template <typename ProgramType>
 std::shared_ptr<ProgramType> ResourcePool::LoadShaderFromCode(const char* code, const std::string& identifier) {
+  std::shared_ptr<ProgramType> program = LoadShader<ProgramType>(code, identifier, false);
+  // The cached program may have been loaded asynchronously
+  program->WaitUntilReady();
+  return program;
+}
+
+template <typename ProgramType>
+std::shared_ptr<ProgramType> ResourcePool::LoadShaderFromCodeAsync(const std::string &code,
+                                                                   const std::string &identifier) {
+  return LoadShader<ProgramType>(code.c_str(), identifier, true);
+}
+
+template <typename ProgramType>
+void ResourcePool::WarmUpShader(const std::string &code, const std::string &identifier) {
+  std::shared_ptr<ProgramType> program = LoadShader<ProgramType>(code.c_str(), identifier, true);
+  if (!program->IsReady()) {
+    warm_up_programs_.push_back(program);
+  }
+}
+
+template <typename ProgramType>
+std::shared_ptr<ProgramType> ResourcePool::LoadShader(const char *code, const std::string &identifier, bool async) {
   std::string key;
   if (identifier.empty()) {
     key = code;
   } else {
     key = identifier;
   }
-  return GetOrCreateElement<ProgramType, Program>(program_cache_, key, code);
+  return GetOrCreateElement<ProgramType, Program>(program_cache_, key, code, async);
 }
 
 template <typename Type, typename ParentType, typename... Args>
@@ -6,39 +6,43 @@
 // %COPYRIGHT_END%
 // ---------------------------------------------------------------------
 // %BANNER_END%
+// Generated by compile_shaders.py from shaders/magicleap_mesh.vert, do not edit.
 #pragma once
 
 namespace ml {
 namespace app_framework {
 
 static const char *kMagicLeapMeshVertexShader = R"GLSL(
-  #version 410 core
-
-  layout(std140) uniform Camera {
-    mat4 view_proj;
-    vec4 world_position;
-  } camera;
-
-  layout(std140) uniform Model {
-    mat4 transform;
-  } model;
-
-  layout (location = 0) in vec3 position;
-  layout (location = 1) in vec3 normal;
-  layout (location = 4) in float confidence;
-
-  layout (location = 0) out vec4 out_color;
-  layout (location = 1) out vec4 out_normal;
-
-  out gl_PerVertex {
-    vec4 gl_Position;
-  };
-
-  void main() {
-    gl_Position = camera.view_proj * model.transform * vec4(position, 1.0);
-    out_color = mix(vec4(1, 0, 0, 1), vec4(0, 1, 0, 1), confidence);
-    out_normal = camera.view_proj * model.transform * vec4(normal, 0.0);
-  }
+#version 410 core
+layout(std140) uniform Camera {
+mat4 view_proj;
+vec4 world_position;
+} camera;
+layout(std140) uniform Model {
+mat4 transform;
+ivec4 vertex_format;
+} model;
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 4) in float confidence;
+layout (location = 0) out vec4 out_color;
+layout (location = 1) out vec4 out_normal;
+vec3 DecodeOctahedral(vec2 encoded) {
+vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+if (n.z < 0.0) {
+n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+}
+return normalize(n);
+}
+out gl_PerVertex {
+vec4 gl_Position;
+};
+void main() {
+gl_Position = camera.view_proj * model.transform * vec4(position, 1.0);
+out_color = mix(vec4(1, 0, 0, 1), vec4(0, 1, 0, 1), confidence);
+vec3 model_normal = model.vertex_format.x != 0 ? DecodeOctahedral(normal.xy) : normal;
+out_normal = camera.view_proj * model.transform * vec4(model_normal, 0.0);
+}
 )GLSL";
 }
 }
@@ -6,189 +6,183 @@
 // %COPYRIGHT_END%
 // ---------------------------------------------------------------------
 // %BANNER_END%
+// Generated by compile_shaders.py from shaders/pbr.frag, do not edit.
 #pragma once
 
 namespace ml {
 namespace app_framework {
 
 static const char *kPBRFragmentShader = R"GLSL(
-  #version 410 core
-  // BRDF functinos refers the same one used in https://github.com/KhronosGroup/glTF-WebGL-PBR/
-
-  uniform sampler2D Albedo;
-  uniform sampler2D Metallic;
-  uniform sampler2D Roughness;
-  uniform sampler2D Normals;
-  uniform sampler2D AmbientOcclusion;
-  uniform sampler2D Emissive;
-
-  const vec3 Fc = vec3(0.04, 0.04, 0.04);
-  const float PI = 3.14159265359;
-
-  layout (location = 0) in vec3 in_world_position;
-  layout (location = 1) in vec3 in_normal;
-  layout (location = 2) in vec2 in_tex_coords;
-
-  layout (location = 0) out vec4 out_color;
-
-  layout(std140) uniform Camera {
-    mat4 view_proj;
-    vec4 world_position;
-  } camera;
-
-  layout(std140) uniform Material {
-    int MetallicChannel;
-    int RoughnessChannel;
-    bool HasNormals;
-    bool HasAlbedo;
-    bool HasNormalMap;
-    bool HasMetallic;
-    bool HasRoughness;
-    bool HasAmbientOcclusion;
-    bool HasEmissive;
-  } material;
-
-  struct Light {
-    vec3 light_position;
-    float light_strength;
-    vec3 light_direction;
-    int light_type;
-    vec3 light_color;
-    float pad;
-  };
-
-  layout(std140) uniform Lights {
-    Light lights_array[32];
-    int number_of_lights;
-  } lights;
-
-  vec3 SpecularReflection(float cos_theta, vec3 F0) {
-    return F0 + (1 - F0) * pow(clamp(1.0 - cos_theta, 0.0, 1.0), 5.0);
-  }
-
-  float GeometricOcclusion(vec3 N, vec3 V, vec3 L, float roughness) {
-    float NdotL = clamp(dot(N, L), 0.001, 1.0);
-    float NdotV = clamp(abs(dot(N, V)), 0.001, 1.0);
-    float r = roughness;
-
-    float attenuation_L = 2.0 * NdotL / (NdotL + sqrt(r * r + (1.0 - r * r) * (NdotL * NdotL)));
-    float attenuation_V = 2.0 * NdotV / (NdotV + sqrt(r * r + (1.0 - r * r) * (NdotV * NdotV)));
-    return attenuation_L * attenuation_V;
-  }
-
-  float MicrofacetDistribution(vec3 N, vec3 H, float roughness) {
-    float NdotH = clamp(dot(N, H), 0.0, 1.0);
-    float roughness_Sq = roughness * roughness;
-    float f = (NdotH * roughness_Sq - NdotH) * NdotH + 1.0;
-    return roughness_Sq / (PI * f * f);
-  }
-
-  // Convert the tangent space normal to world space
-  vec3 GetWorldNormal() {
-    vec3 dPx = dFdx(in_world_position);
-    vec3 dPy = dFdy(in_world_position);
-    vec3 N = normalize(cross(dPx, dPy));
-    vec2 dUVx = dFdx(in_tex_coords);
-    vec2 dUVy = dFdy(in_tex_coords);
-
-    if (material.HasNormals) {
-      N = normalize(in_normal);
-    }
-
-    if (!material.HasNormalMap) {
-      // Just return surface normal
-      return N;
-    }
-
-    vec3 tangent_normal = texture(Normals, in_tex_coords).xyz * 2.0 - 1.0;
-    vec3 T = (dUVy.t * dPx - dUVx.t * dPy) / (dUVx.s * dUVy.t - dUVy.s * dUVx.t);
-    T = normalize(T - N * dot(N, T));
-    vec3 B = normalize(cross(N, T));
-    mat3 TBN = mat3(T, B, N);
-    return normalize(TBN * tangent_normal);
-  }
-
-  void main() {
-    float roughness = 0.5f;
-    float metallic = 0.0f;
-
-    if (material.HasRoughness) {
-      vec4 metallic_sample = texture(Metallic, in_tex_coords);
-      if (material.MetallicChannel == 0) {
-        metallic = metallic_sample.r;
-      } else if (material.MetallicChannel == 1) {
-        metallic = metallic_sample.g;
-      } else if (material.MetallicChannel == 2) {
-        metallic = metallic_sample.b;
-      } else {
-        metallic = metallic_sample.a;
-      }
-    }
-
-    if (material.HasMetallic) {
-      vec4 roughness_sample = texture(Roughness, in_tex_coords);
-      if (material.RoughnessChannel == 0) {
-        roughness = roughness_sample.r;
-      } else if (material.RoughnessChannel == 1) {
-        roughness = roughness_sample.g;
-      } else if (material.RoughnessChannel == 2) {
-        roughness = roughness_sample.b;
-      } else {
-        roughness = roughness_sample.a;
-      }
-    }
-
-    vec4 albedo = vec4(1.0f);
-    if (material.HasAlbedo) {
-      albedo = texture(Albedo, in_tex_coords);
-    }
-
-    vec3 F0 = mix(Fc, albedo.rgb, metallic);
-    vec3 V = normalize(camera.world_position.xyz - in_world_position);
-    vec3 N = GetWorldNormal();
-    vec3 color = vec3(0.0);
-
-    for (int i = 0; i < lights.number_of_lights; ++i) {
-      float attenuation = 1.0f;
-      vec3 L;
-      if (lights.lights_array[i].light_type == 0) {
-        // Point light
-        L = normalize(lights.lights_array[i].light_position - in_world_position);
-        float distance    = length(lights.lights_array[i].light_position - in_world_position);
-        attenuation = 1.0 / (distance * distance);
-      } else {
-        // Directional light
-        L = -normalize(lights.lights_array[i].light_direction);
-      }
-      vec3 H = normalize(V + L);
-      vec3 F = SpecularReflection(clamp(dot(H, V), 0.0, 1.0), F0);
-      float G = GeometricOcclusion(N, V, L, roughness);
-      float D = MicrofacetDistribution(N, H, roughness);
-
-      float NdotL = clamp(dot(N, L), 0.001, 1.0);
-      float NdotV = clamp(abs(dot(N, V)), 0.001, 1.0);
-
-      vec3 diffuse_part = (albedo.rgb * (vec3(1.0) - F)) / PI;
-      diffuse_part *= 1 - metallic;
-      vec3 spectacular_part = F * G * D / max(4.0 * NdotL * NdotV, 0.0001);
-
-      color += NdotL * lights.lights_array[i].light_color * lights.lights_array[i].light_strength * attenuation * (diffuse_part + spectacular_part);
-    }
-
-    if (material.HasAmbientOcclusion) {
-      float ao = texture(AmbientOcclusion, in_tex_coords).r;
-      color = color * ao;
-    }
-
-    if (material.HasEmissive) {
-      vec3 emissive = texture(Emissive, in_tex_coords).rgb;
-      color += emissive;
-    }
-
-    color = color / (color + vec3(1.0));
-    out_color = vec4(color, 1.0f);
-  }
+#version 410 core
+#ifdef PBR_SHADER_VARIANT
+#define HAS_FEATURE(define_flag, material_flag) define_flag
+#else
+#define HAS_FEATURE(define_flag, material_flag) material.material_flag
+#endif
+uniform sampler2DArray Albedo;
+uniform sampler2DArray Metallic;
+uniform sampler2DArray Roughness;
+uniform sampler2DArray Normals;
+uniform sampler2DArray AmbientOcclusion;
+uniform sampler2DArray Emissive;
+const vec3 Fc = vec3(0.04, 0.04, 0.04);
+const float PI = 3.14159265359;
+layout (location = 0) in vec3 in_world_position;
+layout (location = 1) in vec3 in_normal;
+layout (location = 2) in vec2 in_tex_coords;
+layout (location = 0) out vec4 out_color;
+layout(std140) uniform Camera {
+mat4 view_proj;
+vec4 world_position;
+} camera;
+layout(std140) uniform Material {
+int MetallicChannel;
+int RoughnessChannel;
+bool HasNormals;
+bool HasAlbedo;
+bool HasNormalMap;
+bool HasMetallic;
+bool HasRoughness;
+bool HasAmbientOcclusion;
+bool HasEmissive;
+int AlbedoLayer;
+int MetallicLayer;
+int RoughnessLayer;
+int NormalsLayer;
+int AmbientOcclusionLayer;
+int EmissiveLayer;
+} material;
+uniform samplerBuffer ClusterLights;
+uniform usamplerBuffer ClusterRanges;
+uniform usamplerBuffer ClusterLightIndices;
+layout(std140) uniform Clusters {
+mat4 view;
+vec4 viewport;
+vec4 depth_params;
+ivec4 grid;
+} clusters;
+vec3 SpecularReflection(float cos_theta, vec3 F0) {
+return F0 + (1 - F0) * pow(clamp(1.0 - cos_theta, 0.0, 1.0), 5.0);
+}
+float GeometricOcclusion(vec3 N, vec3 V, vec3 L, float roughness) {
+float NdotL = clamp(dot(N, L), 0.001, 1.0);
+float NdotV = clamp(abs(dot(N, V)), 0.001, 1.0);
+float r = roughness;
+float attenuation_L = 2.0 * NdotL / (NdotL + sqrt(r * r + (1.0 - r * r) * (NdotL * NdotL)));
+float attenuation_V = 2.0 * NdotV / (NdotV + sqrt(r * r + (1.0 - r * r) * (NdotV * NdotV)));
+return attenuation_L * attenuation_V;
+}
+float MicrofacetDistribution(vec3 N, vec3 H, float roughness) {
+float NdotH = clamp(dot(N, H), 0.0, 1.0);
+float roughness_Sq = roughness * roughness;
+float f = (NdotH * roughness_Sq - NdotH) * NdotH + 1.0;
+return roughness_Sq / (PI * f * f);
+}
+vec3 GetWorldNormal() {
+vec3 dPx = dFdx(in_world_position);
+vec3 dPy = dFdy(in_world_position);
+vec3 N = normalize(cross(dPx, dPy));
+vec2 dUVx = dFdx(in_tex_coords);
+vec2 dUVy = dFdy(in_tex_coords);
+if (HAS_FEATURE(HAS_NORMALS, HasNormals)) {
+N = normalize(in_normal);
+}
+if (!HAS_FEATURE(HAS_NORMAL_MAP, HasNormalMap)) {
+return N;
+}
+vec3 tangent_normal = texture(Normals, vec3(in_tex_coords, material.NormalsLayer)).xyz * 2.0 - 1.0;
+vec3 T = (dUVy.t * dPx - dUVx.t * dPy) / (dUVx.s * dUVy.t - dUVy.s * dUVx.t);
+T = normalize(T - N * dot(N, T));
+vec3 B = normalize(cross(N, T));
+mat3 TBN = mat3(T, B, N);
+return normalize(TBN * tangent_normal);
+}
+int GetCluster() {
+vec2 tile = (gl_FragCoord.xy - clusters.viewport.xy) / clusters.viewport.zw * vec2(clusters.grid.xy);
+ivec2 tile_index = clamp(ivec2(tile), ivec2(0), clusters.grid.xy - 1);
+float depth = max(-(clusters.view * vec4(in_world_position, 1.0)).z, 1e-4);
+int slice = clamp(int(floor(log(depth) * clusters.depth_params.x + clusters.depth_params.y)), 0, clusters.grid.z - 1);
+return (slice * clusters.grid.y + tile_index.y) * clusters.grid.x + tile_index.x;
+}
+vec3 Shade(int light_index, vec3 N, vec3 V, vec3 F0, vec3 albedo, float metallic, float roughness) {
+vec4 position_strength = texelFetch(ClusterLights, light_index * 3);
+vec4 direction_type = texelFetch(ClusterLights, light_index * 3 + 1);
+vec4 color_range = texelFetch(ClusterLights, light_index * 3 + 2);
+float attenuation = 1.0f;
+vec3 L;
+if (int(direction_type.w) == 0) {
+vec3 to_light = position_strength.xyz - in_world_position;
+float distance = length(to_light);
+L = to_light / distance;
+float falloff = clamp(1.0 - pow(distance / color_range.w, 4.0), 0.0, 1.0);
+attenuation = falloff * falloff / (distance * distance);
+} else {
+L = -normalize(direction_type.xyz);
+}
+vec3 H = normalize(V + L);
+vec3 F = SpecularReflection(clamp(dot(H, V), 0.0, 1.0), F0);
+float G = GeometricOcclusion(N, V, L, roughness);
+float D = MicrofacetDistribution(N, H, roughness);
+float NdotL = clamp(dot(N, L), 0.001, 1.0);
+float NdotV = clamp(abs(dot(N, V)), 0.001, 1.0);
+vec3 diffuse_part = (albedo * (vec3(1.0) - F)) / PI;
+diffuse_part *= 1 - metallic;
+vec3 spectacular_part = F * G * D / max(4.0 * NdotL * NdotV, 0.0001);
+return NdotL * color_range.rgb * position_strength.w * attenuation * (diffuse_part + spectacular_part);
+}
+void main() {
+float roughness = 0.5f;
+float metallic = 0.0f;
+if (HAS_FEATURE(HAS_METALLIC, HasMetallic)) {
+vec4 metallic_sample = texture(Metallic, vec3(in_tex_coords, material.MetallicLayer));
+if (material.MetallicChannel == 0) {
+metallic = metallic_sample.r;
+} else if (material.MetallicChannel == 1) {
+metallic = metallic_sample.g;
+} else if (material.MetallicChannel == 2) {
+metallic = metallic_sample.b;
+} else {
+metallic = metallic_sample.a;
+}
+}
+if (HAS_FEATURE(HAS_ROUGHNESS, HasRoughness)) {
+vec4 roughness_sample = texture(Roughness, vec3(in_tex_coords, material.RoughnessLayer));
+if (material.RoughnessChannel == 0) {
+roughness = roughness_sample.r;
+} else if (material.RoughnessChannel == 1) {
+roughness = roughness_sample.g;
+} else if (material.RoughnessChannel == 2) {
+roughness = roughness_sample.b;
+} else {
+roughness = roughness_sample.a;
+}
+}
+vec4 albedo = vec4(1.0f);
+if (HAS_FEATURE(HAS_ALBEDO, HasAlbedo)) {
+albedo = texture(Albedo, vec3(in_tex_coords, material.AlbedoLayer));
+}
+vec3 F0 = mix(Fc, albedo.rgb, metallic);
+vec3 V = normalize(camera.world_position.xyz - in_world_position);
+vec3 N = GetWorldNormal();
+vec3 color = vec3(0.0);
+for (int i = 0; i < clusters.grid.w; ++i) {
+color += Shade(i, N, V, F0, albedo.rgb, metallic, roughness);
+}
+uvec2 range = texelFetch(ClusterRanges, GetCluster()).xy;
+for (uint i = 0u; i < range.y; ++i) {
+color += Shade(int(texelFetch(ClusterLightIndices, int(range.x + i)).r), N, V, F0, albedo.rgb, metallic, roughness);
+}
+if (HAS_FEATURE(HAS_AMBIENT_OCCLUSION, HasAmbientOcclusion)) {
+float ao = texture(AmbientOcclusion, vec3(in_tex_coords, material.AmbientOcclusionLayer)).r;
+color = color * ao;
+}
+if (HAS_FEATURE(HAS_EMISSIVE, HasEmissive)) {
+vec3 emissive = texture(Emissive, vec3(in_tex_coords, material.EmissiveLayer)).rgb;
+color += emissive;
+}
+color = color / (color + vec3(1.0));
+out_color = vec4(color, 1.0f);
+}
 )GLSL";
-
 }
 }
@@ -6,24 +6,20 @@
 // %COPYRIGHT_END%
 // ---------------------------------------------------------------------
 // %BANNER_END%
+// Generated by compile_shaders.py from shaders/simple_textured.frag, do not edit.
 #pragma once
 
 namespace ml {
 namespace app_framework {
 
 static const char *kSimpleTexturedFragmentShader = R"GLSL(
-  #version 410 core
-
-  uniform sampler2D Texture0;
-
-  layout (location = 0) in vec2 in_tex_coords;
-
-  layout (location = 0) out vec4 out_color;
-
-  void main() {
-    out_color = texture(Texture0, in_tex_coords);
-  }
+#version 410 core
+uniform sampler2D Texture0;
+layout (location = 0) in vec2 in_tex_coords;
+layout (location = 0) out vec4 out_color;
+void main() {
+out_color = texture(Texture0, in_tex_coords);
+}
 )GLSL";
-
 }
 }
@@ -6,30 +6,27 @@
 // %COPYRIGHT_END%
 // ---------------------------------------------------------------------
 // %BANNER_END%
+// Generated by compile_shaders.py from shaders/solid_color.frag, do not edit.
 #pragma once
 
 namespace ml {
 namespace app_framework {
 
 static const char *kSolidColorFragmentShader = R"GLSL(
-  #version 410 core
-
-  layout(std140) uniform Material {
-    vec4 Color;
-    bool OverrideVertexColor;
-  } material;
-
-  layout (location = 0) in vec4 in_color;
-
-  layout (location = 0) out vec4 out_color;
-
-  void main() {
-    if (material.OverrideVertexColor) {
-      out_color = material.Color;
-    } else {
-      out_color = in_color;
-    }
-  }
+#version 410 core
+layout(std140) uniform Material {
+vec4 Color;
+bool OverrideVertexColor;
+} material;
+layout (location = 0) in vec4 in_color;
+layout (location = 0) out vec4 out_color;
+void main() {
+if (material.OverrideVertexColor) {
+out_color = material.Color;
+} else {
+out_color = in_color;
+}
+}
 )GLSL";
 }
 }
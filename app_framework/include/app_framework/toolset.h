@@ -53,7 +53,7 @@ inline std::shared_ptr<Node> CreatePresetNode(NodeType type) {
       material->SetPolygonMode(GL_FILL);
     } break;
     case NodeType::Line: {
-      mesh = std::make_shared<Mesh>(Buffer::Category::Dynamic, GL_UNSIGNED_SHORT);
+      mesh = std::make_shared<Mesh>(Buffer::Category::Dynamic, GL_UNSIGNED_SHORT, VertexLayout::Positions());
       material->SetOverrideVertexColor(true);
       material->SetColor(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
       material->SetPolygonMode(GL_LINE);
@@ -0,0 +1,40 @@
+#version 410 core
+
+layout(std140) uniform Camera {
+  mat4 view_proj;
+  vec4 world_position;
+} camera;
+
+layout(std140) uniform Model {
+  mat4 transform;
+  // x: the normals are octahedral encoded, see VertexLayout
+  ivec4 vertex_format;
+} model;
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 tex_coords;
+
+vec3 DecodeOctahedral(vec2 encoded) {
+  vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+  if (n.z < 0.0) {
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return normalize(n);
+}
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+layout (location = 0) out vec3 out_world_position;
+layout (location = 1) out vec3 out_normal;
+layout (location = 2) out vec2 out_tex_coords;
+
+void main() {
+  gl_Position = camera.view_proj * model.transform * vec4(position, 1.0);
+  out_world_position = (model.transform * vec4(position, 1.0)).rgb;
+  vec3 model_normal = model.vertex_format.x != 0 ? DecodeOctahedral(normal.xy) : normal;
+  out_normal = normalize(transpose(inverse(mat3(model.transform))) * model_normal);
+  out_tex_coords = tex_coords;
+}
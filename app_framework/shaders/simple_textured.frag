@@ -0,0 +1,11 @@
+#version 410 core
+
+uniform sampler2D Texture0;
+
+layout (location = 0) in vec2 in_tex_coords;
+
+layout (location = 0) out vec4 out_color;
+
+void main() {
+  out_color = texture(Texture0, in_tex_coords);
+}
@@ -0,0 +1,18 @@
+#version 410 core
+
+layout(std140) uniform Material {
+  vec4 Color;
+  bool OverrideVertexColor;
+} material;
+
+layout (location = 0) in vec4 in_color;
+
+layout (location = 0) out vec4 out_color;
+
+void main() {
+  if (material.OverrideVertexColor) {
+    out_color = material.Color;
+  } else {
+    out_color = in_color;
+  }
+}
@@ -11,9 +11,14 @@
 // %BANNER_END%
 #include <app_framework/application.h>
 #include <app_framework/cli_args_parser.h>
+#include <app_framework/frame_pacer.h>
 #include <app_framework/geometry/quad_mesh.h>
 #include <app_framework/material/textured_material.h>
 #include <app_framework/ml_macros.h>
+#include <app_framework/render/dynamic_resolution.h>
+#include <app_framework/render/program_cache.h>
+#include <app_framework/render/shader_compiler.h>
+#include <app_framework/perception_recorder.h>
 
 #if !ML_LUMIN
 #include <GLFW/glfw3.h>
@@ -28,6 +33,8 @@
 
 #include <ml_logging.h>
 
+#include <algorithm>
+#include <cinttypes>
 #include <cstdlib>
 
 namespace chrono = std::chrono;
@@ -51,7 +58,86 @@ DEFINE_int32(window_width, 800, "Width of the window on the host machine.");
 DEFINE_int32(window_height, 600, "Height of the window on the host machine.");
 
 DEFINE_int32(frame_timing_hint, 60,
-    "Suggested rate for how frequently the application will render new frames. Can be either 60 or 120");
+    "Suggested rate for how frequently the application will render new frames. Can be either 60 or 120. With "
+    "adaptive_frame_timing this is the fastest rate used.");
+
+DEFINE_bool(adaptive_frame_timing, true,
+    "Switch the frame timing hint between 120 and 60 based on the measured CPU/GPU frame cost and dropped "
+    "frames. Only has an effect when frame_timing_hint is 120.");
+
+#if !ML_LUMIN
+DEFINE_bool(headless, false,
+    "Render offscreen without a window and without the ML graphics client (Linux only). Frames are rendered into "
+    "an internal stereo render target pair, so this works on machines with no display or GPU.");
+
+DEFINE_int32(headless_width, 1280, "Width of each eye's render target when running headless.");
+
+DEFINE_int32(headless_height, 960, "Height of each eye's render target when running headless.");
+#endif
+
+DEFINE_string(perception_record, "",
+    "Record the results of perception calls made through PerceptionRecorder into this file. Relative paths are "
+    "resolved against the application's writable directory.");
+
+DEFINE_string(perception_replay, "",
+    "Replay the results of perception calls from a file written with --perception_record. The application stops "
+    "once the last frame has been replayed and logs the replay frame rate.");
+
+DEFINE_bool(perception_replay_realtime, true,
+    "Replay perception inputs at the recorded pace. When false, frames are replayed as fast as possible.");
+
+DEFINE_bool(dynamic_resolution, false,
+    "Scale the rendered area of the render targets to keep the measured GPU frame time within the frame budget.");
+
+DEFINE_double(dynamic_resolution_budget_ms, 0,
+    "GPU frame time budget for dynamic resolution in milliseconds. 0 uses the current frame timing hint period.");
+
+DEFINE_double(dynamic_resolution_min_scale, 0.5, "Smallest render target scale used by dynamic resolution.");
+
+DEFINE_double(dynamic_resolution_max_scale, 1.0, "Largest render target scale used by dynamic resolution.");
+
+DEFINE_double(dynamic_resolution_smoothing, 0.1,
+    "How fast dynamic resolution follows changes in GPU time, between 0 (never) and 1 (immediately).");
+
+DEFINE_bool(program_cache, true,
+    "Keep linked program binaries in the writable directory so that later launches can skip shader compilation.");
+
+DEFINE_bool(async_shaders, true,
+    "Compile the shaders of materials in the background, drawing them with a fallback material until they are "
+    "ready.");
+
+DEFINE_bool(quantize_meshes, true,
+    "Store the positions, normals and texture coordinates of loaded models in 16 bits each (octahedral normals, "
+    "half float texture coordinates) instead of floats.");
+
+DEFINE_bool(optimize_meshes, true,
+    "Reorder the triangles and vertices of loaded models for the vertex cache, overdraw and vertex fetch, and merge "
+    "their submeshes sharing a material.");
+
+DEFINE_bool(geometry_arena, true,
+    "Put the meshes of loaded models in large vertex and index buffers shared by the meshes of the same layout, "
+    "drawn with a base vertex, instead of buffers of their own.");
+
+DEFINE_bool(generate_mipmaps, true,
+    "Generate the mip levels of textures loaded from uncompressed images, sRGB correctly. KTX files keep the levels "
+    "they were authored with.");
+
+DEFINE_int32(mesh_lods, 3,
+    "Levels of detail generated for every mesh of loaded models, each with half the triangles of the previous one. "
+    "0 disables them.");
+
+DEFINE_double(lod_error_pixels, 1.0,
+    "Largest projected error in pixels of the level of detail drawn for a mesh. 0 always draws the full meshes.");
+
+DEFINE_int32(upload_budget_kb, 4096,
+    "Kilobytes of geometry and textures copied to the GPU per frame, larger uploads are spread over frames.");
+
+DEFINE_int32(gpu_memory_budget_mb, 0,
+    "Megabytes of GPU memory the framework aims to stay under. Loaded textures drop mip levels that would go over "
+    "it and samples are told when it is nearly used up. 0 disables the budget.");
+
+DEFINE_int32(job_workers, 0,
+    "Number of worker threads of the job system. 0 uses one worker per hardware thread, minus the main thread.");
 
 DEFINE_double(perf_log_rate, 0,
     "How often to log the performance information in seconds. A value of 0 will prevent logging this performance "
@@ -138,7 +224,9 @@ const std::vector<std::string> &Application::GetLifecycleStartupArgUri() const {
 
 void Application::Initialize() {
   exit_signal_ = false;
+  InitializeJobSystem();
   InitializePerception();
+  InitializePerceptionRecorder();
   if (use_gfx_) {
     InitializeGraphics();
   }
@@ -195,6 +283,27 @@ void Application::InitializePerception() {
   UNWRAP_MLRESULT_FATAL(MLPerceptionStartup(&perception_settings));
 }
 
+void Application::InitializeJobSystem() {
+  job_system_.reset(new JobSystem((uint32_t)std::max(FLAGS_job_workers, 0)));
+  Registry::GetInstance()->SetJobSystem(job_system_.get());
+}
+
+void Application::InitializePerceptionRecorder() {
+  auto resolve_path = [this](const std::string &path) {
+    if (path.empty() || path[0] == '/' || lifecycle_info_ == nullptr) {
+      return path;
+    }
+    return std::string(lifecycle_info_->writable_dir_path) + "/" + path;
+  };
+
+  PerceptionRecorder &recorder = PerceptionRecorder::GetInstance();
+  if (!FLAGS_perception_replay.empty()) {
+    recorder.StartReplay(resolve_path(FLAGS_perception_replay), FLAGS_perception_replay_realtime);
+  } else if (!FLAGS_perception_record.empty()) {
+    recorder.StartRecording(resolve_path(FLAGS_perception_record));
+  }
+}
+
 static void PrintGlDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
     const GLchar *message, const void *userParam) {
   MLLogLevel log_level = MLLogLevel_Error;
@@ -212,8 +321,13 @@ void Application::InitializeGraphics() {
 #ifdef ML_LUMIN
   graphics_context_.reset(new GraphicsContext());
 #else
-  graphics_context_.reset(
-      new GraphicsContext(window_title_.c_str(), FLAGS_mirror_window, FLAGS_window_width, FLAGS_window_height));
+  headless_ = FLAGS_headless;
+  if (headless_) {
+    graphics_context_.reset(GraphicsContext::CreateHeadless(FLAGS_headless_width, FLAGS_headless_height));
+  } else {
+    graphics_context_.reset(
+        new GraphicsContext(window_title_.c_str(), FLAGS_mirror_window, FLAGS_window_width, FLAGS_window_height));
+  }
 #endif  // #ifdef ML_LUMIN
   graphics_context_->SetTitle(window_title_.c_str());
   graphics_context_->SetWindowCloseCallback([this]() { StopApp(); });
@@ -247,19 +361,79 @@ void Application::InitializeGraphics() {
   glDebugMessageCallback(PrintGlDebugMessage, nullptr);
 #endif
 
+  if (FLAGS_program_cache && lifecycle_info_) {
+    ProgramCache::GetInstance().Initialize(lifecycle_info_->writable_dir_path);
+  }
+  if (FLAGS_async_shaders) {
+    ShaderCompiler::GetInstance().Initialize(*graphics_context_);
+  }
+
+  if (headless_) {
+    InitializeHeadlessRenderTargets();
+  } else {
+    InitializeGraphicsClient();
+  }
+
+  if (FLAGS_dynamic_resolution) {
+    dynamic_resolution_.reset(new DynamicResolution((float)FLAGS_dynamic_resolution_min_scale,
+        (float)FLAGS_dynamic_resolution_max_scale, (float)FLAGS_dynamic_resolution_smoothing));
+  }
+
+  // Initialize the new renderer and setting the post render camera callback
+  renderer_.reset(new Renderer());
+  auto cb = [this](std::shared_ptr<CameraComponent> camera) { Application::InternalRenderCamCallback(camera); };
+  renderer_->SetPostRenderCameraCallback(cb);
+  renderer_->SetLodErrorThreshold(static_cast<float>(FLAGS_lod_error_pixels));
+  // The light cluster slices start at the near clip plane, nothing closer is drawn
+  LightClusters &light_clusters = renderer_->GetLightClusters();
+  if (frame_params_.near_clip > 0.f && frame_params_.near_clip < light_clusters.GetFarDepth()) {
+    light_clusters.SetDepthRange(frame_params_.near_clip, light_clusters.GetFarDepth());
+  }
+  Registry::GetInstance()->Initialize();
+  if (!FLAGS_quantize_meshes) {
+    Registry::GetInstance()->GetResourcePool()->SetModelVertexLayout(VertexLayout());
+  }
+  Registry::GetInstance()->GetResourcePool()->SetOptimizeModels(FLAGS_optimize_meshes);
+  Registry::GetInstance()->GetResourcePool()->SetUseGeometryArena(FLAGS_geometry_arena);
+  Registry::GetInstance()->GetResourcePool()->SetGenerateMipmaps(FLAGS_generate_mipmaps);
+  Registry::GetInstance()->GetResourcePool()->SetModelLodCount(static_cast<size_t>(std::max(FLAGS_mesh_lods, 0)));
+  Registry::GetInstance()->GetUploadManager().SetFrameBudget(static_cast<uint64_t>(FLAGS_upload_budget_kb) * 1024);
+  Registry::GetInstance()->GetGpuMemoryTracker().SetBudget(
+      static_cast<uint64_t>(std::max(FLAGS_gpu_memory_budget_mb, 0)) * 1024 * 1024);
+
+  // Init nodes
+  root_ = std::make_shared<Node>();
+  for (int i = 0; i < camera_nodes_.size(); ++i) {
+    camera_nodes_[i] = std::make_shared<Node>();
+    auto camera = std::make_shared<CameraComponent>();
+    camera_nodes_[i]->AddComponent(camera);
+    root_->AddChild(camera_nodes_[i]);
+  }
+
+  // Setup light node
+  light_node_ = std::make_shared<ml::app_framework::Node>();
+  std::shared_ptr<LightComponent> light_component = std::make_shared<LightComponent>();
+  light_component->SetLightStrength(5.0f);
+  light_node_->AddComponent(light_component);
+  root_->AddChild(light_node_);
+}
+
+void Application::InitializeGraphicsClient() {
   // Get ready to connect our GL context to the MLSDK graphics API
   graphics_options_ = {0, MLSurfaceFormat_RGBA8UNorm, MLSurfaceFormat_D32Float};
   opengl_context_ = graphics_context_->GetContextHandle();
   graphics_client_ = ML_INVALID_HANDLE;
   MLGraphicsCreateClientGL(&graphics_options_, opengl_context_, &graphics_client_);
 
+  MLGraphicsFrameTimingHint frame_timing_hint = MLGraphicsFrameTimingHint_Unspecified;
   if (60 == FLAGS_frame_timing_hint) {
-    MLGraphicsSetFrameTimingHint(graphics_client_, MLGraphicsFrameTimingHint_60Hz);
+    frame_timing_hint = MLGraphicsFrameTimingHint_60Hz;
   } else if (120 == FLAGS_frame_timing_hint) {
-    MLGraphicsSetFrameTimingHint(graphics_client_, MLGraphicsFrameTimingHint_120Hz);
+    frame_timing_hint = MLGraphicsFrameTimingHint_120Hz;
   } else {
     ML_LOG(Fatal, "Invalid input for frame_timing_hint");
   }
+  frame_pacer_.reset(new FramePacer(graphics_client_, frame_timing_hint, FLAGS_adaptive_frame_timing));
 
   // Init ml render targets
   MLGraphicsRenderTargetsInfo targets{};
@@ -283,28 +457,63 @@ void Application::InitializeGraphics() {
     ml_render_target_cache_.insert(std::make_pair(std::make_pair(buffer.color.id, 0), left_render_target));
     ml_render_target_cache_.insert(std::make_pair(std::make_pair(buffer.color.id, 1), right_render_target));
   }
+}
 
-  // Initialize the new renderer and setting the post render camera callback
-  renderer_.reset(new Renderer());
-  auto cb = [this](std::shared_ptr<CameraComponent> camera) { Application::InternalRenderCamCallback(camera); };
-  renderer_->SetPostRenderCameraCallback(cb);
-  Registry::GetInstance()->Initialize();
-
-  // Init nodes
-  root_ = std::make_shared<Node>();
-  for (int i = 0; i < camera_nodes_.size(); ++i) {
-    camera_nodes_[i] = std::make_shared<Node>();
-    auto camera = std::make_shared<CameraComponent>();
-    camera_nodes_[i]->AddComponent(camera);
-    root_->AddChild(camera_nodes_[i]);
+void Application::InitializeHeadlessRenderTargets() {
+  // Stand-in for MLGraphicsGetRenderTargets: a single color/depth texture array pair with one layer per eye,
+  // matching the layout of the render targets handed out by the ML graphics client.
+  const auto dims = graphics_context_->GetFramebufferDimensions();
+  GLuint textures[2] = {};
+  glGenTextures(2, textures);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, textures[0]);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, dims.first, dims.second, camera_nodes_.size());
+  glBindTexture(GL_TEXTURE_2D_ARRAY, textures[1]);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, dims.first, dims.second, camera_nodes_.size());
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  auto color_tex = std::make_shared<Texture>(GL_TEXTURE_2D_ARRAY, textures[0], dims.first, dims.second, true);
+  auto depth_tex = std::make_shared<Texture>(GL_TEXTURE_2D_ARRAY, textures[1], dims.first, dims.second, true);
+  GpuMemoryTracker &tracker = Registry::GetInstance()->GetGpuMemoryTracker();
+  tracker.Update(color_tex.get(), GpuMemoryTracker::Category::kRenderTarget,
+                 camera_nodes_.size() * GetTextureSize(GL_RGBA8, dims.first, dims.second, 1));
+  tracker.Update(depth_tex.get(), GpuMemoryTracker::Category::kRenderTarget,
+                 camera_nodes_.size() * GetTextureSize(GL_DEPTH_COMPONENT32F, dims.first, dims.second, 1));
+  tracker.SetLabel(color_tex.get(), "headless render targets");
+  tracker.SetLabel(depth_tex.get(), "headless render targets");
+  for (uint32_t i = 0; i < camera_nodes_.size(); ++i) {
+    auto render_target = std::make_shared<RenderTarget>(color_tex, depth_tex, i, i);
+    ml_render_target_cache_.insert(std::make_pair(std::make_pair((MLHandle)textures[0], i), render_target));
+  }
+  headless_color_id_ = textures[0];
+  ML_LOG(Info, "Headless render targets: 2x %dx%d", dims.first, dims.second);
+}
+
+void Application::BeginHeadlessFrame(MLGraphicsFrameInfo &frame_info) {
+  // Fixed head pose at the origin with a typical IPD and field of view, so frames are reproducible
+  static constexpr float kHeadlessIpd = 0.064f;
+  static constexpr float kHeadlessVerticalFov = 40.f;
+  const auto dims = graphics_context_->GetFramebufferDimensions();
+
+  frame_info.handle = ML_INVALID_HANDLE;
+  frame_info.num_virtual_cameras = camera_nodes_.size();
+  frame_info.color_id = headless_color_id_;
+  frame_info.viewport.x = 0.f;
+  frame_info.viewport.y = 0.f;
+  frame_info.viewport.w = (float)dims.first;
+  frame_info.viewport.h = (float)dims.second;
+
+  const float far_clip = frame_params_.far_clip > frame_params_.near_clip ? frame_params_.far_clip : 100.f;
+  const glm::mat4 proj = glm::perspective(glm::radians(kHeadlessVerticalFov), (float)dims.first / (float)dims.second,
+      frame_params_.near_clip, far_clip);
+  for (uint32_t camera_index = 0; camera_index < frame_info.num_virtual_cameras; ++camera_index) {
+    auto &camera = frame_info.virtual_cameras[camera_index];
+    memcpy(camera.projection.matrix_colmajor, glm::value_ptr(proj), sizeof(camera.projection.matrix_colmajor));
+    camera.transform.rotation = {};
+    camera.transform.rotation.w = 1.f;
+    camera.transform.position = {};
+    camera.transform.position.x = (camera_index == 0 ? -0.5f : 0.5f) * kHeadlessIpd;
+    camera.sync_object = ML_INVALID_HANDLE;
   }
-
-  // Setup light node
-  light_node_ = std::make_shared<ml::app_framework::Node>();
-  std::shared_ptr<LightComponent> light_component = std::make_shared<LightComponent>();
-  light_component->SetLightStrength(5.0f);
-  light_node_->AddComponent(light_component);
-  root_->AddChild(light_node_);
 }
 
 void Application::InitializeSignalHandler() {
@@ -319,6 +528,8 @@ void Application::InitializeSignalHandler() {
 }
 
 void Application::Terminate() {
+  // Finish outstanding jobs while everything they may use still exists
+  TerminateJobSystem();
   if (use_gfx_) {
     TerminateGraphics();
   }
@@ -329,6 +540,14 @@ void Application::Terminate() {
   TerminateSignalHandler();
 }
 
+void Application::TerminateJobSystem() {
+  if (job_system_) {
+    job_system_->ExecuteMainThreadJobs();
+    Registry::GetInstance()->SetJobSystem(nullptr);
+    job_system_.reset();
+  }
+}
+
 void Application::TerminateLifecycle() {
   if (lifecycle_info_) {
     MLResult ml_result = MLLifecycleFreeSelfInfo(&lifecycle_info_);
@@ -339,6 +558,7 @@ void Application::TerminateLifecycle() {
 }
 
 void Application::TerminatePerception() {
+  PerceptionRecorder::GetInstance().Stop();
   MLResult ml_result = MLPerceptionShutdown();
   if (ml_result != MLResult_Ok) {
     ML_LOG(Error, "MLPerceptionShutdown returned %d - %s", ml_result, MLGetResultString(ml_result));
@@ -346,7 +566,13 @@ void Application::TerminatePerception() {
 }
 
 void Application::TerminateGraphics() {
+  ShaderCompiler::GetInstance().Terminate();
+  Registry::GetInstance()->GetGLDeletionQueue().Flush();
+  ML_LOG(Info, "%s", Registry::GetInstance()->GetGpuMemoryTracker().Dump().c_str());
   graphics_context_->UnMakeCurrent();
+  if (headless_) {
+    return;
+  }
   MLResult ml_result = MLGraphicsDestroyClient(&graphics_client_);
   if (ml_result != MLResult_Ok) {
     ML_LOG(Error, "MLGraphicsDestroyClient returned %d - %s", ml_result, MLGetResultString(ml_result));
@@ -371,7 +597,18 @@ void Application::Update() {
     prev_update_perf_log_ += delta;
   }
 
-  OnUpdate(delta_time.count());
+  float delta_seconds = delta_time.count();
+  PerceptionRecorder &recorder = PerceptionRecorder::GetInstance();
+  if (recorder.GetMode() != PerceptionRecorder::Mode::Off) {
+    delta_seconds = recorder.BeginFrame(delta_seconds);
+    if (recorder.IsReplayFinished()) {
+      StopApp();
+      return;
+    }
+  }
+
+  job_system_->ExecuteMainThreadJobs();
+  OnUpdate(delta_seconds);
   prev_update_time_ = update_time;
 }
 
@@ -391,19 +628,62 @@ void Application::Render() {
 
   MLGraphicsFrameInfo frame_info = {};
   MLGraphicsFrameInfoInit(&frame_info);
-  MLResult out_result = MLGraphicsBeginFrameEx(graphics_client_, &frame_params_, &frame_info);
+  if (dynamic_resolution_) {
+    float budget_ms = (float)FLAGS_dynamic_resolution_budget_ms;
+    if (budget_ms <= 0.f) {
+      budget_ms = frame_pacer_ ? frame_pacer_->GetFramePeriodMs() : 1000.f / FLAGS_frame_timing_hint;
+    }
+    dynamic_resolution_->SetFrameBudget(budget_ms);
+    frame_params_.surface_scale = dynamic_resolution_->GetScale();
+  }
+
+  MLResult out_result = MLResult_Ok;
+  if (headless_) {
+    BeginHeadlessFrame(frame_info);
+  } else {
+    out_result = MLGraphicsBeginFrameEx(graphics_client_, &frame_params_, &frame_info);
+  }
   if (MLResult_Pending == out_result || MLResult_Timeout == out_result) {
     ++dropped_frames_;
+    if (frame_pacer_) {
+      // Block for a while instead of immediately asking again
+      frame_pacer_->OnFrameDropped();
+      frame_pacer_->WaitAfterDroppedFrame();
+    }
   } else if (MLResult_Ok == out_result) {
     frame_handle_ = frame_info.handle;
+    PerceptionRecorder::GetInstance().SyncCameraPoses(frame_info);
     UpdateMLCamera(frame_info);
+    Registry::GetInstance()->GetUploadManager().Process();
+    Registry::GetInstance()->GetGpuMemoryTracker().DispatchCallbacks();
+    Registry::GetInstance()->GetGeometryArena().Defragment();
+    if (dynamic_resolution_) {
+      dynamic_resolution_->BeginFrame();
+    }
     renderer_->Render();
+    if (dynamic_resolution_) {
+      dynamic_resolution_->EndFrame();
+    }
+
+    if (headless_) {
+      // Nothing consumes the frame, wait for it instead so that frame times include the GPU work
+      glFinish();
+      renderer_->ClearQueues();
+      Registry::GetInstance()->GetRenderTargetPool().EndFrame();
+      Registry::GetInstance()->GetGLDeletionQueue().EndFrame();
+      return;
+    }
 
     for (int i = 0; i < camera_nodes_.size(); ++i) {
       MLGraphicsSignalSyncObjectGL(graphics_client_, ml_sync_objs_[i]);
     }
     UNWRAP_MLRESULT(MLGraphicsEndFrame(graphics_client_, frame_handle_));
     graphics_context_->SwapBuffers();
+    frame_pacer_->OnFrameSubmitted();
+    RenderTargetPool &render_target_pool = Registry::GetInstance()->GetRenderTargetPool();
+    render_target_pool.EndFrame();
+    GLDeletionQueue &gl_deletion_queue = Registry::GetInstance()->GetGLDeletionQueue();
+    gl_deletion_queue.EndFrame();
 
     auto now = chrono::steady_clock::now();
     if (FLAGS_perf_log_rate > 0 && now - prev_gfx_perf_log_ >= chrono::duration<double>(FLAGS_perf_log_rate)) {
@@ -419,6 +699,31 @@ void Application::Render() {
       ML_LOG(Debug, "frame_duration_gpu: %.4fs", perf_info.frame_duration_gpu_ns / ns_per_s);
       ML_LOG(Debug, "frame_internal_duration_cpu: %.4fs", perf_info.frame_internal_duration_cpu_ns / ns_per_s);
       ML_LOG(Debug, "frame_internal_duration_gpu: %.4fs", perf_info.frame_internal_duration_gpu_ns / ns_per_s);
+      frame_pacer_->LogStats();
+      if (dynamic_resolution_) {
+        ML_LOG(Debug, "dynamic_resolution: scale %.3f, gpu %.2f ms, changes %u", dynamic_resolution_->GetScale(),
+               dynamic_resolution_->GetGpuTimeMs(), dynamic_resolution_->GetScaleChanges());
+      }
+      ML_LOG(Debug, "gl_deletion_queue: backlog %zu, deleted %zu in %.3f ms", gl_deletion_queue.GetBacklog(),
+             gl_deletion_queue.GetLastDeletedCount(), gl_deletion_queue.GetLastDeletionMs());
+      UploadManager &upload_manager = Registry::GetInstance()->GetUploadManager();
+      ML_LOG(Debug, "upload_manager: %" PRIu64 " bytes in %.3f ms, %" PRIu64 " pending, %" PRIu64
+             " frames over budget, %" PRIu64 " ring stalls, %" PRIu64 " direct", upload_manager.GetLastFrameBytes(),
+             upload_manager.GetLastFrameMs(), upload_manager.GetPendingBytes(),
+             upload_manager.GetBudgetDeferredFrameCount(), upload_manager.GetRingStallFrameCount(),
+             upload_manager.GetDirectUploadCount());
+      ML_LOG(Debug, "lod: %" PRIu64 " triangles drawn, %" PRIu64 " at full detail", renderer_->GetTriangleCount(),
+             renderer_->GetFullDetailTriangleCount());
+      ML_LOG(Debug, "render_target_pool: %zu targets, %" PRIu64 " created", render_target_pool.GetTargetCount(),
+             render_target_pool.GetCreatedCount());
+      const GeometryArena::Statistics geometry_arena = Registry::GetInstance()->GetGeometryArena().GetStatistics();
+      ML_LOG(Debug, "geometry_arena: %zu meshes in %zu pages, %" PRIu64 " of %" PRIu64 " KB used, %zu free ranges, "
+             "fragmentation %.2f, %" PRIu64 " KB moved", geometry_arena.allocation_count, geometry_arena.page_count,
+             geometry_arena.used_bytes / 1024, geometry_arena.capacity_bytes / 1024, geometry_arena.free_range_count,
+             geometry_arena.GetFragmentation(), geometry_arena.moved_bytes / 1024);
+      GpuMemoryTracker &gpu_memory_tracker = Registry::GetInstance()->GetGpuMemoryTracker();
+      ML_LOG(Debug, "gpu_memory: %" PRIu64 " KB used, %" PRIu64 " KB budget", gpu_memory_tracker.GetTotalUsage() / 1024,
+             gpu_memory_tracker.GetBudget() / 1024);
 
       prev_gfx_perf_log_ = now;
     }
@@ -508,6 +813,10 @@ void Application::RunApp() {
 
   Initialize();
   OnStart();
+  if (use_gfx_) {
+    // Most programs are created by now, this shows what the cache saved on startup
+    ProgramCache::GetInstance().LogStats();
+  }
   ML_LOG(Verbose, "Start loop.");
   prev_update_time_ = ApplicationClock::now();
   while (true) {
@@ -546,11 +855,23 @@ void Application::UpdateMLCamera(const MLGraphicsFrameInfo &frame_info) {
   for (uint32_t camera_index = 0; camera_index < frame_info.num_virtual_cameras; ++camera_index) {
     std::shared_ptr<CameraComponent> cam = camera_nodes_[camera_index]->GetComponent<CameraComponent>();
 
-    const MLRectf &viewport = frame_info.viewport;
-    cam->SetRenderTarget(ml_render_target_cache_[std::make_pair(frame_info.color_id, camera_index)]);
+    MLRectf viewport = frame_info.viewport;
+    auto render_target = ml_render_target_cache_[std::make_pair(frame_info.color_id, camera_index)];
+    cam->SetRenderTarget(render_target);
+
+    if (dynamic_resolution_ && render_target) {
+      // The compositor shrinks the viewport itself when it supports surface_scale, otherwise render into
+      // the scaled sub-rectangle here
+      const float scale = dynamic_resolution_->GetScale();
+      const float full_width = (float)render_target->GetColorTexture()->GetWidth();
+      if (viewport.w > scale * full_width + 1.f) {
+        viewport.w *= scale;
+        viewport.h *= scale;
+      }
+    }
 
 #ifndef ML_LUMIN
-    if (FLAGS_mirror_window && camera_index == 1) {
+    if (FLAGS_mirror_window && !headless_ && camera_index == 1) {
       // add a blit target, only for one eye
       auto dims = graphics_context_->GetFramebufferDimensions();
       if (!default_render_target_) {
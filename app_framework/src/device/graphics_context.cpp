@@ -10,6 +10,7 @@
 // ---------------------------------------------------------------------
 // %BANNER_END%
 #include <app_framework/graphics_context.h>
+#include <app_framework/ml_macros.h>
 
 #ifndef EGL_EGLEXT_PROTOTYPES
 #define EGL_EGLEXT_PROTOTYPES
@@ -20,6 +21,11 @@
 
 namespace ml {
 namespace app_framework {
+
+namespace {
+const EGLint kContextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION_KHR, 3, EGL_CONTEXT_MINOR_VERSION_KHR, 0, EGL_NONE};
+}  // namespace
+
 GraphicsContext::GraphicsContext(const char *, bool, int32_t, int32_t) {
   display_handle_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
 
@@ -33,9 +39,25 @@ GraphicsContext::GraphicsContext(const char *, bool, int32_t, int32_t) {
   EGLConfig egl_config = nullptr;
   EGLint config_size = 0;
   eglChooseConfig(display_handle_, config_attribs, &egl_config, 1, &config_size);
+  config_handle_ = egl_config;
+
+  context_handle_ = eglCreateContext(display_handle_, egl_config, EGL_NO_CONTEXT, kContextAttribs);
+}
+
+GraphicsContext::GraphicsContext(SharedTag, const GraphicsContext &parent)
+    : shared_(true), display_handle_(parent.display_handle_), config_handle_(parent.config_handle_) {
+  context_handle_ = eglCreateContext(display_handle_, config_handle_, parent.context_handle_, kContextAttribs);
+}
 
-  EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION_KHR, 3, EGL_CONTEXT_MINOR_VERSION_KHR, 0, EGL_NONE};
-  context_handle_ = eglCreateContext(display_handle_, egl_config, EGL_NO_CONTEXT, context_attribs);
+GraphicsContext *GraphicsContext::CreateSharedContext() {
+  GraphicsContext *context = new GraphicsContext(SharedTag(), *this);
+  if (context->context_handle_ == EGL_NO_CONTEXT) {
+    ML_LOG(Error, "eglCreateContext() failed for the shared context (%X)", eglGetError());
+    context->context_handle_ = nullptr;
+    delete context;
+    return nullptr;
+  }
+  return context;
 }
 
 void GraphicsContext::MakeCurrent() {
@@ -43,6 +65,10 @@ void GraphicsContext::MakeCurrent() {
 }
 
 void GraphicsContext::UnMakeCurrent() {
+  if (shared_) {
+    eglMakeCurrent(display_handle_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    return;
+  }
   eglMakeCurrent(NULL, EGL_NO_SURFACE, EGL_NO_SURFACE, NULL);
 }
 
@@ -69,8 +95,12 @@ void *GraphicsContext::GetDisplayHandle() const {
 }
 
 GraphicsContext::~GraphicsContext() {
-  eglDestroyContext(display_handle_, context_handle_);
-  eglTerminate(display_handle_);
+  if (context_handle_) {
+    eglDestroyContext(display_handle_, context_handle_);
+  }
+  if (!shared_) {
+    eglTerminate(display_handle_);
+  }
 }
 
 GraphicsContext::gl_proc_t GraphicsContext::GetProcAddress(char const *procname) {
@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include <app_framework/frame_pacer.h>
+
+#include <ml_logging.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+const uint32_t kWindowFrames = 60;
+// Consecutive windows that have to fit the 120 Hz budget before going back up
+const uint32_t kWindowsBeforeUpshift = 5;
+const std::chrono::seconds kMinTimeBetweenSwitches(2);
+// Fractions of the 120 Hz frame budget used to go down and back up, the gap between them is the hysteresis
+const float kDownshiftBudgetFraction = 0.9f;
+const float kUpshiftBudgetFraction = 0.6f;
+const float kMaxDroppedFrameRate = 0.1f;
+const float kUpshiftDroppedFrameRate = 0.01f;
+const float k120HzBudgetMs = 1000.f / 120.f;
+const std::chrono::microseconds kMinBackoff(500);
+
+const char *HintToString(MLGraphicsFrameTimingHint hint) {
+  switch (hint) {
+    case MLGraphicsFrameTimingHint_60Hz: return "60Hz";
+    case MLGraphicsFrameTimingHint_120Hz: return "120Hz";
+    default: return "Unspecified";
+  }
+}
+
+}  // namespace
+
+FramePacer::FramePacer(MLHandle graphics_client, MLGraphicsFrameTimingHint max_hint, bool adaptive)
+    : graphics_client_(graphics_client), max_hint_(max_hint), adaptive_(adaptive) {
+  SetHint(max_hint_);
+  stats_.hint_switches = 0;
+}
+
+void FramePacer::OnFrameSubmitted() {
+  backoff_ = std::chrono::microseconds(0);
+  ++window_submitted_;
+  if (adaptive_) {
+    MLGraphicsClientPerformanceInfo perf_info = {};
+    if (MLResult_Ok == MLGraphicsGetClientPerformanceInfo(graphics_client_, &perf_info)) {
+      window_cpu_ns_ += perf_info.frame_duration_cpu_ns;
+      window_gpu_ns_ += perf_info.frame_duration_gpu_ns;
+    }
+  }
+  if (window_submitted_ + window_dropped_ >= kWindowFrames) {
+    Evaluate();
+  }
+}
+
+void FramePacer::OnFrameDropped() {
+  ++window_dropped_;
+  if (window_submitted_ + window_dropped_ >= kWindowFrames) {
+    Evaluate();
+  }
+}
+
+void FramePacer::WaitAfterDroppedFrame() {
+  auto max_backoff = GetFramePeriod() / 4;
+  backoff_ = std::min(std::max(backoff_ * 2, kMinBackoff), max_backoff);
+  std::this_thread::sleep_for(backoff_);
+  stats_.total_wait += backoff_;
+}
+
+void FramePacer::Evaluate() {
+  uint32_t total = window_submitted_ + window_dropped_;
+  stats_.dropped_frame_rate = total ? float(window_dropped_) / total : 0.f;
+  stats_.cpu_frame_ms = window_submitted_ ? window_cpu_ns_ / (1e6f * window_submitted_) : 0.f;
+  stats_.gpu_frame_ms = window_submitted_ ? window_gpu_ns_ / (1e6f * window_submitted_) : 0.f;
+  window_submitted_ = 0;
+  window_dropped_ = 0;
+  window_cpu_ns_ = 0;
+  window_gpu_ns_ = 0;
+
+  if (!adaptive_ || max_hint_ != MLGraphicsFrameTimingHint_120Hz) {
+    return;
+  }
+
+  float frame_ms = std::max(stats_.cpu_frame_ms, stats_.gpu_frame_ms);
+  bool over_budget =
+      frame_ms > kDownshiftBudgetFraction * k120HzBudgetMs || stats_.dropped_frame_rate > kMaxDroppedFrameRate;
+  bool under_budget =
+      frame_ms < kUpshiftBudgetFraction * k120HzBudgetMs && stats_.dropped_frame_rate < kUpshiftDroppedFrameRate;
+  windows_under_budget_ = under_budget ? windows_under_budget_ + 1 : 0;
+
+  if (std::chrono::steady_clock::now() - last_switch_ < kMinTimeBetweenSwitches) {
+    return;
+  }
+  if (stats_.hint == MLGraphicsFrameTimingHint_120Hz && over_budget) {
+    SetHint(MLGraphicsFrameTimingHint_60Hz);
+  } else if (stats_.hint == MLGraphicsFrameTimingHint_60Hz && windows_under_budget_ >= kWindowsBeforeUpshift) {
+    SetHint(MLGraphicsFrameTimingHint_120Hz);
+  }
+}
+
+void FramePacer::SetHint(MLGraphicsFrameTimingHint hint) {
+  MLResult result = MLGraphicsSetFrameTimingHint(graphics_client_, hint);
+  if (MLResult_Ok != result) {
+    ML_LOG(Error, "MLGraphicsSetFrameTimingHint(%s) returned %d - %s", HintToString(hint), result,
+           MLGetResultString(result));
+    return;
+  }
+  if (stats_.hint != MLGraphicsFrameTimingHint_Unspecified) {
+    ML_LOG(Info, "Frame pacer: %s -> %s (cpu %.2f ms, gpu %.2f ms, dropped %.1f%%)", HintToString(stats_.hint),
+           HintToString(hint), stats_.cpu_frame_ms, stats_.gpu_frame_ms, 100.f * stats_.dropped_frame_rate);
+  }
+  stats_.hint = hint;
+  ++stats_.hint_switches;
+  windows_under_budget_ = 0;
+  last_switch_ = std::chrono::steady_clock::now();
+}
+
+std::chrono::microseconds FramePacer::GetFramePeriod() const {
+  return std::chrono::microseconds(stats_.hint == MLGraphicsFrameTimingHint_120Hz ? 8333 : 16667);
+}
+
+void FramePacer::LogStats() const {
+  ML_LOG(Debug, "frame_pacer: hint %s, cpu %.2f ms, gpu %.2f ms, dropped %.1f%%, switches %u, waited %.3f s",
+         HintToString(stats_.hint), stats_.cpu_frame_ms, stats_.gpu_frame_ms, 100.f * stats_.dropped_frame_rate,
+         stats_.hint_switches, stats_.total_wait.count() / 1e6f);
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -9,6 +9,7 @@
 #include "app_framework/gui.h"
 
 #include <app_framework/convert.h>
+#include <app_framework/perception_recorder.h>
 #include <app_framework/components/renderable_component.h>
 #include <app_framework/render/texture.h>
 
@@ -208,6 +209,11 @@ void Gui::Initialize(GraphicsContext *g, MLHandle input_handle) {
   if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
     ML_LOG(Fatal, "Framebuffer is not complete!");
   }
+  GpuMemoryTracker &tracker = Registry::GetInstance()->GetGpuMemoryTracker();
+  tracker.SetLabel(this, "gui");
+  tracker.Update(this, GpuMemoryTracker::Category::kRenderTarget,
+                 GetTextureSize(GL_RGBA8, kImguiQuadWidth, kImguiQuadHeight, 1) +
+                     GetTextureSize(GL_DEPTH24_STENCIL8, kImguiQuadWidth, kImguiQuadHeight, 1));
   ImGui::StyleColorsDark();
 
   std::shared_ptr<Mesh> quad = Registry::GetInstance()->GetResourcePool()->GetMesh<QuadMesh>();
@@ -225,6 +231,7 @@ void Gui::Cleanup() {
   glDeleteTextures(1, &imgui_color_texture_);
   glDeleteFramebuffers(1, &imgui_framebuffer_);
   glDeleteRenderbuffers(1, &imgui_depth_renderbuffer_);
+  Registry::GetInstance()->GetGpuMemoryTracker().Release(this);
   ImGui_ImplOpenGL3_Shutdown();
   if (owned_input_) {
     MLInputDestroy(input_handle_);
@@ -247,7 +254,7 @@ void Gui::BeginUpdate() {
 
   // Handle input
   MLInputControllerState input_states[MLInput_MaxControllers] = {};
-  MLInputGetControllerState(input_handle_, input_states);
+  PerceptionRecorder::GetInstance().GetControllerState(input_handle_, input_states);
   UpdateState(input_states[0]);
 
 #if ML_LUMIN
@@ -283,6 +290,31 @@ void Gui::EndUpdate() {
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void Gui::DrawGpuMemoryPanel() {
+  if (!ImGui::CollapsingHeader("GPU memory")) {
+    return;
+  }
+  static constexpr float kMegabyte = 1024.f * 1024.f;
+  GpuMemoryTracker &tracker = Registry::GetInstance()->GetGpuMemoryTracker();
+  const uint64_t usage = tracker.GetTotalUsage();
+  const uint64_t budget = tracker.GetBudget();
+  if (budget) {
+    char overlay[64];
+    snprintf(overlay, sizeof(overlay), "%.1f / %.1f MB", usage / kMegabyte, budget / kMegabyte);
+    ImGui::ProgressBar(static_cast<float>(usage) / budget, ImVec2(-1.f, 0.f), overlay);
+  } else {
+    ImGui::Text("Total: %.1f MB, no budget", usage / kMegabyte);
+  }
+  for (size_t i = 0; i < static_cast<size_t>(GpuMemoryTracker::Category::kCount); ++i) {
+    const auto category = static_cast<GpuMemoryTracker::Category>(i);
+    ImGui::Text("%s: %.2f MB", GpuMemoryTracker::GetCategoryName(category), tracker.GetUsage(category) / kMegabyte);
+  }
+  ImGui::Separator();
+  for (const auto &label_and_usage : tracker.GetLabelUsage()) {
+    ImGui::Text("%s: %.2f MB", label_and_usage.first.c_str(), label_and_usage.second / kMegabyte);
+  }
+}
+
 void Gui::UpdateState(const MLInputControllerState &input_state) {
   bool toggle_state = input_state.button_state[MLInputControllerButton_Bumper];
   if (toggle_state && !prev_toggle_state_) {
@@ -14,11 +14,28 @@
 
 #include <GLFW/glfw3.h>
 
+#if ML_LINUX
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace {
+const EGLint kHeadlessContextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION_KHR, 4, EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+                                          EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+                                          EGL_NONE};
+}  // namespace
+#endif
+
 #include <cstdlib>
 
 namespace ml {
 namespace app_framework {
 
+bool GraphicsContext::sHeadless = false;
+
 class GraphicsContextCallbacks {
 public:
   static void OnClose(GraphicsContext *instance) {
@@ -87,11 +104,113 @@ GraphicsContext::GraphicsContext(const char *title, bool window_visible, int32_t
   glfwSwapInterval(0);
 }
 
+GraphicsContext *GraphicsContext::CreateHeadless(int32_t width, int32_t height) {
+  return new GraphicsContext(HeadlessTag(), width, height);
+}
+
+GraphicsContext::GraphicsContext(HeadlessTag, int32_t width, int32_t height) {
+  frame_buffer_dimensions_ = std::make_pair(width, height);
+#if ML_LINUX
+  // Prefer the surfaceless platform, it needs neither an X server nor a GPU
+  auto get_platform_display =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  EGLDisplay display = EGL_NO_DISPLAY;
+  if (get_platform_display) {
+    display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+  EGLint major = 0;
+  EGLint minor = 0;
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+    ML_LOG(Fatal, "eglInitialize() failed (%X)", eglGetError());
+    std::exit(1);
+  }
+  ML_LOG(Info, "Headless EGL %d.%d: %s", major, minor, eglQueryString(display, EGL_VENDOR));
+  eglBindAPI(EGL_OPENGL_API);
+
+  EGLint config_attribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_RED_SIZE, 8,
+                             EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8, EGL_DEPTH_SIZE, 24, EGL_NONE};
+  EGLConfig egl_config = nullptr;
+  EGLint config_size = 0;
+  eglChooseConfig(display, config_attribs, &egl_config, 1, &config_size);
+  if (config_size == 0) {
+    // Surfaceless displays may not expose any config, EGL_KHR_no_config_context covers that case
+    egl_config = nullptr;
+  }
+
+  EGLContext context = eglCreateContext(display, egl_config, EGL_NO_CONTEXT, kHeadlessContextAttribs);
+  if (context == EGL_NO_CONTEXT) {
+    ML_LOG(Fatal, "eglCreateContext() failed (%X)", eglGetError());
+    std::exit(1);
+  }
+
+  egl_display_ = display;
+  egl_config_ = egl_config;
+  egl_context_ = context;
+  sHeadless = true;
+  MakeCurrent();
+#else
+  ML_LOG(Fatal, "Headless rendering is only supported on Linux");
+  std::exit(1);
+#endif
+}
+
+GraphicsContext::GraphicsContext(SharedTag, const GraphicsContext &parent) : shared_(true) {
+  frame_buffer_dimensions_ = std::make_pair(0, 0);
+#if ML_LINUX
+  if (parent.IsHeadless()) {
+    EGLContext context = eglCreateContext(parent.egl_display_, parent.egl_config_, parent.egl_context_,
+                                          kHeadlessContextAttribs);
+    if (context != EGL_NO_CONTEXT) {
+      egl_display_ = parent.egl_display_;
+      egl_config_ = parent.egl_config_;
+      egl_context_ = context;
+    }
+    return;
+  }
+#endif
+  // GLFW only creates contexts along with a window, the hints of the main window still apply
+  glfwWindowHint(GLFW_VISIBLE, false);
+  window_handle_ = glfwCreateWindow(1, 1, "", NULL, parent.window_handle_);
+}
+
+GraphicsContext *GraphicsContext::CreateSharedContext() {
+  GraphicsContext *context = new GraphicsContext(SharedTag(), *this);
+  if (!context->window_handle_ && !context->egl_context_) {
+    ML_LOG(Error, "Failed to create a shared context");
+    delete context;
+    return nullptr;
+  }
+  return context;
+}
+
 void GraphicsContext::MakeCurrent() {
+#if ML_LINUX
+  if (IsHeadless()) {
+    // Render targets are always application owned, so no surface is bound
+    eglMakeCurrent(egl_display_, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context_);
+    return;
+  }
+#endif
   glfwMakeContextCurrent(window_handle_);
 }
 
-void GraphicsContext::UnMakeCurrent() {}
+void GraphicsContext::UnMakeCurrent() {
+  // The main context stays current until exit, shared ones are released so another thread can destroy them
+  if (!shared_) {
+    return;
+  }
+#if ML_LINUX
+  if (IsHeadless()) {
+    eglMakeCurrent(egl_display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    return;
+  }
+#endif
+  glfwMakeContextCurrent(NULL);
+}
 
 std::pair<int32_t, int32_t> GraphicsContext::GetFramebufferDimensions() {
   return frame_buffer_dimensions_;
@@ -102,15 +221,24 @@ void GraphicsContext::SetWindowCloseCallback(std::function<void(void)> callback)
 }
 
 void GraphicsContext::SwapBuffers() {
+  if (IsHeadless()) {
+    // There is no surface to present to
+    return;
+  }
   glfwSwapBuffers(window_handle_);
   glfwPollEvents();
 }
 
 void GraphicsContext::SetTitle(const char *title) {
-  glfwSetWindowTitle(window_handle_, title);
+  if (window_handle_) {
+    glfwSetWindowTitle(window_handle_, title);
+  }
 }
 
 MLHandle GraphicsContext::GetContextHandle() const {
+  if (IsHeadless()) {
+    return reinterpret_cast<MLHandle>(egl_context_);
+  }
   return reinterpret_cast<MLHandle>(glfwGetCurrentContext());
 }
 
@@ -119,11 +247,33 @@ void *GraphicsContext::GetDisplayHandle() const {
 }
 
 GraphicsContext::~GraphicsContext() {
-  glfwDestroyWindow(window_handle_);
+#if ML_LINUX
+  if (IsHeadless()) {
+    // A shared context is released by its own thread, the main one is current on the calling thread
+    if (!shared_) {
+      eglMakeCurrent(egl_display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+    eglDestroyContext(egl_display_, egl_context_);
+    if (!shared_) {
+      eglTerminate(egl_display_);
+    }
+    egl_context_ = nullptr;
+    egl_display_ = nullptr;
+    return;
+  }
+#endif
+  if (window_handle_) {
+    glfwDestroyWindow(window_handle_);
+  }
   window_handle_ = nullptr;
 }
 
 GraphicsContext::gl_proc_t GraphicsContext::GetProcAddress(char const *procname) {
+#if ML_LINUX
+  if (sHeadless) {
+    return eglGetProcAddress(procname);
+  }
+#endif
   return glfwGetProcAddress(procname);
 }
 }  // namespace app_framework
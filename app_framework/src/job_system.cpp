@@ -0,0 +1,238 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include <app_framework/job_system.h>
+
+#include <ml_logging.h>
+
+#include <algorithm>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+// Index of the worker owned by the current thread within its JobSystem, -1 on other threads
+thread_local int32_t sWorkerIndex = -1;
+thread_local const JobSystem *sWorkerJobSystem = nullptr;
+const size_t kChunksPerWorker = 4;
+}  // namespace
+
+JobSystem::JobSystem(uint32_t worker_count) : main_thread_id_(std::this_thread::get_id()) {
+  if (worker_count == 0) {
+    uint32_t hardware_threads = std::thread::hardware_concurrency();
+    worker_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+  }
+  workers_.reserve(worker_count);
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    workers_.emplace_back(new Worker());
+  }
+  // Start the threads once all deques exist, since workers steal from each other right away
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    workers_[i]->thread = std::thread(&JobSystem::WorkerLoop, this, i);
+  }
+  ML_LOG(Debug, "Job system started with %u workers", worker_count);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stop_ = true;
+  }
+  wake_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+std::shared_ptr<JobCounter> JobSystem::Run(Job job, std::shared_ptr<JobCounter> counter) {
+  if (!counter) {
+    counter = std::make_shared<JobCounter>();
+  }
+  counter->pending_.fetch_add(1, std::memory_order_relaxed);
+  Schedule(QueuedJob{std::move(job), counter}, false);
+  return counter;
+}
+
+std::shared_ptr<JobCounter> JobSystem::RunOnMainThread(Job job, std::shared_ptr<JobCounter> counter) {
+  if (!counter) {
+    counter = std::make_shared<JobCounter>();
+  }
+  counter->pending_.fetch_add(1, std::memory_order_relaxed);
+  Schedule(QueuedJob{std::move(job), counter}, true);
+  return counter;
+}
+
+std::shared_ptr<JobCounter> JobSystem::RunAfter(const std::shared_ptr<JobCounter> &dependency, Job job,
+                                                bool main_thread, std::shared_ptr<JobCounter> counter) {
+  if (!counter) {
+    counter = std::make_shared<JobCounter>();
+  }
+  counter->pending_.fetch_add(1, std::memory_order_relaxed);
+  {
+    // Finish takes the continuations under the same lock after the count reached zero, so a continuation is
+    // either picked up there or scheduled here
+    std::lock_guard<std::mutex> lock(dependency->mutex_);
+    if (!dependency->IsDone()) {
+      dependency->continuations_.push_back(JobCounter::Continuation{std::move(job), counter, main_thread});
+      return counter;
+    }
+  }
+  Schedule(QueuedJob{std::move(job), counter}, main_thread);
+  return counter;
+}
+
+std::shared_ptr<JobCounter> JobSystem::ParallelFor(size_t begin, size_t end, size_t grain_size,
+                                                   std::function<void(size_t, size_t)> body) {
+  auto counter = std::make_shared<JobCounter>();
+  if (end <= begin) {
+    return counter;
+  }
+  if (grain_size == 0) {
+    grain_size = std::max<size_t>(1, (end - begin) / (kChunksPerWorker * (workers_.size() + 1)));
+  }
+  auto shared_body = std::make_shared<std::function<void(size_t, size_t)>>(std::move(body));
+  for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += grain_size) {
+    size_t chunk_end = std::min(end, chunk_begin + grain_size);
+    Run([shared_body, chunk_begin, chunk_end]() { (*shared_body)(chunk_begin, chunk_end); }, counter);
+  }
+  return counter;
+}
+
+void JobSystem::Wait(const std::shared_ptr<JobCounter> &counter) {
+  int32_t worker_index = GetCurrentWorkerIndex();
+  while (!counter->IsDone()) {
+    if (IsMainThread()) {
+      ExecuteMainThreadJobs();
+    }
+    if (!TryExecuteJob(worker_index)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::ExecuteMainThreadJobs() {
+  std::deque<QueuedJob> jobs;
+  {
+    std::lock_guard<std::mutex> lock(main_thread_mutex_);
+    jobs.swap(main_thread_jobs_);
+  }
+  // Jobs queued while these run are picked up next time
+  for (auto &job : jobs) {
+    Execute(job);
+  }
+}
+
+void JobSystem::WorkerLoop(uint32_t worker_index) {
+  sWorkerIndex = int32_t(worker_index);
+  sWorkerJobSystem = this;
+  while (!stop_) {
+    if (TryExecuteJob(worker_index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_cv_.wait(lock, [this]() { return stop_ || queued_jobs_.load() > 0; });
+  }
+}
+
+void JobSystem::Schedule(QueuedJob job, bool main_thread) {
+  if (main_thread) {
+    std::lock_guard<std::mutex> lock(main_thread_mutex_);
+    main_thread_jobs_.push_back(std::move(job));
+    return;
+  }
+
+  // Workers keep their own jobs local, everyone else spreads them over the workers
+  int32_t worker_index = GetCurrentWorkerIndex();
+  if (worker_index < 0) {
+    worker_index = int32_t(next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size());
+  }
+  {
+    // Count the job before it becomes visible so that a thief never sees the count drop below zero
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    ++queued_jobs_;
+  }
+  {
+    Worker &worker = *workers_[worker_index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.jobs.push_back(std::move(job));
+  }
+  wake_cv_.notify_one();
+}
+
+bool JobSystem::TryExecuteJob(int32_t worker_index) {
+  QueuedJob job;
+  if (!PopJob(worker_index, job)) {
+    return false;
+  }
+  Execute(job);
+  return true;
+}
+
+bool JobSystem::PopJob(int32_t worker_index, QueuedJob &job) {
+  // Own deque first, newest job first since its data is most likely still in cache
+  if (worker_index >= 0) {
+    Worker &worker = *workers_[worker_index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (!worker.jobs.empty()) {
+      job = std::move(worker.jobs.back());
+      worker.jobs.pop_back();
+      --queued_jobs_;
+      return true;
+    }
+  }
+
+  // Steal the oldest job of another worker
+  if (queued_jobs_.load() == 0) {
+    return false;
+  }
+  size_t worker_count = workers_.size();
+  size_t start = worker_index >= 0 ? size_t(worker_index) + 1 : next_worker_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < worker_count; ++i) {
+    size_t victim_index = (start + i) % worker_count;
+    if (int32_t(victim_index) == worker_index) {
+      continue;
+    }
+    Worker &victim = *workers_[victim_index];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      --queued_jobs_;
+      stolen_jobs_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void JobSystem::Execute(QueuedJob &job) {
+  job.function();
+  executed_jobs_.fetch_add(1, std::memory_order_relaxed);
+  Finish(job.counter);
+}
+
+void JobSystem::Finish(const std::shared_ptr<JobCounter> &counter) {
+  if (counter->pending_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  std::vector<JobCounter::Continuation> continuations;
+  {
+    std::lock_guard<std::mutex> lock(counter->mutex_);
+    continuations.swap(counter->continuations_);
+  }
+  for (auto &continuation : continuations) {
+    Schedule(QueuedJob{std::move(continuation.function), continuation.counter}, continuation.main_thread);
+  }
+}
+
+int32_t JobSystem::GetCurrentWorkerIndex() const {
+  return sWorkerJobSystem == this ? sWorkerIndex : -1;
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,507 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include <app_framework/perception_recorder.h>
+
+#include <ml_logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+const uint32_t kLogMagic = 0x52504c4d;  // "MLPR"
+const uint32_t kLogVersion = 1;
+
+struct LogHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct FramePayload {
+  double timestamp;
+  float delta_time;
+  uint32_t padding;
+};
+
+size_t Align8(size_t size) {
+  return (size + 7) & ~size_t(7);
+}
+
+uint64_t CoordinateFrameKey(const MLCoordinateFrameUID &id) {
+  return id.data[0] ^ (id.data[1] * 0x9E3779B97F4A7C15ull);
+}
+
+// Appends values to a record payload, keeping every array 8 byte aligned
+class PayloadWriter {
+public:
+  void Write(const void *data, size_t size) {
+    size_t offset = payload_.size();
+    payload_.resize(offset + Align8(size));
+    if (size) {
+      memcpy(payload_.data() + offset, data, size);
+    }
+  }
+
+  template <typename T>
+  void Write(const T &value) {
+    Write(&value, sizeof(T));
+  }
+
+  void WriteCount(uint32_t count) {
+    uint64_t value = count;
+    Write(value);
+  }
+
+  const std::vector<uint8_t> &GetPayload() const {
+    return payload_;
+  }
+
+private:
+  std::vector<uint8_t> payload_;
+};
+
+// Reads values back in the order PayloadWriter wrote them
+class PayloadReader {
+public:
+  PayloadReader(const uint8_t *data) : data_(data) {}
+
+  template <typename T>
+  T *Read(size_t count = 1) {
+    T *value = reinterpret_cast<T *>(const_cast<uint8_t *>(data_));
+    data_ += Align8(sizeof(T) * count);
+    return value;
+  }
+
+  uint32_t ReadCount() {
+    return uint32_t(*Read<uint64_t>());
+  }
+
+private:
+  const uint8_t *data_;
+};
+
+}  // namespace
+
+PerceptionRecorder::~PerceptionRecorder() {
+  Stop();
+}
+
+bool PerceptionRecorder::StartRecording(const std::string &path) {
+  Stop();
+  file_ = std::fopen(path.c_str(), "wb");
+  if (!file_) {
+    ML_LOG(Error, "Unable to open perception log %s for writing", path.c_str());
+    return false;
+  }
+  LogHeader header = {kLogMagic, kLogVersion};
+  std::fwrite(&header, sizeof(header), 1, file_);
+  recorded_bytes_ = sizeof(header);
+  recorded_frames_ = 0;
+  path_ = path;
+  mode_ = Mode::Record;
+  ML_LOG(Info, "Recording perception inputs to %s", path.c_str());
+  return true;
+}
+
+bool PerceptionRecorder::StartReplay(const std::string &path, bool realtime) {
+  Stop();
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    ML_LOG(Error, "Unable to open perception log %s", path.c_str());
+    return false;
+  }
+  std::fseek(file, 0, SEEK_END);
+  long size = std::ftell(file);
+  std::fseek(file, 0, SEEK_SET);
+  log_.assign(Align8(size > 0 ? size : 0) / sizeof(uint64_t), 0);
+  size_t read = size > 0 ? std::fread(log_.data(), 1, size, file) : 0;
+  std::fclose(file);
+
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(log_.data());
+  const LogHeader *header = reinterpret_cast<const LogHeader *>(data);
+  if (read < sizeof(LogHeader) || header->magic != kLogMagic || header->version != kLogVersion) {
+    ML_LOG(Error, "%s is not a perception log (or has an unsupported version)", path.c_str());
+    log_.clear();
+    return false;
+  }
+
+  // The first frame holds the records made before the first BeginFrame, e.g. from OnStart
+  frames_.assign(1, Frame{0.f, std::chrono::duration<double>(0), {}, {}});
+  size_t offset = Align8(sizeof(LogHeader));
+  while (offset + sizeof(RecordHeader) <= read) {
+    const RecordHeader *record = reinterpret_cast<const RecordHeader *>(data + offset);
+    if (offset + sizeof(RecordHeader) + record->size > read) {
+      ML_LOG(Warning, "Perception log %s is truncated at frame %u", path.c_str(), record->frame);
+      break;
+    }
+    if (record->type == RecordType::Frame) {
+      const FramePayload *payload = reinterpret_cast<const FramePayload *>(GetPayload(record));
+      frames_.push_back(Frame{payload->delta_time, std::chrono::duration<double>(payload->timestamp), {}, {}});
+    } else {
+      frames_.back().records.push_back(offset);
+      frames_.back().consumed.push_back(false);
+    }
+    offset += sizeof(RecordHeader) + record->size;
+  }
+
+  current_frame_ = 0;
+  realtime_ = realtime;
+  path_ = path;
+  mode_ = Mode::Replay;
+  ML_LOG(Info, "Replaying %zu frames of perception inputs from %s%s", frames_.size() - 1, path.c_str(),
+         realtime ? "" : " at maximum speed");
+  return true;
+}
+
+void PerceptionRecorder::Stop() {
+  if (mode_ == Mode::Record) {
+    FlushFrame();
+    std::fclose(file_);
+    file_ = nullptr;
+    ML_LOG(Info, "Recorded %u frames (%zu bytes) of perception inputs to %s", recorded_frames_, recorded_bytes_,
+           path_.c_str());
+  }
+  log_.clear();
+  frames_.clear();
+  last_records_.clear();
+  mode_ = Mode::Off;
+}
+
+float PerceptionRecorder::BeginFrame(float delta_time) {
+  auto now = std::chrono::steady_clock::now();
+  if (mode_ == Mode::Record) {
+    FlushFrame();
+    if (recorded_frames_ == 0) {
+      start_time_ = now;
+    }
+    ++recorded_frames_;
+    PayloadWriter writer;
+    writer.Write(FramePayload{std::chrono::duration<double>(now - start_time_).count(), delta_time, 0});
+    WriteRecord(RecordType::Frame, 0, MLResult_Ok, writer.GetPayload());
+    return delta_time;
+  }
+
+  if (mode_ != Mode::Replay || IsReplayFinished()) {
+    return delta_time;
+  }
+
+  if (current_frame_ == 0) {
+    replay_start_ = now;
+  }
+  ++current_frame_;
+  if (IsReplayFinished()) {
+    double elapsed = std::chrono::duration<double>(now - replay_start_).count();
+    size_t frame_count = frames_.size() - 1;
+    ML_LOG(Info, "Perception replay finished: %zu frames in %.3f s (%.2f fps)", frame_count, elapsed,
+           elapsed > 0. ? frame_count / elapsed : 0.);
+    return delta_time;
+  }
+
+  const Frame &frame = frames_[current_frame_];
+  if (realtime_) {
+    auto frame_offset = std::chrono::duration_cast<std::chrono::steady_clock::duration>(frame.timestamp);
+    std::this_thread::sleep_until(replay_start_ + frame_offset);
+  }
+  return frame.delta_time;
+}
+
+void PerceptionRecorder::WriteRecord(RecordType type, uint64_t key, MLResult result,
+                                     const std::vector<uint8_t> &payload) {
+  RecordHeader header = {type, uint32_t(payload.size()), result, recorded_frames_, key};
+  const uint8_t *header_bytes = reinterpret_cast<const uint8_t *>(&header);
+  frame_buffer_.insert(frame_buffer_.end(), header_bytes, header_bytes + sizeof(header));
+  frame_buffer_.insert(frame_buffer_.end(), payload.begin(), payload.end());
+}
+
+void PerceptionRecorder::FlushFrame() {
+  if (file_ && !frame_buffer_.empty()) {
+    std::fwrite(frame_buffer_.data(), 1, frame_buffer_.size(), file_);
+    recorded_bytes_ += frame_buffer_.size();
+  }
+  frame_buffer_.clear();
+}
+
+const PerceptionRecorder::RecordHeader *PerceptionRecorder::FindRecord(RecordType type, uint64_t key,
+                                                                       bool allow_previous_frames) {
+  auto key_pair = std::make_pair(type, key);
+  if (current_frame_ < frames_.size()) {
+    Frame &frame = frames_[current_frame_];
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(log_.data());
+    for (size_t i = 0; i < frame.records.size(); ++i) {
+      const RecordHeader *record = reinterpret_cast<const RecordHeader *>(data + frame.records[i]);
+      if (!frame.consumed[i] && record->type == type && record->key == key) {
+        frame.consumed[i] = true;
+        last_records_[key_pair] = record;
+        return record;
+      }
+    }
+  }
+  if (allow_previous_frames) {
+    auto last = last_records_.find(key_pair);
+    if (last != last_records_.end()) {
+      return last->second;
+    }
+  }
+  return nullptr;
+}
+
+void PerceptionRecorder::SyncCameraPoses(MLGraphicsFrameInfo &frame_info) {
+  if (mode_ == Mode::Replay) {
+    const RecordHeader *record = FindRecord(RecordType::CameraPoses, 0, true);
+    if (record) {
+      PayloadReader reader(GetPayload(record));
+      uint32_t camera_count = std::min(reader.ReadCount(), frame_info.num_virtual_cameras);
+      for (uint32_t i = 0; i < camera_count; ++i) {
+        frame_info.virtual_cameras[i].transform = *reader.Read<MLTransform>();
+        frame_info.virtual_cameras[i].projection = *reader.Read<MLMat4f>();
+      }
+    }
+  } else if (mode_ == Mode::Record) {
+    PayloadWriter writer;
+    writer.WriteCount(frame_info.num_virtual_cameras);
+    for (uint32_t i = 0; i < frame_info.num_virtual_cameras; ++i) {
+      writer.Write(frame_info.virtual_cameras[i].transform);
+      writer.Write(frame_info.virtual_cameras[i].projection);
+    }
+    WriteRecord(RecordType::CameraPoses, 0, MLResult_Ok, writer.GetPayload());
+  }
+}
+
+MLResult PerceptionRecorder::GetTransform(const MLSnapshot *snapshot, const MLCoordinateFrameUID *id,
+                                          MLTransform *out_transform) {
+  uint64_t key = CoordinateFrameKey(*id);
+  if (mode_ == Mode::Replay) {
+    const RecordHeader *record = FindRecord(RecordType::Transform, key, true);
+    if (record) {
+      *out_transform = *PayloadReader(GetPayload(record)).Read<MLTransform>();
+      return record->result;
+    }
+  }
+
+  MLResult result = MLSnapshotGetTransform(snapshot, id, out_transform);
+  if (mode_ == Mode::Record) {
+    PayloadWriter writer;
+    writer.Write(*out_transform);
+    WriteRecord(RecordType::Transform, key, result, writer.GetPayload());
+  }
+  return result;
+}
+
+MLResult PerceptionRecorder::GetControllerState(MLHandle input,
+                                                MLInputControllerState out_state[MLInput_MaxControllers]) {
+  if (mode_ == Mode::Replay) {
+    const RecordHeader *record = FindRecord(RecordType::ControllerState, 0, true);
+    if (record) {
+      memcpy(out_state, GetPayload(record), sizeof(MLInputControllerState) * MLInput_MaxControllers);
+      return record->result;
+    }
+  }
+
+  MLResult result = MLInputGetControllerState(input, out_state);
+  if (mode_ == Mode::Record) {
+    PayloadWriter writer;
+    writer.Write(out_state, sizeof(MLInputControllerState) * MLInput_MaxControllers);
+    WriteRecord(RecordType::ControllerState, 0, result, writer.GetPayload());
+  }
+  return result;
+}
+
+MLResult PerceptionRecorder::GetHandTrackingData(MLHandle hand_tracker, MLHandTrackingDataEx *out_data) {
+  if (mode_ == Mode::Replay) {
+    const RecordHeader *record = FindRecord(RecordType::HandTrackingData, 0, true);
+    if (record) {
+      *out_data = *PayloadReader(GetPayload(record)).Read<MLHandTrackingDataEx>();
+      return record->result;
+    }
+  }
+
+  MLResult result = MLHandTrackingGetDataEx(hand_tracker, out_data);
+  if (mode_ == Mode::Record) {
+    PayloadWriter writer;
+    writer.Write(*out_data);
+    WriteRecord(RecordType::HandTrackingData, 0, result, writer.GetPayload());
+  }
+  return result;
+}
+
+MLResult PerceptionRecorder::GetMeshInfoResult(MLHandle meshing_client, MLHandle request,
+                                               MLMeshingMeshInfo *out_mesh_info) {
+  if (mode_ == Mode::Replay) {
+    // A polled result that was not recorded for this frame simply has not arrived yet
+    const RecordHeader *record = FindRecord(RecordType::MeshInfoResult, 0, false);
+    if (!record) {
+      return MLResult_Pending;
+    }
+    if (record->result == MLResult_Ok) {
+      PayloadReader reader(GetPayload(record));
+      *out_mesh_info = *reader.Read<MLMeshingMeshInfo>();
+      const MLMeshingBlockInfo *blocks = reader.Read<MLMeshingBlockInfo>(out_mesh_info->data_count);
+      replay_block_infos_.assign(blocks, blocks + out_mesh_info->data_count);
+      out_mesh_info->data = replay_block_infos_.data();
+    }
+    return record->result;
+  }
+
+  MLResult result = MLMeshingGetMeshInfoResult(meshing_client, request, out_mesh_info);
+  if (mode_ == Mode::Record) {
+    PayloadWriter writer;
+    if (result == MLResult_Ok) {
+      writer.Write(*out_mesh_info);
+      writer.Write(out_mesh_info->data, sizeof(MLMeshingBlockInfo) * out_mesh_info->data_count);
+    }
+    WriteRecord(RecordType::MeshInfoResult, 0, result, writer.GetPayload());
+  }
+  return result;
+}
+
+MLResult PerceptionRecorder::GetMeshResult(MLHandle meshing_client, MLHandle request, MLMeshingMesh *out_mesh) {
+  if (mode_ == Mode::Replay) {
+    const RecordHeader *record = FindRecord(RecordType::MeshResult, 0, false);
+    if (!record) {
+      return MLResult_Pending;
+    }
+    if (record->result == MLResult_Ok) {
+      // Block arrays are handed out straight from the log, only the block structs need their pointers patched
+      PayloadReader reader(GetPayload(record));
+      *out_mesh = *reader.Read<MLMeshingMesh>();
+      replay_blocks_.resize(out_mesh->data_count);
+      for (MLMeshingBlockMesh &block : replay_blocks_) {
+        block = *reader.Read<MLMeshingBlockMesh>();
+        block.vertex = reader.Read<MLVec3f>(block.vertex_count);
+        block.normal = block.normal ? reader.Read<MLVec3f>(block.vertex_count) : nullptr;
+        block.confidence = block.confidence ? reader.Read<float>(block.vertex_count) : nullptr;
+        block.index = reader.Read<uint16_t>(block.index_count);
+      }
+      out_mesh->data = replay_blocks_.data();
+    }
+    return record->result;
+  }
+
+  MLResult result = MLMeshingGetMeshResult(meshing_client, request, out_mesh);
+  if (mode_ == Mode::Record) {
+    PayloadWriter writer;
+    if (result == MLResult_Ok) {
+      writer.Write(*out_mesh);
+      for (uint32_t i = 0; i < out_mesh->data_count; ++i) {
+        const MLMeshingBlockMesh &block = out_mesh->data[i];
+        writer.Write(block);
+        writer.Write(block.vertex, sizeof(MLVec3f) * block.vertex_count);
+        if (block.normal) {
+          writer.Write(block.normal, sizeof(MLVec3f) * block.vertex_count);
+        }
+        if (block.confidence) {
+          writer.Write(block.confidence, sizeof(float) * block.vertex_count);
+        }
+        writer.Write(block.index, sizeof(uint16_t) * block.index_count);
+      }
+    }
+    WriteRecord(RecordType::MeshResult, 0, result, writer.GetPayload());
+  }
+  return result;
+}
+
+MLResult PerceptionRecorder::GetPlanesResults(MLHandle planes_tracker, MLHandle request, MLPlane *out_results,
+                                              uint32_t *out_num_results, MLPlaneBoundariesList *out_boundaries) {
+  if (mode_ == Mode::Replay) {
+    const RecordHeader *record = FindRecord(RecordType::PlanesResults, 0, false);
+    if (!record) {
+      return MLResult_Pending;
+    }
+    if (record->result != MLResult_Ok) {
+      return record->result;
+    }
+
+    PayloadReader reader(GetPayload(record));
+    *out_num_results = reader.ReadCount();
+    memcpy(out_results, reader.Read<MLPlane>(*out_num_results), sizeof(MLPlane) * *out_num_results);
+    bool has_boundaries = reader.ReadCount() != 0;
+    if (!out_boundaries) {
+      return record->result;
+    }
+    if (!has_boundaries) {
+      out_boundaries->plane_boundaries = nullptr;
+      out_boundaries->plane_boundaries_count = 0;
+      return record->result;
+    }
+
+    // Flatten the boundary tree into three arrays, storing indices first and pointers once the arrays are final
+    *out_boundaries = *reader.Read<MLPlaneBoundariesList>();
+    replay_plane_boundaries_.resize(out_boundaries->plane_boundaries_count);
+    replay_boundaries_.clear();
+    replay_polygons_.clear();
+    std::vector<size_t> first_boundary, first_polygon;
+    for (MLPlaneBoundaries &plane_boundaries : replay_plane_boundaries_) {
+      plane_boundaries = *reader.Read<MLPlaneBoundaries>();
+      first_boundary.push_back(replay_boundaries_.size());
+      for (uint32_t i = 0; i < plane_boundaries.boundaries_count; ++i) {
+        replay_boundaries_.push_back(*reader.Read<MLPlaneBoundary>());
+        first_polygon.push_back(replay_polygons_.size());
+        for (uint32_t j = 0; j < replay_boundaries_.back().holes_count + 1; ++j) {
+          MLPolygon polygon = *reader.Read<MLPolygon>();
+          polygon.vertices = reader.Read<MLVec3f>(polygon.vertices_count);
+          replay_polygons_.push_back(polygon);
+        }
+      }
+    }
+    for (size_t i = 0; i < replay_plane_boundaries_.size(); ++i) {
+      replay_plane_boundaries_[i].boundaries = replay_boundaries_.data() + first_boundary[i];
+    }
+    for (size_t i = 0; i < replay_boundaries_.size(); ++i) {
+      replay_boundaries_[i].polygon = replay_polygons_.data() + first_polygon[i];
+      replay_boundaries_[i].holes = replay_polygons_.data() + first_polygon[i] + 1;
+    }
+    out_boundaries->plane_boundaries = replay_plane_boundaries_.data();
+    return record->result;
+  }
+
+  MLResult result = MLPlanesQueryGetResultsWithBoundaries(planes_tracker, request, out_results, out_num_results,
+                                                          out_boundaries);
+  if (mode_ == Mode::Record) {
+    PayloadWriter writer;
+    if (result == MLResult_Ok) {
+      writer.WriteCount(*out_num_results);
+      writer.Write(out_results, sizeof(MLPlane) * *out_num_results);
+      writer.WriteCount(out_boundaries ? 1 : 0);
+      if (out_boundaries) {
+        writer.Write(*out_boundaries);
+        for (uint32_t i = 0; i < out_boundaries->plane_boundaries_count; ++i) {
+          const MLPlaneBoundaries &plane_boundaries = out_boundaries->plane_boundaries[i];
+          writer.Write(plane_boundaries);
+          for (uint32_t j = 0; j < plane_boundaries.boundaries_count; ++j) {
+            const MLPlaneBoundary &boundary = plane_boundaries.boundaries[j];
+            writer.Write(boundary);
+            writer.Write(*boundary.polygon);
+            writer.Write(boundary.polygon->vertices, sizeof(MLVec3f) * boundary.polygon->vertices_count);
+            for (uint32_t k = 0; k < boundary.holes_count; ++k) {
+              writer.Write(boundary.holes[k]);
+              writer.Write(boundary.holes[k].vertices, sizeof(MLVec3f) * boundary.holes[k].vertices_count);
+            }
+          }
+        }
+      }
+    }
+    WriteRecord(RecordType::PlanesResults, 0, result, writer.GetPayload());
+  }
+  return result;
+}
+
+MLResult PerceptionRecorder::ReleasePlaneBoundaries(MLHandle planes_tracker, MLPlaneBoundariesList *boundaries) {
+  if (mode_ == Mode::Replay) {
+    // Replayed boundaries are owned by the recorder
+    return MLResult_Ok;
+  }
+  return MLPlanesReleaseBoundariesList(planes_tracker, boundaries);
+}
+
+}  // namespace app_framework
+}  // namespace ml
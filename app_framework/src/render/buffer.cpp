@@ -8,28 +8,95 @@
 // %BANNER_END%
 #include "buffer.h"
 
+#include <app_framework/registry.h>
+
+#include <algorithm>
+#include <atomic>
+
 namespace ml {
 namespace app_framework {
 
+namespace {
+
+std::atomic<uint64_t> sUpdateCount(0);
+std::atomic<uint64_t> sReallocationCount(0);
+
+GpuMemoryTracker::Category GetMemoryCategory(GLint gl_buffer_type) {
+  switch (gl_buffer_type) {
+    case GL_ARRAY_BUFFER: return GpuMemoryTracker::Category::kVertexBuffer;
+    case GL_ELEMENT_ARRAY_BUFFER: return GpuMemoryTracker::Category::kIndexBuffer;
+    case GL_UNIFORM_BUFFER: return GpuMemoryTracker::Category::kUniformBuffer;
+    default: return GpuMemoryTracker::Category::kOther;
+  }
+}
+
+}  // namespace
+
 Buffer::Buffer(Buffer::Category category, GLint gl_buffer_type)
-    : buffer_(0), gl_buffer_type_(gl_buffer_type), category_(category) {
+    : buffer_(0), gl_buffer_type_(gl_buffer_type), category_(category), size_(0), capacity_(0), reallocation_cnt_(0) {
   gl_buffer_category_ = Buffer::GetGLBufferCategory(category);
   glGenBuffers(1, &buffer_);
 }
 
 Buffer::~Buffer() {
   if (buffer_) {
-    glDeleteBuffers(1, &buffer_);
+    Registry::GetInstance()->GetGLDeletionQueue().Enqueue(GLDeletionQueue::ObjectType::kBuffer, buffer_);
     buffer_ = 0;
   }
+  Registry::GetInstance()->GetGpuMemoryTracker().Release(this);
+}
+
+void Buffer::SetMemoryLabel(const std::string &label) {
+  Registry::GetInstance()->GetGpuMemoryTracker().SetLabel(this, label);
 }
 
 void Buffer::UpdateBuffer(const char *data, uint64_t size) {
-  if (data != nullptr && size > 0) {
-    size_ = size;
-    glBindBuffer(gl_buffer_type_, buffer_);
-    glBufferData(gl_buffer_type_, size, data, gl_buffer_category_);
+  if (size == 0) {
+    size_ = 0;
+    return;
   }
+  if (data == nullptr) {
+    return;
+  }
+  ++sUpdateCount;
+  glBindBuffer(gl_buffer_type_, buffer_);
+  size_ = size;
+  if (size > capacity_) {
+    capacity_ = category_ == Category::Dynamic ? std::max(size, 2 * capacity_) : size;
+    ++reallocation_cnt_;
+    ++sReallocationCount;
+    Registry::GetInstance()->GetGpuMemoryTracker().Update(this, GetMemoryCategory(gl_buffer_type_), capacity_);
+    if (capacity_ == size) {
+      glBufferData(gl_buffer_type_, size, data, gl_buffer_category_);
+      return;
+    }
+    glBufferData(gl_buffer_type_, capacity_, nullptr, gl_buffer_category_);
+  } else if (category_ == Category::Dynamic) {
+    // Orphan the storage, the draws still reading it keep the old one and the driver doesn't need to wait for them
+    glBufferData(gl_buffer_type_, capacity_, nullptr, gl_buffer_category_);
+  }
+  glBufferSubData(gl_buffer_type_, 0, size, data);
+}
+
+void Buffer::Reserve(uint64_t size) {
+  if (size <= capacity_) {
+    return;
+  }
+  capacity_ = category_ == Category::Dynamic ? std::max(size, 2 * capacity_) : size;
+  ++reallocation_cnt_;
+  ++sReallocationCount;
+  Registry::GetInstance()->GetGpuMemoryTracker().Update(this, GetMemoryCategory(gl_buffer_type_), capacity_);
+  glBindBuffer(gl_buffer_type_, buffer_);
+  glBufferData(gl_buffer_type_, capacity_, nullptr, gl_buffer_category_);
+  size_ = 0;
+}
+
+uint64_t Buffer::GetTotalUpdateCount() {
+  return sUpdateCount;
+}
+
+uint64_t Buffer::GetTotalReallocationCount() {
+  return sReallocationCount;
 }
 }
 }
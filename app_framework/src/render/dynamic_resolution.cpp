@@ -0,0 +1,63 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+// Leave headroom for the compositor and for frame to frame variation
+const float kBudgetFraction = 0.9f;
+const float kScaleStep = 1.f / 32.f;
+}  // namespace
+
+DynamicResolution::DynamicResolution(float min_scale, float max_scale, float smoothing)
+    : min_scale_(std::min(min_scale, max_scale)),
+      max_scale_(max_scale),
+      smoothing_(std::max(0.f, std::min(smoothing, 1.f))),
+      target_scale_(max_scale),
+      scale_(max_scale) {}
+
+void DynamicResolution::BeginFrame() {
+  timer_.Begin();
+}
+
+void DynamicResolution::EndFrame() {
+  timer_.End();
+  uint64_t elapsed_ns = 0;
+  if (timer_.Poll(elapsed_ns)) {
+    Update(elapsed_ns / 1e6f);
+  }
+}
+
+void DynamicResolution::Update(float gpu_ms) {
+  gpu_ms_ = gpu_ms_ > 0.f ? gpu_ms_ + smoothing_ * (gpu_ms - gpu_ms_) : gpu_ms;
+  if (gpu_ms_ <= 0.f) {
+    return;
+  }
+
+  // The timed frame was rendered at the current scale, so the ideal scale is relative to it
+  float ideal_scale = scale_ * std::sqrt(kBudgetFraction * budget_ms_ / gpu_ms_);
+  target_scale_ += smoothing_ * (ideal_scale - target_scale_);
+  target_scale_ = std::max(min_scale_, std::min(target_scale_, max_scale_));
+
+  float scale = std::max(min_scale_, std::min(std::round(target_scale_ / kScaleStep) * kScaleStep, max_scale_));
+  if (scale != scale_) {
+    ML_LOG(Info, "Dynamic resolution: scale %.3f -> %.3f (gpu %.2f ms, budget %.2f ms)", scale_, scale, gpu_ms_,
+           budget_ms_);
+    scale_ = scale;
+    ++scale_changes_;
+  }
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,292 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "geometry_arena.h"
+
+#include <app_framework/registry.h>
+
+#include <algorithm>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+// Which of the position, normal and texture coordinate attributes are enabled
+uint32_t GetAttributeMask(bool positions, bool normals, bool tex_coords) {
+  return (positions ? 1u : 0u) | (normals ? 2u : 0u) | (tex_coords ? 4u : 0u);
+}
+
+bool IsSameLayout(const VertexLayout &lhs, const VertexLayout &rhs) {
+  return lhs.GetPositionFormat() == rhs.GetPositionFormat() && lhs.GetNormalFormat() == rhs.GetNormalFormat() &&
+         lhs.GetTexCoordFormat() == rhs.GetTexCoordFormat();
+}
+
+// Copies count units of size bytes within a buffer, the ranges don't overlap
+void CopyWithinBuffer(const Buffer &buffer, uint32_t from, uint32_t to, uint32_t count, uint32_t size) {
+  glBindBuffer(GL_COPY_READ_BUFFER, buffer.GetGLBuffer());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.GetGLBuffer());
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(from) * size,
+                      static_cast<GLintptr>(to) * size, static_cast<GLsizeiptr>(count) * size);
+}
+
+}  // namespace
+
+constexpr uint64_t GeometryArena::kPageVertexBytes;
+constexpr uint64_t GeometryArena::kPageIndexBytes;
+constexpr uint64_t GeometryArena::kDefaultDefragmentBudget;
+
+RangeAllocator::RangeAllocator(uint32_t size) : size_(size), free_count_(size) {
+  if (size) {
+    free_ranges_[0] = size;
+  }
+}
+
+bool RangeAllocator::Allocate(uint32_t count, uint32_t &offset, uint32_t limit) {
+  if (!count) {
+    offset = 0;
+    return true;
+  }
+  auto best = free_ranges_.end();
+  for (auto it = free_ranges_.begin(); it != free_ranges_.end() && it->first < limit; ++it) {
+    if (it->second >= count && it->first + count <= limit && (best == free_ranges_.end() || it->second < best->second)) {
+      best = it;
+    }
+  }
+  if (best == free_ranges_.end()) {
+    return false;
+  }
+  offset = best->first;
+  const uint32_t remaining = best->second - count;
+  free_ranges_.erase(best);
+  if (remaining) {
+    free_ranges_[offset + count] = remaining;
+  }
+  free_count_ -= count;
+  return true;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t count) {
+  if (!count) {
+    return;
+  }
+  free_count_ += count;
+  auto next = free_ranges_.lower_bound(offset);
+  if (next != free_ranges_.end() && offset + count == next->first) {
+    count += next->second;
+    next = free_ranges_.erase(next);
+  }
+  if (next != free_ranges_.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      previous->second += count;
+      return;
+    }
+  }
+  free_ranges_[offset] = count;
+}
+
+uint32_t RangeAllocator::GetLargestFreeRange() const {
+  uint32_t largest = 0;
+  for (const auto &range : free_ranges_) {
+    largest = std::max(largest, range.second);
+  }
+  return largest;
+}
+
+GeometryArena::~GeometryArena() {
+  for (const auto &page : pages_) {
+    Registry::GetInstance()->GetGLDeletionQueue().Enqueue(GLDeletionQueue::ObjectType::kVertexArray,
+                                                          page->vertex_array);
+  }
+}
+
+std::shared_ptr<GeometryArena::Allocation> GeometryArena::Allocate(const VertexLayout &vertex_layout, bool positions,
+                                                                   bool normals, bool tex_coords,
+                                                                   uint32_t vertex_count, uint32_t index_count) {
+  const uint32_t attribute_mask = GetAttributeMask(positions, normals, tex_coords);
+  const GLenum index_type = vertex_count <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  std::unique_ptr<Allocation> allocation(new Allocation{nullptr, 0, vertex_count, 0, index_count});
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &page : pages_) {
+    if (page->attribute_mask != attribute_mask || page->index_type != index_type ||
+        !IsSameLayout(page->vertex_layout, vertex_layout)) {
+      continue;
+    }
+    if (!page->vertices.Allocate(vertex_count, allocation->first_vertex)) {
+      continue;
+    }
+    if (!page->indices.Allocate(index_count, allocation->first_index)) {
+      page->vertices.Free(allocation->first_vertex, vertex_count);
+      continue;
+    }
+    allocation->page = page.get();
+    break;
+  }
+
+  if (!allocation->page) {
+    const uint32_t stride = vertex_layout.GetStride();
+    const uint32_t index_size = index_type == GL_UNSIGNED_SHORT ? 2 : 4;
+    const uint32_t page_vertices = static_cast<uint32_t>(kPageVertexBytes / stride);
+    const uint32_t page_indices = static_cast<uint32_t>(kPageIndexBytes / index_size);
+    if (vertex_count > page_vertices || index_count > page_indices) {
+      return nullptr;
+    }
+    std::unique_ptr<Page> page(new Page{vertex_layout, attribute_mask, index_type, index_size,
+                                        std::make_shared<Buffer>(Buffer::Category::Static, GL_ARRAY_BUFFER),
+                                        std::make_shared<Buffer>(Buffer::Category::Static, GL_ELEMENT_ARRAY_BUFFER),
+                                        0, RangeAllocator(page_vertices), RangeAllocator(page_indices), {}});
+    page->vertex_buffer->Reserve(static_cast<uint64_t>(page_vertices) * stride);
+    page->index_buffer->Reserve(static_cast<uint64_t>(page_indices) * index_size);
+    page->vertex_buffer->SetMemoryLabel("geometry arena");
+    page->index_buffer->SetMemoryLabel("geometry arena");
+
+    glGenVertexArrays(1, &page->vertex_array);
+    glBindVertexArray(page->vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, page->vertex_buffer->GetGLBuffer());
+    for (const auto &attribute : vertex_layout.GetAttributes()) {
+      glVertexAttribPointer(attribute.location, attribute.count, attribute.type, attribute.normalized, stride,
+                            (void *)(uintptr_t)attribute.offset);
+    }
+    vertex_layout.EnableAttributes(positions, normals, tex_coords);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->index_buffer->GetGLBuffer());
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    page->vertices.Allocate(vertex_count, allocation->first_vertex);
+    page->indices.Allocate(index_count, allocation->first_index);
+    allocation->page = page.get();
+    pages_.push_back(std::move(page));
+  }
+
+  allocation->page->allocations.insert(allocation.get());
+  return std::shared_ptr<Allocation>(allocation.release(), [this](Allocation *allocation) {
+    Free(allocation);
+    delete allocation;
+  });
+}
+
+void GeometryArena::Write(const Allocation &allocation, const char *vertex_data, const uint32_t *indices) {
+  const Page &page = *allocation.page;
+  const uint32_t stride = page.vertex_layout.GetStride();
+  glBindBuffer(GL_COPY_WRITE_BUFFER, page.vertex_buffer->GetGLBuffer());
+  glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(allocation.first_vertex) * stride,
+                  static_cast<GLsizeiptr>(allocation.vertex_count) * stride, vertex_data);
+  if (!allocation.index_count) {
+    return;
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, page.index_buffer->GetGLBuffer());
+  const GLintptr index_offset = static_cast<GLintptr>(allocation.first_index) * page.index_size;
+  if (page.index_type == GL_UNSIGNED_SHORT) {
+    const std::vector<uint16_t> narrow_indices(indices, indices + allocation.index_count);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, index_offset, narrow_indices.size() * sizeof(uint16_t),
+                    narrow_indices.data());
+  } else {
+    glBufferSubData(GL_COPY_WRITE_BUFFER, index_offset, allocation.index_count * sizeof(uint32_t), indices);
+  }
+}
+
+void GeometryArena::Free(Allocation *allocation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Page &page = *allocation->page;
+  page.vertices.Free(allocation->first_vertex, allocation->vertex_count);
+  page.indices.Free(allocation->first_index, allocation->index_count);
+  page.allocations.erase(allocation);
+}
+
+void GeometryArena::Defragment() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t budget = defragment_budget_;
+  for (auto it = pages_.begin(); it != pages_.end();) {
+    Page &page = **it;
+    if (page.allocations.empty()) {
+      Registry::GetInstance()->GetGLDeletionQueue().Enqueue(GLDeletionQueue::ObjectType::kVertexArray,
+                                                            page.vertex_array);
+      it = pages_.erase(it);
+      continue;
+    }
+    if (budget) {
+      const uint64_t moved = Compact(page, budget);
+      budget -= std::min(moved, budget);
+      moved_bytes_ += moved;
+    }
+    ++it;
+  }
+}
+
+uint64_t GeometryArena::Compact(Page &page, uint64_t budget) {
+  // Only worth it with holes, the free space of a compacted page is a single range at its end
+  if (page.vertices.GetFreeRangeCount() <= 1 && page.indices.GetFreeRangeCount() <= 1) {
+    return 0;
+  }
+  std::vector<Allocation *> allocations(page.allocations.begin(), page.allocations.end());
+  const uint32_t stride = page.vertex_layout.GetStride();
+  uint64_t moved = 0;
+
+  // The last vertex ranges first, each into the best fitting hole before it
+  std::sort(allocations.begin(), allocations.end(),
+            [](const Allocation *lhs, const Allocation *rhs) { return lhs->first_vertex > rhs->first_vertex; });
+  for (Allocation *allocation : allocations) {
+    const uint64_t bytes = static_cast<uint64_t>(allocation->vertex_count) * stride;
+    if (moved + bytes > budget) {
+      break;
+    }
+    uint32_t first_vertex = 0;
+    if (allocation->vertex_count &&
+        page.vertices.Allocate(allocation->vertex_count, first_vertex, allocation->first_vertex)) {
+      CopyWithinBuffer(*page.vertex_buffer, allocation->first_vertex, first_vertex, allocation->vertex_count,
+                       stride);
+      page.vertices.Free(allocation->first_vertex, allocation->vertex_count);
+      allocation->first_vertex = first_vertex;
+      moved += bytes;
+    }
+  }
+
+  std::sort(allocations.begin(), allocations.end(),
+            [](const Allocation *lhs, const Allocation *rhs) { return lhs->first_index > rhs->first_index; });
+  for (Allocation *allocation : allocations) {
+    const uint64_t bytes = static_cast<uint64_t>(allocation->index_count) * page.index_size;
+    if (moved + bytes > budget) {
+      break;
+    }
+    uint32_t first_index = 0;
+    if (allocation->index_count &&
+        page.indices.Allocate(allocation->index_count, first_index, allocation->first_index)) {
+      CopyWithinBuffer(*page.index_buffer, allocation->first_index, first_index, allocation->index_count,
+                       page.index_size);
+      page.indices.Free(allocation->first_index, allocation->index_count);
+      allocation->first_index = first_index;
+      moved += bytes;
+    }
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return moved;
+}
+
+GeometryArena::Statistics GeometryArena::GetStatistics() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Statistics statistics;
+  statistics.page_count = pages_.size();
+  statistics.moved_bytes = moved_bytes_;
+  for (const auto &page : pages_) {
+    const uint64_t stride = page->vertex_layout.GetStride();
+    statistics.allocation_count += page->allocations.size();
+    statistics.capacity_bytes += page->vertices.GetSize() * stride + page->indices.GetSize() * page->index_size;
+    statistics.used_bytes += (page->vertices.GetSize() - page->vertices.GetFreeCount()) * stride +
+                             (page->indices.GetSize() - page->indices.GetFreeCount()) * page->index_size;
+    statistics.free_range_count += page->vertices.GetFreeRangeCount() + page->indices.GetFreeRangeCount();
+    statistics.largest_free_bytes +=
+        page->vertices.GetLargestFreeRange() * stride + page->indices.GetLargestFreeRange() * page->index_size;
+  }
+  return statistics;
+}
+
+}  // namespace app_framework
+}  // namespace ml
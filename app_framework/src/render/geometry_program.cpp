@@ -12,9 +12,15 @@
 namespace ml {
 namespace app_framework {
 
-GeometryProgram::GeometryProgram(const char *code) : Program(code, GL_GEOMETRY_SHADER) {
+GeometryProgram::GeometryProgram(const char *code, bool async)
+    : Program(code, GL_GEOMETRY_SHADER, async), type_(GL_NONE) {}
+
+GLint GeometryProgram::GetInputPrimitiveType() {
   // Parse parameters
-  glGetProgramiv(GetGLProgram(), GL_GEOMETRY_INPUT_TYPE, &type_);
+  if (type_ == GL_NONE && IsReady()) {
+    glGetProgramiv(GetGLProgram(), GL_GEOMETRY_INPUT_TYPE, &type_);
+  }
+  return type_;
 }
 }
 }
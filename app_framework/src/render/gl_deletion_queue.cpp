@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "gl_deletion_queue.h"
+
+#include <app_framework/registry.h>
+
+#include <chrono>
+
+namespace ml {
+namespace app_framework {
+
+GLDeletionQueue::~GLDeletionQueue() {
+  // The caches notified of deleted objects are gone already, only the GL objects are left to delete
+  FenceEnqueued();
+  for (auto &batch : batches_) {
+    Delete(batch, false);
+  }
+}
+
+void GLDeletionQueue::Enqueue(ObjectType type, GLuint name) {
+  if (!name) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  enqueued_.names[static_cast<size_t>(type)].push_back(name);
+  ++enqueued_.count;
+  ++backlog_;
+}
+
+void GLDeletionQueue::EndFrame() {
+  const auto start = std::chrono::steady_clock::now();
+  FenceEnqueued();
+
+  size_t deleted_count = 0;
+  while (!batches_.empty()) {
+    Batch &batch = batches_.front();
+    const GLenum result = glClientWaitSync(batch.fence, 0, 0);
+    if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+      // The batches are fenced in order, the later ones can't be done either
+      break;
+    }
+    deleted_count += Delete(batch, true);
+    batches_.pop_front();
+  }
+
+  last_deleted_count_ = deleted_count;
+  last_deletion_ms_ = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void GLDeletionQueue::Flush() {
+  FenceEnqueued();
+  if (batches_.empty()) {
+    return;
+  }
+  glFinish();
+  for (auto &batch : batches_) {
+    Delete(batch, true);
+  }
+  batches_.clear();
+}
+
+void GLDeletionQueue::FenceEnqueued() {
+  Batch batch;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enqueued_.count) {
+      return;
+    }
+    std::swap(batch, enqueued_);
+  }
+  batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  batches_.push_back(std::move(batch));
+}
+
+size_t GLDeletionQueue::Delete(Batch &batch, bool release) {
+  auto &buffers = batch.names[static_cast<size_t>(ObjectType::kBuffer)];
+  auto &textures = batch.names[static_cast<size_t>(ObjectType::kTexture)];
+  auto &vertex_arrays = batch.names[static_cast<size_t>(ObjectType::kVertexArray)];
+  auto &framebuffers = batch.names[static_cast<size_t>(ObjectType::kFramebuffer)];
+  auto &programs = batch.names[static_cast<size_t>(ObjectType::kProgram)];
+
+  // Names are reused once deleted, forget them where they are cached
+  if (release) {
+    auto &texture_bindings = Registry::GetInstance()->GetTextureBindingCache();
+    for (GLuint texture : textures) {
+      texture_bindings.ReleaseTexture(texture);
+    }
+    auto &pipeline_states = Registry::GetInstance()->GetPipelineStateCache();
+    for (GLuint program : programs) {
+      pipeline_states.ReleaseProgram(program);
+    }
+  }
+
+  if (!buffers.empty()) {
+    glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+  }
+  if (!textures.empty()) {
+    glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+  }
+  if (!vertex_arrays.empty()) {
+    glDeleteVertexArrays(static_cast<GLsizei>(vertex_arrays.size()), vertex_arrays.data());
+  }
+  if (!framebuffers.empty()) {
+    glDeleteFramebuffers(static_cast<GLsizei>(framebuffers.size()), framebuffers.data());
+  }
+  for (GLuint program : programs) {
+    glDeleteProgram(program);
+  }
+  if (batch.fence) {
+    glDeleteSync(batch.fence);
+    batch.fence = nullptr;
+  }
+
+  const size_t count = batch.count;
+  backlog_ -= count;
+  batch.count = 0;
+  return count;
+}
+
+}  // namespace app_framework
+}  // namespace ml
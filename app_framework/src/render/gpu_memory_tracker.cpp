@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "gpu_memory_tracker.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+const char *const kUnlabeled = "unlabeled";
+
+std::string FormatLine(const char *name, uint64_t bytes) {
+  char line[256];
+  snprintf(line, sizeof(line), "  %-40s %10" PRIu64 " KB\n", name, bytes / 1024);
+  return line;
+}
+
+}  // namespace
+
+const char *GpuMemoryTracker::GetCategoryName(Category category) {
+  switch (category) {
+    case Category::kVertexBuffer: return "vertex buffers";
+    case Category::kIndexBuffer: return "index buffers";
+    case Category::kUniformBuffer: return "uniform buffers";
+    case Category::kTexture: return "textures";
+    case Category::kRenderTarget: return "render targets";
+    case Category::kStaging: return "staging";
+    default: return "other";
+  }
+}
+
+void GpuMemoryTracker::Update(const void *owner, Category category, uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Allocation &allocation = allocations_[owner];
+  category_usage_[static_cast<size_t>(allocation.category)] -= allocation.bytes;
+  total_usage_ -= allocation.bytes;
+  allocation.category = category;
+  allocation.bytes = bytes;
+  category_usage_[static_cast<size_t>(category)] += bytes;
+  total_usage_ += bytes;
+}
+
+void GpuMemoryTracker::Release(const void *owner) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = allocations_.find(owner);
+  if (it == allocations_.end()) {
+    return;
+  }
+  category_usage_[static_cast<size_t>(it->second.category)] -= it->second.bytes;
+  total_usage_ -= it->second.bytes;
+  allocations_.erase(it);
+}
+
+void GpuMemoryTracker::SetLabel(const void *owner, const std::string &label) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Objects can be labeled before they allocate
+  allocations_[owner].label = label;
+}
+
+uint64_t GpuMemoryTracker::GetUsage(Category category) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return category_usage_[static_cast<size_t>(category)];
+}
+
+uint64_t GpuMemoryTracker::GetTotalUsage() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return total_usage_;
+}
+
+std::vector<std::pair<std::string, uint64_t>> GpuMemoryTracker::GetLabelUsage() {
+  std::unordered_map<std::string, uint64_t> usage;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &owner_and_allocation : allocations_) {
+      const Allocation &allocation = owner_and_allocation.second;
+      if (allocation.bytes) {
+        usage[allocation.label.empty() ? kUnlabeled : allocation.label] += allocation.bytes;
+      }
+    }
+  }
+  std::vector<std::pair<std::string, uint64_t>> sorted(usage.begin(), usage.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<std::string, uint64_t> &lhs, const std::pair<std::string, uint64_t> &rhs) {
+              return lhs.second > rhs.second;
+            });
+  return sorted;
+}
+
+void GpuMemoryTracker::SetBudget(uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_ = bytes;
+}
+
+uint64_t GpuMemoryTracker::GetBudget() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return budget_;
+}
+
+uint64_t GpuMemoryTracker::GetHeadroom() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return budget_ > total_usage_ ? budget_ - total_usage_ : 0;
+}
+
+uint32_t GpuMemoryTracker::AddThresholdCallback(float fraction, ThresholdCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint32_t id = next_threshold_id_++;
+  thresholds_.push_back(Threshold{id, fraction, std::move(callback), false});
+  return id;
+}
+
+void GpuMemoryTracker::RemoveThresholdCallback(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  thresholds_.erase(std::remove_if(thresholds_.begin(), thresholds_.end(),
+                                   [id](const Threshold &threshold) { return threshold.id == id; }),
+                    thresholds_.end());
+}
+
+void GpuMemoryTracker::DispatchCallbacks() {
+  // Called without the lock, the callbacks are free to release memory or change the thresholds
+  std::vector<std::function<void()>> calls;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!budget_) {
+      return;
+    }
+    for (auto &threshold : thresholds_) {
+      const bool exceeded = total_usage_ > static_cast<uint64_t>(threshold.fraction * budget_);
+      if (exceeded != threshold.exceeded) {
+        threshold.exceeded = exceeded;
+        const ThresholdCallback &callback = threshold.callback;
+        const uint64_t usage = total_usage_;
+        const uint64_t budget = budget_;
+        calls.push_back([callback, exceeded, usage, budget]() { callback(exceeded, usage, budget); });
+      }
+    }
+  }
+  for (const auto &call : calls) {
+    call();
+  }
+}
+
+std::string GpuMemoryTracker::Dump() {
+  std::string dump = "GPU memory by category:\n";
+  uint64_t total = 0;
+  uint64_t budget = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t category = 0; category < static_cast<size_t>(Category::kCount); ++category) {
+      dump += FormatLine(GetCategoryName(static_cast<Category>(category)), category_usage_[category]);
+    }
+    total = total_usage_;
+    budget = budget_;
+  }
+  dump += FormatLine("total", total);
+  if (budget) {
+    dump += FormatLine("budget", budget);
+  }
+  dump += "GPU memory by label:\n";
+  for (const auto &label_and_usage : GetLabelUsage()) {
+    dump += FormatLine(label_and_usage.first.c_str(), label_and_usage.second);
+  }
+  return dump;
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "gpu_timer.h"
+
+namespace ml {
+namespace app_framework {
+
+constexpr size_t GpuTimer::kQueryCount;
+
+GpuTimer::GpuTimer() {
+  glGenQueries(kQueryCount, queries_.data());
+}
+
+GpuTimer::~GpuTimer() {
+  glDeleteQueries(kQueryCount, queries_.data());
+}
+
+void GpuTimer::Begin() {
+  if (pending_ == kQueryCount) {
+    // All queries are still in flight, skip this measurement rather than wait
+    return;
+  }
+  glBeginQuery(GL_TIME_ELAPSED, queries_[next_query_]);
+  active_ = true;
+}
+
+void GpuTimer::End() {
+  if (!active_) {
+    return;
+  }
+  glEndQuery(GL_TIME_ELAPSED);
+  next_query_ = (next_query_ + 1) % kQueryCount;
+  ++pending_;
+  active_ = false;
+}
+
+bool GpuTimer::Poll(uint64_t &elapsed_ns) {
+  bool has_result = false;
+  while (pending_ > 0) {
+    GLuint query = queries_[(next_query_ + kQueryCount - pending_) % kQueryCount];
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      break;
+    }
+    GLuint64 result = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+    elapsed_ns = result;
+    has_result = true;
+    --pending_;
+  }
+  return has_result;
+}
+
+}  // namespace app_framework
+}  // namespace ml
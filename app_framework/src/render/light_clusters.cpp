@@ -0,0 +1,368 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "light_clusters.h"
+
+#include <app_framework/job_system.h>
+#include <app_framework/node.h>
+#include <app_framework/registry.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define LIGHT_CLUSTERS_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LIGHT_CLUSTERS_NEON 1
+#endif
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+const char *kClusterLightsName = "ClusterLights";
+const char *kClusterRangesName = "ClusterRanges";
+const char *kClusterLightIndicesName = "ClusterLightIndices";
+const uint32_t kClusterTextureCount = 3;
+
+// Far bound of the last slice, which takes every fragment past the far depth
+const float kUnboundedDepth = 1.0e4f;
+const size_t kInitialLightCapacity = 64;
+const size_t kInitialIndexCapacity = 4096;
+
+// Returns a mask with bit i set if sphere offset + i of the slice lights intersects the box
+uint32_t IntersectSpheres4(const std::vector<float> &x, const std::vector<float> &y, const std::vector<float> &z,
+                           const std::vector<float> &radius_sq, size_t offset, const glm::vec3 &box_min,
+                           const glm::vec3 &box_max) {
+#if defined(LIGHT_CLUSTERS_SSE)
+  const __m128 px = _mm_loadu_ps(&x[offset]);
+  const __m128 py = _mm_loadu_ps(&y[offset]);
+  const __m128 pz = _mm_loadu_ps(&z[offset]);
+  // Distance to the closest point of the box
+  const __m128 dx = _mm_sub_ps(px, _mm_min_ps(_mm_max_ps(px, _mm_set1_ps(box_min.x)), _mm_set1_ps(box_max.x)));
+  const __m128 dy = _mm_sub_ps(py, _mm_min_ps(_mm_max_ps(py, _mm_set1_ps(box_min.y)), _mm_set1_ps(box_max.y)));
+  const __m128 dz = _mm_sub_ps(pz, _mm_min_ps(_mm_max_ps(pz, _mm_set1_ps(box_min.z)), _mm_set1_ps(box_max.z)));
+  const __m128 distance_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+  return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(distance_sq, _mm_loadu_ps(&radius_sq[offset])));
+#elif defined(LIGHT_CLUSTERS_NEON)
+  const float32x4_t px = vld1q_f32(&x[offset]);
+  const float32x4_t py = vld1q_f32(&y[offset]);
+  const float32x4_t pz = vld1q_f32(&z[offset]);
+  const float32x4_t dx = vsubq_f32(px, vminq_f32(vmaxq_f32(px, vdupq_n_f32(box_min.x)), vdupq_n_f32(box_max.x)));
+  const float32x4_t dy = vsubq_f32(py, vminq_f32(vmaxq_f32(py, vdupq_n_f32(box_min.y)), vdupq_n_f32(box_max.y)));
+  const float32x4_t dz = vsubq_f32(pz, vminq_f32(vmaxq_f32(pz, vdupq_n_f32(box_min.z)), vdupq_n_f32(box_max.z)));
+  const float32x4_t distance_sq = vmlaq_f32(vmlaq_f32(vmulq_f32(dx, dx), dy, dy), dz, dz);
+  const uint32_t lane_bits[4] = {1, 2, 4, 8};
+  const uint32x4_t hits = vandq_u32(vcleq_f32(distance_sq, vld1q_f32(&radius_sq[offset])), vld1q_u32(lane_bits));
+  const uint32x2_t sum = vadd_u32(vget_low_u32(hits), vget_high_u32(hits));
+  return vget_lane_u32(vpadd_u32(sum, sum), 0);
+#else
+  uint32_t mask = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    const glm::vec3 p(x[offset + i], y[offset + i], z[offset + i]);
+    const glm::vec3 d = p - glm::clamp(p, box_min, box_max);
+    if (glm::dot(d, d) <= radius_sq[offset + i]) {
+      mask |= 1u << i;
+    }
+  }
+  return mask;
+#endif
+}
+
+// Grows the data store of a buffer to at least size bytes, keeping it if it's large enough
+void ReserveBuffer(GLuint buffer, size_t size, size_t &capacity) {
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+  if (size > capacity) {
+    capacity = std::max(size, capacity * 2);
+    glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+  }
+}
+
+void CreateTextureBuffer(GLenum format, size_t capacity, GLuint &buffer, GLuint &texture) {
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+  glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_BUFFER, texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+}  // namespace
+
+LightClusters::LightClusters()
+    : near_depth_(0.1f),
+      far_depth_(50.f),
+      camera_count_(0),
+      directional_light_count_(0),
+      light_capacity_(kInitialLightCapacity * sizeof(Light)) {
+  CreateTextureBuffer(GL_RGBA32F, light_capacity_, light_buffer_, light_texture_);
+
+  GLint texture_units = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &texture_units);
+  texture_unit_base_ = texture_units - kClusterTextureCount;
+  Registry::GetInstance()->GetGpuMemoryTracker().SetLabel(this, "light clusters");
+}
+
+LightClusters::~LightClusters() {
+  // The textures are deleted here rather than through the GL deletion queue, the binding cache must forget them
+  auto &texture_bindings = Registry::GetInstance()->GetTextureBindingCache();
+  for (const auto &clusters : cameras_) {
+    texture_bindings.ReleaseTexture(clusters->range_texture);
+    texture_bindings.ReleaseTexture(clusters->index_texture);
+    glDeleteBuffers(1, &clusters->uniform_buffer);
+    glDeleteBuffers(1, &clusters->range_buffer);
+    glDeleteBuffers(1, &clusters->index_buffer);
+    glDeleteTextures(1, &clusters->range_texture);
+    glDeleteTextures(1, &clusters->index_texture);
+  }
+  glDeleteBuffers(1, &light_buffer_);
+  texture_bindings.ReleaseTexture(light_texture_);
+  glDeleteTextures(1, &light_texture_);
+  Registry::GetInstance()->GetGpuMemoryTracker().Release(this);
+}
+
+void LightClusters::SetDepthRange(float near_depth, float far_depth) {
+  ML_LOG_IF(Fatal, near_depth <= 0.f || far_depth <= near_depth, "Invalid light cluster depth range %f-%f",
+            near_depth, far_depth);
+  near_depth_ = near_depth;
+  far_depth_ = far_depth;
+}
+
+float LightClusters::GetSliceDepth(uint32_t slice) const {
+  return near_depth_ * std::pow(far_depth_ / near_depth_, (float)slice / kSlices);
+}
+
+void LightClusters::Assign(const std::vector<std::shared_ptr<CameraComponent>> &cameras,
+                           const std::vector<Light> &lights) {
+  // Directional lights first, the shaders apply them to every fragment
+  lights_.clear();
+  point_lights_.clear();
+  for (const auto &light : lights) {
+    if (light.light_type != (float)LightType::Point) {
+      lights_.push_back(light);
+    }
+  }
+  directional_light_count_ = std::min<uint32_t>(lights_.size(), LightComponent::MAXIMUM_LIGHTS);
+  lights_.resize(directional_light_count_);
+  for (const auto &light : lights) {
+    if (light.light_type == (float)LightType::Point && lights_.size() < LightComponent::MAXIMUM_LIGHTS) {
+      lights_.push_back(light);
+      point_lights_.push_back(glm::vec4(light.light_position, light.light_range));
+    }
+  }
+
+  camera_count_ = cameras.size();
+  while (cameras_.size() < camera_count_) {
+    std::unique_ptr<CameraClusters> clusters(new CameraClusters());
+    clusters->corner_rays.resize((kTilesX + 1) * (kTilesY + 1));
+    clusters->ranges.resize(kClusterCount);
+    clusters->slice_lights.resize(kSlices);
+    clusters->slice_indices.resize(kSlices);
+    cameras_.push_back(std::move(clusters));
+  }
+  for (size_t i = 0; i < camera_count_; ++i) {
+    PrepareCamera(*cameras[i], *cameras_[i]);
+  }
+
+  // One job per depth slice of each camera
+  auto assign_slices = [this](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      AssignSlice(*cameras_[i / kSlices], i % kSlices);
+    }
+  };
+  JobSystem *job_system = Registry::GetInstance()->GetJobSystem();
+  if (job_system && job_system->GetWorkerCount()) {
+    job_system->Wait(job_system->ParallelFor(0, camera_count_ * kSlices, 1, assign_slices));
+  } else {
+    assign_slices(0, camera_count_ * kSlices);
+  }
+
+  // Concatenate the slices, the ranges were relative to the indices of their slice
+  for (size_t i = 0; i < camera_count_; ++i) {
+    CameraClusters &clusters = *cameras_[i];
+    clusters.indices.clear();
+    for (uint32_t slice = 0; slice < kSlices; ++slice) {
+      const uint32_t base = clusters.indices.size();
+      const uint32_t first_cluster = slice * kTilesX * kTilesY;
+      for (uint32_t cluster = first_cluster; cluster < first_cluster + kTilesX * kTilesY; ++cluster) {
+        clusters.ranges[cluster].x += base;
+      }
+      const auto &slice_indices = clusters.slice_indices[slice];
+      clusters.indices.insert(clusters.indices.end(), slice_indices.begin(), slice_indices.end());
+    }
+  }
+}
+
+void LightClusters::PrepareCamera(const CameraComponent &camera, CameraClusters &clusters) {
+  const glm::mat4 view = glm::inverse(camera.GetNode()->GetWorldTransform());
+  const glm::mat4 inverse_projection = glm::inverse(camera.GetProjectionMatrix());
+
+  // Rays through the tile corners, at any depth in front of the camera they work for both depth conventions
+  for (uint32_t y = 0; y <= kTilesY; ++y) {
+    for (uint32_t x = 0; x <= kTilesX; ++x) {
+      const glm::vec4 ndc(-1.f + 2.f * x / kTilesX, -1.f + 2.f * y / kTilesY, 0.5f, 1.f);
+      const glm::vec4 corner = inverse_projection * ndc;
+      const glm::vec3 position = glm::vec3(corner) / corner.w;
+      clusters.corner_rays[y * (kTilesX + 1) + x] = position / -position.z;
+    }
+  }
+
+  const float log_depth_ratio = std::log(far_depth_ / near_depth_);
+  const float slice_scale = kSlices / log_depth_ratio;
+  const float slice_bias = -(float)kSlices * std::log(near_depth_) / log_depth_ratio;
+  clusters.ubo.view = view;
+  clusters.ubo.viewport = camera.GetViewport();
+  clusters.ubo.depth_params = glm::vec4(slice_scale, slice_bias, 0.f, 0.f);
+  clusters.ubo.grid = glm::ivec4(kTilesX, kTilesY, kSlices, directional_light_count_);
+
+  auto get_slice = [&](float depth) {
+    if (depth <= near_depth_) {
+      return 0;
+    }
+    return glm::clamp((int32_t)std::floor(std::log(depth) * slice_scale + slice_bias), 0, (int32_t)kSlices - 1);
+  };
+
+  // Bin the point lights by the slices their sphere overlaps
+  for (auto &slice_lights : clusters.slice_lights) {
+    slice_lights.x.clear();
+    slice_lights.y.clear();
+    slice_lights.z.clear();
+    slice_lights.radius_sq.clear();
+    slice_lights.index.clear();
+  }
+  for (size_t i = 0; i < point_lights_.size(); ++i) {
+    const glm::vec4 position = view * glm::vec4(glm::vec3(point_lights_[i]), 1.f);
+    const float radius = point_lights_[i].w;
+    const float depth = -position.z;
+    if (depth + radius <= 0.f) {
+      continue;
+    }
+    const int32_t last_slice = get_slice(depth + radius);
+    for (int32_t slice = get_slice(depth - radius); slice <= last_slice; ++slice) {
+      SliceLights &slice_lights = clusters.slice_lights[slice];
+      slice_lights.x.push_back(position.x);
+      slice_lights.y.push_back(position.y);
+      slice_lights.z.push_back(position.z);
+      slice_lights.radius_sq.push_back(radius * radius);
+      slice_lights.index.push_back(directional_light_count_ + i);
+    }
+  }
+  // A negative radius never intersects, so the padding lights are never assigned
+  for (auto &slice_lights : clusters.slice_lights) {
+    while (slice_lights.x.size() % 4) {
+      slice_lights.x.push_back(0.f);
+      slice_lights.y.push_back(0.f);
+      slice_lights.z.push_back(0.f);
+      slice_lights.radius_sq.push_back(-1.f);
+      slice_lights.index.push_back(0);
+    }
+  }
+}
+
+void LightClusters::AssignSlice(CameraClusters &clusters, uint32_t slice) {
+  const float near_depth = slice == 0 ? 0.f : GetSliceDepth(slice);
+  const float far_depth = slice == kSlices - 1 ? kUnboundedDepth : GetSliceDepth(slice + 1);
+  const SliceLights &lights = clusters.slice_lights[slice];
+  std::vector<uint16_t> &indices = clusters.slice_indices[slice];
+  indices.clear();
+
+  for (uint32_t y = 0; y < kTilesY; ++y) {
+    for (uint32_t x = 0; x < kTilesX; ++x) {
+      // Bounding box of the cluster, from the four corner rays between the depths of the slice
+      glm::vec3 box_min(std::numeric_limits<float>::max());
+      glm::vec3 box_max(-std::numeric_limits<float>::max());
+      for (uint32_t corner = 0; corner < 4; ++corner) {
+        const glm::vec3 &ray = clusters.corner_rays[(y + corner / 2) * (kTilesX + 1) + x + corner % 2];
+        box_min = glm::min(box_min, glm::min(ray * near_depth, ray * far_depth));
+        box_max = glm::max(box_max, glm::max(ray * near_depth, ray * far_depth));
+      }
+
+      const uint32_t offset = indices.size();
+      for (size_t i = 0; i < lights.x.size(); i += 4) {
+        const uint32_t mask = IntersectSpheres4(lights.x, lights.y, lights.z, lights.radius_sq, i, box_min, box_max);
+        for (uint32_t lane = 0; mask >> lane; ++lane) {
+          if (mask & (1u << lane)) {
+            indices.push_back(lights.index[i + lane]);
+          }
+        }
+      }
+      const uint32_t cluster = (slice * kTilesY + y) * kTilesX + x;
+      clusters.ranges[cluster] = glm::uvec2(offset, indices.size() - offset);
+    }
+  }
+}
+
+void LightClusters::Upload() {
+  ReserveBuffer(light_buffer_, lights_.size() * sizeof(Light), light_capacity_);
+  glBufferSubData(GL_TEXTURE_BUFFER, 0, lights_.size() * sizeof(Light), lights_.data());
+  uint64_t memory_usage = light_capacity_;
+
+  for (size_t i = 0; i < camera_count_; ++i) {
+    CameraClusters &clusters = *cameras_[i];
+    if (!clusters.uniform_buffer) {
+      glGenBuffers(1, &clusters.uniform_buffer);
+      glBindBuffer(GL_UNIFORM_BUFFER, clusters.uniform_buffer);
+      glBufferData(GL_UNIFORM_BUFFER, sizeof(ClustersUBO), nullptr, GL_DYNAMIC_DRAW);
+      CreateTextureBuffer(GL_RG32UI, kClusterCount * sizeof(glm::uvec2), clusters.range_buffer, clusters.range_texture);
+      clusters.index_capacity = kInitialIndexCapacity * sizeof(uint16_t);
+      CreateTextureBuffer(GL_R16UI, clusters.index_capacity, clusters.index_buffer, clusters.index_texture);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, clusters.uniform_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ClustersUBO), &clusters.ubo);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, clusters.range_buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, kClusterCount * sizeof(glm::uvec2), clusters.ranges.data());
+
+    ReserveBuffer(clusters.index_buffer, clusters.indices.size() * sizeof(uint16_t), clusters.index_capacity);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, clusters.indices.size() * sizeof(uint16_t), clusters.indices.data());
+    memory_usage += sizeof(ClustersUBO) + kClusterCount * sizeof(glm::uvec2) + clusters.index_capacity;
+  }
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  Registry::GetInstance()->GetGpuMemoryTracker().Update(this, GpuMemoryTracker::Category::kOther, memory_usage);
+}
+
+void LightClusters::Bind(const Program &program, size_t camera_index) const {
+  if (camera_index >= camera_count_) {
+    return;
+  }
+  const CameraClusters &clusters = *cameras_[camera_index];
+
+  const auto &blocks = program.GetUniformBlocks();
+  auto block_it = blocks.find(UniformName::kClusters);
+  if (block_it != blocks.end()) {
+    glBindBufferBase(GL_UNIFORM_BUFFER, block_it->second.binding, clusters.uniform_buffer);
+  }
+
+  const char *names[kClusterTextureCount] = {kClusterLightsName, kClusterRangesName, kClusterLightIndicesName};
+  const GLuint textures[kClusterTextureCount] = {light_texture_, clusters.range_texture, clusters.index_texture};
+  const auto &uniforms = program.GetUniforms();
+  auto &texture_bindings = Registry::GetInstance()->GetTextureBindingCache();
+  for (uint32_t i = 0; i < kClusterTextureCount; ++i) {
+    auto uniform_it = uniforms.find(names[i]);
+    if (uniform_it == uniforms.end()) {
+      continue;
+    }
+    // Through the cache, so the materials drawn next see these units as taken
+    texture_bindings.Bind(texture_unit_base_ + i, GL_TEXTURE_BUFFER, textures[i], 0);
+    glProgramUniform1i(program.GetGLProgram(), uniform_it->second.location, texture_unit_base_ + i);
+  }
+  glActiveTexture(GL_TEXTURE0);
+}
+
+size_t LightClusters::GetLightIndexCount(size_t camera_index) const {
+  return camera_index < camera_count_ ? cameras_[camera_index]->indices.size() : 0;
+}
+
+}  // namespace app_framework
+}  // namespace ml
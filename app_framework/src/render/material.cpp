@@ -8,90 +8,313 @@
 // %BANNER_END%
 #include "material.h"
 
+#include <app_framework/registry.h>
+
+#include <algorithm>
+
 namespace ml {
 namespace app_framework {
 
-Material::Material(const Material& rhs) {
-  dirty_ = true;
-  SetVertexProgram(rhs.vert_);
-  SetGeometryProgram(rhs.geom_);
-  SetFragmentProgram(rhs.frag_);
+namespace {
+
+// Bytes a block member takes, std140 bools are 32 bits while the reflection reports the size of a C++ bool
+uint64_t GetStd140Size(const UniformDescription &des) {
+  return des.type == GL_BOOL ? des.size * sizeof(uint32_t) : des.size;
+}
+
+// Texture type a sampler reads, GL_NONE for the ones that aren't checked
+GLenum GetSamplerTextureType(GLenum sampler_type) {
+  switch (sampler_type) {
+    case GL_SAMPLER_2D:
+      return GL_TEXTURE_2D;
+    case GL_SAMPLER_2D_ARRAY:
+      return GL_TEXTURE_2D_ARRAY;
+    case GL_SAMPLER_CUBE:
+      return GL_TEXTURE_CUBE_MAP;
+    case GL_SAMPLER_3D:
+      return GL_TEXTURE_3D;
+    default:
+      return GL_NONE;
+  }
+}
+
+// A texture bound to a sampler of another type reads as black, or is undefined
+bool IsTextureCompatible(const MaterialTemplate::TextureUnit &unit, const std::shared_ptr<Texture> &texture) {
+  const GLenum texture_type = GetSamplerTextureType(unit.type);
+  return !texture || texture_type == GL_NONE || texture->GetTextureType() == texture_type;
+}
+
+}  // namespace
 
-  // Copy all uniform values
-  for (const auto rhs_pair : rhs.variables_by_name_) {
-    auto lhs_it = variables_by_name_.find(rhs_pair.first);
-    lhs_it->second->CopyValue(rhs_pair.second);
+Material::Material(std::shared_ptr<MaterialTemplate> material_template) : dirty_(true) {
+  SetTemplate(material_template);
+}
+
+Material::Material(const Material& rhs)
+    : dirty_(true),
+      template_(rhs.template_),
+      parameters_(rhs.parameters_),
+      textures_(rhs.textures_),
+      inactive_parameters_(rhs.inactive_parameters_),
+      layout_(rhs.layout_),
+      parameter_size_(rhs.parameter_size_),
+      alpha_blending_enabled_(rhs.alpha_blending_enabled_),
+      depth_write_enabled_(rhs.depth_write_enabled_),
+      polygon_mode_(rhs.polygon_mode_),
+      pipeline_state_(rhs.pipeline_state_) {
+  if (parameter_size_) {
+    parameter_offset_ = Registry::GetInstance()->GetMaterialParameterArena().Allocate(parameter_size_);
   }
 }
 
 Material::~Material() {
-  if(uniform_buffer_) {
-    glDeleteBuffers(1, &uniform_buffer_);
+  if (parameter_size_) {
+    Registry::GetInstance()->GetMaterialParameterArena().Free(parameter_offset_, parameter_size_);
+  }
+}
+
+void Material::SetVertexProgram(std::shared_ptr<VertexProgram> program) {
+  SetTemplate(Registry::GetInstance()->GetResourcePool()->GetMaterialTemplate(program, GetGeometryProgram(),
+                                                                              GetFragmentProgram()));
+}
+
+void Material::SetGeometryProgram(std::shared_ptr<GeometryProgram> program) {
+  SetTemplate(Registry::GetInstance()->GetResourcePool()->GetMaterialTemplate(GetVertexProgram(), program,
+                                                                              GetFragmentProgram()));
+}
+
+void Material::SetFragmentProgram(std::shared_ptr<FragmentProgram> program) {
+  SetTemplate(Registry::GetInstance()->GetResourcePool()->GetMaterialTemplate(GetVertexProgram(),
+                                                                              GetGeometryProgram(), program));
+}
+
+bool Material::IsReady() {
+  if (!template_) {
+    return false;
+  }
+  if (layout_) {
+    return true;
+  }
+  if (!template_->IsReady()) {
+    return false;
+  }
+  RestoreParameters();
+  return true;
+}
+
+void Material::UpdatePipelineState() {
+  if (!template_) {
+    pipeline_state_ = PipelineStateCache::kInvalidId;
+    return;
+  }
+  PipelineStateDescription description;
+  auto vert = template_->GetVertexProgram();
+  auto geom = template_->GetGeometryProgram();
+  auto frag = template_->GetFragmentProgram();
+  description.vertex_program = vert ? vert->GetGLProgram() : 0;
+  description.geometry_program = geom ? geom->GetGLProgram() : 0;
+  description.fragment_program = frag ? frag->GetGLProgram() : 0;
+  description.polygon_mode = polygon_mode_;
+  description.blend_enabled = alpha_blending_enabled_;
+  description.depth_write_enabled = depth_write_enabled_;
+  pipeline_state_ = Registry::GetInstance()->GetPipelineStateCache().GetId(description);
+}
+
+MaterialParameter Material::FindParameter(const std::string &name) const {
+  MaterialParameter parameter;
+  parameter.layout = GetLayout();
+  if (!template_ || !layout_) {
+    return parameter;
+  }
+  for (const auto &des : template_->GetBlockDescription().entries) {
+    if (des.name == name) {
+      parameter.offset = static_cast<uint32_t>(des.offset);
+      parameter.type = des.type;
+      return parameter;
+    }
+  }
+  const auto &texture_units = template_->GetTextureUnits();
+  for (size_t i = 0; i < texture_units.size(); ++i) {
+    if (texture_units[i].name == name) {
+      parameter.offset = static_cast<uint32_t>(i);
+      parameter.type = texture_units[i].type;
+      return parameter;
+    }
+  }
+  return parameter;
+}
+
+void Material::CheckParameter(const MaterialParameter &parameter, GLenum type, size_t size) const {
+  ML_LOG_IF(Fatal, parameter.layout != GetLayout(), "Material parameter handle resolved against another layout");
+  ML_LOG_IF(Fatal, parameter.type != type, "Material parameter declared as type %x, accessed as %x", parameter.type,
+            type);
+  ML_LOG_IF(Fatal, parameter.offset + size > parameters_.size(),
+            "Material parameter at offset %u, size %zu is out of the %zu bytes block", parameter.offset, size,
+            parameters_.size());
+}
+
+void Material::SetInactiveParameter(const char *name, GLenum type, const void *value, size_t size) {
+  const char *bytes = static_cast<const char *>(value);
+  auto &inactive = inactive_parameters_[name];
+  inactive.type = type;
+  inactive.value.assign(bytes, bytes + size);
+}
+
+void Material::GetInactiveParameter(const char *name, GLenum type, void *value, size_t size) const {
+  auto it = inactive_parameters_.find(name);
+  if (it != inactive_parameters_.end() && it->second.type == type && it->second.value.size() == size) {
+    memcpy(value, it->second.value.data(), size);
+  }
+}
+
+void Material::SetParameter(const MaterialParameter &parameter, const char *name,
+                            const std::shared_ptr<Texture> &texture) {
+  if (parameter.IsValid()) {
+    SetParameter(parameter, texture);
+    return;
+  }
+  // The sampler type isn't known until a template has the parameter, textures are restored whatever it is
+  inactive_parameters_[name] = InactiveParameter{GL_NONE, {}, texture};
+}
+
+void Material::SetParameter(const MaterialParameter &parameter, const std::shared_ptr<Texture> &texture) {
+  if (!parameter.IsValid()) {
+    return;
+  }
+  ML_LOG_IF(Fatal, parameter.layout != GetLayout(), "Material parameter handle resolved against another layout");
+  ML_LOG_IF(Fatal, parameter.offset >= textures_.size(), "Material parameter %x is not a texture", parameter.type);
+  const auto &unit = template_->GetTextureUnits()[parameter.offset];
+  if (!IsTextureCompatible(unit, texture)) {
+    ML_LOG(Error, "Texture of type %x rejected by the sampler %s of type %x", texture->GetTextureType(),
+           unit.name.c_str(), unit.type);
+    return;
+  }
+  textures_[parameter.offset] = texture;
+  UpdateTextureLayer(parameter.offset);
+}
+
+template <>
+std::shared_ptr<Texture> Material::GetParameter<std::shared_ptr<Texture>>(const MaterialParameter &parameter) const {
+  if (!parameter.IsValid()) {
+    return nullptr;
+  }
+  ML_LOG_IF(Fatal, parameter.layout != GetLayout(), "Material parameter handle resolved against another layout");
+  ML_LOG_IF(Fatal, parameter.offset >= textures_.size(), "Material parameter %x is not a texture", parameter.type);
+  return textures_[parameter.offset];
+}
+
+template <>
+std::shared_ptr<Texture> Material::GetParameter<std::shared_ptr<Texture>>(const MaterialParameter &parameter,
+                                                                          const char *name) const {
+  if (parameter.IsValid()) {
+    return GetParameter<std::shared_ptr<Texture>>(parameter);
   }
+  auto it = inactive_parameters_.find(name);
+  return it != inactive_parameters_.end() ? it->second.texture : nullptr;
 }
 
 void Material::UpdateMaterialUniformBuffer() {
-  // Pack the buffer
-  for (const auto& des : blk_desc_.entries) {
-    auto variable = variables_by_name_[des.name];
-    const auto& variable_size = variable->GetSize();
-    const auto& variable_name = variable->GetName();
-
-    ML_LOG_IF(Fatal, des.name != variable_name,
-              "Name of the entry in the shader(%s) and variable(%s) are different",
-              des.name.c_str(), variable_name.c_str());
-    ML_LOG_IF(Fatal, des.size != variable_size,
-              "Size of the entry in the shader(%" PRIu64 ") and variable(%" PRIu64 ") are different",
-              des.size, variable_size);
-    memcpy(ubo_cache_.data() + des.offset, variable->GetMemoryPtr(), variable_size);
-  }
-  glBindBuffer(GL_UNIFORM_BUFFER, uniform_buffer_);
-  glBufferData(GL_UNIFORM_BUFFER, ubo_cache_.size(), ubo_cache_.data(), GL_DYNAMIC_DRAW);
+  if (!dirty_) {
+    return;
+  }
+  if (parameter_size_) {
+    auto &arena = Registry::GetInstance()->GetMaterialParameterArena();
+    memcpy(arena.GetData(parameter_offset_), parameters_.data(), parameter_size_);
+    arena.MarkDirty(parameter_offset_, parameter_size_);
+  }
   dirty_ = false;
 }
 
 void Material::UpdateMaterialUniforms() {
-  // Update texture
-  for(int i = 0; i < textures_des_.size(); ++i) {
-    const auto& des = textures_des_[i];
-    auto variable = variables_by_name_[des.name];
-    std::shared_ptr<Texture> tex = variable->GetValue<std::shared_ptr<Texture>>();
+  // Update texture, units already holding the texture (e.g. the same texture array) aren't bound again
+  auto &texture_bindings = Registry::GetInstance()->GetTextureBindingCache();
+  for (size_t i = 0; i < textures_.size(); ++i) {
+    const auto &tex = textures_[i];
     if (!tex) {
       continue;
     }
-    glActiveTexture(GL_TEXTURE0 + i);
-    glBindTexture(tex->GetTextureType(), tex->GetGLTexture());
+    texture_bindings.Bind(i, tex->GetTextureType(), tex->GetGLTexture(), tex->GetSampler());
+  }
+}
+
+void Material::UpdateTextureLayer(size_t unit) {
+  // The layer of a texture in an array is passed in the Material block, as an int named after the sampler
+  MaterialParameter layer = FindParameter(template_->GetTextureUnits()[unit].name + "Layer");
+  if (layer.IsValid() && layer.type == GL_INT) {
+    const auto &tex = textures_[unit];
+    SetParameter(layer, tex ? tex->GetLayer() : 0);
   }
 }
 
-void Material::BuildVariables() {
-  const auto& fragment_ubo_blk_list = frag_->GetUniformBlocks();
-  auto fragment_ubo_it = fragment_ubo_blk_list.find(UniformName::kMaterial);
-  if (fragment_ubo_it != fragment_ubo_blk_list.end()) {
-    blk_desc_ = fragment_ubo_it->second;
-    glGenBuffers(1, &uniform_buffer_);
-    ubo_cache_.resize(blk_desc_.size);
-    variables_by_name_.clear();
+void Material::SetTemplate(std::shared_ptr<MaterialTemplate> material_template) {
+  if (material_template == template_) {
+    return;
+  }
+
+  // Put the current values aside, the new template takes back the ones it has once it's ready
+  if (layout_) {
+    for (const auto &des : template_->GetBlockDescription().entries) {
+      auto begin = parameters_.begin() + des.offset;
+      inactive_parameters_[des.name] = InactiveParameter{des.type, std::vector<char>(begin, begin + GetStd140Size(des)),
+                                                         nullptr};
+    }
+    const auto &texture_units = template_->GetTextureUnits();
+    for (size_t i = 0; i < texture_units.size(); ++i) {
+      inactive_parameters_[texture_units[i].name] = InactiveParameter{texture_units[i].type, {}, textures_[i]};
+    }
+  }
+  template_ = material_template;
+  UpdatePipelineState();
+  layout_ = 0;
+  parameters_.clear();
+  textures_.clear();
+  dirty_ = true;
+
+  if (!IsReady() && parameter_size_) {
+    // Nothing is drawn with the material until then, so it doesn't need its range of the arena
+    Registry::GetInstance()->GetMaterialParameterArena().Free(parameter_offset_, parameter_size_);
+    parameter_offset_ = 0;
+    parameter_size_ = 0;
+  }
+}
 
-    for (const auto& des: blk_desc_.entries) {
-      std::shared_ptr<Variable> variable = MakeVariableFromGLType(des.name, des.type);
-      variables_by_name_[variable->GetName()] = variable;
+void Material::RestoreParameters() {
+  const auto &blk_desc = template_->GetBlockDescription();
+  parameters_.assign(blk_desc.size, 0);
+  for (const auto &des : blk_desc.entries) {
+    auto it = inactive_parameters_.find(des.name);
+    if (it != inactive_parameters_.end() && it->second.type == des.type &&
+        it->second.value.size() == GetStd140Size(des)) {
+      std::copy(it->second.value.begin(), it->second.value.end(), parameters_.begin() + des.offset);
+      inactive_parameters_.erase(it);
+    }
+  }
+  textures_.clear();
+  for (const auto &unit : template_->GetTextureUnits()) {
+    auto it = inactive_parameters_.find(unit.name);
+    if (it != inactive_parameters_.end() && (it->second.type == unit.type || it->second.type == GL_NONE) &&
+        IsTextureCompatible(unit, it->second.texture)) {
+      textures_.push_back(it->second.texture);
+      inactive_parameters_.erase(it);
+    } else {
+      textures_.push_back(nullptr);
     }
   }
 
-  // Build for texture binding
-  const auto& fragment_ubo_list = frag_->GetUniforms();
-  for (const auto& pair : fragment_ubo_list) {
-    const auto& des = pair.second;
-    if (des.type == GL_SAMPLER_2D || des.type == GL_SAMPLER_2D_ARRAY) {
-      textures_des_.push_back(des);
-      glUseProgram(frag_->GetGLProgram());
-      glUniform1i(des.location, textures_des_.size() - 1);
-      std::shared_ptr<Variable> variable = MakeVariableFromGLType(des.name, des.type);
-      variables_by_name_[variable->GetName()] = variable;
-      glUseProgram(0);
+  // Variants of a program share the block layout, the range is only reallocated when the size changes
+  if (parameter_size_ != blk_desc.size) {
+    auto &arena = Registry::GetInstance()->GetMaterialParameterArena();
+    if (parameter_size_) {
+      arena.Free(parameter_offset_, parameter_size_);
     }
+    parameter_size_ = static_cast<uint32_t>(blk_desc.size);
+    parameter_offset_ = parameter_size_ ? arena.Allocate(parameter_size_) : 0;
   }
+  layout_ = template_->GetLayout();
+  for (size_t i = 0; i < textures_.size(); ++i) {
+    UpdateTextureLayer(i);
+  }
+  dirty_ = true;
 }
 
 }
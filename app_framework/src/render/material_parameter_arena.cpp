@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "material_parameter_arena.h"
+
+#include <app_framework/registry.h>
+
+#include <algorithm>
+
+namespace ml {
+namespace app_framework {
+
+MaterialParameterArena::~MaterialParameterArena() {
+  if (gl_buffer_) {
+    glDeleteBuffers(1, &gl_buffer_);
+  }
+  Registry::GetInstance()->GetGpuMemoryTracker().Release(this);
+}
+
+uint32_t MaterialParameterArena::GetAlignment() {
+  if (!alignment_) {
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment_ = alignment > 0 ? static_cast<uint32_t>(alignment) : 256;
+  }
+  return alignment_;
+}
+
+uint32_t MaterialParameterArena::Allocate(uint32_t size) {
+  const uint32_t alignment = GetAlignment();
+  size = (size + alignment - 1) / alignment * alignment;
+
+  // First fit, the ranges are all multiples of the alignment so any offset handed out stays aligned
+  for (;;) {
+    for (size_t i = 0; i < free_ranges_.size(); ++i) {
+      FreeRange &range = free_ranges_[i];
+      if (range.size < size) {
+        continue;
+      }
+      uint32_t offset = range.offset;
+      range.offset += size;
+      range.size -= size;
+      if (range.size == 0) {
+        free_ranges_.erase(free_ranges_.begin() + i);
+      }
+      return offset;
+    }
+    Grow(std::max({kInitialCapacity, GetCapacity() * 2, GetCapacity() + size}));
+  }
+}
+
+void MaterialParameterArena::Free(uint32_t offset, uint32_t size) {
+  const uint32_t alignment = GetAlignment();
+  size = (size + alignment - 1) / alignment * alignment;
+
+  // Keep the free list sorted by offset and merge it with its neighbours
+  auto it = std::lower_bound(free_ranges_.begin(), free_ranges_.end(), offset,
+                             [](const FreeRange &range, uint32_t value) { return range.offset < value; });
+  it = free_ranges_.insert(it, FreeRange{offset, size});
+  auto next = it + 1;
+  if (next != free_ranges_.end() && it->offset + it->size == next->offset) {
+    it->size += next->size;
+    free_ranges_.erase(next);
+  }
+  if (it != free_ranges_.begin()) {
+    auto prev = it - 1;
+    if (prev->offset + prev->size == it->offset) {
+      prev->size += it->size;
+      free_ranges_.erase(it);
+    }
+  }
+}
+
+void MaterialParameterArena::Grow(uint32_t min_capacity) {
+  const uint32_t alignment = GetAlignment();
+  const uint32_t old_capacity = GetCapacity();
+  const uint32_t new_capacity = (min_capacity + alignment - 1) / alignment * alignment;
+  data_.resize(new_capacity, 0);
+  const size_t units = new_capacity / alignment;
+  dirty_bits_.resize((units + 63) / 64, 0);
+  Free(old_capacity, new_capacity - old_capacity);
+  ML_LOG(Debug, "Material parameter arena grown to %u bytes", new_capacity);
+}
+
+void MaterialParameterArena::MarkDirty(uint32_t offset, uint32_t size) {
+  if (size == 0) {
+    return;
+  }
+  const uint32_t alignment = GetAlignment();
+  const uint32_t first = offset / alignment;
+  const uint32_t last = (offset + size - 1) / alignment;
+  for (uint32_t unit = first; unit <= last; ++unit) {
+    dirty_bits_[unit / 64] |= uint64_t(1) << (unit % 64);
+  }
+}
+
+void MaterialParameterArena::Flush() {
+  last_upload_bytes_ = 0;
+  last_upload_ranges_ = 0;
+  if (data_.empty()) {
+    return;
+  }
+  if (!gl_buffer_) {
+    glGenBuffers(1, &gl_buffer_);
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, gl_buffer_);
+
+  // A grown arena is reallocated and uploaded whole
+  if (gl_buffer_size_ != GetCapacity()) {
+    gl_buffer_size_ = GetCapacity();
+    glBufferData(GL_UNIFORM_BUFFER, gl_buffer_size_, data_.data(), GL_DYNAMIC_DRAW);
+    GpuMemoryTracker &tracker = Registry::GetInstance()->GetGpuMemoryTracker();
+    tracker.SetLabel(this, "material parameters");
+    tracker.Update(this, GpuMemoryTracker::Category::kUniformBuffer, gl_buffer_size_);
+    std::fill(dirty_bits_.begin(), dirty_bits_.end(), 0);
+    last_upload_bytes_ = gl_buffer_size_;
+    last_upload_ranges_ = 1;
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return;
+  }
+
+  // Upload every run of consecutive dirty units with one glBufferSubData
+  const uint32_t alignment = GetAlignment();
+  const uint32_t units = GetCapacity() / alignment;
+  uint32_t unit = 0;
+  while (unit < units) {
+    uint64_t word = dirty_bits_[unit / 64] >> (unit % 64);
+    if (word == 0) {
+      unit = (unit / 64 + 1) * 64;
+      continue;
+    }
+    if (!(word & 1)) {
+      ++unit;
+      continue;
+    }
+    uint32_t run_end = unit;
+    while (run_end < units && (dirty_bits_[run_end / 64] >> (run_end % 64) & 1)) {
+      ++run_end;
+    }
+    glBufferSubData(GL_UNIFORM_BUFFER, unit * alignment, (run_end - unit) * alignment, data_.data() + unit * alignment);
+    last_upload_bytes_ += (run_end - unit) * alignment;
+    ++last_upload_ranges_;
+    unit = run_end;
+  }
+  std::fill(dirty_bits_.begin(), dirty_bits_.end(), 0);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,69 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "material_template.h"
+
+namespace ml {
+namespace app_framework {
+
+std::atomic<uint32_t> MaterialTemplate::sNextLayout(1);
+
+MaterialTemplate::MaterialTemplate(std::shared_ptr<VertexProgram> vert, std::shared_ptr<GeometryProgram> geom,
+                                   std::shared_ptr<FragmentProgram> frag)
+    : vert_(vert), geom_(geom), frag_(frag), layout_(0) {
+  IsReady();
+}
+
+bool MaterialTemplate::IsReady() {
+  if (layout_) {
+    return true;
+  }
+  // Poll every program, so that each one is reflected as soon as it's linked
+  bool ready = true;
+  if (vert_ && !vert_->IsReady()) {
+    ready = false;
+  }
+  if (geom_ && !geom_->IsReady()) {
+    ready = false;
+  }
+  if (frag_ && !frag_->IsReady()) {
+    ready = false;
+  }
+  if (!ready) {
+    return false;
+  }
+  Reflect();
+  layout_ = sNextLayout++;
+  return true;
+}
+
+void MaterialTemplate::Reflect() {
+  if (!frag_) {
+    return;
+  }
+
+  const auto &fragment_ubo_blk_list = frag_->GetUniformBlocks();
+  auto fragment_ubo_it = fragment_ubo_blk_list.find(UniformName::kMaterial);
+  if (fragment_ubo_it != fragment_ubo_blk_list.end()) {
+    blk_desc_ = fragment_ubo_it->second;
+  }
+
+  // Assign the texture units
+  glUseProgram(frag_->GetGLProgram());
+  for (const auto &pair : frag_->GetUniforms()) {
+    const auto &des = pair.second;
+    if (des.type == GL_SAMPLER_2D || des.type == GL_SAMPLER_2D_ARRAY) {
+      glUniform1i(des.location, texture_units_.size());
+      texture_units_.push_back(TextureUnit{des.name, des.type});
+    }
+  }
+  glUseProgram(0);
+}
+
+}  // namespace app_framework
+}  // namespace ml
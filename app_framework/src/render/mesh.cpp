@@ -9,45 +9,51 @@
 #include <app_framework/render/mesh.h>
 
 #include <app_framework/render/program.h>
+#include <app_framework/registry.h>
+
+#include <algorithm>
 
 namespace ml {
 namespace app_framework {
 
-Mesh::Mesh(Buffer::Category buffer_category, GLenum index_buffer_element_type) {
-  vert_buffer_ = std::make_shared<VertexBuffer>(buffer_category, GL_FLOAT, 3);
-  normal_buffer_ = std::make_shared<VertexBuffer>(buffer_category, GL_FLOAT, 3);
-  tex_coords_buffer_ =
-      std::make_shared<VertexBuffer>(buffer_category, GL_FLOAT, 2);
+Mesh::Mesh(Buffer::Category buffer_category, GLenum index_buffer_element_type, const VertexLayout &vertex_layout)
+    : vertex_layout_(vertex_layout), position_dequantization_(0.f, 0.f, 0.f, 1.f),
+      bounding_sphere_(0.f), upload_target_(std::make_shared<Mesh *>(this)) {
+  vertex_buffer_ = std::make_shared<Buffer>(buffer_category, GL_ARRAY_BUFFER);
   index_buffer_ = std::make_shared<IndexBuffer>(buffer_category, index_buffer_element_type);
 
   glGenVertexArrays(1, &gl_vertex_array_);
 
-  auto vert_buffers = {
-      std::make_pair(attribute_locations::kPosition, vert_buffer_),
-      std::make_pair(attribute_locations::kNormal, normal_buffer_),
-      std::make_pair(attribute_locations::kTextureCoordinates, tex_coords_buffer_),
-  };
-
   glBindVertexArray(gl_vertex_array_);
-  for (auto &loc_buffer_pair : vert_buffers) {
-    auto &location = loc_buffer_pair.first;
-    auto &buffer = loc_buffer_pair.second;
-
-    glBindBuffer(GL_ARRAY_BUFFER, buffer->GetGLBuffer());
-    glVertexAttribPointer(location, buffer->GetElementCount(), buffer->GetElementType(), GL_FALSE,
-                          buffer->GetVertexSize(), (void *)0);
-    glDisableVertexAttribArray(location);
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_->GetGLBuffer());
+  for (const auto &attribute : vertex_layout_.GetAttributes()) {
+    glVertexAttribPointer(attribute.location, attribute.count, attribute.type, attribute.normalized,
+                          vertex_layout_.GetStride(), (void *)(uintptr_t)attribute.offset);
+    glDisableVertexAttribArray(attribute.location);
   }
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_->GetGLBuffer());
   glBindVertexArray(0);
 }
 
 Mesh::~Mesh() {
-  glDeleteVertexArrays(1, &gl_vertex_array_);
+  Registry::GetInstance()->GetGLDeletionQueue().Enqueue(GLDeletionQueue::ObjectType::kVertexArray, gl_vertex_array_);
+}
+
+void Mesh::SetMemoryLabel(const std::string &label) {
+  memory_label_ = label;
+  vertex_buffer_->SetMemoryLabel(label);
+  index_buffer_->SetMemoryLabel(label);
+  for (const auto &buffer : custom_buffers_) {
+    buffer->SetMemoryLabel(label);
+  }
 }
 
 void Mesh::SetCustomBuffer(GLuint location, std::shared_ptr<VertexBuffer> buffer) {
+  ML_LOG_IF(Error, arena_allocation_ != nullptr, "Custom buffers of meshes in the geometry arena aren't drawn");
   custom_buffers_.push_back(buffer);
+  if (!memory_label_.empty()) {
+    buffer->SetMemoryLabel(memory_label_);
+  }
   glBindVertexArray(gl_vertex_array_);
   glBindBuffer(GL_ARRAY_BUFFER, buffer->GetGLBuffer());
   glVertexAttribPointer(location, buffer->GetElementCount(), buffer->GetElementType(), GL_FALSE,
@@ -59,38 +65,120 @@ void Mesh::SetCustomBuffer(GLuint location, std::shared_ptr<VertexBuffer> buffer
 
 void Mesh::UpdateMesh(glm::vec3 const *vertices, glm::vec3 const *normals, size_t num_vertices, void const *indices,
                       size_t num_indices) {
-  glBindVertexArray(gl_vertex_array_);
-  if (vertices) {
-    vert_buffer_->UpdateBuffer((char *)vertices, num_vertices * 3 * sizeof(float));
-    glEnableVertexAttribArray(attribute_locations::kPosition);
-  } else {
-    glDisableVertexAttribArray(attribute_locations::kPosition);
+  UpdateVertices(vertices, normals, nullptr, num_vertices);
+  if (indices) {
+    UpdateIndices(indices, num_indices);
   }
-  if (normals) {
-    normal_buffer_->UpdateBuffer((char *)normals, num_vertices * 3 * sizeof(float));
-    glEnableVertexAttribArray(attribute_locations::kNormal);
-  } else {
-    glDisableVertexAttribArray(attribute_locations::kNormal);
+}
+
+void Mesh::UpdateVertices(glm::vec3 const *vertices, glm::vec3 const *normals, glm::vec2 const *tex_coords,
+                          size_t num_vertices) {
+  arena_allocation_.reset();
+  if (vertex_layout_.GetPositionFormat() == VertexLayout::PositionFormat::kUnorm16) {
+    position_dequantization_ = VertexLayout::GetPositionDequantization(vertices, num_vertices);
   }
-  glBindVertexArray(0);
+  std::vector<char> vertex_data(num_vertices * vertex_layout_.GetStride());
+  vertex_layout_.Pack(vertices, normals, tex_coords, num_vertices, position_dequantization_, vertex_data.data());
+  bounding_sphere_ = ComputeBoundingSphere(vertices, num_vertices);
+  vertex_buffer_->UpdateBuffer(vertex_data.data(), vertex_data.size());
+  EnableAttributes(vertices != nullptr, normals != nullptr, tex_coords != nullptr);
+}
+
+void Mesh::UpdateIndices(void const *indices, size_t num_indices) {
+  arena_allocation_.reset();
+  index_buffer_->UpdateBuffer((char *)indices, num_indices * index_buffer_->GetIndexSize());
+}
 
+void Mesh::UpdateMeshStaged(glm::vec3 const *vertices, glm::vec3 const *normals, size_t num_vertices,
+                            void const *indices, size_t num_indices, std::vector<UploadManager::BufferCopy> copies) {
+  if (vertex_layout_.GetPositionFormat() == VertexLayout::PositionFormat::kUnorm16) {
+    for (const auto &copy : copies) {
+      copy.buffer->UpdateBuffer(copy.data.data(), copy.data.size());
+    }
+    UpdateMesh(vertices, normals, num_vertices, indices, num_indices);
+    return;
+  }
+
+  UploadManager::BufferCopy vertex_copy;
+  vertex_copy.buffer = vertex_buffer_;
+  vertex_copy.data.resize(num_vertices * vertex_layout_.GetStride());
+  vertex_layout_.Pack(vertices, normals, nullptr, num_vertices, position_dequantization_, vertex_copy.data.data());
+  copies.push_back(std::move(vertex_copy));
   if (indices) {
-    index_buffer_->UpdateBuffer((char *)indices, num_indices * index_buffer_->GetIndexSize());
+    UploadManager::BufferCopy index_copy;
+    index_copy.buffer = index_buffer_;
+    index_copy.data.assign(static_cast<const char *>(indices),
+                           static_cast<const char *>(indices) + num_indices * index_buffer_->GetIndexSize());
+    copies.push_back(std::move(index_copy));
   }
 
-  num_vertices_ = num_vertices;
+  // The buffers aren't reserved here, growing them would discard what the mesh draws until the copies land. What
+  // describes the geometry changes with it.
+  std::weak_ptr<Mesh *> target = upload_target_;
+  const glm::vec4 bounding_sphere = ComputeBoundingSphere(vertices, num_vertices);
+  const bool has_positions = vertices != nullptr;
+  const bool has_normals = normals != nullptr;
+  Registry::GetInstance()->GetUploadManager().Submit(
+      std::move(copies), {}, [target, bounding_sphere, has_positions, has_normals]() {
+        auto mesh = target.lock();
+        if (!mesh) {
+          return;
+        }
+        (*mesh)->arena_allocation_.reset();
+        (*mesh)->bounding_sphere_ = bounding_sphere;
+        (*mesh)->EnableAttributes(has_positions, has_normals, false);
+      });
 }
 
-void Mesh::UpdateTexCoordsBuffer(glm::vec2 const *tex_coords) {
-  glBindVertexArray(gl_vertex_array_);
-  if (tex_coords) {
-    tex_coords_buffer_->UpdateBuffer((char *)tex_coords, num_vertices_ * 2 * sizeof(float));
-    glEnableVertexAttribArray(attribute_locations::kTextureCoordinates);
-  } else {
-    glDisableVertexAttribArray(attribute_locations::kTextureCoordinates);
+bool Mesh::UpdateMeshInArena(glm::vec3 const *vertices, glm::vec3 const *normals, glm::vec2 const *tex_coords,
+                             size_t num_vertices, uint32_t const *indices, size_t num_indices) {
+  GeometryArena &arena = Registry::GetInstance()->GetGeometryArena();
+  auto allocation = arena.Allocate(vertex_layout_, vertices != nullptr, normals != nullptr, tex_coords != nullptr,
+                                   static_cast<uint32_t>(num_vertices), static_cast<uint32_t>(num_indices));
+  if (!allocation) {
+    return false;
+  }
+  if (vertex_layout_.GetPositionFormat() == VertexLayout::PositionFormat::kUnorm16) {
+    position_dequantization_ = VertexLayout::GetPositionDequantization(vertices, num_vertices);
   }
+  std::vector<char> vertex_data(num_vertices * vertex_layout_.GetStride());
+  vertex_layout_.Pack(vertices, normals, tex_coords, num_vertices, position_dequantization_, vertex_data.data());
+  arena.Write(*allocation, vertex_data.data(), indices);
+  bounding_sphere_ = ComputeBoundingSphere(vertices, num_vertices);
+  arena_allocation_ = std::move(allocation);
+  return true;
+}
+
+void Mesh::EnableAttributes(bool positions, bool normals, bool tex_coords) {
+  glBindVertexArray(gl_vertex_array_);
+  vertex_layout_.EnableAttributes(positions, normals, tex_coords);
   glBindVertexArray(0);
 }
 
+glm::vec4 Mesh::ComputeBoundingSphere(glm::vec3 const *vertices, size_t num_vertices) {
+  if (!vertices || !num_vertices) {
+    return glm::vec4(0.f);
+  }
+  // Around the center of the bounding box, not the smallest sphere but close enough for picking levels of detail
+  glm::vec3 min_position = vertices[0];
+  glm::vec3 max_position = vertices[0];
+  for (size_t i = 1; i < num_vertices; ++i) {
+    min_position = glm::min(min_position, vertices[i]);
+    max_position = glm::max(max_position, vertices[i]);
+  }
+  const glm::vec3 center = (min_position + max_position) * 0.5f;
+  float radius = 0.f;
+  for (size_t i = 0; i < num_vertices; ++i) {
+    radius = std::max(radius, glm::distance(center, vertices[i]));
+  }
+  return glm::vec4(center, radius);
+}
+
+glm::mat4 Mesh::GetPositionDequantization() const {
+  glm::mat4 dequantization(position_dequantization_.w);
+  dequantization[3] = glm::vec4(glm::vec3(position_dequantization_), 1.f);
+  return dequantization;
+}
+
 }  // namespace app_framework
 }  // namespace ml
@@ -0,0 +1,525 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+// Scoring of "Linear-Speed Vertex Cache Optimisation", Tom Forsyth 2006
+constexpr uint32_t kScoredCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.f;
+constexpr float kValenceBoostPower = 0.5f;
+
+// Cache size the clusters of OptimizeOverdraw are found with, close to the FIFO of current GPUs
+constexpr uint32_t kClusterCacheSize = 16;
+
+float GetVertexScore(int32_t cache_position, uint32_t remaining_triangles) {
+  if (remaining_triangles == 0) {
+    return -1.f;
+  }
+  float score = 0.f;
+  if (cache_position >= 0) {
+    if (cache_position < 3) {
+      // The vertices of the last triangle get a fixed score, so the next one doesn't reuse the same edge
+      score = kLastTriangleScore;
+    } else {
+      const float scale = 1.f / (kScoredCacheSize - 3);
+      score = std::pow(1.f - (cache_position - 3) * scale, kCacheDecayPower);
+    }
+  }
+  // Vertices with few triangles left are finished first, so they don't get stranded
+  return score + kValenceBoostScale * std::pow(static_cast<float>(remaining_triangles), -kValenceBoostPower);
+}
+
+// Triangles of every vertex, those of vertex are adjacency[offsets[vertex]] to adjacency[offsets[vertex + 1]]
+void BuildTriangleAdjacency(const std::vector<uint32_t> &indices, size_t vertex_count, std::vector<uint32_t> &offsets,
+                            std::vector<uint32_t> &adjacency) {
+  offsets.assign(vertex_count + 1, 0);
+  for (uint32_t index : indices) {
+    ++offsets[index + 1];
+  }
+  for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+    offsets[vertex + 1] += offsets[vertex];
+  }
+  adjacency.resize(indices.size());
+  std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+}
+
+// Sum of squared distances to planes, weighted by the areas of the triangles they are the planes of
+struct Quadric {
+  double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+  double b2 = 0.0, bc = 0.0, bd = 0.0;
+  double c2 = 0.0, cd = 0.0;
+  double d2 = 0.0;
+  double weight = 0.0;
+
+  void AddPlane(const glm::vec3 &normal, double d, double plane_weight) {
+    const double a = normal.x;
+    const double b = normal.y;
+    const double c = normal.z;
+    a2 += plane_weight * a * a;
+    ab += plane_weight * a * b;
+    ac += plane_weight * a * c;
+    ad += plane_weight * a * d;
+    b2 += plane_weight * b * b;
+    bc += plane_weight * b * c;
+    bd += plane_weight * b * d;
+    c2 += plane_weight * c * c;
+    cd += plane_weight * c * d;
+    d2 += plane_weight * d * d;
+    weight += plane_weight;
+  }
+
+  Quadric &operator+=(const Quadric &rhs) {
+    a2 += rhs.a2;
+    ab += rhs.ab;
+    ac += rhs.ac;
+    ad += rhs.ad;
+    b2 += rhs.b2;
+    bc += rhs.bc;
+    bd += rhs.bd;
+    c2 += rhs.c2;
+    cd += rhs.cd;
+    d2 += rhs.d2;
+    weight += rhs.weight;
+    return *this;
+  }
+
+  // Weighted mean of the squared distances of the point to the planes
+  double GetError(const glm::vec3 &point) const {
+    const double x = point.x;
+    const double y = point.y;
+    const double z = point.z;
+    const double error = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x + b2 * y * y +
+                         2.0 * bc * y * z + 2.0 * bd * y + c2 * z * z + 2.0 * cd * z + d2;
+    return weight > 0.0 ? std::max(0.0, error / weight) : 0.0;
+  }
+};
+
+struct Collapse {
+  double error;
+  uint32_t from;
+  uint32_t to;
+};
+
+// Whether moving vertex from onto vertex to turns one of the triangles of from over or makes it degenerate
+bool FlipsTriangle(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &offsets,
+                   const std::vector<uint32_t> &adjacency, const glm::vec3 *positions, uint32_t from, uint32_t to) {
+  for (uint32_t i = offsets[from]; i < offsets[from + 1]; ++i) {
+    const uint32_t *triangle = &indices[3 * adjacency[i]];
+    if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+      // Collapsed away
+      continue;
+    }
+    glm::vec3 corners[3] = {positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]};
+    const glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+    for (size_t corner = 0; corner < 3; ++corner) {
+      if (triangle[corner] == from) {
+        corners[corner] = positions[to];
+      }
+    }
+    // Turning by more than 75 degrees counts as a flip, it folds the surface over in all but the smoothest meshes
+    const glm::vec3 collapsed_normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+    if (glm::dot(normal, collapsed_normal) <= 0.25f * glm::length(normal) * glm::length(collapsed_normal)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertex_count,
+                                         uint32_t cache_size) {
+  VertexCacheStatistics statistics;
+  statistics.triangle_count = indices.size() / 3;
+
+  // A vertex is in the FIFO if fewer than cache_size vertices were added since it was
+  std::vector<uint32_t> added(vertex_count, 0);
+  std::vector<bool> referenced(vertex_count, false);
+  uint32_t time = cache_size + 1;
+  for (uint32_t index : indices) {
+    if (time - added[index] > cache_size) {
+      added[index] = time++;
+      ++statistics.transformed_count;
+    }
+    if (!referenced[index]) {
+      referenced[index] = true;
+      ++statistics.vertex_count;
+    }
+  }
+  return statistics;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertex_count) {
+  const size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+
+  // Triangles not emitted yet of every vertex, the first remaining[vertex] after offsets[vertex]
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> adjacency;
+  BuildTriangleAdjacency(indices, vertex_count, offsets, adjacency);
+  std::vector<uint32_t> remaining(vertex_count);
+  for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+    remaining[vertex] = offsets[vertex + 1] - offsets[vertex];
+  }
+
+  std::vector<int32_t> cache_position(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+  for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+    vertex_score[vertex] = GetVertexScore(-1, remaining[vertex]);
+  }
+
+  std::vector<bool> emitted(triangle_count, false);
+  int64_t best = -1;
+  float best_score = -1.f;
+  for (size_t triangle = 0; triangle < triangle_count; ++triangle) {
+    const uint32_t *vertices = &indices[3 * triangle];
+    const float score = vertex_score[vertices[0]] + vertex_score[vertices[1]] + vertex_score[vertices[2]];
+    if (score > best_score) {
+      best_score = score;
+      best = triangle;
+    }
+  }
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> next_cache;
+  cache.reserve(kScoredCacheSize + 3);
+  next_cache.reserve(kScoredCacheSize + 3);
+  size_t next_unemitted = 0;
+
+  for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+    if (best < 0) {
+      // No triangle left uses a cached vertex, continue with the first one not emitted yet
+      while (emitted[next_unemitted]) {
+        ++next_unemitted;
+      }
+      best = next_unemitted;
+    }
+
+    const uint32_t *triangle = &indices[3 * best];
+    emitted[best] = true;
+    result.insert(result.end(), triangle, triangle + 3);
+
+    for (size_t i = 0; i < 3; ++i) {
+      const uint32_t vertex = triangle[i];
+      uint32_t *triangles = &adjacency[offsets[vertex]];
+      uint32_t *end = triangles + remaining[vertex];
+      uint32_t *it = std::find(triangles, end, static_cast<uint32_t>(best));
+      if (it != end) {
+        std::swap(*it, *(end - 1));
+        --remaining[vertex];
+      }
+    }
+
+    // The vertices of the triangle move to the front of the cache
+    next_cache.assign(triangle, triangle + 3);
+    for (uint32_t vertex : cache) {
+      if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+        next_cache.push_back(vertex);
+      }
+    }
+    for (size_t i = kScoredCacheSize; i < next_cache.size(); ++i) {
+      cache_position[next_cache[i]] = -1;
+      vertex_score[next_cache[i]] = GetVertexScore(-1, remaining[next_cache[i]]);
+    }
+    if (next_cache.size() > kScoredCacheSize) {
+      next_cache.resize(kScoredCacheSize);
+    }
+    cache.swap(next_cache);
+    for (size_t i = 0; i < cache.size(); ++i) {
+      cache_position[cache[i]] = static_cast<int32_t>(i);
+      vertex_score[cache[i]] = GetVertexScore(static_cast<int32_t>(i), remaining[cache[i]]);
+    }
+
+    // Only the triangles of cached vertices changed score, the best one of them is next
+    best = -1;
+    best_score = -1.f;
+    for (uint32_t vertex : cache) {
+      for (uint32_t i = 0; i < remaining[vertex]; ++i) {
+        const uint32_t candidate = adjacency[offsets[vertex] + i];
+        const uint32_t *vertices = &indices[3 * candidate];
+        const float score = vertex_score[vertices[0]] + vertex_score[vertices[1]] + vertex_score[vertices[2]];
+        if (score > best_score) {
+          best_score = score;
+          best = candidate;
+        }
+      }
+    }
+  }
+
+  indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t> &indices, const glm::vec3 *positions, size_t vertex_count) {
+  const size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+
+  // A cluster starts with a triangle missing the cache with all of its vertices, moving it costs nothing more
+  std::vector<size_t> cluster_begins;
+  std::vector<uint32_t> added(vertex_count, 0);
+  uint32_t time = kClusterCacheSize + 1;
+  for (size_t triangle = 0; triangle < triangle_count; ++triangle) {
+    uint32_t misses = 0;
+    for (size_t i = 0; i < 3; ++i) {
+      const uint32_t vertex = indices[3 * triangle + i];
+      if (time - added[vertex] > kClusterCacheSize) {
+        added[vertex] = time++;
+        ++misses;
+      }
+    }
+    if (misses == 3 || triangle == 0) {
+      cluster_begins.push_back(triangle);
+    }
+  }
+  cluster_begins.push_back(triangle_count);
+  const size_t cluster_count = cluster_begins.size() - 1;
+  if (cluster_count < 2) {
+    return;
+  }
+
+  // Area weighted centroid and normal of every cluster
+  std::vector<glm::vec3> centroids(cluster_count, glm::vec3(0.f));
+  std::vector<glm::vec3> normals(cluster_count, glm::vec3(0.f));
+  glm::vec3 mesh_centroid(0.f);
+  float mesh_area = 0.f;
+  for (size_t cluster = 0; cluster < cluster_count; ++cluster) {
+    float area = 0.f;
+    for (size_t triangle = cluster_begins[cluster]; triangle < cluster_begins[cluster + 1]; ++triangle) {
+      const glm::vec3 &p0 = positions[indices[3 * triangle]];
+      const glm::vec3 &p1 = positions[indices[3 * triangle + 1]];
+      const glm::vec3 &p2 = positions[indices[3 * triangle + 2]];
+      const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+      const float triangle_area = glm::length(normal);
+      centroids[cluster] += (p0 + p1 + p2) * (triangle_area / 3.f);
+      normals[cluster] += normal;
+      area += triangle_area;
+    }
+    mesh_centroid += centroids[cluster];
+    mesh_area += area;
+    if (area > 0.f) {
+      centroids[cluster] *= 1.f / area;
+    }
+  }
+  if (mesh_area > 0.f) {
+    mesh_centroid *= 1.f / mesh_area;
+  }
+
+  // Clusters facing away from the center first, they are the likeliest to occlude the others
+  std::vector<float> keys(cluster_count);
+  for (size_t cluster = 0; cluster < cluster_count; ++cluster) {
+    const float normal_length = glm::length(normals[cluster]);
+    keys[cluster] =
+        normal_length > 0.f ? glm::dot(centroids[cluster] - mesh_centroid, normals[cluster] / normal_length) : 0.f;
+  }
+  std::vector<size_t> order(cluster_count);
+  for (size_t cluster = 0; cluster < cluster_count; ++cluster) {
+    order[cluster] = cluster;
+  }
+  std::stable_sort(order.begin(), order.end(), [&keys](size_t lhs, size_t rhs) { return keys[lhs] > keys[rhs]; });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (size_t cluster : order) {
+    result.insert(result.end(), indices.begin() + 3 * cluster_begins[cluster],
+                  indices.begin() + 3 * cluster_begins[cluster + 1]);
+  }
+  indices.swap(result);
+}
+
+size_t OptimizeVertexFetch(std::vector<uint32_t> &indices, size_t vertex_count, std::vector<uint32_t> &remap) {
+  remap.assign(vertex_count, ~0u);
+  uint32_t next = 0;
+  for (uint32_t &index : indices) {
+    if (remap[index] == ~0u) {
+      remap[index] = next++;
+    }
+    index = remap[index];
+  }
+  return next;
+}
+
+float SimplifyMesh(std::vector<uint32_t> &indices, const glm::vec3 *positions, size_t vertex_count,
+                   size_t target_index_count) {
+  std::vector<bool> locked(vertex_count, false);
+
+  // Seams, where vertices with different attributes share a position
+  std::vector<uint32_t> by_position(vertex_count);
+  for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+    by_position[vertex] = static_cast<uint32_t>(vertex);
+  }
+  auto position_less = [positions](uint32_t lhs, uint32_t rhs) {
+    const glm::vec3 &p = positions[lhs];
+    const glm::vec3 &q = positions[rhs];
+    return p.x < q.x || (p.x == q.x && (p.y < q.y || (p.y == q.y && p.z < q.z)));
+  };
+  std::sort(by_position.begin(), by_position.end(), position_less);
+  for (size_t i = 1; i < vertex_count; ++i) {
+    if (!position_less(by_position[i - 1], by_position[i])) {
+      locked[by_position[i - 1]] = true;
+      locked[by_position[i]] = true;
+    }
+  }
+
+  // Borders, the edges of a single triangle
+  std::vector<uint64_t> edges;
+  edges.reserve(indices.size());
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    for (size_t corner = 0; corner < 3; ++corner) {
+      const uint32_t a = indices[i + corner];
+      const uint32_t b = indices[i + (corner + 1) % 3];
+      edges.push_back(static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b));
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  for (size_t i = 0; i < edges.size();) {
+    size_t end = i + 1;
+    while (end < edges.size() && edges[end] == edges[i]) {
+      ++end;
+    }
+    if (end - i == 1) {
+      locked[edges[i] >> 32] = true;
+      locked[edges[i] & 0xffffffffu] = true;
+    }
+    i = end;
+  }
+
+  std::vector<Quadric> quadrics(vertex_count);
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const glm::vec3 &p0 = positions[indices[i]];
+    const glm::vec3 normal = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+    const float length = glm::length(normal);
+    if (length <= 0.f) {
+      continue;
+    }
+    const glm::vec3 unit_normal = normal * (1.f / length);
+    const double d = -glm::dot(unit_normal, p0);
+    for (size_t corner = 0; corner < 3; ++corner) {
+      quadrics[indices[i + corner]].AddPlane(unit_normal, d, 0.5 * length);
+    }
+  }
+
+  double max_error = 0.0;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> adjacency;
+  std::vector<Collapse> collapses;
+  std::vector<bool> touched;
+  std::vector<uint32_t> remap(vertex_count);
+  while (indices.size() > target_index_count) {
+    BuildTriangleAdjacency(indices, vertex_count, offsets, adjacency);
+
+    collapses.clear();
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      for (size_t corner = 0; corner < 3; ++corner) {
+        const uint32_t a = indices[i + corner];
+        const uint32_t b = indices[i + (corner + 1) % 3];
+        for (size_t direction = 0; direction < 2; ++direction) {
+          const uint32_t from = direction ? b : a;
+          const uint32_t to = direction ? a : b;
+          if (locked[from]) {
+            continue;
+          }
+          Quadric quadric = quadrics[from];
+          quadric += quadrics[to];
+          collapses.push_back(Collapse{quadric.GetError(positions[to]), from, to});
+        }
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse &lhs, const Collapse &rhs) { return lhs.error < rhs.error; });
+
+    // A collapse removes two triangles on average. The vertices around a collapse don't move again in the same pass,
+    // so the cheapest collapses are spread over the mesh and every flip test sees the triangles as they will be.
+    const size_t collapse_budget = (indices.size() - target_index_count) / 6 + 1;
+    size_t collapse_count = 0;
+    touched.assign(vertex_count, false);
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+      remap[vertex] = static_cast<uint32_t>(vertex);
+    }
+    for (const Collapse &collapse : collapses) {
+      if (collapse_count >= collapse_budget) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to] ||
+          FlipsTriangle(indices, offsets, adjacency, positions, collapse.from, collapse.to)) {
+        continue;
+      }
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      for (uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1]; ++i) {
+        const uint32_t *triangle = &indices[3 * adjacency[i]];
+        touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+      }
+      touched[collapse.to] = true;
+      max_error = std::max(max_error, collapse.error);
+      ++collapse_count;
+    }
+    if (!collapse_count) {
+      break;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      const uint32_t a = remap[indices[i]];
+      const uint32_t b = remap[indices[i + 1]];
+      const uint32_t c = remap[indices[i + 2]];
+      if (a != b && b != c && c != a) {
+        indices[kept++] = a;
+        indices[kept++] = b;
+        indices[kept++] = c;
+      }
+    }
+    indices.resize(kept);
+  }
+
+  return static_cast<float>(std::sqrt(max_error));
+}
+
+bool GenerateLod(const std::vector<uint32_t> &indices, const glm::vec3 *positions, size_t vertex_count, float ratio,
+                 MeshLod &lod) {
+  const size_t target_index_count = 3 * static_cast<size_t>(ratio * (indices.size() / 3));
+  lod.indices = indices;
+  lod.error = SimplifyMesh(lod.indices, positions, vertex_count, target_index_count);
+  if (lod.indices.empty() || 5 * lod.indices.size() > 4 * indices.size()) {
+    return false;
+  }
+  OptimizeVertexCache(lod.indices, vertex_count);
+  lod.vertex_count = OptimizeVertexFetch(lod.indices, vertex_count, lod.remap);
+  return true;
+}
+
+GLenum GetSmallestIndexType(size_t vertex_count) {
+  if (vertex_count <= std::numeric_limits<uint8_t>::max() + 1u) {
+    return GL_UNSIGNED_BYTE;
+  }
+  if (vertex_count <= std::numeric_limits<uint16_t>::max() + 1u) {
+    return GL_UNSIGNED_SHORT;
+  }
+  return GL_UNSIGNED_INT;
+}
+
+}  // namespace app_framework
+}  // namespace ml
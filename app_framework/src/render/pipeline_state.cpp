@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "pipeline_state.h"
+#include "hash_combine.h"
+
+#include <functional>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+inline void SetEnabled(GLenum capability, bool enabled) {
+  if (enabled) {
+    glEnable(capability);
+  } else {
+    glDisable(capability);
+  }
+}
+
+}  // namespace
+
+bool PipelineStateDescription::operator==(const PipelineStateDescription &rhs) const {
+  return vertex_program == rhs.vertex_program && geometry_program == rhs.geometry_program &&
+         fragment_program == rhs.fragment_program && polygon_mode == rhs.polygon_mode &&
+         blend_enabled == rhs.blend_enabled && blend_source == rhs.blend_source &&
+         blend_destination == rhs.blend_destination && depth_test_enabled == rhs.depth_test_enabled &&
+         depth_write_enabled == rhs.depth_write_enabled && depth_function == rhs.depth_function;
+}
+
+size_t PipelineStateDescriptionHash::operator()(const PipelineStateDescription &description) const {
+  std::hash<uint32_t> hash;
+  size_t seed = hash(description.vertex_program);
+  HashCombine(seed, hash(description.geometry_program));
+  HashCombine(seed, hash(description.fragment_program));
+  HashCombine(seed, hash(description.polygon_mode));
+  HashCombine(seed, hash(description.blend_enabled));
+  HashCombine(seed, hash(description.blend_source));
+  HashCombine(seed, hash(description.blend_destination));
+  HashCombine(seed, hash(description.depth_test_enabled));
+  HashCombine(seed, hash(description.depth_write_enabled));
+  HashCombine(seed, hash(description.depth_function));
+  return seed;
+}
+
+PipelineStateCache::PipelineStateCache() {
+  // Slot of kInvalidId
+  states_.emplace_back();
+}
+
+PipelineStateCache::~PipelineStateCache() {
+  for (auto &state : states_) {
+    if (state.gl_pipeline) {
+      glDeleteProgramPipelines(1, &state.gl_pipeline);
+    }
+  }
+}
+
+uint32_t PipelineStateCache::GetId(const PipelineStateDescription &description) {
+  auto it = ids_.find(description);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+  uint32_t id = static_cast<uint32_t>(states_.size());
+  PipelineState state;
+  state.description = description;
+  states_.push_back(state);
+  ids_[description] = id;
+  return id;
+}
+
+void PipelineStateCache::Bind(uint32_t id) {
+  if (id == kInvalidId || id == bound_id_) {
+    return;
+  }
+  PipelineState &state = states_[id];
+  const PipelineStateDescription &next = state.description;
+  if (!state.gl_pipeline) {
+    glGenProgramPipelines(1, &state.gl_pipeline);
+    glUseProgramStages(state.gl_pipeline, GL_VERTEX_SHADER_BIT, next.vertex_program);
+    if (next.geometry_program) {
+      glUseProgramStages(state.gl_pipeline, GL_GEOMETRY_SHADER_BIT, next.geometry_program);
+    }
+    glUseProgramStages(state.gl_pipeline, GL_FRAGMENT_SHADER_BIT, next.fragment_program);
+  }
+  if (state.gl_pipeline != bound_pipeline_) {
+    glBindProgramPipeline(state.gl_pipeline);
+    bound_pipeline_ = state.gl_pipeline;
+  }
+
+  const bool all = !bound_valid_;
+  if (all || next.polygon_mode != bound_.polygon_mode) {
+    glPolygonMode(GL_FRONT_AND_BACK, next.polygon_mode);
+    bound_.polygon_mode = next.polygon_mode;
+  }
+  if (all || next.blend_enabled != bound_.blend_enabled) {
+    SetEnabled(GL_BLEND, next.blend_enabled);
+    bound_.blend_enabled = next.blend_enabled;
+  }
+  if (all || (next.blend_enabled && (next.blend_source != bound_.blend_source ||
+                                     next.blend_destination != bound_.blend_destination))) {
+    glBlendFunc(next.blend_source, next.blend_destination);
+    bound_.blend_source = next.blend_source;
+    bound_.blend_destination = next.blend_destination;
+  }
+  if (all || next.depth_test_enabled != bound_.depth_test_enabled) {
+    SetEnabled(GL_DEPTH_TEST, next.depth_test_enabled);
+    bound_.depth_test_enabled = next.depth_test_enabled;
+  }
+  if (all || next.depth_write_enabled != bound_.depth_write_enabled) {
+    glDepthMask(next.depth_write_enabled ? GL_TRUE : GL_FALSE);
+    bound_.depth_write_enabled = next.depth_write_enabled;
+  }
+  if (all || (next.depth_test_enabled && next.depth_function != bound_.depth_function)) {
+    glDepthFunc(next.depth_function);
+    bound_.depth_function = next.depth_function;
+  }
+  bound_valid_ = true;
+  bound_id_ = id;
+}
+
+void PipelineStateCache::ReleaseProgram(GLuint program) {
+  for (uint32_t id = 1; id < states_.size(); ++id) {
+    PipelineState &state = states_[id];
+    const PipelineStateDescription &description = state.description;
+    if (description.vertex_program != program && description.geometry_program != program &&
+        description.fragment_program != program) {
+      continue;
+    }
+    auto it = ids_.find(description);
+    if (it != ids_.end() && it->second == id) {
+      ids_.erase(it);
+    }
+    if (state.gl_pipeline) {
+      if (state.gl_pipeline == bound_pipeline_) {
+        Invalidate();
+      }
+      glDeleteProgramPipelines(1, &state.gl_pipeline);
+      state.gl_pipeline = 0;
+    }
+  }
+}
+
+void PipelineStateCache::Invalidate() {
+  bound_id_ = kInvalidId;
+  bound_pipeline_ = 0;
+  bound_valid_ = false;
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+// Generated by compile_shaders.py, do not edit.
+#include "shader_reflection.h"
+
+#include <app_framework/shader/magicleap_mesh_gs_program.h>
+#include <app_framework/shader/magicleap_mesh_vs_program.h>
+#include <app_framework/shader/oes_textured_fs_program.h>
+#include <app_framework/shader/pbr_fs_program.h>
+#include <app_framework/shader/pbr_vs_program.h>
+#include <app_framework/shader/simple_textured_fs_program.h>
+#include <app_framework/shader/simple_textured_vs_program.h>
+#include <app_framework/shader/solid_color_fs_program.h>
+#include <app_framework/shader/solid_color_vs_program.h>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+const ShaderUniformReflection kMagicLeapMeshVertexShaderCameraMembers[] = {
+    {"view_proj", GL_FLOAT_MAT4, 1, 0},
+    {"world_position", GL_FLOAT_VEC4, 1, 64},
+};
+
+const ShaderUniformReflection kMagicLeapMeshVertexShaderModelMembers[] = {
+    {"transform", GL_FLOAT_MAT4, 1, 0},
+    {"vertex_format", GL_INT_VEC4, 1, 64},
+};
+
+const ShaderBlockReflection kMagicLeapMeshVertexShaderBlocks[] = {
+    {"Camera", 80, kMagicLeapMeshVertexShaderCameraMembers, 2},
+    {"Model", 80, kMagicLeapMeshVertexShaderModelMembers, 2},
+};
+
+const ShaderUniformReflection kOESTexturedFragmentShaderUniforms[] = {
+    {"Texture0", 0x8D66 /* GL_SAMPLER_EXTERNAL_OES */, 1, 0},
+};
+
+const ShaderUniformReflection kPBRFragmentShaderCameraMembers[] = {
+    {"view_proj", GL_FLOAT_MAT4, 1, 0},
+    {"world_position", GL_FLOAT_VEC4, 1, 64},
+};
+
+const ShaderUniformReflection kPBRFragmentShaderMaterialMembers[] = {
+    {"MetallicChannel", GL_INT, 1, 0},
+    {"RoughnessChannel", GL_INT, 1, 4},
+    {"HasNormals", GL_BOOL, 1, 8},
+    {"HasAlbedo", GL_BOOL, 1, 12},
+    {"HasNormalMap", GL_BOOL, 1, 16},
+    {"HasMetallic", GL_BOOL, 1, 20},
+    {"HasRoughness", GL_BOOL, 1, 24},
+    {"HasAmbientOcclusion", GL_BOOL, 1, 28},
+    {"HasEmissive", GL_BOOL, 1, 32},
+    {"AlbedoLayer", GL_INT, 1, 36},
+    {"MetallicLayer", GL_INT, 1, 40},
+    {"RoughnessLayer", GL_INT, 1, 44},
+    {"NormalsLayer", GL_INT, 1, 48},
+    {"AmbientOcclusionLayer", GL_INT, 1, 52},
+    {"EmissiveLayer", GL_INT, 1, 56},
+};
+
+const ShaderUniformReflection kPBRFragmentShaderClustersMembers[] = {
+    {"view", GL_FLOAT_MAT4, 1, 0},
+    {"viewport", GL_FLOAT_VEC4, 1, 64},
+    {"depth_params", GL_FLOAT_VEC4, 1, 80},
+    {"grid", GL_INT_VEC4, 1, 96},
+};
+
+const ShaderBlockReflection kPBRFragmentShaderBlocks[] = {
+    {"Camera", 80, kPBRFragmentShaderCameraMembers, 2},
+    {"Material", 64, kPBRFragmentShaderMaterialMembers, 15},
+    {"Clusters", 112, kPBRFragmentShaderClustersMembers, 4},
+};
+
+const ShaderUniformReflection kPBRFragmentShaderUniforms[] = {
+    {"Albedo", GL_SAMPLER_2D_ARRAY, 1, 0},
+    {"Metallic", GL_SAMPLER_2D_ARRAY, 1, 0},
+    {"Roughness", GL_SAMPLER_2D_ARRAY, 1, 0},
+    {"Normals", GL_SAMPLER_2D_ARRAY, 1, 0},
+    {"AmbientOcclusion", GL_SAMPLER_2D_ARRAY, 1, 0},
+    {"Emissive", GL_SAMPLER_2D_ARRAY, 1, 0},
+    {"ClusterLights", GL_SAMPLER_BUFFER, 1, 0},
+    {"ClusterRanges", GL_UNSIGNED_INT_SAMPLER_BUFFER, 1, 0},
+    {"ClusterLightIndices", GL_UNSIGNED_INT_SAMPLER_BUFFER, 1, 0},
+};
+
+const ShaderUniformReflection kPBRVertexShaderCameraMembers[] = {
+    {"view_proj", GL_FLOAT_MAT4, 1, 0},
+    {"world_position", GL_FLOAT_VEC4, 1, 64},
+};
+
+const ShaderUniformReflection kPBRVertexShaderModelMembers[] = {
+    {"transform", GL_FLOAT_MAT4, 1, 0},
+    {"vertex_format", GL_INT_VEC4, 1, 64},
+};
+
+const ShaderBlockReflection kPBRVertexShaderBlocks[] = {
+    {"Camera", 80, kPBRVertexShaderCameraMembers, 2},
+    {"Model", 80, kPBRVertexShaderModelMembers, 2},
+};
+
+const ShaderUniformReflection kSimpleTexturedFragmentShaderUniforms[] = {
+    {"Texture0", GL_SAMPLER_2D, 1, 0},
+};
+
+const ShaderUniformReflection kSimpleTexturedVertexShaderCameraMembers[] = {
+    {"view_proj", GL_FLOAT_MAT4, 1, 0},
+    {"world_position", GL_FLOAT_VEC4, 1, 64},
+};
+
+const ShaderUniformReflection kSimpleTexturedVertexShaderModelMembers[] = {
+    {"transform", GL_FLOAT_MAT4, 1, 0},
+};
+
+const ShaderBlockReflection kSimpleTexturedVertexShaderBlocks[] = {
+    {"Camera", 80, kSimpleTexturedVertexShaderCameraMembers, 2},
+    {"Model", 64, kSimpleTexturedVertexShaderModelMembers, 1},
+};
+
+const ShaderUniformReflection kSolidColorFragmentShaderMaterialMembers[] = {
+    {"Color", GL_FLOAT_VEC4, 1, 0},
+    {"OverrideVertexColor", GL_BOOL, 1, 16},
+};
+
+const ShaderBlockReflection kSolidColorFragmentShaderBlocks[] = {
+    {"Material", 32, kSolidColorFragmentShaderMaterialMembers, 2},
+};
+
+const ShaderUniformReflection kSolidColorVertexShaderCameraMembers[] = {
+    {"view_proj", GL_FLOAT_MAT4, 1, 0},
+    {"world_position", GL_FLOAT_VEC4, 1, 64},
+};
+
+const ShaderUniformReflection kSolidColorVertexShaderModelMembers[] = {
+    {"transform", GL_FLOAT_MAT4, 1, 0},
+};
+
+const ShaderBlockReflection kSolidColorVertexShaderBlocks[] = {
+    {"Camera", 80, kSolidColorVertexShaderCameraMembers, 2},
+    {"Model", 64, kSolidColorVertexShaderModelMembers, 1},
+};
+
+}  // namespace
+
+const ShaderReflection kPrecompiledShaders[] = {
+    {kMagicLeapMeshGeometryShader, GL_GEOMETRY_SHADER, nullptr, 0, nullptr, 0},
+    {kMagicLeapMeshVertexShader, GL_VERTEX_SHADER, kMagicLeapMeshVertexShaderBlocks, 2, nullptr, 0},
+    {kOESTexturedFragmentShader, GL_FRAGMENT_SHADER, nullptr, 0, kOESTexturedFragmentShaderUniforms, 1},
+    {kPBRFragmentShader, GL_FRAGMENT_SHADER, kPBRFragmentShaderBlocks, 3, kPBRFragmentShaderUniforms, 9},
+    {kPBRVertexShader, GL_VERTEX_SHADER, kPBRVertexShaderBlocks, 2, nullptr, 0},
+    {kSimpleTexturedFragmentShader, GL_FRAGMENT_SHADER, nullptr, 0, kSimpleTexturedFragmentShaderUniforms, 1},
+    {kSimpleTexturedVertexShader, GL_VERTEX_SHADER, kSimpleTexturedVertexShaderBlocks, 2, nullptr, 0},
+    {kSolidColorFragmentShader, GL_FRAGMENT_SHADER, kSolidColorFragmentShaderBlocks, 1, nullptr, 0},
+    {kSolidColorVertexShader, GL_VERTEX_SHADER, kSolidColorVertexShaderBlocks, 2, nullptr, 0},
+};
+const size_t kPrecompiledShaderCount = sizeof(kPrecompiledShaders) / sizeof(kPrecompiledShaders[0]);
+
+}  // namespace app_framework
+}  // namespace ml
@@ -6,10 +6,16 @@
 // %COPYRIGHT_END%
 // ---------------------------------------------------------------------
 // %BANNER_END%
+#include <chrono>
 #include <set>
 
+#include <app_framework/registry.h>
+
 #include "gl_type_size.h"
 #include "program.h"
+#include "program_cache.h"
+#include "shader_compiler.h"
+#include "shader_reflection.h"
 
 namespace ml {
 namespace app_framework {
@@ -17,23 +23,103 @@ namespace app_framework {
 const std::string UniformName::kMaterial("Material");
 const std::string UniformName::kCamera("Camera");
 const std::string UniformName::kModel("Model");
-const std::string UniformName::kLight("Lights");
+const std::string UniformName::kClusters("Clusters");
 
 GLint Program::sMaxUniformBinding = 0;
 GLint Program::sVertBindingLocation = 0;
 GLint Program::sGeomBindingLocation = 0;
 GLint Program::sFragBindingLocation = 0;
 
-Program::Program(const char *code, GLenum type) : program_(0), type_(type), uniform_cnt_(0), uniform_blk_cnt_(0) {
+Program::Program(const char *code, GLenum type, bool async)
+    : program_(0), type_(type), uniform_cnt_(0), uniform_blk_cnt_(0), ready_(true) {
+  ProgramCache &cache = ProgramCache::GetInstance();
+  if (cache.Load(code, type_, *this)) {
+    return;
+  }
+
+  compile_start_ = std::chrono::steady_clock::now();
+  ShaderCompiler &compiler = ShaderCompiler::GetInstance();
+  if (async && compiler.IsAsync()) {
+    program_ = glCreateProgram();
+    glProgramParameteri(program_, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    if (cache.IsEnabled()) {
+      glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    compiler.Submit(program_, code, type_);
+    pending_code_ = code;
+    ready_ = false;
+    return;
+  }
+
+  Compile(code);
+  Reflect(code);
+  cache.Store(code, type_, *this, std::chrono::steady_clock::now() - compile_start_);
+}
+
+bool Program::IsReady() {
+  if (ready_) {
+    return true;
+  }
+  if (!ShaderCompiler::GetInstance().IsComplete(program_)) {
+    return false;
+  }
+  CheckLinkStatus();
+  Reflect(pending_code_.c_str());
+  ProgramCache::GetInstance().Store(pending_code_.c_str(), type_, *this,
+                                    std::chrono::steady_clock::now() - compile_start_);
+  pending_code_.clear();
+  ready_ = true;
+  return true;
+}
+
+void Program::WaitUntilReady() {
+  if (ready_) {
+    return;
+  }
+  ShaderCompiler::GetInstance().Wait(program_);
+  IsReady();
+}
+
+void Program::Compile(const char *code) {
+  GLint success = 0;
+  char info_log[512]{};
+
+  if (!ProgramCache::GetInstance().IsEnabled()) {
+    program_ = glCreateShaderProgramv(type_, 1, &code);
+  } else {
+    // Same as glCreateShaderProgramv, but the binary has to be marked retrievable before linking
+    GLuint shader = glCreateShader(type_);
+    glShaderSource(shader, 1, &code, nullptr);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+      glGetShaderInfoLog(shader, 512, nullptr, info_log);
+      ML_LOG(Fatal, "Shader compilation failed: %s", info_log);
+    }
+    program_ = glCreateProgram();
+    glProgramParameteri(program_, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program_, shader);
+    glLinkProgram(program_);
+    glDetachShader(program_, shader);
+    glDeleteShader(shader);
+  }
+
+  CheckLinkStatus();
+}
+
+void Program::CheckLinkStatus() {
   GLint success = 0;
   char info_log[512]{};
 
-  program_ = glCreateShaderProgramv(type_, 1, &code);
   glGetProgramiv(program_, GL_LINK_STATUS, &success);
   if (!success) {
     glGetProgramInfoLog(program_, 512, nullptr, info_log);
     ML_LOG(Fatal, "Shader compilation failed: %s", info_log);
   }
+}
+
+void Program::Reflect(const char *code) {
   glUseProgram(program_);
 
   GLint binding = 0;
@@ -51,12 +137,19 @@ Program::Program(const char *code, GLenum type) : program_(0), type_(type), unif
 
   if (type_ == GL_VERTEX_SHADER) {
     binding = sVertBindingLocation;
-  } else if (type == GL_GEOMETRY_SHADER) {
+  } else if (type_ == GL_GEOMETRY_SHADER) {
     binding = sGeomBindingLocation;
   } else {
     binding = sFragBindingLocation;
   }
 
+  const ShaderReflection *reflection = FindShaderReflection(code, type_);
+  if (reflection) {
+    ReflectPrecomputed(*reflection, binding);
+    glUseProgram(0);
+    return;
+  }
+
   std::set<GLint> excluded_set;
 
   glGetProgramiv(program_, GL_ACTIVE_UNIFORM_BLOCKS, &uniform_blk_cnt_);
@@ -132,11 +225,84 @@ Program::Program(const char *code, GLenum type) : program_(0), type_(type), unif
   glUseProgram(0);
 }
 
+void Program::ReflectPrecomputed(const ShaderReflection &reflection, GLint binding) {
+  // Layouts come from compile_shaders.py, only the indices and locations have to be looked up. Anything the
+  // driver optimized out is dropped, same as it would be missing from the active uniform queries.
+  uniform_blk_cnt_ = 0;
+  for (size_t i = 0; i < reflection.block_count; ++i) {
+    const ShaderBlockReflection &block = reflection.blocks[i];
+    GLuint index = glGetUniformBlockIndex(program_, block.name);
+    if (index == GL_INVALID_INDEX) {
+      continue;
+    }
+    UniformBlockDescription data{};
+    data.name = block.name;
+    data.index = index;
+    data.binding = binding++;
+    data.size = block.size;
+    glUniformBlockBinding(program_, index, data.binding);
+
+    data.entries.resize(block.member_count);
+    for (size_t j = 0; j < block.member_count; ++j) {
+      const ShaderUniformReflection &uniform = block.members[j];
+      UniformDescription member{};
+      member.name = uniform.name;
+      member.type = uniform.type;
+      member.size = GetGLTypeSize(uniform.type) * uniform.array_size;
+      member.location = -1;
+      member.offset = uniform.offset;
+      data.entries[j] = member;
+    }
+    uniform_blocks_by_name_[data.name] = data;
+    ++uniform_blk_cnt_;
+  }
+
+  uniform_cnt_ = 0;
+  for (size_t i = 0; i < reflection.uniform_count; ++i) {
+    const ShaderUniformReflection &uniform = reflection.uniforms[i];
+    GLint location = glGetUniformLocation(program_, uniform.name);
+    if (location < 0) {
+      continue;
+    }
+    UniformDescription data{};
+    data.name = uniform.name;
+    data.type = uniform.type;
+    data.size = GetGLTypeSize(uniform.type) * uniform.array_size;
+    data.location = location;
+    uniforms_by_name_[data.name] = data;
+    ++uniform_cnt_;
+  }
+}
+
 Program::~Program() {
+  if (!ready_ && !ShaderCompiler::GetInstance().Cancel(program_)) {
+    // The compile thread deletes it once it's done linking
+    program_ = 0;
+  }
   if (program_) {
-    glDeleteProgram(program_);
+    // The pipelines using it are released when it's deleted
+    Registry::GetInstance()->GetGLDeletionQueue().Enqueue(GLDeletionQueue::ObjectType::kProgram, program_);
     program_ = 0;
   }
 }
+
+std::string AddShaderDefines(const std::string &code, const std::vector<std::string> &defines) {
+  std::string define_lines;
+  for (const auto &define : defines) {
+    define_lines += "#define " + define + "\n";
+  }
+
+  // #version has to stay the first directive of the shader
+  size_t insert_at = 0;
+  size_t version = code.find("#version");
+  if (version != std::string::npos) {
+    size_t end_of_line = code.find('\n', version);
+    insert_at = end_of_line == std::string::npos ? code.size() : end_of_line + 1;
+  }
+  std::string result = code;
+  result.insert(insert_at, define_lines);
+  return result;
+}
+
 }
 }
@@ -0,0 +1,271 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "program_cache.h"
+#include "program.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+const uint32_t kCacheMagic = 0x43504c4d;  // "MLPC"
+const uint32_t kCacheVersion = 1;
+
+uint64_t Fnv1a(const void *data, size_t size, uint64_t hash = 14695981039346656037ull) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+class CacheWriter {
+public:
+  template <typename T>
+  void Write(const T &value) {
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    data_.insert(data_.end(), bytes, bytes + sizeof(T));
+  }
+
+  void Write(const std::string &value) {
+    Write(uint32_t(value.size()));
+    data_.insert(data_.end(), value.begin(), value.end());
+  }
+
+  void Write(const UniformDescription &uniform) {
+    Write(uniform.name);
+    Write(uniform.index);
+    Write(uniform.size);
+    Write(uniform.location);
+    Write(uniform.offset);
+    Write(uniform.type);
+  }
+
+  std::vector<char> &GetData() {
+    return data_;
+  }
+
+private:
+  std::vector<char> data_;
+};
+
+class CacheReader {
+public:
+  CacheReader(const std::vector<char> &data) : data_(data) {}
+
+  template <typename T>
+  bool Read(T &value) {
+    if (offset_ + sizeof(T) > data_.size()) {
+      return false;
+    }
+    memcpy(&value, data_.data() + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return true;
+  }
+
+  bool Read(std::string &value) {
+    uint32_t size = 0;
+    if (!Read(size) || offset_ + size > data_.size()) {
+      return false;
+    }
+    value.assign(data_.data() + offset_, size);
+    offset_ += size;
+    return true;
+  }
+
+  bool Read(UniformDescription &uniform) {
+    return Read(uniform.name) && Read(uniform.index) && Read(uniform.size) && Read(uniform.location) &&
+           Read(uniform.offset) && Read(uniform.type);
+  }
+
+  const char *ReadBytes(size_t size) {
+    if (offset_ + size > data_.size()) {
+      return nullptr;
+    }
+    const char *bytes = data_.data() + offset_;
+    offset_ += size;
+    return bytes;
+  }
+
+private:
+  const std::vector<char> &data_;
+  size_t offset_ = 0;
+};
+
+}  // namespace
+
+void ProgramCache::Initialize(const std::string &directory) {
+  GLint binary_formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats);
+  if (binary_formats == 0) {
+    ML_LOG(Info, "Program cache disabled, the driver does not support program binaries");
+    return;
+  }
+  driver_ = std::string(reinterpret_cast<const char *>(glGetString(GL_VENDOR))) + "|" +
+            reinterpret_cast<const char *>(glGetString(GL_RENDERER)) + "|" +
+            reinterpret_cast<const char *>(glGetString(GL_VERSION));
+  directory_ = directory;
+  enabled_ = true;
+}
+
+std::string ProgramCache::GetPath(const char *code, GLenum type) const {
+  uint64_t hash = Fnv1a(code, strlen(code));
+  hash = Fnv1a(&type, sizeof(type), hash);
+  hash = Fnv1a(driver_.data(), driver_.size(), hash);
+  char name[64];
+  snprintf(name, sizeof(name), "program_cache_%016llx.bin", (unsigned long long)hash);
+  return directory_ + "/" + name;
+}
+
+bool ProgramCache::Load(const char *code, GLenum type, Program &program) {
+  if (!enabled_) {
+    return false;
+  }
+  auto start = std::chrono::steady_clock::now();
+  std::ifstream file(GetPath(code, type), std::ios::binary);
+  if (!file) {
+    ++misses_;
+    return false;
+  }
+  std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  CacheReader reader(data);
+
+  // The key is a hash, so make sure this entry really is for this source and driver
+  uint32_t magic = 0, version = 0;
+  std::string driver, source;
+  double compile_seconds = 0.;
+  GLenum binary_format = 0;
+  uint32_t binary_size = 0;
+  const char *binary = nullptr;
+  bool valid = reader.Read(magic) && magic == kCacheMagic && reader.Read(version) && version == kCacheVersion &&
+               reader.Read(driver) && driver == driver_ && reader.Read(source) && source == code &&
+               reader.Read(compile_seconds) && reader.Read(binary_format) && reader.Read(binary_size) &&
+               (binary = reader.ReadBytes(binary_size)) != nullptr;
+
+  std::unordered_map<std::string, UniformBlockDescription> uniform_blocks;
+  std::unordered_map<std::string, UniformDescription> uniforms;
+  uint32_t block_count = 0, uniform_count = 0;
+  valid = valid && reader.Read(block_count);
+  for (uint32_t i = 0; valid && i < block_count; ++i) {
+    UniformBlockDescription block;
+    uint32_t entry_count = 0;
+    valid = reader.Read(block.name) && reader.Read(block.index) && reader.Read(block.size) &&
+            reader.Read(block.binding) && reader.Read(entry_count);
+    block.entries.resize(valid ? entry_count : 0);
+    for (auto &entry : block.entries) {
+      valid = valid && reader.Read(entry);
+    }
+    uniform_blocks[block.name] = block;
+  }
+  valid = valid && reader.Read(uniform_count);
+  for (uint32_t i = 0; valid && i < uniform_count; ++i) {
+    UniformDescription uniform;
+    valid = reader.Read(uniform);
+    uniforms[uniform.name] = uniform;
+  }
+  if (!valid) {
+    ML_LOG(Warning, "Ignoring invalid program cache entry %s", GetPath(code, type).c_str());
+    ++misses_;
+    return false;
+  }
+
+  GLuint gl_program = glCreateProgram();
+  glProgramParameteri(gl_program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+  glProgramBinary(gl_program, binary_format, binary, binary_size);
+  GLint success = 0;
+  glGetProgramiv(gl_program, GL_LINK_STATUS, &success);
+  if (!success) {
+    ML_LOG(Info, "Program binary rejected by the driver, recompiling");
+    glDeleteProgram(gl_program);
+    ++rejected_;
+    return false;
+  }
+
+  // Block bindings are not part of the binary
+  for (const auto &block : uniform_blocks) {
+    glUniformBlockBinding(gl_program, block.second.index, block.second.binding);
+  }
+  program.program_ = gl_program;
+  program.uniform_blocks_by_name_.swap(uniform_blocks);
+  program.uniforms_by_name_.swap(uniforms);
+  program.uniform_blk_cnt_ = GLint(block_count);
+  program.uniform_cnt_ = GLint(uniform_count);
+
+  ++hits_;
+  load_time_ += std::chrono::steady_clock::now() - start;
+  saved_compile_time_ += std::chrono::duration<double>(compile_seconds);
+  return true;
+}
+
+void ProgramCache::Store(const char *code, GLenum type, const Program &program,
+                         std::chrono::duration<double> compile_time) {
+  compile_time_ += compile_time;
+  if (!enabled_) {
+    return;
+  }
+
+  GLint binary_size = 0;
+  glGetProgramiv(program.program_, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+  if (binary_size <= 0) {
+    return;
+  }
+  std::vector<char> binary(binary_size);
+  GLenum binary_format = 0;
+  glGetProgramBinary(program.program_, binary_size, &binary_size, &binary_format, binary.data());
+
+  CacheWriter writer;
+  writer.Write(kCacheMagic);
+  writer.Write(kCacheVersion);
+  writer.Write(driver_);
+  writer.Write(std::string(code));
+  writer.Write(compile_time.count());
+  writer.Write(binary_format);
+  writer.Write(uint32_t(binary_size));
+  writer.GetData().insert(writer.GetData().end(), binary.begin(), binary.begin() + binary_size);
+  writer.Write(uint32_t(program.uniform_blocks_by_name_.size()));
+  for (const auto &block : program.uniform_blocks_by_name_) {
+    writer.Write(block.second.name);
+    writer.Write(block.second.index);
+    writer.Write(block.second.size);
+    writer.Write(block.second.binding);
+    writer.Write(uint32_t(block.second.entries.size()));
+    for (const auto &entry : block.second.entries) {
+      writer.Write(entry);
+    }
+  }
+  writer.Write(uint32_t(program.uniforms_by_name_.size()));
+  for (const auto &uniform : program.uniforms_by_name_) {
+    writer.Write(uniform.second);
+  }
+
+  std::string path = GetPath(code, type);
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(writer.GetData().data(), writer.GetData().size());
+  if (!file) {
+    ML_LOG(Warning, "Unable to write program cache entry %s", path.c_str());
+  }
+}
+
+void ProgramCache::LogStats() const {
+  using milliseconds = std::chrono::duration<double, std::milli>;
+  ML_LOG(Info,
+         "Program cache: %u hits, %u misses, %u rejected. Loaded in %.1f ms instead of %.1f ms of compilation "
+         "(%.1f ms saved), %.1f ms spent compiling",
+         hits_, misses_, rejected_, milliseconds(load_time_).count(), milliseconds(saved_compile_time_).count(),
+         milliseconds(saved_compile_time_ - load_time_).count(), milliseconds(compile_time_).count());
+}
+
+}  // namespace app_framework
+}  // namespace ml
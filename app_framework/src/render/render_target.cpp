@@ -8,43 +8,55 @@
 // %BANNER_END%
 #include "render_target.h"
 
+#include <app_framework/registry.h>
+
 namespace ml {
 namespace app_framework {
 
 RenderTarget::~RenderTarget() {
   if (gl_framebuffer_) {
-    glDeleteFramebuffers(1, &gl_framebuffer_);
+    Registry::GetInstance()->GetGLDeletionQueue().Enqueue(GLDeletionQueue::ObjectType::kFramebuffer, gl_framebuffer_);
   }
 }
 
 void RenderTarget::InitializeFramebuffer() {
   gl_framebuffer_ = 0;
-  if (color_) {
-    width_ = color_->GetWidth();
-    height_ = color_->GetHeight();
-    glGenFramebuffers(1, &gl_framebuffer_);
-    glBindFramebuffer(GL_FRAMEBUFFER, gl_framebuffer_);
+  const auto &size_texture = color_ ? color_ : depth_;
+  if (!size_texture) {
+    return;
+  }
+  width_ = size_texture->GetWidth();
+  height_ = size_texture->GetHeight();
+  glGenFramebuffers(1, &gl_framebuffer_);
+  glBindFramebuffer(GL_FRAMEBUFFER, gl_framebuffer_);
 
+  if (color_) {
     auto color_texture_type = color_->GetTextureType();
     if (color_texture_type == GL_TEXTURE_2D_ARRAY) {
       glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color_->GetGLTexture(), 0,
                                 color_layer_index_);
-    } else if (color_texture_type == GL_TEXTURE_2D) {
+    } else if (color_texture_type == GL_TEXTURE_2D || color_texture_type == GL_TEXTURE_2D_MULTISAMPLE) {
       glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, color_->GetGLTexture(), 0);
     }
+  } else {
+    // Depth only
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  }
 
-    // Only do depth when we have color
-    if (depth_) {
-      auto depth_texture_type = depth_->GetTextureType();
-      if (depth_texture_type == GL_TEXTURE_2D_ARRAY) {
-        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_->GetGLTexture(), 0,
-                                  depth_layer_index_);
-      } else if (depth_texture_type == GL_TEXTURE_2D) {
-        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_->GetGLTexture(), 0);
-      }
+  if (depth_) {
+    const GLenum depth_format = depth_->GetInternalFormat();
+    const GLenum attachment = depth_format == GL_DEPTH24_STENCIL8 || depth_format == GL_DEPTH32F_STENCIL8
+                                  ? GL_DEPTH_STENCIL_ATTACHMENT
+                                  : GL_DEPTH_ATTACHMENT;
+    auto depth_texture_type = depth_->GetTextureType();
+    if (depth_texture_type == GL_TEXTURE_2D_ARRAY) {
+      glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, depth_->GetGLTexture(), 0, depth_layer_index_);
+    } else if (depth_texture_type == GL_TEXTURE_2D || depth_texture_type == GL_TEXTURE_2D_MULTISAMPLE) {
+      glFramebufferTexture(GL_FRAMEBUFFER, attachment, depth_->GetGLTexture(), 0);
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
   }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 }
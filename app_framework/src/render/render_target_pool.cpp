@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "render_target_pool.h"
+
+#include <app_framework/registry.h>
+
+#include <algorithm>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+bool HasStencil(GLenum depth_format) {
+  return depth_format == GL_DEPTH24_STENCIL8 || depth_format == GL_DEPTH32F_STENCIL8;
+}
+
+std::shared_ptr<Texture> CreateAttachment(const RenderTargetDescription &description, GLenum format) {
+  const GLenum target = description.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+  GLuint gl_texture = 0;
+  glGenTextures(1, &gl_texture);
+  glBindTexture(target, gl_texture);
+  if (description.samples > 1) {
+    // glTexStorage2DMultisample is GL 4.3, glTexImage2DMultisample allocates the same storage since GL 3.2
+    glTexImage2DMultisample(target, description.samples, format, description.width, description.height, GL_TRUE);
+  } else {
+    glTexStorage2D(target, 1, format, description.width, description.height);
+  }
+  glBindTexture(target, 0);
+
+  auto texture = std::make_shared<Texture>(target, gl_texture, description.width, description.height, true);
+  texture->SetFormat(format, 1, GpuMemoryTracker::Category::kRenderTarget);
+  texture->SetMemoryLabel("render target pool");
+  if (description.samples > 1) {
+    Registry::GetInstance()->GetGpuMemoryTracker().Update(texture.get(), GpuMemoryTracker::Category::kRenderTarget,
+                                                          texture->GetByteSize() * description.samples);
+  }
+  return texture;
+}
+
+}  // namespace
+
+constexpr uint32_t RenderTargetPool::kMaxUnusedFrames;
+
+bool RenderTargetDescription::operator==(const RenderTargetDescription &rhs) const {
+  return width == rhs.width && height == rhs.height && color_format == rhs.color_format &&
+         depth_format == rhs.depth_format && samples == rhs.samples;
+}
+
+std::shared_ptr<RenderTarget> RenderTargetPool::Acquire(const RenderTargetDescription &description) {
+  for (auto &target : targets_) {
+    if (!target.in_use && target.description == description) {
+      target.in_use = true;
+      target.unused_frames = 0;
+      return target.render_target;
+    }
+  }
+  auto render_target = CreateRenderTarget(description);
+  targets_.push_back(PooledTarget{description, render_target, true, 0});
+  return render_target;
+}
+
+void RenderTargetPool::Release(const std::shared_ptr<RenderTarget> &render_target) {
+  for (auto &target : targets_) {
+    if (target.render_target == render_target) {
+      if (target.in_use) {
+        Invalidate(target);
+        target.in_use = false;
+      }
+      return;
+    }
+  }
+  ML_LOG(Error, "Released a render target that isn't from the render target pool");
+}
+
+void RenderTargetPool::EndFrame() {
+  for (auto &target : targets_) {
+    if (target.in_use) {
+      Invalidate(target);
+      target.in_use = false;
+    } else {
+      ++target.unused_frames;
+    }
+  }
+  // The textures and framebuffers go through the GL deletion queue once nothing else holds the target
+  targets_.erase(std::remove_if(targets_.begin(), targets_.end(),
+                                [](const PooledTarget &target) { return target.unused_frames >= kMaxUnusedFrames; }),
+                 targets_.end());
+}
+
+size_t RenderTargetPool::GetInUseCount() const {
+  return std::count_if(targets_.begin(), targets_.end(), [](const PooledTarget &target) { return target.in_use; });
+}
+
+std::shared_ptr<RenderTarget> RenderTargetPool::CreateRenderTarget(const RenderTargetDescription &description) {
+  ++created_count_;
+  ML_LOG(Debug, "Render target pool: creating a %dx%d target, color 0x%x, depth 0x%x, %d samples", description.width,
+         description.height, description.color_format, description.depth_format, description.samples);
+  auto color = description.color_format != GL_NONE ? CreateAttachment(description, description.color_format)
+                                                   : nullptr;
+  auto depth = description.depth_format != GL_NONE ? CreateAttachment(description, description.depth_format)
+                                                   : nullptr;
+  return std::make_shared<RenderTarget>(color, depth, 0, 0);
+}
+
+void RenderTargetPool::Invalidate(PooledTarget &target) {
+  // glInvalidateFramebuffer is GL 4.3, older desktop contexts keep the contents
+  if (!glInvalidateFramebuffer) {
+    return;
+  }
+  GLenum attachments[2] = {};
+  GLsizei attachment_count = 0;
+  if (target.description.color_format != GL_NONE) {
+    attachments[attachment_count++] = GL_COLOR_ATTACHMENT0;
+  }
+  if (target.description.depth_format != GL_NONE) {
+    attachments[attachment_count++] =
+        HasStencil(target.description.depth_format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+  }
+  // Only the read binding is touched, the frame being rendered may still have its target bound for drawing
+  GLint read_framebuffer = 0;
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, target.render_target->GetGLFramebuffer());
+  glInvalidateFramebuffer(GL_READ_FRAMEBUFFER, attachment_count, attachments);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(read_framebuffer));
+}
+
+}  // namespace app_framework
+}  // namespace ml
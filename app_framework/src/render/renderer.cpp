@@ -8,30 +8,45 @@
 // %BANNER_END%
 #include "renderer.h"
 #include <app_framework/gui.h>
+#include <app_framework/registry.h>
+#include <app_framework/material/flat_material.h>
 
 #include <algorithm>
 
 namespace ml {
 namespace app_framework {
 
+namespace {
+
+uint64_t CountTriangles(Mesh &mesh) {
+  if (mesh.GetPrimitiveType() != GL_TRIANGLES) {
+    return 0;
+  }
+  return (mesh.UsesIndexedRendering() ? mesh.GetNumVertices() : mesh.GetNumIndices()) / 3;
+}
+
+}  // namespace
+
+constexpr float Renderer::kLodHysteresis;
+
 Renderer::Renderer() {
   glGenBuffers(1, &camera_uniform_buffer_);
   glBindBuffer(GL_UNIFORM_BUFFER, camera_uniform_buffer_);
   glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraUBO), nullptr, GL_DYNAMIC_DRAW);
 
-  glGenBuffers(1, &light_uniform_buffer_);
-  glBindBuffer(GL_UNIFORM_BUFFER, light_uniform_buffer_);
-  glBufferData(GL_UNIFORM_BUFFER, sizeof(LightsUBO), nullptr, GL_DYNAMIC_DRAW);
-
   glGenBuffers(1, &model_uniform_buffer_);
   glBindBuffer(GL_UNIFORM_BUFFER, model_uniform_buffer_);
-  glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(ModelUBO), nullptr, GL_DYNAMIC_DRAW);
+
+  GpuMemoryTracker &tracker = Registry::GetInstance()->GetGpuMemoryTracker();
+  tracker.SetLabel(this, "renderer");
+  tracker.Update(this, GpuMemoryTracker::Category::kUniformBuffer, sizeof(CameraUBO) + sizeof(ModelUBO));
 }
 
 Renderer::~Renderer() {
   glDeleteBuffers(1, &camera_uniform_buffer_);
-  glDeleteBuffers(1, &light_uniform_buffer_);
   glDeleteBuffers(1, &model_uniform_buffer_);
+  Registry::GetInstance()->GetGpuMemoryTracker().Release(this);
 }
 
 void Renderer::QueueCamera(std::shared_ptr<CameraComponent> camera) {
@@ -59,12 +74,45 @@ void Renderer::Render() {
     pre_render_callback_();
   }
 
+  // Pack the parameters of every queued material, then upload what changed with one pass over the arena. The
+  // opaque materials are sorted by pipeline state so each state is bound once.
+  opaque_batches_.clear();
+  transparent_materials_.clear();
+  for (const auto &material_and_renderables : queued_opaque_renderables_) {
+    Material *material = PrepareMaterial(*material_and_renderables.first);
+    if (material) {
+      const uint64_t sort_key = (uint64_t)material->GetPipelineState() << 32 | material->GetParameterOffset();
+      opaque_batches_.push_back(OpaqueBatch{sort_key, material, &material_and_renderables.second});
+    }
+  }
+  std::sort(opaque_batches_.begin(), opaque_batches_.end(),
+      [](const OpaqueBatch &batch1, const OpaqueBatch &batch2) { return batch1.sort_key < batch2.sort_key; });
+  for (const auto &renderable : queued_transparent_renderables_) {
+    transparent_materials_[renderable.get()] = PrepareMaterial(*renderable->GetMaterial());
+  }
+  Registry::GetInstance()->GetMaterialParameterArena().Flush();
+
+  // Assign the lights to the clusters of every camera up front, the cameras are the eyes of the same frame
+  lights_.clear();
+  for (auto &light : queued_lights_) {
+    lights_.push_back(Light(light->GetNode()->GetWorldTranslation(), light->GetLightColor(), light->GetDirection(),
+                            light->GetLightType(), light->GetLightStrength(), light->GetLightRange()));
+  }
+  light_clusters_.Assign(queued_cameras_, lights_);
+  light_clusters_.Upload();
+
   glEnable(GL_PROGRAM_POINT_SIZE);
-  glEnable(GL_DEPTH_TEST);
   glEnable(GL_FRAMEBUFFER_SRGB);
 
-  for (const std::shared_ptr<CameraComponent> &cam : queued_cameras_) {
+  PipelineStateCache &pipeline_states = Registry::GetInstance()->GetPipelineStateCache();
+  TextureBindingCache &texture_bindings = Registry::GetInstance()->GetTextureBindingCache();
+  triangle_count_ = 0;
+  full_detail_triangle_count_ = 0;
+
+  for (size_t cam_index = 0; cam_index < queued_cameras_.size(); ++cam_index) {
+    const std::shared_ptr<CameraComponent> &cam = queued_cameras_[cam_index];
     current_cam_ = cam;
+    current_cam_index_ = cam_index;
     if (pre_cam_callback_) {
       pre_cam_callback_(current_cam_);
     }
@@ -78,27 +126,29 @@ void Renderer::Render() {
     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
     auto viewport = current_cam_->GetViewport();
     glViewport((int)viewport.x, (int)viewport.y, (int)viewport.z, (int)viewport.w);
+    lod_pixel_scale_ = 0.5f * viewport.w * cam->GetProjectionMatrix()[1][1];
+
+    // The callbacks and the previous camera can leave anything bound
+    pipeline_states.Invalidate();
+    texture_bindings.Invalidate();
+    current_template_ = nullptr;
+    bound_vertex_array_ = 0;
 
     glClearColor(0.0, 0.0, 0.0, 0.0);
+    glDepthMask(GL_TRUE);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Draw all opaque objects first.
-    glDisable(GL_BLEND);
-
-    for (auto &material_and_renderables : queued_opaque_renderables_) {
-      auto &material = *material_and_renderables.first;
-      auto &renderables = material_and_renderables.second;
-
-      UseMaterial(material);
+    for (const auto &batch : opaque_batches_) {
+      UsePipelineState(*batch.material);
+      UseMaterial(*batch.material);
       glBindBuffer(GL_UNIFORM_BUFFER, model_uniform_buffer_);
-      for (const auto &renderable : renderables) {
+      for (const auto &renderable : *batch.renderables) {
         RenderRenderable(*renderable);
       }
     }
 
     // Sort transparent renderables back-to-front and then draw them
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     const auto camera_position = cam->GetNode()->GetWorldTranslation();
     std::sort(queued_transparent_renderables_.begin(), queued_transparent_renderables_.end(),
         [&camera_position](const std::shared_ptr<RenderableComponent> &renderable1,
@@ -108,16 +158,25 @@ void Renderer::Render() {
           return dist1 > dist2;
         });
     for (const auto &renderable : queued_transparent_renderables_) {
-      UseMaterial(*renderable->GetMaterial());
+      Material *material = transparent_materials_[renderable.get()];
+      if (!material) {
+        continue;
+      }
+      UsePipelineState(*material);
+      UseMaterial(*material);
       glBindBuffer(GL_UNIFORM_BUFFER, model_uniform_buffer_);
       RenderRenderable(*renderable);
     }
 
     // Finally unbind any vertex array after drawing, to make sure nothing else messes with it
     glBindVertexArray(0);
+    bound_vertex_array_ = 0;
 
-    // Reset the glPolygonMode to avoid interfering with imgui's rendering
+    // Reset the glPolygonMode, the depth writes and the samplers to avoid interfering with imgui's rendering
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDepthMask(GL_TRUE);
+    pipeline_states.Invalidate();
+    texture_bindings.Reset();
 
     auto blit_target = cam->GetBlitTarget();
     if (blit_target) {
@@ -149,34 +208,51 @@ void Renderer::Render() {
 }
 
 void Renderer::ClearQueues() {
+  opaque_batches_.clear();
+  transparent_materials_.clear();
   queued_opaque_renderables_.clear();
   queued_transparent_renderables_.clear();
   queued_cameras_.clear();
   queued_lights_.clear();
 }
 
-void Renderer::BindProgram(GLuint vert, GLuint geom, GLuint frag) {
-  std::tuple<GLuint, GLuint, GLuint> key = std::make_tuple(vert, geom, frag);
-  auto it = shader_program_cache_.find(key);
-  if (it == shader_program_cache_.end()) {
-    glGenProgramPipelines(1, &program_pipeline_);
-    glUseProgramStages(program_pipeline_, GL_VERTEX_SHADER_BIT, vert);
-    if (geom != 0) {
-      glUseProgramStages(program_pipeline_, GL_GEOMETRY_SHADER_BIT, geom);
-    }
-    glUseProgramStages(program_pipeline_, GL_FRAGMENT_SHADER_BIT, frag);
-    shader_program_cache_[key] = program_pipeline_;
-  } else {
-    program_pipeline_ = it->second;
+Material *Renderer::PrepareMaterial(Material &material) {
+  material.ResolveProgram();
+  if (material.IsReady()) {
+    material.UpdateMaterialUniformBuffer();
+    return &material;
   }
 
-  glBindProgramPipeline(program_pipeline_);
+  // Flat gray, the solid color shaders are the cheapest ones and only need the positions of the mesh
+  if (!fallback_material_) {
+    auto fallback_material = std::make_shared<FlatMaterial>(glm::vec4(0.5f, 0.5f, 0.5f, 1.f));
+    fallback_material->SetOverrideVertexColor(true);
+    fallback_material_ = fallback_material;
+  }
+  if (!fallback_material_->IsReady()) {
+    return nullptr;
+  }
+  fallback_material_->UpdateMaterialUniformBuffer();
+  return fallback_material_.get();
 }
 
-void Renderer::UseMaterial(Material &material) {
+void Renderer::UsePipelineState(const Material &material) {
+  const MaterialTemplate *material_template = material.GetTemplate().get();
+  if (material_template != current_template_) {
+    UseMaterialTemplate(*material_template);
+    current_template_ = material_template;
+  }
+  Registry::GetInstance()->GetPipelineStateCache().Bind(material.GetPipelineState());
+}
+
+void Renderer::UseMaterialTemplate(const MaterialTemplate &material_template) {
   auto view = glm::inverse(current_cam_->GetNode()->GetWorldTransform());
   auto view_proj = current_cam_->GetProjectionMatrix() * view;
 
+  current_vertex_program_ = material_template.GetVertexProgram();
+  current_frag_program_ = material_template.GetFragmentProgram();
+  current_geom_program_ = material_template.GetGeometryProgram();
+
   // Get the camera data, mvp, update the uniform
   camera_uniform_buffer_dirty_ = true;
   CameraUBO transforms_ubo(view_proj, current_cam_->GetNode()->GetWorldTranslation());
@@ -194,58 +270,77 @@ void Renderer::UseMaterial(Material &material) {
     BindModelUniform(*current_geom_program_);
   }
 
-  glPolygonMode(GL_FRONT_AND_BACK, material.GetPolygonMode());
+  light_clusters_.Bind(*current_frag_program_, current_cam_index_);
+}
 
-  current_vertex_program_ = material.GetVertexProgram();
-  current_frag_program_ = material.GetFragmentProgram();
-  current_geom_program_ = material.GetGeometryProgram();
+void Renderer::UseMaterial(Material &material) {
+  material.UpdateMaterialUniforms();
+  if (material.GetParameterSize()) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, material.GetTemplate()->GetBlockDescription().binding,
+        Registry::GetInstance()->GetMaterialParameterArena().GetGLBuffer(), material.GetParameterOffset(),
+        material.GetParameterSize());
+  }
+}
 
-  bool bind_gs = static_cast<bool>(current_geom_program_);
+void Renderer::RenderRenderable(RenderableComponent &renderable) {
+  Mesh &mesh = SelectLod(renderable);
+  triangle_count_ += CountTriangles(mesh);
+  full_detail_triangle_count_ += CountTriangles(*renderable.GetMesh());
 
-  BindProgram(current_vertex_program_->GetGLProgram(), bind_gs ? current_geom_program_->GetGLProgram() : 0,
-      current_frag_program_->GetGLProgram());
+  ModelUBO model_ubo;
+  model_ubo.transform = renderable.GetNode()->GetWorldTransform() * mesh.GetPositionDequantization();
+  model_ubo.vertex_format = glm::ivec4(mesh.HasOctahedralNormals() ? 1 : 0, 0, 0, 0);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(model_ubo), &model_ubo);
 
-  const auto &fragment_ubo_blk_list = current_frag_program_->GetUniformBlocks();
-  lights_.clear();
-  for (auto &light : queued_lights_) {
-    Light l(light->GetNode()->GetWorldTranslation(), light->GetLightColor(), light->GetDirection(),
-        light->GetLightType(), light->GetLightStrength());
-    lights_.push_back(l);
+  if (mesh.GetPrimitiveType() == GL_POINTS) {
+    glPointSize(mesh.GetPointSize());
   }
-  LightsUBO lights_ubo(lights_);
-  auto fragment_ubo_light_it = fragment_ubo_blk_list.find(UniformName::kLight);
-  if (fragment_ubo_light_it != fragment_ubo_blk_list.end()) {
-    const auto &des = fragment_ubo_light_it->second;
-    glBindBufferBase(GL_UNIFORM_BUFFER, des.binding, light_uniform_buffer_);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(lights_ubo), &lights_ubo);
+
+  // Meshes of the geometry arena share their vertex array with the other meshes of their layout
+  if (mesh.GetVertexArrayObject() != bound_vertex_array_) {
+    glBindVertexArray(mesh.GetVertexArrayObject());
+    bound_vertex_array_ = mesh.GetVertexArrayObject();
   }
 
-  material.UpdateMaterialUniforms();
-  auto fragment_ubo_it = fragment_ubo_blk_list.find(UniformName::kMaterial);
-  if (fragment_ubo_it != fragment_ubo_blk_list.end()) {
-    const auto &des = fragment_ubo_it->second;
-    material.UpdateMaterialUniformBuffer();
-    glBindBufferBase(GL_UNIFORM_BUFFER, des.binding, material.GetGLUniformBuffer());
+  if (mesh.UsesIndexedRendering()) {
+    glDrawArrays(mesh.GetPrimitiveType(), mesh.GetBaseVertex(), mesh.GetNumVertices());
+  } else {
+    glDrawElementsBaseVertex(mesh.GetPrimitiveType(), mesh.GetNumIndices(), mesh.GetIndexType(),
+                             (void *)mesh.GetIndexOffset(), mesh.GetBaseVertex());
   }
 }
 
-void Renderer::RenderRenderable(const RenderableComponent &renderable) {
-  auto model_transform = renderable.GetNode()->GetWorldTransform();
-  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(model_transform), glm::value_ptr(model_transform));
-
-  auto mesh = renderable.GetMesh();
-
-  if (mesh->GetPrimitiveType() == GL_POINTS) {
-    glPointSize(mesh->GetPointSize());
+Mesh &Renderer::SelectLod(RenderableComponent &renderable) {
+  const size_t lod_count = renderable.GetLodCount();
+  if (lod_count == 1 || lod_error_threshold_ <= 0.f) {
+    return *renderable.GetMesh();
   }
 
-  glBindVertexArray(mesh->GetVertexArrayObject());
-
-  if (mesh->UsesIndexedRendering()) {
-    glDrawArrays(mesh->GetPrimitiveType(), 0, mesh->GetNumVertices());
-  } else {
-    glDrawElements(mesh->GetPrimitiveType(), mesh->GetNumIndices(), mesh->GetIndexType(), nullptr);
+  // Distance to the nearest point of the bounding sphere, the levels of a mesh share the bounds of the full one
+  const glm::mat4 world_transform = renderable.GetNode()->GetWorldTransform();
+  const float world_scale = std::max(glm::length(glm::vec3(world_transform[0])),
+      std::max(glm::length(glm::vec3(world_transform[1])), glm::length(glm::vec3(world_transform[2]))));
+  const glm::vec4 &bounding_sphere = renderable.GetMesh()->GetBoundingSphere();
+  const glm::vec3 center = glm::vec3(world_transform * glm::vec4(glm::vec3(bounding_sphere), 1.f));
+  const float distance = glm::distance(center, current_cam_->GetNode()->GetWorldTranslation()) -
+      bounding_sphere.w * world_scale;
+
+  size_t level = 0;
+  if (distance > 0.f) {
+    const float pixels_per_unit = lod_pixel_scale_ * world_scale / distance;
+    auto get_pixels = [&renderable, pixels_per_unit](size_t lod) {
+      return renderable.GetLodMesh(lod)->GetSimplificationError() * pixels_per_unit;
+    };
+    level = std::min(renderable.GetLodLevel(current_cam_index_), lod_count - 1);
+    while (level > 0 && get_pixels(level) > lod_error_threshold_) {
+      --level;
+    }
+    while (level + 1 < lod_count && get_pixels(level + 1) <= kLodHysteresis * lod_error_threshold_) {
+      ++level;
+    }
   }
+  renderable.SetLodLevel(current_cam_index_, level);
+  return *renderable.GetLodMesh(level);
 }
 
 void Renderer::BindCameraUniform(Program &program, const CameraUBO &camera_ubo) {
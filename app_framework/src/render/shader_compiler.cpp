@@ -0,0 +1,192 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "shader_compiler.h"
+
+#include <cstring>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+bool HasExtension(const char *name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+    if (extension && strcmp(extension, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+ShaderCompiler::~ShaderCompiler() {
+  Terminate();
+}
+
+void ShaderCompiler::Initialize(GraphicsContext &context) {
+  if (mode_ != Mode::kSync) {
+    return;
+  }
+
+  if (HasExtension("GL_KHR_parallel_shader_compile")) {
+    using MaxShaderCompilerThreadsProc = void (*)(GLuint);
+    auto max_shader_compiler_threads = reinterpret_cast<MaxShaderCompilerThreadsProc>(
+        GraphicsContext::GetProcAddress("glMaxShaderCompilerThreadsKHR"));
+    if (max_shader_compiler_threads) {
+      // Let the driver pick the number of threads
+      max_shader_compiler_threads(0xFFFFFFFF);
+      mode_ = Mode::kParallel;
+      ML_LOG(Info, "Compiling shaders with GL_KHR_parallel_shader_compile");
+      return;
+    }
+  }
+
+  worker_context_.reset(context.CreateSharedContext());
+  if (!worker_context_) {
+    ML_LOG(Warning, "No shared context for the shader compile thread, compiling shaders synchronously");
+    return;
+  }
+  stop_ = false;
+  mode_ = Mode::kWorker;
+  worker_ = std::thread(&ShaderCompiler::WorkerLoop, this);
+  ML_LOG(Info, "Compiling shaders on a shared context thread");
+}
+
+void ShaderCompiler::Terminate() {
+  if (mode_ == Mode::kWorker) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+      jobs_.clear();
+    }
+    job_added_.notify_all();
+    job_completed_.notify_all();
+    worker_.join();
+    worker_context_.reset();
+  }
+  mode_ = Mode::kSync;
+}
+
+void ShaderCompiler::Submit(GLuint program, const char *code, GLenum type) {
+  if (mode_ == Mode::kParallel) {
+    // The calls only queue the work, the driver threads compile and link
+    CompileAndLink(program, code, type);
+    return;
+  }
+  if (mode_ == Mode::kSync) {
+    CompileAndLink(program, code, type);
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed_.insert(program);
+    return;
+  }
+  // The program and its parameters were set by this context, the worker context only sees them once they are flushed
+  glFlush();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(Job{program, code, type});
+  }
+  job_added_.notify_one();
+}
+
+bool ShaderCompiler::IsComplete(GLuint program) {
+  if (mode_ == Mode::kParallel) {
+    GLint complete = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = completed_.find(program);
+  if (it == completed_.end()) {
+    return false;
+  }
+  completed_.erase(it);
+  return true;
+}
+
+void ShaderCompiler::Wait(GLuint program) {
+  if (mode_ == Mode::kParallel) {
+    // Reading the link status blocks until the driver is done
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_completed_.wait(lock, [this, program]() { return stop_ || completed_.count(program) != 0; });
+}
+
+bool ShaderCompiler::Cancel(GLuint program) {
+  if (mode_ != Mode::kWorker) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  completed_.erase(program);
+  if (linking_ == program) {
+    linking_cancelled_ = true;
+    return false;
+  }
+  for (auto it = jobs_.begin(); it != jobs_.end(); ++it) {
+    if (it->program == program) {
+      jobs_.erase(it);
+      break;
+    }
+  }
+  return true;
+}
+
+void ShaderCompiler::CompileAndLink(GLuint program, const char *code, GLenum type) {
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &code, nullptr);
+  glCompileShader(shader);
+  glAttachShader(program, shader);
+  glLinkProgram(program);
+  // Deletion is deferred until the program is done with the shader
+  glDetachShader(program, shader);
+  glDeleteShader(shader);
+}
+
+void ShaderCompiler::WorkerLoop() {
+  worker_context_->MakeCurrent();
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    job_added_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+    if (stop_) {
+      break;
+    }
+    Job job = std::move(jobs_.front());
+    jobs_.pop_front();
+    linking_ = job.program;
+    linking_cancelled_ = false;
+    lock.unlock();
+
+    CompileAndLink(job.program, job.code.c_str(), job.type);
+    // The render context only sees the linked program once the commands of this context have completed
+    glFinish();
+
+    lock.lock();
+    if (linking_cancelled_) {
+      glDeleteProgram(job.program);
+    } else {
+      completed_.insert(job.program);
+    }
+    linking_ = 0;
+    job_completed_.notify_all();
+  }
+  worker_context_->UnMakeCurrent();
+}
+
+}  // namespace app_framework
+}  // namespace ml
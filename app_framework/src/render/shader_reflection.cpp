@@ -0,0 +1,32 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "shader_reflection.h"
+
+#include <cstring>
+
+namespace ml {
+namespace app_framework {
+
+// Defined in the generated precompiled_shaders.cpp
+extern const ShaderReflection kPrecompiledShaders[];
+extern const size_t kPrecompiledShaderCount;
+
+const ShaderReflection *FindShaderReflection(const char *code, GLenum type) {
+  // There are only a handful of generated programs, and this runs once per compiled program
+  for (size_t i = 0; i < kPrecompiledShaderCount; ++i) {
+    const ShaderReflection &reflection = kPrecompiledShaders[i];
+    if (reflection.type == type && (reflection.code == code || strcmp(reflection.code, code) == 0)) {
+      return &reflection;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace app_framework
+}  // namespace ml
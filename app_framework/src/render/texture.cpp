@@ -9,14 +9,48 @@
 #include "texture.h"
 #include "stb_image.h"
 
+#include <app_framework/registry.h>
+
 namespace ml {
 namespace app_framework {
 
+Texture::Texture(std::shared_ptr<TextureArray> array, int32_t layer)
+    : texture_(array->GetGLTexture()),
+      texture_type_(GL_TEXTURE_2D_ARRAY),
+      width_(array->GetWidth()),
+      height_(array->GetHeight()),
+      owned_(false),
+      array_(array),
+      layer_(layer),
+      internal_format_(array->GetInternalFormat()),
+      level_count_(array->GetLevelCount()) {
+  Registry::GetInstance()->GetGpuMemoryTracker().Update(this, GpuMemoryTracker::Category::kTexture, GetByteSize());
+}
+
 Texture::~Texture() {
+  if (array_) {
+    array_->FreeLayer(layer_);
+  }
   if (owned_) {
-    glDeleteTextures(1, &texture_);
+    Registry::GetInstance()->GetGLDeletionQueue().Enqueue(GLDeletionQueue::ObjectType::kTexture, texture_);
     texture_ = 0;
   }
+  // Only the storage the texture owns, or its layer of an array, is accounted to it
+  if (owned_ || array_) {
+    Registry::GetInstance()->GetGpuMemoryTracker().Release(this);
+  }
+}
+
+void Texture::SetFormat(GLenum internal_format, int32_t level_count, GpuMemoryTracker::Category category) {
+  internal_format_ = internal_format;
+  level_count_ = level_count;
+  if (owned_ || array_) {
+    Registry::GetInstance()->GetGpuMemoryTracker().Update(this, category, GetByteSize());
+  }
+}
+
+void Texture::SetMemoryLabel(const std::string &label) {
+  Registry::GetInstance()->GetGpuMemoryTracker().SetLabel(this, label);
 }
 
 }
@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "texture_array.h"
+#include "texture_image.h"
+
+#include <app_framework/registry.h>
+
+namespace ml {
+namespace app_framework {
+
+TextureArray::TextureArray(int32_t width, int32_t height, GLenum internal_format, int32_t layer_count,
+                           int32_t level_count)
+    : texture_(0),
+      width_(width),
+      height_(height),
+      internal_format_(internal_format),
+      layer_count_(layer_count),
+      level_count_(level_count) {
+  glGenTextures(1, &texture_);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture_);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, level_count_, internal_format_, width_, height_, layer_count_);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  // Lowest layer first
+  for (int32_t layer = layer_count_ - 1; layer >= 0; --layer) {
+    free_layers_.push_back(layer);
+  }
+  Registry::GetInstance()->GetGpuMemoryTracker().SetLabel(this, "free texture array layers");
+  UpdateMemoryUsage();
+}
+
+TextureArray::~TextureArray() {
+  Registry::GetInstance()->GetGLDeletionQueue().Enqueue(GLDeletionQueue::ObjectType::kTexture, texture_);
+  Registry::GetInstance()->GetGpuMemoryTracker().Release(this);
+}
+
+int32_t TextureArray::AllocateLayer() {
+  if (free_layers_.empty()) {
+    return -1;
+  }
+  int32_t layer = free_layers_.back();
+  free_layers_.pop_back();
+  UpdateMemoryUsage();
+  return layer;
+}
+
+void TextureArray::FreeLayer(int32_t layer) {
+  free_layers_.push_back(layer);
+  UpdateMemoryUsage();
+}
+
+void TextureArray::UpdateMemoryUsage() {
+  Registry::GetInstance()->GetGpuMemoryTracker().Update(
+      this, GpuMemoryTracker::Category::kTexture,
+      free_layers_.size() * GetTextureSize(internal_format_, width_, height_, level_count_));
+}
+
+}  // namespace app_framework
+}  // namespace ml
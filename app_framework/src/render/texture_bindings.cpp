@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "texture_bindings.h"
+#include "hash_combine.h"
+
+#include <functional>
+
+namespace ml {
+namespace app_framework {
+
+size_t SamplerDescriptionHash::operator()(const SamplerDescription &description) const {
+  std::hash<uint32_t> hash;
+  size_t seed = hash(description.min_filter);
+  HashCombine(seed, hash(description.mag_filter));
+  HashCombine(seed, hash(description.wrap_s));
+  HashCombine(seed, hash(description.wrap_t));
+  return seed;
+}
+
+TextureBindingCache::~TextureBindingCache() {
+  for (auto &pair : samplers_) {
+    glDeleteSamplers(1, &pair.second);
+  }
+}
+
+GLuint TextureBindingCache::GetSampler(const SamplerDescription &description) {
+  auto it = samplers_.find(description);
+  if (it != samplers_.end()) {
+    return it->second;
+  }
+  GLuint sampler = 0;
+  glGenSamplers(1, &sampler);
+  glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, description.min_filter);
+  glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, description.mag_filter);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, description.wrap_s);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, description.wrap_t);
+  samplers_[description] = sampler;
+  return sampler;
+}
+
+void TextureBindingCache::Bind(GLuint unit, GLenum target, GLuint texture, GLuint sampler) {
+  if (unit >= units_.size()) {
+    units_.resize(unit + 1);
+  }
+  Binding &binding = units_[unit];
+  if (binding.valid && binding.target == target && binding.texture == texture && binding.sampler == sampler) {
+    return;
+  }
+  glActiveTexture(GL_TEXTURE0 + unit);
+  // Switching targets leaves the texture of the previous one bound, which is fine as long as a program samples
+  // one target per unit
+  if (!binding.valid || binding.target != target || binding.texture != texture) {
+    glBindTexture(target, texture);
+  }
+  if (!binding.valid || binding.sampler != sampler) {
+    glBindSampler(unit, sampler);
+  }
+  binding.target = target;
+  binding.texture = texture;
+  binding.sampler = sampler;
+  binding.valid = true;
+}
+
+void TextureBindingCache::ReleaseTexture(GLuint texture) {
+  for (auto &binding : units_) {
+    if (binding.texture == texture) {
+      binding.valid = false;
+    }
+  }
+}
+
+void TextureBindingCache::Reset() {
+  for (GLuint unit = 0; unit < units_.size(); ++unit) {
+    if (!units_[unit].valid || units_[unit].sampler) {
+      glBindSampler(unit, 0);
+    }
+  }
+  Invalidate();
+}
+
+void TextureBindingCache::Invalidate() {
+  for (auto &binding : units_) {
+    binding.valid = false;
+  }
+}
+
+}  // namespace app_framework
+}  // namespace ml
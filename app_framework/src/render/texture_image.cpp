@@ -0,0 +1,469 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "texture_image.h"
+
+#include <ml_logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+struct BlockFormat {
+  int32_t width;
+  int32_t height;
+  uint32_t bytes;
+};
+
+// Footprints of GL_COMPRESSED_RGBA_ASTC_4x4 to GL_COMPRESSED_RGBA_ASTC_12x12, in enum order. The sRGB formats are
+// in the same order.
+const int32_t kAstcFootprints[][2] = {{4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6},
+                                      {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}};
+
+bool IsAstcFormat(GLenum internal_format) {
+  return (internal_format >= GL_COMPRESSED_RGBA_ASTC_4x4 && internal_format <= GL_COMPRESSED_RGBA_ASTC_12x12) ||
+         (internal_format >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4 &&
+          internal_format <= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12);
+}
+
+bool IsEtcFormat(GLenum internal_format) {
+  return internal_format >= GL_COMPRESSED_R11_EAC && internal_format <= GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+}
+
+// Texels of a block and its size, 1x1 for the uncompressed formats
+BlockFormat GetBlockFormat(GLenum internal_format) {
+  if (IsAstcFormat(internal_format)) {
+    const GLenum base = internal_format >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4 ? GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4
+                                                                              : GL_COMPRESSED_RGBA_ASTC_4x4;
+    const int32_t *footprint = kAstcFootprints[internal_format - base];
+    return BlockFormat{footprint[0], footprint[1], 16};
+  }
+  switch (internal_format) {
+    case GL_COMPRESSED_R11_EAC:
+    case GL_COMPRESSED_SIGNED_R11_EAC:
+    case GL_COMPRESSED_RGB8_ETC2:
+    case GL_COMPRESSED_SRGB8_ETC2:
+    case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+    case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2: return BlockFormat{4, 4, 8};
+    case GL_COMPRESSED_RG11_EAC:
+    case GL_COMPRESSED_SIGNED_RG11_EAC:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+    case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC: return BlockFormat{4, 4, 16};
+    case GL_R8: return BlockFormat{1, 1, 1};
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16: return BlockFormat{1, 1, 2};
+    case GL_RGB8:
+    case GL_SRGB8: return BlockFormat{1, 1, 3};
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8: return BlockFormat{1, 1, 8};
+    case GL_RGBA32F: return BlockFormat{1, 1, 16};
+    default: return BlockFormat{1, 1, 4};
+  }
+}
+
+// sRGB transfer function, 8 bit encoded to linear and linear quantized to 12 bits back to 8 bit encoded
+struct SrgbTables {
+  float to_linear[256];
+  uint8_t to_srgb[4096];
+
+  SrgbTables() {
+    for (int32_t i = 0; i < 256; ++i) {
+      const float c = i / 255.f;
+      to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int32_t i = 0; i < 4096; ++i) {
+      const float c = i / 4095.f;
+      const float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+      to_srgb[i] = static_cast<uint8_t>(std::min(255.f, srgb * 255.f + 0.5f));
+    }
+  }
+};
+
+const SrgbTables &GetSrgbTables() {
+  static const SrgbTables tables;
+  return tables;
+}
+
+std::vector<char> Downsample(const std::vector<char> &level, int32_t width, int32_t height, bool srgb) {
+  const int32_t next_width = std::max(1, width / 2);
+  const int32_t next_height = std::max(1, height / 2);
+  const uint8_t *src = reinterpret_cast<const uint8_t *>(level.data());
+  std::vector<char> next(4 * static_cast<size_t>(next_width) * next_height);
+  uint8_t *dst = reinterpret_cast<uint8_t *>(&next[0]);
+  const SrgbTables &tables = GetSrgbTables();
+  for (int32_t y = 0; y < next_height; ++y) {
+    const int32_t y0 = std::min(2 * y, height - 1);
+    const int32_t y1 = std::min(2 * y + 1, height - 1);
+    for (int32_t x = 0; x < next_width; ++x) {
+      const int32_t x0 = std::min(2 * x, width - 1);
+      const int32_t x1 = std::min(2 * x + 1, width - 1);
+      const uint8_t *texels[4] = {src + 4 * (y0 * width + x0), src + 4 * (y0 * width + x1),
+                                  src + 4 * (y1 * width + x0), src + 4 * (y1 * width + x1)};
+      uint8_t *out = dst + 4 * (y * next_width + x);
+      for (int32_t channel = 0; channel < 4; ++channel) {
+        if (srgb && channel < 3) {
+          float sum = 0.f;
+          for (const uint8_t *texel : texels) {
+            sum += tables.to_linear[texel[channel]];
+          }
+          out[channel] = tables.to_srgb[static_cast<int32_t>(sum * (4095.f / 4.f) + 0.5f)];
+        } else {
+          const int32_t sum = texels[0][channel] + texels[1][channel] + texels[2][channel] + texels[3][channel];
+          out[channel] = static_cast<uint8_t>((sum + 2) / 4);
+        }
+      }
+    }
+  }
+  return next;
+}
+
+uint32_t ByteSwap(uint32_t value) {
+  return (value >> 24) | ((value >> 8) & 0xff00u) | ((value << 8) & 0xff0000u) | (value << 24);
+}
+
+// ETC2 and EAC blocks are stored big endian, the texels of a block are numbered column by column
+uint64_t ReadBlock(const uint8_t *block) {
+  uint64_t bits = 0;
+  for (int32_t i = 0; i < 8; ++i) {
+    bits = bits << 8 | block[i];
+  }
+  return bits;
+}
+
+inline int32_t Bits(uint64_t bits, int32_t high, int32_t low) {
+  return static_cast<int32_t>((bits >> low) & ((1ull << (high - low + 1)) - 1));
+}
+
+inline uint8_t Clamp255(int32_t value) {
+  return static_cast<uint8_t>(std::min(255, std::max(0, value)));
+}
+
+inline int32_t Extend(int32_t value, int32_t bit_count) {
+  return value << (8 - bit_count) | value >> (2 * bit_count - 8);
+}
+
+const int32_t kEtcModifiers[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+const int32_t kEtcDistances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+const int32_t kEacModifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12}, {-2, -5, -8, -13, 1, 4, 7, 12},
+    {-2, -4, -6, -13, 1, 3, 5, 12}, {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10}, {-2, -6, -8, -10, 1, 5, 7, 9},
+    {-2, -5, -8, -10, 1, 4, 7, 9},  {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},  {-4, -6, -8, -9, 3, 5, 7, 8},
+    {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+// Decodes the RGB of an ETC2 block to 4x4 RGBA8 texels, row by row. Alpha is left untouched.
+void DecodeEtc2Rgb(const uint8_t *block, uint8_t *texels) {
+  const uint64_t bits = ReadBlock(block);
+  const bool differential = Bits(bits, 33, 33) != 0;
+  const bool flip = Bits(bits, 32, 32) != 0;
+
+  int32_t colors[2][3];
+  int32_t paint[4][3];
+  bool paint_mode = false;
+  if (!differential) {
+    for (int32_t channel = 0; channel < 3; ++channel) {
+      colors[0][channel] = Extend(Bits(bits, 63 - 8 * channel, 60 - 8 * channel), 4);
+      colors[1][channel] = Extend(Bits(bits, 59 - 8 * channel, 56 - 8 * channel), 4);
+    }
+  } else {
+    int32_t base[3];
+    int32_t offset[3];
+    for (int32_t channel = 0; channel < 3; ++channel) {
+      base[channel] = Bits(bits, 63 - 8 * channel, 59 - 8 * channel);
+      const int32_t delta = Bits(bits, 58 - 8 * channel, 56 - 8 * channel);
+      offset[channel] = base[channel] + (delta >= 4 ? delta - 8 : delta);
+    }
+    if (offset[0] < 0 || offset[0] > 31) {
+      // T mode
+      const int32_t c1[3] = {Extend(Bits(bits, 60, 59) << 2 | Bits(bits, 57, 56), 4), Extend(Bits(bits, 55, 52), 4),
+                             Extend(Bits(bits, 51, 48), 4)};
+      const int32_t c2[3] = {Extend(Bits(bits, 47, 44), 4), Extend(Bits(bits, 43, 40), 4),
+                             Extend(Bits(bits, 39, 36), 4)};
+      const int32_t distance = kEtcDistances[Bits(bits, 35, 34) << 1 | Bits(bits, 32, 32)];
+      for (int32_t channel = 0; channel < 3; ++channel) {
+        paint[0][channel] = c1[channel];
+        paint[1][channel] = Clamp255(c2[channel] + distance);
+        paint[2][channel] = c2[channel];
+        paint[3][channel] = Clamp255(c2[channel] - distance);
+      }
+      paint_mode = true;
+    } else if (offset[1] < 0 || offset[1] > 31) {
+      // H mode
+      const int32_t r1 = Bits(bits, 62, 59);
+      const int32_t g1 = Bits(bits, 58, 56) << 1 | Bits(bits, 52, 52);
+      const int32_t b1 = Bits(bits, 51, 51) << 3 | Bits(bits, 49, 47);
+      const int32_t r2 = Bits(bits, 46, 43);
+      const int32_t g2 = Bits(bits, 42, 39);
+      const int32_t b2 = Bits(bits, 38, 35);
+      const int32_t order = (r1 << 8 | g1 << 4 | b1) >= (r2 << 8 | g2 << 4 | b2) ? 1 : 0;
+      const int32_t distance = kEtcDistances[Bits(bits, 34, 34) << 2 | Bits(bits, 32, 32) << 1 | order];
+      const int32_t c1[3] = {Extend(r1, 4), Extend(g1, 4), Extend(b1, 4)};
+      const int32_t c2[3] = {Extend(r2, 4), Extend(g2, 4), Extend(b2, 4)};
+      for (int32_t channel = 0; channel < 3; ++channel) {
+        paint[0][channel] = Clamp255(c1[channel] + distance);
+        paint[1][channel] = Clamp255(c1[channel] - distance);
+        paint[2][channel] = Clamp255(c2[channel] + distance);
+        paint[3][channel] = Clamp255(c2[channel] - distance);
+      }
+      paint_mode = true;
+    } else if (offset[2] < 0 || offset[2] > 31) {
+      // Planar mode, a gradient from the origin color to the horizontal and vertical ones
+      const int32_t origin[3] = {
+          Extend(Bits(bits, 62, 57), 6), Extend(Bits(bits, 56, 56) << 6 | Bits(bits, 54, 49), 7),
+          Extend(Bits(bits, 48, 48) << 5 | Bits(bits, 44, 43) << 3 | Bits(bits, 41, 39), 6)};
+      const int32_t horizontal[3] = {Extend(Bits(bits, 38, 34) << 1 | Bits(bits, 32, 32), 6),
+                                     Extend(Bits(bits, 31, 25), 7), Extend(Bits(bits, 24, 19), 6)};
+      const int32_t vertical[3] = {Extend(Bits(bits, 18, 13), 6), Extend(Bits(bits, 12, 6), 7),
+                                   Extend(Bits(bits, 5, 0), 6)};
+      for (int32_t y = 0; y < 4; ++y) {
+        for (int32_t x = 0; x < 4; ++x) {
+          for (int32_t channel = 0; channel < 3; ++channel) {
+            texels[4 * (4 * y + x) + channel] =
+                Clamp255((x * (horizontal[channel] - origin[channel]) + y * (vertical[channel] - origin[channel]) +
+                          4 * origin[channel] + 2) >> 2);
+          }
+        }
+      }
+      return;
+    } else {
+      for (int32_t channel = 0; channel < 3; ++channel) {
+        colors[0][channel] = Extend(base[channel], 5);
+        colors[1][channel] = Extend(offset[channel], 5);
+      }
+    }
+  }
+
+  const int32_t tables[2] = {Bits(bits, 39, 37), Bits(bits, 36, 34)};
+  for (int32_t x = 0; x < 4; ++x) {
+    for (int32_t y = 0; y < 4; ++y) {
+      const int32_t texel = 4 * x + y;
+      const int32_t msb = Bits(bits, 16 + texel, 16 + texel);
+      const int32_t lsb = Bits(bits, texel, texel);
+      uint8_t *out = texels + 4 * (4 * y + x);
+      if (paint_mode) {
+        for (int32_t channel = 0; channel < 3; ++channel) {
+          out[channel] = static_cast<uint8_t>(paint[msb << 1 | lsb][channel]);
+        }
+        continue;
+      }
+      const int32_t sub_block = flip ? (y >= 2) : (x >= 2);
+      const int32_t modifier = kEtcModifiers[tables[sub_block]][lsb];
+      for (int32_t channel = 0; channel < 3; ++channel) {
+        out[channel] = Clamp255(colors[sub_block][channel] + (msb ? -modifier : modifier));
+      }
+    }
+  }
+}
+
+// Decodes an EAC alpha block to the alpha of 4x4 RGBA8 texels, row by row
+void DecodeEacAlpha(const uint8_t *block, uint8_t *texels) {
+  const uint64_t bits = ReadBlock(block);
+  const int32_t base = Bits(bits, 63, 56);
+  const int32_t multiplier = Bits(bits, 55, 52);
+  const int32_t *modifiers = kEacModifiers[Bits(bits, 51, 48)];
+  for (int32_t texel = 0; texel < 16; ++texel) {
+    const int32_t index = Bits(bits, 47 - 3 * texel, 45 - 3 * texel);
+    const int32_t x = texel / 4;
+    const int32_t y = texel % 4;
+    texels[4 * (4 * y + x) + 3] = Clamp255(base + modifiers[index] * multiplier);
+  }
+}
+
+}  // namespace
+
+bool IsCompressedFormat(GLenum internal_format) {
+  return IsAstcFormat(internal_format) || IsEtcFormat(internal_format);
+}
+
+bool IsFormatSupported(GLenum internal_format) {
+  if (!IsCompressedFormat(internal_format)) {
+    return true;
+  }
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &format_count);
+  std::vector<GLint> formats(format_count);
+  if (format_count > 0) {
+    glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+  }
+  if (std::find(formats.begin(), formats.end(), static_cast<GLint>(internal_format)) != formats.end()) {
+    return true;
+  }
+  if (IsEtcFormat(internal_format)) {
+    return GLAD_GL_VERSION_4_3 != 0;
+  }
+  GLint extension_count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+  for (GLint i = 0; i < extension_count; ++i) {
+    const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+    if (extension && !strcmp(extension, "GL_KHR_texture_compression_astc_ldr")) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t GetTextureLevelSize(GLenum internal_format, int32_t width, int32_t height, int32_t level) {
+  const BlockFormat block = GetBlockFormat(internal_format);
+  const uint64_t level_width = std::max(1, width >> level);
+  const uint64_t level_height = std::max(1, height >> level);
+  return ((level_width + block.width - 1) / block.width) * ((level_height + block.height - 1) / block.height) *
+         block.bytes;
+}
+
+uint64_t GetTextureSize(GLenum internal_format, int32_t width, int32_t height, int32_t level_count) {
+  uint64_t size = 0;
+  for (int32_t level = 0; level < level_count; ++level) {
+    size += GetTextureLevelSize(internal_format, width, height, level);
+  }
+  return size;
+}
+
+int32_t GetMipLevelCount(int32_t width, int32_t height) {
+  int32_t level_count = 1;
+  for (int32_t size = std::max(width, height); size > 1; size /= 2) {
+    ++level_count;
+  }
+  return level_count;
+}
+
+void GenerateMipmaps(TextureImage &image) {
+  const bool srgb = image.internal_format == GL_SRGB8_ALPHA8;
+  image.levels.resize(1);
+  const int32_t level_count = GetMipLevelCount(image.width, image.height);
+  for (int32_t level = 1; level < level_count; ++level) {
+    image.levels.push_back(Downsample(image.levels.back(), std::max(1, image.width >> (level - 1)),
+                                      std::max(1, image.height >> (level - 1)), srgb));
+  }
+}
+
+bool LoadKtx(const void *data, size_t size, TextureImage &image) {
+  static const uint8_t kIdentifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+  enum {
+    kEndianness,
+    kGlType,
+    kGlTypeSize,
+    kGlFormat,
+    kGlInternalFormat,
+    kGlBaseInternalFormat,
+    kPixelWidth,
+    kPixelHeight,
+    kPixelDepth,
+    kNumberOfArrayElements,
+    kNumberOfFaces,
+    kNumberOfMipmapLevels,
+    kBytesOfKeyValueData,
+    kHeaderFieldCount
+  };
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  uint32_t header[kHeaderFieldCount];
+  if (size < sizeof(kIdentifier) + sizeof(header) || memcmp(bytes, kIdentifier, sizeof(kIdentifier))) {
+    ML_LOG(Error, "Not a KTX 1.1 file");
+    return false;
+  }
+  memcpy(header, bytes + sizeof(kIdentifier), sizeof(header));
+  const bool swap = header[kEndianness] == 0x01020304;
+  if (swap) {
+    for (uint32_t &field : header) {
+      field = ByteSwap(field);
+    }
+  }
+
+  const GLenum internal_format = header[kGlInternalFormat];
+  const bool rgba8 = header[kGlType] == GL_UNSIGNED_BYTE && header[kGlFormat] == GL_RGBA &&
+                     (internal_format == GL_RGBA8 || internal_format == GL_SRGB8_ALPHA8);
+  if (!(header[kGlType] == 0 && IsCompressedFormat(internal_format)) && !rgba8) {
+    ML_LOG(Error, "Unsupported KTX format 0x%x", internal_format);
+    return false;
+  }
+  if (header[kPixelHeight] == 0 || header[kPixelDepth] > 1 || header[kNumberOfArrayElements] > 0 ||
+      header[kNumberOfFaces] != 1) {
+    ML_LOG(Error, "Only 2D KTX textures are supported");
+    return false;
+  }
+
+  image.internal_format = internal_format;
+  image.width = static_cast<int32_t>(header[kPixelWidth]);
+  image.height = static_cast<int32_t>(header[kPixelHeight]);
+  image.levels.clear();
+  const int32_t level_count = std::max<int32_t>(1, header[kNumberOfMipmapLevels]);
+  size_t offset = sizeof(kIdentifier) + sizeof(header) + header[kBytesOfKeyValueData];
+  for (int32_t level = 0; level < level_count; ++level) {
+    uint32_t image_size = 0;
+    if (offset + sizeof(image_size) > size) {
+      ML_LOG(Error, "Truncated KTX file");
+      return false;
+    }
+    memcpy(&image_size, bytes + offset, sizeof(image_size));
+    image_size = swap ? ByteSwap(image_size) : image_size;
+    offset += sizeof(image_size);
+    if (image_size != GetTextureLevelSize(internal_format, image.width, image.height, level) ||
+        offset + image_size > size) {
+      ML_LOG(Error, "Level %d of the KTX file has an unexpected size", level);
+      return false;
+    }
+    image.levels.emplace_back(bytes + offset, bytes + offset + image_size);
+    // Levels are padded to 4 bytes
+    offset += (image_size + 3) & ~3u;
+  }
+  return true;
+}
+
+bool TranscodeToRgba8(TextureImage &image) {
+  bool alpha = false;
+  bool srgb = false;
+  switch (image.internal_format) {
+    case GL_COMPRESSED_RGB8_ETC2: break;
+    case GL_COMPRESSED_SRGB8_ETC2: srgb = true; break;
+    case GL_COMPRESSED_RGBA8_ETC2_EAC: alpha = true; break;
+    case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+      alpha = true;
+      srgb = true;
+      break;
+    default: return false;
+  }
+
+  const uint32_t block_bytes = alpha ? 16 : 8;
+  for (size_t level = 0; level < image.levels.size(); ++level) {
+    const int32_t width = std::max(1, image.width >> level);
+    const int32_t height = std::max(1, image.height >> level);
+    const int32_t blocks_x = (width + 3) / 4;
+    const int32_t blocks_y = (height + 3) / 4;
+    const uint8_t *block = reinterpret_cast<const uint8_t *>(image.levels[level].data());
+    std::vector<char> rgba(4 * static_cast<size_t>(width) * height);
+    uint8_t texels[4 * 16];
+    for (int32_t block_y = 0; block_y < blocks_y; ++block_y) {
+      for (int32_t block_x = 0; block_x < blocks_x; ++block_x, block += block_bytes) {
+        memset(texels, 255, sizeof(texels));
+        if (alpha) {
+          DecodeEacAlpha(block, texels);
+        }
+        DecodeEtc2Rgb(alpha ? block + 8 : block, texels);
+        for (int32_t y = 0; y < 4 && 4 * block_y + y < height; ++y) {
+          const int32_t row_width = std::min(4, width - 4 * block_x);
+          memcpy(&rgba[4 * ((4 * block_y + y) * static_cast<size_t>(width) + 4 * block_x)], texels + 16 * y,
+                 4 * row_width);
+        }
+      }
+    }
+    image.levels[level] = std::move(rgba);
+  }
+  image.internal_format = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  return true;
+}
+
+}  // namespace app_framework
+}  // namespace ml
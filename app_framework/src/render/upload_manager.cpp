@@ -0,0 +1,282 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "upload_manager.h"
+
+#include <app_framework/registry.h>
+#include <ml_logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+// Offset alignment of the copies in the ring
+constexpr uint64_t kAlignment = 64;
+
+inline uint64_t Align(uint64_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+// Textures created without a format take RGBA8 images
+GLenum GetCopyFormat(const Texture &texture) {
+  return texture.GetInternalFormat() != GL_NONE ? texture.GetInternalFormat() : GL_RGBA8;
+}
+
+bool IsValidTextureCopy(const UploadManager::TextureCopy &copy) {
+  if (!copy.texture || copy.level >= copy.texture->GetLevelCount() ||
+      copy.data.size() != GetTextureLevelSize(GetCopyFormat(*copy.texture), copy.texture->GetWidth(),
+                                              copy.texture->GetHeight(), copy.level)) {
+    ML_LOG(Error, "Texture upload doesn't match the size of the texture");
+    return false;
+  }
+  return true;
+}
+
+void CopyToTexture(const UploadManager::TextureCopy &copy, const void *pixels) {
+  const Texture &texture = *copy.texture;
+  const GLenum format = GetCopyFormat(texture);
+  const GLsizei size = static_cast<GLsizei>(copy.data.size());
+  const int32_t width = std::max(1, texture.GetWidth() >> copy.level);
+  const int32_t height = std::max(1, texture.GetHeight() >> copy.level);
+  glBindTexture(texture.GetTextureType(), texture.GetGLTexture());
+  if (texture.GetTextureType() == GL_TEXTURE_2D_ARRAY) {
+    if (IsCompressedFormat(format)) {
+      glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, copy.level, 0, 0, texture.GetLayer(), width, height, 1, format,
+                                size, pixels);
+    } else {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, copy.level, 0, 0, texture.GetLayer(), width, height, 1, GL_RGBA,
+                      GL_UNSIGNED_BYTE, pixels);
+    }
+  } else if (IsCompressedFormat(format)) {
+    glCompressedTexSubImage2D(texture.GetTextureType(), copy.level, 0, 0, width, height, format, size, pixels);
+  } else {
+    glTexSubImage2D(texture.GetTextureType(), copy.level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  }
+  glBindTexture(texture.GetTextureType(), 0);
+}
+
+}  // namespace
+
+UploadManager::~UploadManager() {
+  for (auto &region : regions_) {
+    glDeleteSync(region.fence);
+  }
+  Registry::GetInstance()->GetGLDeletionQueue().Enqueue(GLDeletionQueue::ObjectType::kBuffer, ring_);
+  Registry::GetInstance()->GetGpuMemoryTracker().Release(this);
+}
+
+void UploadManager::Submit(std::vector<BufferCopy> buffer_copies, std::vector<TextureCopy> texture_copies,
+                           std::function<void()> on_uploaded) {
+  Submission submission;
+  for (const auto &copy : buffer_copies) {
+    submission.size += Align(copy.data.size());
+  }
+  for (const auto &copy : texture_copies) {
+    submission.size += Align(copy.data.size());
+  }
+  submission.buffer_copies = std::move(buffer_copies);
+  submission.texture_copies = std::move(texture_copies);
+  submission.on_uploaded = std::move(on_uploaded);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_bytes_ += submission.size;
+  submissions_.push_back(std::move(submission));
+}
+
+void UploadManager::UploadBuffer(std::shared_ptr<Buffer> buffer, std::vector<char> data) {
+  std::vector<BufferCopy> copies(1);
+  copies[0].buffer = std::move(buffer);
+  copies[0].data = std::move(data);
+  Submit(std::move(copies), {});
+}
+
+void UploadManager::UploadTexture(std::shared_ptr<Texture> texture, std::vector<char> data, int32_t level) {
+  std::vector<TextureCopy> copies(1);
+  copies[0].texture = std::move(texture);
+  copies[0].data = std::move(data);
+  copies[0].level = level;
+  Submit({}, std::move(copies));
+}
+
+void UploadManager::UploadTexture(std::shared_ptr<Texture> texture, TextureImage image) {
+  std::vector<TextureCopy> copies(image.levels.size());
+  for (size_t level = 0; level < copies.size(); ++level) {
+    copies[level].texture = texture;
+    copies[level].data = std::move(image.levels[level]);
+    copies[level].level = static_cast<int32_t>(level);
+  }
+  Submit({}, std::move(copies));
+}
+
+uint64_t UploadManager::GetPendingBytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_bytes_;
+}
+
+void UploadManager::Process() {
+  const auto start = std::chrono::steady_clock::now();
+  if (!ring_) {
+    glGenBuffers(1, &ring_);
+    glBindBuffer(GL_COPY_READ_BUFFER, ring_);
+    glBufferData(GL_COPY_READ_BUFFER, kRingSize, nullptr, GL_STREAM_DRAW);
+    GpuMemoryTracker &tracker = Registry::GetInstance()->GetGpuMemoryTracker();
+    tracker.SetLabel(this, "upload ring");
+    tracker.Update(this, GpuMemoryTracker::Category::kStaging, kRingSize);
+  }
+  Retire();
+
+  uint64_t frame_bytes = 0;
+  for (;;) {
+    Submission submission;
+    uint64_t offset = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (submissions_.empty()) {
+        break;
+      }
+      const uint64_t size = submissions_.front().size;
+      if (frame_bytes > 0 && frame_bytes + size > frame_budget_) {
+        ++budget_deferred_frames_;
+        break;
+      }
+      if (size <= kRingSize) {
+        offset = Allocate(size);
+        if (offset == kRingSize) {
+          ++ring_stall_frames_;
+          break;
+        }
+      }
+      submission = std::move(submissions_.front());
+      submissions_.pop_front();
+      pending_bytes_ -= size;
+    }
+
+    frame_bytes += submission.size;
+    if (submission.size > kRingSize) {
+      UploadDirect(submission);
+    } else {
+      Upload(submission, offset);
+    }
+    if (submission.on_uploaded) {
+      submission.on_uploaded();
+    }
+  }
+
+  if (frame_used_ > 0) {
+    Region region;
+    region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region.size = frame_used_;
+    regions_.push_back(region);
+    frame_used_ = 0;
+  }
+
+  last_frame_bytes_ = frame_bytes;
+  last_frame_ms_ = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void UploadManager::Retire() {
+  while (!regions_.empty()) {
+    const GLenum result = glClientWaitSync(regions_.front().fence, 0, 0);
+    if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+      break;
+    }
+    glDeleteSync(regions_.front().fence);
+    used_ -= regions_.front().size;
+    regions_.pop_front();
+  }
+}
+
+uint64_t UploadManager::Allocate(uint64_t size) {
+  if (head_ + size > kRingSize) {
+    // Skip the end of the ring, the submission has to be contiguous
+    const uint64_t padding = kRingSize - head_;
+    if (used_ + padding + size > kRingSize) {
+      return kRingSize;
+    }
+    used_ += padding;
+    frame_used_ += padding;
+    head_ = 0;
+  } else if (used_ + size > kRingSize) {
+    return kRingSize;
+  }
+  const uint64_t offset = head_;
+  head_ += size;
+  used_ += size;
+  frame_used_ += size;
+  return offset;
+}
+
+void UploadManager::Upload(Submission &submission, uint64_t offset) {
+  glBindBuffer(GL_COPY_READ_BUFFER, ring_);
+  if (submission.size > 0) {
+    // The fences guarantee the GPU isn't reading this region anymore
+    char *staging = static_cast<char *>(
+        glMapBufferRange(GL_COPY_READ_BUFFER, offset, submission.size,
+                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    ML_LOG_IF(Fatal, !staging, "Unable to map the upload ring");
+    uint64_t write_offset = 0;
+    for (const auto &copy : submission.buffer_copies) {
+      memcpy(staging + write_offset, copy.data.data(), copy.data.size());
+      write_offset += Align(copy.data.size());
+    }
+    for (const auto &copy : submission.texture_copies) {
+      memcpy(staging + write_offset, copy.data.data(), copy.data.size());
+      write_offset += Align(copy.data.size());
+    }
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+  }
+
+  for (const auto &copy : submission.buffer_copies) {
+    const uint64_t size = copy.data.size();
+    copy.buffer->Reserve(size);
+    if (size > 0) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, copy.buffer->GetGLBuffer());
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, size);
+    }
+    copy.buffer->SetSize(size);
+    offset += Align(size);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring_);
+  for (const auto &copy : submission.texture_copies) {
+    if (IsValidTextureCopy(copy)) {
+      CopyToTexture(copy, reinterpret_cast<const void *>(static_cast<uintptr_t>(offset)));
+    }
+    offset += Align(copy.data.size());
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadManager::UploadDirect(Submission &submission) {
+  ++direct_uploads_;
+  for (const auto &copy : submission.buffer_copies) {
+    const uint64_t size = copy.data.size();
+    copy.buffer->Reserve(size);
+    if (size > 0) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, copy.buffer->GetGLBuffer());
+      glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, copy.data.data());
+    }
+    copy.buffer->SetSize(size);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  for (const auto &copy : submission.texture_copies) {
+    if (IsValidTextureCopy(copy)) {
+      CopyToTexture(copy, copy.data.data());
+    }
+  }
+}
+
+}  // namespace app_framework
+}  // namespace ml
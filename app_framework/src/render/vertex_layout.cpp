@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "vertex_layout.h"
+
+#include <app_framework/render/program.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ml {
+namespace app_framework {
+
+namespace {
+
+inline uint16_t ToUnorm16(float value) {
+  return static_cast<uint16_t>(std::round(std::min(std::max(value, 0.f), 1.f) * 65535.f));
+}
+
+inline int16_t ToSnorm16(float value) {
+  return static_cast<int16_t>(std::round(std::min(std::max(value, -1.f), 1.f) * 32767.f));
+}
+
+// Rounds to the nearest half float, values out of its range become infinity or zero
+uint16_t ToHalf(float value) {
+  uint32_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+  uint32_t mantissa = bits & 0x7fffff;
+  if (exponent >= 31) {
+    return static_cast<uint16_t>(sign | 0x7c00);
+  }
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return static_cast<uint16_t>(sign);
+    }
+    // Denormal
+    mantissa |= 0x800000;
+    return static_cast<uint16_t>(sign | (mantissa >> (14 - exponent)));
+  }
+  uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+  // A carry out of the mantissa correctly rounds up to the next exponent
+  if (mantissa & 0x1000) {
+    ++half;
+  }
+  return static_cast<uint16_t>(half);
+}
+
+// Projects the normal on the octahedron |x| + |y| + |z| = 1 and unfolds the lower half over the corners of the
+// upper one, see DecodeOctahedral in the vertex shaders
+void EncodeOctahedral(const glm::vec3 &normal, int16_t *out) {
+  const float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  float x = l1 > 0.f ? normal.x / l1 : 0.f;
+  float y = l1 > 0.f ? normal.y / l1 : 0.f;
+  if (normal.z < 0.f) {
+    const float folded_x = (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f);
+    const float folded_y = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+    x = folded_x;
+    y = folded_y;
+  }
+  out[0] = ToSnorm16(x);
+  out[1] = ToSnorm16(y);
+}
+
+}  // namespace
+
+VertexLayout::VertexLayout(PositionFormat position_format, NormalFormat normal_format,
+                           TexCoordFormat tex_coord_format)
+    : position_format_(position_format),
+      normal_format_(normal_format),
+      tex_coord_format_(tex_coord_format),
+      normal_offset_(0),
+      tex_coord_offset_(0),
+      stride_(0) {
+  // Attributes are 4 byte aligned, three 16 bit components take 8 bytes
+  switch (position_format_) {
+    case PositionFormat::kFloat3:
+      attributes_.push_back(VertexAttribute{attribute_locations::kPosition, GL_FLOAT, 3, GL_FALSE, stride_});
+      stride_ += 3 * sizeof(float);
+      break;
+    case PositionFormat::kUnorm16:
+      attributes_.push_back(VertexAttribute{attribute_locations::kPosition, GL_UNSIGNED_SHORT, 3, GL_TRUE, stride_});
+      stride_ += 4 * sizeof(uint16_t);
+      break;
+  }
+
+  normal_offset_ = stride_;
+  switch (normal_format_) {
+    case NormalFormat::kNone: break;
+    case NormalFormat::kFloat3:
+      attributes_.push_back(VertexAttribute{attribute_locations::kNormal, GL_FLOAT, 3, GL_FALSE, stride_});
+      stride_ += 3 * sizeof(float);
+      break;
+    case NormalFormat::kSnorm16:
+      attributes_.push_back(VertexAttribute{attribute_locations::kNormal, GL_SHORT, 3, GL_TRUE, stride_});
+      stride_ += 4 * sizeof(int16_t);
+      break;
+    case NormalFormat::kOctahedral16:
+      attributes_.push_back(VertexAttribute{attribute_locations::kNormal, GL_SHORT, 2, GL_TRUE, stride_});
+      stride_ += 2 * sizeof(int16_t);
+      break;
+  }
+
+  tex_coord_offset_ = stride_;
+  switch (tex_coord_format_) {
+    case TexCoordFormat::kNone: break;
+    case TexCoordFormat::kFloat2:
+      attributes_.push_back(
+          VertexAttribute{attribute_locations::kTextureCoordinates, GL_FLOAT, 2, GL_FALSE, stride_});
+      stride_ += 2 * sizeof(float);
+      break;
+    case TexCoordFormat::kHalf2:
+      attributes_.push_back(
+          VertexAttribute{attribute_locations::kTextureCoordinates, GL_HALF_FLOAT, 2, GL_FALSE, stride_});
+      stride_ += 2 * sizeof(uint16_t);
+      break;
+  }
+}
+
+void VertexLayout::Pack(const glm::vec3 *positions, const glm::vec3 *normals, const glm::vec2 *tex_coords,
+                        size_t count, const glm::vec4 &dequantization, char *out) const {
+  const float inverse_scale = dequantization.w > 0.f ? 1.f / dequantization.w : 0.f;
+  for (size_t i = 0; i < count; ++i, out += stride_) {
+    if (positions) {
+      const glm::vec3 &position = positions[i];
+      if (position_format_ == PositionFormat::kFloat3) {
+        memcpy(out, &position, 3 * sizeof(float));
+      } else {
+        uint16_t quantized[4] = {ToUnorm16((position.x - dequantization.x) * inverse_scale),
+                                 ToUnorm16((position.y - dequantization.y) * inverse_scale),
+                                 ToUnorm16((position.z - dequantization.z) * inverse_scale), 0};
+        memcpy(out, quantized, sizeof(quantized));
+      }
+    }
+
+    if (normals) {
+      const glm::vec3 &normal = normals[i];
+      char *normal_out = out + normal_offset_;
+      if (normal_format_ == NormalFormat::kFloat3) {
+        memcpy(normal_out, &normal, 3 * sizeof(float));
+      } else if (normal_format_ == NormalFormat::kSnorm16) {
+        int16_t quantized[4] = {ToSnorm16(normal.x), ToSnorm16(normal.y), ToSnorm16(normal.z), 0};
+        memcpy(normal_out, quantized, sizeof(quantized));
+      } else if (normal_format_ == NormalFormat::kOctahedral16) {
+        int16_t quantized[2];
+        EncodeOctahedral(normal, quantized);
+        memcpy(normal_out, quantized, sizeof(quantized));
+      }
+    }
+
+    if (tex_coords) {
+      const glm::vec2 &tex_coord = tex_coords[i];
+      char *tex_coord_out = out + tex_coord_offset_;
+      if (tex_coord_format_ == TexCoordFormat::kFloat2) {
+        memcpy(tex_coord_out, &tex_coord, 2 * sizeof(float));
+      } else if (tex_coord_format_ == TexCoordFormat::kHalf2) {
+        uint16_t quantized[2] = {ToHalf(tex_coord.x), ToHalf(tex_coord.y)};
+        memcpy(tex_coord_out, quantized, sizeof(quantized));
+      }
+    }
+  }
+}
+
+glm::vec4 VertexLayout::GetPositionDequantization(const glm::vec3 *positions, size_t count) {
+  if (!positions || count == 0) {
+    return glm::vec4(0.f, 0.f, 0.f, 1.f);
+  }
+  glm::vec3 min_position = positions[0];
+  glm::vec3 max_position = positions[0];
+  for (size_t i = 1; i < count; ++i) {
+    for (int32_t axis = 0; axis < 3; ++axis) {
+      min_position[axis] = std::min(min_position[axis], positions[i][axis]);
+      max_position[axis] = std::max(max_position[axis], positions[i][axis]);
+    }
+  }
+  float extent = 0.f;
+  for (int32_t axis = 0; axis < 3; ++axis) {
+    extent = std::max(extent, max_position[axis] - min_position[axis]);
+  }
+  // All vertices at one point still need an invertible transform
+  return glm::vec4(min_position, extent > 0.f ? extent : 1.f);
+}
+
+void VertexLayout::EnableAttributes(bool positions, bool normals, bool tex_coords) const {
+  for (const auto &attribute : attributes_) {
+    bool enabled = false;
+    switch (attribute.location) {
+      case attribute_locations::kPosition: enabled = positions; break;
+      case attribute_locations::kNormal: enabled = normals; break;
+      case attribute_locations::kTextureCoordinates: enabled = tex_coords; break;
+    }
+    if (enabled) {
+      glEnableVertexAttribArray(attribute.location);
+    } else {
+      glDisableVertexAttribArray(attribute.location);
+    }
+  }
+}
+
+}  // namespace app_framework
+}  // namespace ml
@@ -8,10 +8,12 @@
 // %BANNER_END%
 #include <app_framework/node.h>
 #include <app_framework/preset_resource.h>
+#include <app_framework/registry.h>
 #include <app_framework/resource_pool.h>
 #include <app_framework/components/renderable_component.h>
 #include <app_framework/material/pbr_material.h>
 #include <app_framework/material/textured_material.h>
+#include <app_framework/render/material_template.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
@@ -20,9 +22,96 @@
 
 #include <stb_image.h>
 
+#include <cctype>
+#include <cinttypes>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
 namespace ml {
 namespace app_framework {
 
+namespace {
+
+// The layers of a texture array are allocated up front, it can't grow without a copy
+const int32_t kMaxTextureArrayLayers = 16;
+
+// Filtering of the textures loaded from files, trilinear between the mip levels
+SamplerDescription GetAssetSamplerDescription() {
+  SamplerDescription description;
+  description.min_filter = GL_LINEAR_MIPMAP_LINEAR;
+  description.mag_filter = GL_NEAREST;
+  return description;
+}
+
+bool HasExtension(const std::string &path, const char *extension) {
+  const size_t length = strlen(extension);
+  if (path.size() < length) {
+    return false;
+  }
+  for (size_t i = 0; i < length; ++i) {
+    if (tolower(path[path.size() - length + i]) != extension[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads a KTX container, or decodes any other image with stb_image to RGBA8 in gl_internal_format
+bool LoadImageFile(const std::string &path, GLint gl_internal_format, TextureImage &image) {
+  if (HasExtension(path, ".ktx")) {
+    std::ifstream file_stream(path, std::ios::binary);
+    const std::vector<char> data((std::istreambuf_iterator<char>(file_stream)), std::istreambuf_iterator<char>());
+    return !data.empty() && LoadKtx(data.data(), data.size(), image);
+  }
+
+  int32_t channels = 0;
+  unsigned char *buffer = stbi_load(path.c_str(), &image.width, &image.height, &channels, STBI_rgb_alpha);
+  if (buffer == nullptr) {
+    return false;
+  }
+  ML_LOG(Debug, "Number of channels for image %s is %d", path.c_str(), channels);
+  image.internal_format = gl_internal_format;
+  image.levels.assign(1, std::vector<char>((const char *)buffer,
+                                           (const char *)buffer + 4 * static_cast<size_t>(image.width) * image.height));
+  stbi_image_free(buffer);
+  return true;
+}
+
+template <typename Index>
+void UpdateIndices(Mesh &mesh, const std::vector<uint32_t> &indices) {
+  std::vector<Index> narrow_indices(indices.begin(), indices.end());
+  mesh.UpdateIndices(narrow_indices.data(), narrow_indices.size());
+}
+
+std::shared_ptr<Mesh> CreateStaticMesh(const VertexLayout &vertex_layout, const glm::vec3 *vertices,
+                                       const glm::vec3 *normals, const glm::vec2 *tex_coords, size_t num_vertices,
+                                       const std::vector<uint32_t> &indices, bool use_geometry_arena) {
+  // Less index bandwidth for the meshes that can be indexed with 8 or 16 bits
+  const GLenum index_type = GetSmallestIndexType(num_vertices);
+  std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(Buffer::Category::Static, index_type, vertex_layout);
+  if (use_geometry_arena && !indices.empty() &&
+      mesh->UpdateMeshInArena(vertices, normals, tex_coords, num_vertices, indices.data(), indices.size())) {
+    return mesh;
+  }
+  mesh->UpdateVertices(vertices, normals, tex_coords, num_vertices);
+  switch (index_type) {
+    case GL_UNSIGNED_BYTE: UpdateIndices<uint8_t>(*mesh, indices); break;
+    case GL_UNSIGNED_SHORT: UpdateIndices<uint16_t>(*mesh, indices); break;
+    default: mesh->UpdateIndices(indices.data(), indices.size()); break;
+  }
+  return mesh;
+}
+
+void CountTriangles(std::vector<size_t> &triangle_counts, size_t level, size_t index_count) {
+  if (triangle_counts.size() <= level) {
+    triangle_counts.resize(level + 1, 0);
+  }
+  triangle_counts[level] += index_count / 3;
+}
+
+}  // namespace
+
 void ResourcePool::InitializePresetResources() {
   PresetResource preset_resource;
   for (const auto &mesh : preset_resource.meshes) {
@@ -31,7 +120,7 @@ void ResourcePool::InitializePresetResources() {
 }
 
 std::shared_ptr<Node> ResourcePool::LoadNodeHierarchy(const std::string &path, const aiScene *ai_scene,
-                                                      const aiNode *ai_node) {
+                                                      const aiNode *ai_node, MeshOptimizationStatistics &statistics) {
   ML_LOG(Info, "Loading node %s", ai_node->mName.C_Str());
   auto node = std::make_shared<Node>();
   aiVector3D position{};
@@ -43,8 +132,9 @@ std::shared_ptr<Node> ResourcePool::LoadNodeHierarchy(const std::string &path, c
   node->SetLocalScale(glm::vec3{scaling.x, scaling.y, scaling.z});
 
   for (size_t mesh_index = 0; mesh_index < ai_node->mNumMeshes; ++mesh_index) {
-    auto model = LoadModel(path, ai_scene, ai_node->mMeshes[mesh_index]);
+    auto model = LoadModel(path, ai_scene, ai_node->mMeshes[mesh_index], statistics);
     auto renderable_pbr = std::make_shared<RenderableComponent>(model.mesh, model.material);
+    renderable_pbr->SetLods(model.lods);
 
     auto model_node = std::make_shared<Node>();
     model_node->AddComponent(renderable_pbr);
@@ -52,7 +142,7 @@ std::shared_ptr<Node> ResourcePool::LoadNodeHierarchy(const std::string &path, c
   }
 
   for (size_t child_index = 0; child_index < ai_node->mNumChildren; ++child_index) {
-    node->AddChild(LoadNodeHierarchy(path, ai_scene, ai_node->mChildren[child_index]));
+    node->AddChild(LoadNodeHierarchy(path, ai_scene, ai_node->mChildren[child_index], statistics));
   }
 
   return node;
@@ -60,22 +150,42 @@ std::shared_ptr<Node> ResourcePool::LoadNodeHierarchy(const std::string &path, c
 
 std::shared_ptr<Node> ResourcePool::LoadAsset(const std::string &path) {
   Assimp::Importer importer;
-  const aiScene *ai_scene = importer.ReadFile(path.c_str(), aiProcess_Triangulate | aiProcess_GenSmoothNormals |
-                                                                aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
+  unsigned int flags =
+      aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices;
+  if (optimize_models_) {
+    // One draw per material and node instead of one per submesh
+    flags |= aiProcess_OptimizeMeshes;
+  }
+  const aiScene *ai_scene = importer.ReadFile(path.c_str(), flags);
   if (ai_scene == nullptr || ai_scene->mNumMeshes <= 0) {
     ML_LOG(Error, "Unable to load model for file %s, %s", path.c_str(), importer.GetErrorString());
     return nullptr;
   }
 
-  return LoadNodeHierarchy(path, ai_scene, ai_scene->mRootNode);
+  MeshOptimizationStatistics statistics;
+  auto node = LoadNodeHierarchy(path, ai_scene, ai_scene->mRootNode, statistics);
+  if (optimize_models_ && statistics.mesh_count) {
+    ML_LOG(Info, "Optimized %zu meshes of %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", statistics.mesh_count,
+           path.c_str(), statistics.original.GetACMR(), statistics.optimized.GetACMR(),
+           statistics.original.GetATVR(), statistics.optimized.GetATVR());
+  }
+  if (statistics.lod_triangle_counts.size() > 1) {
+    std::string triangle_counts;
+    for (size_t level = 1; level < statistics.lod_triangle_counts.size(); ++level) {
+      triangle_counts += (level > 1 ? ", " : "") + std::to_string(statistics.lod_triangle_counts[level]);
+    }
+    ML_LOG(Info, "Levels of detail of %s: %zu triangles -> %s", path.c_str(), statistics.lod_triangle_counts[0],
+           triangle_counts.c_str());
+  }
+  return node;
 }
 
-Model ResourcePool::LoadModel(const std::string &path, const aiScene *ai_scene, size_t mesh_index) {
+Model ResourcePool::LoadModel(const std::string &path, const aiScene *ai_scene, size_t mesh_index,
+                              MeshOptimizationStatistics &statistics) {
   const aiMesh *ai_mesh = ai_scene->mMeshes[mesh_index];
   ML_LOG(Info, "Loading mesh %s", ai_mesh->mName.C_Str());
 
   Model model;
-  std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(Buffer::Category::Static, GL_UNSIGNED_INT);
   std::shared_ptr<PBRMaterial> mat = std::make_shared<PBRMaterial>();
 
   const glm::vec3 *vertices = nullptr;
@@ -111,20 +221,73 @@ Model ResourcePool::LoadModel(const std::string &path, const aiScene *ai_scene,
     }
   }
 
-  ML_LOG(Debug, "Inited model vert:%d indices:%u", ai_mesh->mNumVertices, (uint32_t)indices.size());
-  mesh->UpdateMesh(vertices, normals, ai_mesh->mNumVertices, indices.data(), indices.size());
+  std::vector<glm::vec2> tex_coords;
   if (ai_mesh->HasTextureCoords(0)) {
-    std::vector<glm::vec2> tex_coords(ai_mesh->mNumVertices);
+    tex_coords.resize(ai_mesh->mNumVertices);
     for (uint32_t i = 0; i < ai_mesh->mNumVertices; ++i) {
       tex_coords[i].x = ai_mesh->mTextureCoords[0][i].x;
       tex_coords[i].y = ai_mesh->mTextureCoords[0][i].y;
     }
-    mesh->UpdateTexCoordsBuffer((glm::vec2 const *)tex_coords.data());
   }
 
+  std::vector<glm::vec3> optimized_vertices;
+  std::vector<glm::vec3> optimized_normals;
+  if (optimize_models_ && !indices.empty()) {
+    statistics.original += AnalyzeVertexCache(indices, num_vertices);
+    OptimizeVertexCache(indices, num_vertices);
+    OptimizeOverdraw(indices, vertices, num_vertices);
+    std::vector<uint32_t> remap;
+    const size_t fetched_vertices = OptimizeVertexFetch(indices, num_vertices, remap);
+    optimized_vertices = RemapVertices(vertices, num_vertices, remap, fetched_vertices);
+    vertices = optimized_vertices.data();
+    if (normals) {
+      optimized_normals = RemapVertices(normals, num_vertices, remap, fetched_vertices);
+      normals = optimized_normals.data();
+    }
+    if (!tex_coords.empty()) {
+      tex_coords = RemapVertices(tex_coords.data(), num_vertices, remap, fetched_vertices);
+    }
+    num_vertices = fetched_vertices;
+    statistics.optimized += AnalyzeVertexCache(indices, num_vertices);
+    ++statistics.mesh_count;
+  }
+
+  ML_LOG(Debug, "Inited model vert:%zu indices:%u", num_vertices, (uint32_t)indices.size());
+  std::shared_ptr<Mesh> mesh = CreateStaticMesh(model_vertex_layout_, vertices, normals,
+                                                tex_coords.empty() ? nullptr : tex_coords.data(), num_vertices,
+                                                indices, use_geometry_arena_);
+  mesh->SetMemoryLabel(path);
+
   mesh_cache_.insert(std::make_pair(path, mesh));
   model.mesh = mesh;
 
+  // Every level halves the triangles of the full mesh again, until the simplification stops paying off
+  if (!indices.empty()) {
+    CountTriangles(statistics.lod_triangle_counts, 0, indices.size());
+  }
+  float ratio = 1.f;
+  for (size_t level = 1; level <= model_lod_count_ && !indices.empty(); ++level) {
+    ratio *= 0.5f;
+    MeshLod lod;
+    if (!GenerateLod(indices, vertices, num_vertices, ratio, lod)) {
+      break;
+    }
+    const auto lod_vertices = RemapVertices(vertices, num_vertices, lod.remap, lod.vertex_count);
+    const auto lod_normals = normals ? RemapVertices(normals, num_vertices, lod.remap, lod.vertex_count)
+                                     : std::vector<glm::vec3>();
+    const auto lod_tex_coords = !tex_coords.empty()
+                                    ? RemapVertices(tex_coords.data(), num_vertices, lod.remap, lod.vertex_count)
+                                    : std::vector<glm::vec2>();
+    std::shared_ptr<Mesh> lod_mesh = CreateStaticMesh(model_vertex_layout_, lod_vertices.data(),
+                                                      normals ? lod_normals.data() : nullptr,
+                                                      tex_coords.empty() ? nullptr : lod_tex_coords.data(),
+                                                      lod.vertex_count, lod.indices, use_geometry_arena_);
+    lod_mesh->SetSimplificationError(lod.error);
+    lod_mesh->SetMemoryLabel(path);
+    model.lods.push_back(lod_mesh);
+    CountTriangles(statistics.lod_triangle_counts, level, lod.indices.size());
+  }
+
   // Load material
   const aiMaterial *ai_mat = ai_scene->mMaterials[ai_mesh->mMaterialIndex];
 
@@ -172,14 +335,14 @@ Model ResourcePool::LoadModel(const std::string &path, const aiScene *ai_scene,
       switch (i) {
         case aiTextureType_DIFFUSE:
           tex = embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_SRGB8_ALPHA8)
-                                 : LoadTexture(texture_full_name, GL_SRGB8_ALPHA8);
+                                 : LoadTextureLayer(texture_full_name, GL_SRGB8_ALPHA8);
           mat->SetAlbedo(tex);
           mat->SetHasAlbedo(true);
           ML_LOG(Debug, "Setting albedo...");
           break;
         case aiTextureType_SPECULAR:
           tex =
-              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTexture(texture_full_name, GL_RGBA8);
+              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTextureLayer(texture_full_name, GL_RGBA8);
           mat->SetMetallicChannel(0);
           mat->SetMetallic(tex);
           mat->SetHasMetallic(true);
@@ -188,14 +351,14 @@ Model ResourcePool::LoadModel(const std::string &path, const aiScene *ai_scene,
         case aiTextureType_LIGHTMAP:
         case aiTextureType_AMBIENT:
           tex =
-              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTexture(texture_full_name, GL_RGBA8);
+              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTextureLayer(texture_full_name, GL_RGBA8);
           mat->SetAmbientOcclusion(tex);
           mat->SetHasAmbientOcclusion(true);
           ML_LOG(Debug, "Setting ao...");
           break;
         case aiTextureType_EMISSIVE:
           tex = embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_SRGB8_ALPHA8)
-                                 : LoadTexture(texture_full_name, GL_SRGB8_ALPHA8);
+                                 : LoadTextureLayer(texture_full_name, GL_SRGB8_ALPHA8);
           mat->SetEmissive(tex);
           mat->SetHasEmissive(true);
           ML_LOG(Debug, "Setting emissive...");
@@ -203,14 +366,14 @@ Model ResourcePool::LoadModel(const std::string &path, const aiScene *ai_scene,
         case aiTextureType_NORMALS:
         case aiTextureType_HEIGHT:
           tex =
-              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTexture(texture_full_name, GL_RGBA8);
+              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTextureLayer(texture_full_name, GL_RGBA8);
           mat->SetNormals(tex);
           mat->SetHasNormalMap(true);
           ML_LOG(Debug, "Setting normal map...");
           break;
         case aiTextureType_SHININESS:
           tex =
-              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTexture(texture_full_name, GL_RGBA8);
+              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTextureLayer(texture_full_name, GL_RGBA8);
           mat->SetRoughnessChannel(0);
           mat->SetRoughness(tex);
           mat->SetHasRoughness(true);
@@ -218,7 +381,7 @@ Model ResourcePool::LoadModel(const std::string &path, const aiScene *ai_scene,
           break;
         case aiTextureType_UNKNOWN:
           tex =
-              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTexture(texture_full_name, GL_RGBA8);
+              embedded_texture ? LoadAssimpEmbeddedTexture(ai_tex, GL_RGBA8) : LoadTextureLayer(texture_full_name, GL_RGBA8);
           mat->SetMetallicChannel(2);
           mat->SetRoughnessChannel(1);
           mat->SetMetallic(tex);
@@ -231,43 +394,58 @@ Model ResourcePool::LoadModel(const std::string &path, const aiScene *ai_scene,
     }
   }
 
+  // Pick the shader variant for the textures found now, so it's compiled at load time instead of on first draw
+  mat->ResolveProgram();
   static_material_cache_.insert(std::make_pair(path, mat));
   model.material = mat;
   return model;
 }
 
-std::shared_ptr<Texture> ResourcePool::LoadAssimpEmbeddedTexture(const aiTexture *ai_tex, GLint gl_internal_format) {
-  int32_t channels = 0;
-  GLuint gl_texture = 0;
-  int32_t width = 0;
-  int32_t height = 0;
-  void *buffer = nullptr;
-  glGenTextures(1, &gl_texture);
-  glBindTexture(GL_TEXTURE_2D, gl_texture);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+bool ResourcePool::IsWarmUpComplete() {
+  warm_up_programs_.erase(std::remove_if(warm_up_programs_.begin(), warm_up_programs_.end(),
+                                         [](const std::shared_ptr<Program> &program) { return program->IsReady(); }),
+                          warm_up_programs_.end());
+  return warm_up_programs_.empty();
+}
 
-  std::shared_ptr<Texture> texture = std::make_shared<Texture>(GL_TEXTURE_2D, gl_texture, width, height, true);
+std::shared_ptr<MaterialTemplate> ResourcePool::GetMaterialTemplate(std::shared_ptr<VertexProgram> vert,
+                                                                   std::shared_ptr<GeometryProgram> geom,
+                                                                   std::shared_ptr<FragmentProgram> frag) {
+  // The template keeps its programs alive, so their GL names identify them for as long as it is cached
+  const std::string key = std::to_string(vert ? vert->GetGLProgram() : 0) + ":" +
+                          std::to_string(geom ? geom->GetGLProgram() : 0) + ":" +
+                          std::to_string(frag ? frag->GetGLProgram() : 0);
+  return GetOrCreateElement<MaterialTemplate, MaterialTemplate>(material_template_cache_, key, vert, geom, frag);
+}
 
+std::shared_ptr<Texture> ResourcePool::LoadAssimpEmbeddedTexture(const aiTexture *ai_tex, GLint gl_internal_format) {
+  TextureImage image;
+  image.internal_format = gl_internal_format;
   if (ai_tex->mHeight == 0) {
     ML_LOG(Debug, "Compressed texture %u %u, image format %s", ai_tex->mWidth, ai_tex->mHeight, ai_tex->achFormatHint);
-    buffer = stbi_load_from_memory((unsigned char *)ai_tex->pcData, ai_tex->mWidth, &width, &height, &channels,
-                                   STBI_rgb_alpha);
+    int32_t channels = 0;
+    unsigned char *buffer = stbi_load_from_memory((unsigned char *)ai_tex->pcData, ai_tex->mWidth, &image.width,
+                                                  &image.height, &channels, STBI_rgb_alpha);
+    if (buffer) {
+      image.levels.emplace_back((const char *)buffer,
+                                (const char *)buffer + 4 * static_cast<size_t>(image.width) * image.height);
+      stbi_image_free(buffer);
+    }
   } else {
-    width = ai_tex->mWidth;
-    height = ai_tex->mHeight;
-    buffer = ai_tex->pcData;
+    image.width = ai_tex->mWidth;
+    image.height = ai_tex->mHeight;
+    const char *texels = (const char *)ai_tex->pcData;
+    image.levels.emplace_back(texels, texels + 4 * static_cast<size_t>(image.width) * image.height);
   }
-
-  glTexImage2D(GL_TEXTURE_2D, 0, gl_internal_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
-  texture->SetWidth(width);
-  texture->SetHeight(height);
-
-  if (ai_tex->mHeight == 0) {
-    stbi_image_free(buffer);
+  if (image.levels.empty()) {
+    ML_LOG(Error, "Unable to load embedded texture, image format %s", ai_tex->achFormatHint);
+    return nullptr;
   }
-
-  glBindTexture(GL_TEXTURE_2D, 0);
+  if (!PrepareImage(ai_tex->achFormatHint, image)) {
+    return nullptr;
+  }
+  auto texture = CreateTextureLayer(std::move(image));
+  texture->SetMemoryLabel("embedded textures");
   return texture;
 }
 
@@ -277,29 +455,145 @@ std::shared_ptr<Texture> ResourcePool::LoadTexture(const std::string &path, GLin
     return texture;
   }
 
-  int32_t channels = 0;
-  GLuint gl_texture = 0;
-  int32_t width = 0;
-  int32_t height = 0;
-
-  unsigned char *buffer = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-  if (buffer == nullptr) {
+  TextureImage image;
+  if (!LoadImageFile(path, gl_internal_format, image)) {
     ML_LOG(Error, "Unable to load texture %s", path.c_str());
     return nullptr;
   }
-  ML_LOG(Debug, "Number of channels for image %s is %d", path.c_str(), channels);
+  if (!PrepareImage(path, image)) {
+    return nullptr;
+  }
+  const int32_t level_count = static_cast<int32_t>(image.levels.size());
+  GLuint gl_texture = 0;
   glGenTextures(1, &gl_texture);
   glBindTexture(GL_TEXTURE_2D, gl_texture);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexImage2D(GL_TEXTURE_2D, 0, gl_internal_format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
+  glTexStorage2D(GL_TEXTURE_2D, level_count, image.internal_format, image.width, image.height);
   glBindTexture(GL_TEXTURE_2D, 0);
-  stbi_image_free(buffer);
 
-  texture = std::make_shared<Texture>(GL_TEXTURE_2D, gl_texture, width, height, true);
+  texture = std::make_shared<Texture>(GL_TEXTURE_2D, gl_texture, image.width, image.height, true);
+  texture->SetFormat(image.internal_format, level_count);
+  texture->SetMemoryLabel(path);
+  texture->SetSampler(Registry::GetInstance()->GetTextureBindingCache().GetSampler(GetAssetSamplerDescription()));
+  Registry::GetInstance()->GetUploadManager().UploadTexture(texture, std::move(image));
   texture_cache_.insert(std::make_pair(path, texture));
   return texture;
 }
 
+std::shared_ptr<Texture> ResourcePool::LoadTextureLayer(const std::string &path, GLint gl_internal_format) {
+  auto texture = GetCacheElement<Texture>(texture_layer_cache_, path);
+  if (texture) {
+    return texture;
+  }
+
+  TextureImage image;
+  if (!LoadImageFile(path, gl_internal_format, image)) {
+    ML_LOG(Error, "Unable to load texture %s", path.c_str());
+    return nullptr;
+  }
+  if (!PrepareImage(path, image)) {
+    return nullptr;
+  }
+  texture = CreateTextureLayer(std::move(image));
+  texture->SetMemoryLabel(path);
+
+  texture_layer_cache_.insert(std::make_pair(path, texture));
+  return texture;
+}
+
+bool ResourcePool::PrepareImage(const std::string &name, TextureImage &image) {
+  const GLenum file_format = image.internal_format;
+  if (IsCompressedFormat(image.internal_format) && !IsFormatSupported(image.internal_format)) {
+    if (!TranscodeToRgba8(image)) {
+      ML_LOG(Error, "Texture %s is in format 0x%x, which this GL context doesn't support", name.c_str(),
+             image.internal_format);
+      return false;
+    }
+    ML_LOG(Warning, "Texture %s transcoded from 0x%x to RGBA8, the GL context doesn't support its format",
+           name.c_str(), file_format);
+  }
+  if (generate_mipmaps_ && !IsCompressedFormat(image.internal_format) && image.levels.size() == 1) {
+    GenerateMipmaps(image);
+  }
+
+  // Over the GPU memory budget the largest levels are dropped, as long as there are smaller ones to use instead
+  GpuMemoryTracker &tracker = Registry::GetInstance()->GetGpuMemoryTracker();
+  if (tracker.GetBudget()) {
+    const uint64_t headroom = tracker.GetHeadroom();
+    const int32_t full_width = image.width;
+    const int32_t full_height = image.height;
+    while (image.levels.size() > 1 &&
+           GetTextureSize(image.internal_format, image.width, image.height,
+                          static_cast<int32_t>(image.levels.size())) > headroom) {
+      image.levels.erase(image.levels.begin());
+      image.width = std::max(1, image.width / 2);
+      image.height = std::max(1, image.height / 2);
+    }
+    if (image.width != full_width) {
+      ML_LOG(Warning, "Texture %s reduced from %dx%d to %dx%d, %" PRIu64 " KB left of the GPU memory budget",
+             name.c_str(), full_width, full_height, image.width, image.height, headroom / 1024);
+    }
+  }
+
+  // What the texture costs against an RGBA8 image without mipmaps, sampling reads about 4/3 of the first level
+  const int32_t level_count = static_cast<int32_t>(image.levels.size());
+  const uint64_t bytes = GetTextureSize(image.internal_format, image.width, image.height, level_count);
+  const uint64_t rgba8_bytes = GetTextureLevelSize(GL_RGBA8, image.width, image.height, 0);
+  const float bits_per_texel = 8.f * GetTextureLevelSize(image.internal_format, image.width, image.height, 0) /
+                               (static_cast<float>(image.width) * image.height);
+  texture_bytes_ += bytes;
+  texture_rgba8_bytes_ += rgba8_bytes;
+  ML_LOG(Info, "Texture %s: %dx%d, %d levels, format 0x%x, %.1f bits per texel, %" PRIu64 " KB (%" PRIu64
+         " KB as single level RGBA8). All textures: %" PRIu64 " KB (%" PRIu64 " KB).", name.c_str(), image.width,
+         image.height, level_count, image.internal_format, bits_per_texel, bytes / 1024, rgba8_bytes / 1024,
+         texture_bytes_ / 1024, texture_rgba8_bytes_ / 1024);
+  return true;
+}
+
+std::shared_ptr<Texture> ResourcePool::CreateTextureLayer(TextureImage image) {
+  const int32_t width = image.width;
+  const int32_t height = image.height;
+  const GLenum gl_internal_format = image.internal_format;
+  const int32_t level_count = static_cast<int32_t>(image.levels.size());
+  std::shared_ptr<TextureArray> array;
+  int32_t allocated_layers = 0;
+  for (auto it = texture_arrays_.begin(); it != texture_arrays_.end();) {
+    auto candidate = it->lock();
+    if (!candidate) {
+      it = texture_arrays_.erase(it);
+      continue;
+    }
+    if (candidate->GetWidth() == width && candidate->GetHeight() == height &&
+        candidate->GetInternalFormat() == gl_internal_format && candidate->GetLevelCount() == level_count) {
+      allocated_layers += candidate->GetLayerCount();
+      if (!array && !candidate->IsFull()) {
+        array = candidate;
+      }
+    }
+    ++it;
+  }
+  if (!array) {
+    // As many layers as the arrays of this size and format already have together, so the free layers never
+    // outnumber the used ones and a few arrays hold many textures. No more than the GPU memory budget has room for,
+    // PrepareImage only checked the image itself against it.
+    const uint64_t layer_bytes = GetTextureSize(gl_internal_format, width, height, level_count);
+    uint64_t max_layers = std::min<uint64_t>(kMaxTextureArrayLayers, texture_array_max_bytes_ / layer_bytes);
+    GpuMemoryTracker &tracker = Registry::GetInstance()->GetGpuMemoryTracker();
+    if (tracker.GetBudget()) {
+      max_layers = std::min<uint64_t>(max_layers, tracker.GetHeadroom() / layer_bytes);
+    }
+    const int32_t layer_count =
+        static_cast<int32_t>(std::max<uint64_t>(1, std::min<uint64_t>(std::max(1, allocated_layers), max_layers)));
+    ML_LOG(Debug, "Allocating a texture array of %d layers of %dx%d", layer_count, width, height);
+    array = std::make_shared<TextureArray>(width, height, gl_internal_format, layer_count, level_count);
+    texture_arrays_.push_back(array);
+  }
+
+  const int32_t layer = array->AllocateLayer();
+  auto texture = std::make_shared<Texture>(array, layer);
+  texture->SetSampler(Registry::GetInstance()->GetTextureBindingCache().GetSampler(GetAssetSamplerDescription()));
+  Registry::GetInstance()->GetUploadManager().UploadTexture(texture, std::move(image));
+  return texture;
+}
+
 }  // namespace app_framework
 }  // namespace ml
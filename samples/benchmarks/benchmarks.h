@@ -0,0 +1,34 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#pragma once
+
+#include <chrono>
+
+// Wall clock time of a block of code, in seconds
+class BenchmarkTimer {
+public:
+  BenchmarkTimer() : start_(std::chrono::steady_clock::now()) {}
+
+  double GetSeconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+void RunJobSystemBenchmarks();
+void RunPBRVariantBenchmarks();
+void RunMaterialParameterBenchmarks();
+void RunMaterialInstanceBenchmarks();
+void RunLightClusterBenchmarks();
+void RunVertexFormatBenchmarks();
@@ -0,0 +1,122 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "benchmarks.h"
+
+#include <app_framework/job_system.h>
+#include <app_framework/registry.h>
+#include <gflags/gflags.h>
+#include <ml_logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+DEFINE_int32(benchmark_max_workers, 0,
+    "Largest worker count used by the job system scaling benchmark, the calling thread runs jobs too. 0 uses one "
+    "worker less than the hardware thread count.");
+
+using ml::app_framework::JobCounter;
+using ml::app_framework::JobSystem;
+
+namespace {
+
+const size_t kEmptyJobCount = 200000;
+const size_t kContinuationChainLength = 20000;
+const size_t kScalingItemCount = 1 << 22;
+
+void EmptyJobsFromMainThread(JobSystem &job_system) {
+  BenchmarkTimer timer;
+  auto counter = std::make_shared<JobCounter>();
+  for (size_t i = 0; i < kEmptyJobCount; ++i) {
+    job_system.Run([]() {}, counter);
+  }
+  job_system.Wait(counter);
+  ML_LOG(Info, "job_system: %zu empty jobs from the main thread: %.1f ns/job", kEmptyJobCount,
+         1e9 * timer.GetSeconds() / kEmptyJobCount);
+}
+
+void EmptyJobsFromWorkers(JobSystem &job_system) {
+  // Every worker spawns its share of the jobs, so they land in the local deques and get stolen from there
+  const size_t spawner_count = job_system.GetWorkerCount();
+  const size_t jobs_per_spawner = kEmptyJobCount / spawner_count;
+  BenchmarkTimer timer;
+  auto counter = std::make_shared<JobCounter>();
+  for (size_t i = 0; i < spawner_count; ++i) {
+    job_system.Run([&job_system, counter, jobs_per_spawner]() {
+      for (size_t j = 0; j < jobs_per_spawner; ++j) {
+        job_system.Run([]() {}, counter);
+      }
+    }, counter);
+  }
+  job_system.Wait(counter);
+  size_t job_count = spawner_count * jobs_per_spawner;
+  ML_LOG(Info, "job_system: %zu empty jobs from workers: %.1f ns/job, %llu stolen in total", job_count,
+         1e9 * timer.GetSeconds() / job_count, (unsigned long long)job_system.GetStolenJobCount());
+}
+
+void ContinuationChain(JobSystem &job_system) {
+  BenchmarkTimer timer;
+  auto counter = job_system.Run([]() {});
+  for (size_t i = 1; i < kContinuationChainLength; ++i) {
+    counter = job_system.RunAfter(counter, []() {});
+  }
+  job_system.Wait(counter);
+  ML_LOG(Info, "job_system: chain of %zu continuations: %.1f ns/link", kContinuationChainLength,
+         1e9 * timer.GetSeconds() / kContinuationChainLength);
+}
+
+double ParallelWork(JobSystem &job_system, std::vector<float> &values) {
+  BenchmarkTimer timer;
+  auto counter = job_system.ParallelFor(0, values.size(), 0, [&values](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      float value = values[i];
+      for (int j = 0; j < 16; ++j) {
+        value = std::sqrt(value * value + 1.f);
+      }
+      values[i] = value;
+    }
+  });
+  job_system.Wait(counter);
+  return timer.GetSeconds();
+}
+
+void Scaling() {
+  // ParallelFor and Wait run jobs on the calling thread as well, N workers work on N + 1 threads
+  uint32_t max_workers = FLAGS_benchmark_max_workers > 0 ? uint32_t(FLAGS_benchmark_max_workers)
+                                                         : std::max(2u, std::thread::hardware_concurrency()) - 1;
+  std::vector<float> values(kScalingItemCount, 1.f);
+  double single_worker_seconds = 0.;
+  for (uint32_t workers = 1; workers <= max_workers; ++workers) {
+    JobSystem job_system(workers);
+    // Warm up the threads and the cache before measuring
+    ParallelWork(job_system, values);
+    double seconds = ParallelWork(job_system, values);
+    if (workers == 1) {
+      single_worker_seconds = seconds;
+    }
+    ML_LOG(Info, "job_system: parallel_for over %zu items on %u threads (%u workers): %.2f ms, speedup %.2fx over "
+           "2 threads", values.size(), workers + 1, workers, 1e3 * seconds, single_worker_seconds / seconds);
+  }
+}
+
+}  // namespace
+
+void RunJobSystemBenchmarks() {
+  JobSystem *job_system = ml::app_framework::Registry::GetInstance()->GetJobSystem();
+  ML_LOG(Info, "job_system: %u workers", job_system->GetWorkerCount());
+  EmptyJobsFromMainThread(*job_system);
+  EmptyJobsFromWorkers(*job_system);
+  ContinuationChain(*job_system);
+  Scaling();
+}
@@ -0,0 +1,177 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "benchmarks.h"
+
+#include <app_framework/node.h>
+#include <app_framework/registry.h>
+#include <app_framework/components/camera_component.h>
+#include <app_framework/components/light_component.h>
+#include <app_framework/components/renderable_component.h>
+#include <app_framework/geometry/quad_mesh.h>
+#include <app_framework/material/pbr_material.h>
+#include <app_framework/render/gpu_timer.h>
+#include <app_framework/render/light_clusters.h>
+#include <app_framework/render/renderer.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <ml_logging.h>
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace ml::app_framework;
+
+namespace {
+
+const int32_t kTargetSize = 1024;
+const size_t kLightCounts[] = {16, 64, 256, 1024};
+const size_t kAssignIterations = 100;
+const size_t kWarmupFrames = 10;
+const size_t kMeasuredFrames = 100;
+
+// Two eyes 6.4cm apart looking down -z, like the cameras of the Application
+std::vector<std::shared_ptr<CameraComponent>> CreateCameras(const std::shared_ptr<RenderTarget> &render_target,
+                                                            const std::shared_ptr<Node> &root) {
+  std::vector<std::shared_ptr<CameraComponent>> cameras;
+  for (int32_t i = 0; i < 2; ++i) {
+    auto camera = std::make_shared<CameraComponent>();
+    camera->SetRenderTarget(render_target);
+    camera->SetViewport(glm::vec4(0.f, 0.f, kTargetSize, kTargetSize));
+    camera->SetProjectionMatrix(glm::perspective(glm::radians(50.f), 1.f, 0.1f, 50.f));
+    auto camera_node = std::make_shared<Node>();
+    camera_node->AddComponent(camera);
+    camera_node->SetLocalTranslation(glm::vec3((i == 0 ? -0.5f : 0.5f) * 0.064f, 0.f, 0.f));
+    root->AddChild(camera_node);
+    cameras.push_back(camera);
+  }
+  return cameras;
+}
+
+// Point lights scattered over a 10m x 3m x 10m room in front of the cameras
+std::vector<std::shared_ptr<LightComponent>> CreateLights(size_t count, const std::shared_ptr<Node> &root) {
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+  std::vector<std::shared_ptr<LightComponent>> lights;
+  for (size_t i = 0; i < count; ++i) {
+    auto light = std::make_shared<LightComponent>();
+    light->SetLightColor(glm::vec3(unit(random), unit(random), unit(random)));
+    light->SetLightStrength(0.5f);
+    light->SetLightRange(1.f + unit(random));
+    auto light_node = std::make_shared<Node>();
+    light_node->AddComponent(light);
+    light_node->SetLocalTranslation(glm::vec3(10.f * unit(random) - 5.f, 3.f * unit(random) - 1.5f,
+                                              -10.f * unit(random)));
+    root->AddChild(light_node);
+    lights.push_back(light);
+  }
+  return lights;
+}
+
+std::vector<Light> GetLights(const std::vector<std::shared_ptr<LightComponent>> &components) {
+  std::vector<Light> lights;
+  for (const auto &light : components) {
+    lights.push_back(Light(light->GetNode()->GetWorldTranslation(), light->GetLightColor(), light->GetDirection(),
+                           light->GetLightType(), light->GetLightStrength(), light->GetLightRange()));
+  }
+  return lights;
+}
+
+// Average time of assigning the lights to the clusters of both cameras, in milliseconds
+double MeasureAssign(LightClusters &light_clusters, const std::vector<std::shared_ptr<CameraComponent>> &cameras,
+                     const std::vector<Light> &lights) {
+  light_clusters.Assign(cameras, lights);
+  BenchmarkTimer timer;
+  for (size_t i = 0; i < kAssignIterations; ++i) {
+    light_clusters.Assign(cameras, lights);
+  }
+  return 1e3 * timer.GetSeconds() / kAssignIterations;
+}
+
+// Average GPU time of a frame of the scene, in milliseconds
+double MeasureFrames(Renderer &renderer, const std::shared_ptr<Node> &root) {
+  GpuTimer timer;
+  uint64_t total_ns = 0;
+  size_t measured = 0;
+  for (size_t frame = 0; frame < kWarmupFrames + kMeasuredFrames; ++frame) {
+    renderer.Visit(root);
+    for (const auto &child : root->GetChildren()) {
+      renderer.Visit(child);
+    }
+    timer.Begin();
+    renderer.Render();
+    timer.End();
+    glFinish();
+    uint64_t elapsed_ns = 0;
+    if (timer.Poll(elapsed_ns) && frame >= kWarmupFrames) {
+      total_ns += elapsed_ns;
+      ++measured;
+    }
+  }
+  return measured ? 1e-6 * total_ns / measured : 0.0;
+}
+
+}  // namespace
+
+void RunLightClusterBenchmarks() {
+  GLuint textures[2] = {};
+  glGenTextures(2, textures);
+  glBindTexture(GL_TEXTURE_2D, textures[0]);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, kTargetSize, kTargetSize);
+  glBindTexture(GL_TEXTURE_2D, textures[1]);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, kTargetSize, kTargetSize);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  auto color = std::make_shared<Texture>(GL_TEXTURE_2D, textures[0], kTargetSize, kTargetSize, true);
+  auto depth = std::make_shared<Texture>(GL_TEXTURE_2D, textures[1], kTargetSize, kTargetSize, true);
+  auto render_target = std::make_shared<RenderTarget>(color, depth, 0, 0);
+
+  // A floor under the lights filling the lower half of the view
+  auto material = std::make_shared<PBRMaterial>();
+  while (!material->IsReady()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto floor = std::make_shared<Node>();
+  floor->AddComponent(std::make_shared<RenderableComponent>(std::make_shared<QuadMesh>(), material));
+  floor->SetLocalRotation(glm::quat{glm::vec3{-glm::half_pi<float>(), 0.f, 0.f}});
+  floor->SetLocalScale(glm::vec3(20.f));
+  floor->SetLocalTranslation(glm::vec3(0.f, -1.5f, -5.f));
+
+  JobSystem *job_system = Registry::GetInstance()->GetJobSystem();
+  for (size_t light_count : kLightCounts) {
+    auto root = std::make_shared<Node>();
+    auto cameras = CreateCameras(render_target, root);
+    auto lights = GetLights(CreateLights(light_count, root));
+    root->AddChild(floor);
+
+    Renderer renderer;
+    LightClusters &light_clusters = renderer.GetLightClusters();
+    Registry::GetInstance()->SetJobSystem(nullptr);
+    const double serial_ms = MeasureAssign(light_clusters, cameras, lights);
+    Registry::GetInstance()->SetJobSystem(job_system);
+    const double parallel_ms = MeasureAssign(light_clusters, cameras, lights);
+    const double lights_per_cluster = 0.5 * (light_clusters.GetLightIndexCount(0) +
+        light_clusters.GetLightIndexCount(1)) / LightClusters::kClusterCount;
+
+    ML_LOG(Info, "light_clusters: %zu lights, assignment %.3f ms serial, %.3f ms on %u workers, "
+           "%.2f lights per cluster", light_count, serial_ms, parallel_ms,
+           job_system ? job_system->GetWorkerCount() : 0, lights_per_cluster);
+
+    const double frame_ms = MeasureFrames(renderer, root);
+    root->RemoveChild(floor);
+    if (frame_ms <= 0.0) {
+      ML_LOG(Warning, "light_clusters: no GPU timer results, GL_TIME_ELAPSED queries unsupported?");
+      continue;
+    }
+    ML_LOG(Info, "light_clusters: %zu lights, 2x %dx%d frame %.3f ms GPU", light_count, kTargetSize, kTargetSize,
+           frame_ms);
+  }
+}
@@ -0,0 +1,78 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "benchmarks.h"
+
+#include <app_framework/application.h>
+#include <gflags/gflags.h>
+
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+DEFINE_string(benchmark, "all", "Comma separated list of benchmarks to run, or all.");
+
+namespace {
+
+struct Benchmark {
+  const char *name;
+  std::function<void()> run;
+};
+
+const std::vector<Benchmark> &GetBenchmarks() {
+  static const std::vector<Benchmark> benchmarks = {
+      {"job_system", RunJobSystemBenchmarks},
+      {"pbr_variants", RunPBRVariantBenchmarks},
+      {"material_parameters", RunMaterialParameterBenchmarks},
+      {"material_instances", RunMaterialInstanceBenchmarks},
+      {"light_clusters", RunLightClusterBenchmarks},
+      {"vertex_formats", RunVertexFormatBenchmarks},
+  };
+  return benchmarks;
+}
+
+bool IsSelected(const std::string &name) {
+  if (FLAGS_benchmark == "all") {
+    return true;
+  }
+  std::stringstream selection(FLAGS_benchmark);
+  std::string selected;
+  while (std::getline(selection, selected, ',')) {
+    if (selected == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+class BenchmarksApp : public ml::app_framework::Application {
+public:
+  BenchmarksApp(int argc = 0, char **argv = nullptr) : ml::app_framework::Application(argc, argv) {}
+
+  void OnStart() override {
+    for (const auto &benchmark : GetBenchmarks()) {
+      if (IsSelected(benchmark.name)) {
+        ML_LOG(Info, "Running benchmark %s", benchmark.name);
+        benchmark.run();
+      }
+    }
+    StopApp();
+  }
+};
+
+int main(int argc, char **argv) {
+  BenchmarksApp app(argc, argv);
+  app.RunApp();
+  return 0;
+}
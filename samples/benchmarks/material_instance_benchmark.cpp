@@ -0,0 +1,67 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "benchmarks.h"
+
+#include <app_framework/material/flat_material.h>
+#include <app_framework/registry.h>
+#include <ml_logging.h>
+
+#include <cinttypes>
+#include <memory>
+#include <vector>
+
+using namespace ml::app_framework;
+
+namespace {
+
+const size_t kInstanceCount = 1000;
+
+}  // namespace
+
+void RunMaterialInstanceBenchmarks() {
+  auto &arena = Registry::GetInstance()->GetMaterialParameterArena();
+  auto &tracker = Registry::GetInstance()->GetGpuMemoryTracker();
+  auto prototype = std::make_shared<FlatMaterial>(glm::vec4(1.f));
+
+  // Instances only take a range of the CPU copy of the arena, the GL side is untouched until the next Flush
+  const GLuint gl_buffer_before = arena.GetGLBuffer();
+  const uint64_t gpu_bytes_before = tracker.GetTotalUsage();
+
+  std::vector<std::shared_ptr<FlatMaterial>> constructed;
+  BenchmarkTimer construct_timer;
+  for (size_t i = 0; i < kInstanceCount; ++i) {
+    constructed.push_back(std::make_shared<FlatMaterial>(glm::vec4(static_cast<float>(i))));
+  }
+  const double construct_us = 1e6 * construct_timer.GetSeconds() / kInstanceCount;
+
+  std::vector<std::shared_ptr<FlatMaterial>> copied;
+  BenchmarkTimer copy_timer;
+  for (size_t i = 0; i < kInstanceCount; ++i) {
+    copied.push_back(std::make_shared<FlatMaterial>(*prototype));
+    copied.back()->SetColor(glm::vec4(static_cast<float>(i)));
+  }
+  const double copy_us = 1e6 * copy_timer.GetSeconds() / kInstanceCount;
+
+  size_t shared_templates = 0;
+  for (const auto &material : copied) {
+    shared_templates += material->GetTemplate() == prototype->GetTemplate() ? 1 : 0;
+  }
+  ML_LOG(Info, "material_instances: %zu FlatMaterials constructed %.2f us each, copied %.2f us each, "
+         "%zu/%zu sharing one template, parameter arena %u bytes", kInstanceCount, construct_us, copy_us,
+         shared_templates, copied.size(), arena.GetCapacity());
+
+  const bool allocated_gl = arena.GetGLBuffer() != gl_buffer_before || tracker.GetTotalUsage() != gpu_bytes_before;
+  ML_LOG_IF(Error, allocated_gl, "material_instances: creating %zu instances allocated GL memory, "
+            "%" PRIu64 " bytes tracked before, %" PRIu64 " after", 2 * kInstanceCount, gpu_bytes_before,
+            tracker.GetTotalUsage());
+  ML_LOG_IF(Info, !allocated_gl, "material_instances: no GL objects allocated by %zu instances", 2 * kInstanceCount);
+}
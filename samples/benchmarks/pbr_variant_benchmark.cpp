@@ -0,0 +1,151 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "benchmarks.h"
+
+#include <app_framework/node.h>
+#include <app_framework/registry.h>
+#include <app_framework/components/camera_component.h>
+#include <app_framework/components/light_component.h>
+#include <app_framework/components/renderable_component.h>
+#include <app_framework/material/pbr_material.h>
+#include <app_framework/render/gpu_timer.h>
+#include <app_framework/render/renderer.h>
+#include <gflags/gflags.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <ml_logging.h>
+
+#include <chrono>
+#include <functional>
+#include <set>
+#include <thread>
+
+DEFINE_string(benchmark_pbr_model, "data/Controller.fbx", "Model rendered by the PBR shader variant benchmark.");
+
+using namespace ml::app_framework;
+
+namespace {
+
+const int32_t kTargetSize = 1024;
+const size_t kWarmupFrames = 10;
+const size_t kMeasuredFrames = 200;
+
+void VisitAll(Renderer &renderer, const std::shared_ptr<Node> &node) {
+  renderer.Visit(node);
+  for (const auto &child : node->GetChildren()) {
+    VisitAll(renderer, child);
+  }
+}
+
+std::set<uint32_t> CollectFeatures(const std::shared_ptr<Node> &node) {
+  std::set<uint32_t> features;
+  std::function<void(const std::shared_ptr<Node> &)> collect = [&](const std::shared_ptr<Node> &current) {
+    auto renderable = current->GetComponent<RenderableComponent>();
+    if (renderable) {
+      auto material = std::dynamic_pointer_cast<PBRMaterial>(renderable->GetMaterial());
+      if (material) {
+        features.insert(material->GetFeatures());
+      }
+    }
+    for (const auto &child : current->GetChildren()) {
+      collect(child);
+    }
+  };
+  collect(node);
+  return features;
+}
+
+// The shaders compile in the background, measuring before they are ready would time the fallback material
+void WarmUpShaderVariants(const std::set<uint32_t> &features) {
+  PBRMaterial::WarmUpShaderVariants(std::vector<uint32_t>(features.begin(), features.end()));
+  while (!Registry::GetInstance()->GetResourcePool()->IsWarmUpComplete()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+// Average GPU time of a frame of the scene, in milliseconds
+double MeasureFrames(Renderer &renderer, const std::shared_ptr<Node> &root) {
+  GpuTimer timer;
+  uint64_t total_ns = 0;
+  size_t measured = 0;
+  for (size_t frame = 0; frame < kWarmupFrames + kMeasuredFrames; ++frame) {
+    VisitAll(renderer, root);
+    timer.Begin();
+    renderer.Render();
+    timer.End();
+    glFinish();
+    uint64_t elapsed_ns = 0;
+    if (timer.Poll(elapsed_ns) && frame >= kWarmupFrames) {
+      total_ns += elapsed_ns;
+      ++measured;
+    }
+  }
+  return measured ? 1e-6 * total_ns / measured : 0.0;
+}
+
+}  // namespace
+
+void RunPBRVariantBenchmarks() {
+  auto model = Registry::GetInstance()->GetResourcePool()->LoadAsset(FLAGS_benchmark_pbr_model);
+  if (!model) {
+    ML_LOG(Error, "pbr_variants: unable to load %s", FLAGS_benchmark_pbr_model.c_str());
+    return;
+  }
+  model->SetLocalRotation(glm::quat{glm::vec3{0.f, glm::pi<float>(), 0.f}});
+  model->SetLocalScale(glm::vec3(0.01f));
+  model->SetLocalTranslation(glm::vec3(0.f, 0.f, -0.12f));
+
+  GLuint textures[2] = {};
+  glGenTextures(2, textures);
+  glBindTexture(GL_TEXTURE_2D, textures[0]);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, kTargetSize, kTargetSize);
+  glBindTexture(GL_TEXTURE_2D, textures[1]);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, kTargetSize, kTargetSize);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  auto color = std::make_shared<Texture>(GL_TEXTURE_2D, textures[0], kTargetSize, kTargetSize, true);
+  auto depth = std::make_shared<Texture>(GL_TEXTURE_2D, textures[1], kTargetSize, kTargetSize, true);
+
+  auto camera = std::make_shared<CameraComponent>();
+  camera->SetRenderTarget(std::make_shared<RenderTarget>(color, depth, 0, 0));
+  camera->SetViewport(glm::vec4(0.f, 0.f, kTargetSize, kTargetSize));
+  camera->SetProjectionMatrix(glm::perspective(glm::radians(60.f), 1.f, 0.01f, 10.f));
+  auto camera_node = std::make_shared<Node>();
+  camera_node->AddComponent(camera);
+
+  auto light = std::make_shared<LightComponent>();
+  light->SetLightStrength(5.0f);
+  auto light_node = std::make_shared<Node>();
+  light_node->AddComponent(light);
+  light_node->SetLocalTranslation(glm::vec3(0.f, 0.1f, 0.f));
+
+  auto root = std::make_shared<Node>();
+  root->AddChild(camera_node);
+  root->AddChild(light_node);
+  root->AddChild(model);
+
+  Renderer renderer;
+  WarmUpShaderVariants(CollectFeatures(model));
+  const bool variants_enabled = PBRMaterial::GetShaderVariantsEnabled();
+  PBRMaterial::SetShaderVariantsEnabled(false);
+  double generic_ms = MeasureFrames(renderer, root);
+  PBRMaterial::SetShaderVariantsEnabled(true);
+  double variant_ms = MeasureFrames(renderer, root);
+  PBRMaterial::SetShaderVariantsEnabled(variants_enabled);
+
+  ML_LOG(Info, "pbr_variants: %s uses %zu shader variants", FLAGS_benchmark_pbr_model.c_str(),
+         CollectFeatures(model).size());
+  if (generic_ms <= 0.0 || variant_ms <= 0.0) {
+    ML_LOG(Warning, "pbr_variants: no GPU timer results, GL_TIME_ELAPSED queries unsupported?");
+    return;
+  }
+  ML_LOG(Info, "pbr_variants: %dx%d frame, generic shader %.3f ms, variants %.3f ms (%.1f%% less GPU time)",
+         kTargetSize, kTargetSize, generic_ms, variant_ms, 100.0 * (generic_ms - variant_ms) / generic_ms);
+}
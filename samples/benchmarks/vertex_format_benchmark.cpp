@@ -0,0 +1,164 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+//
+// Copyright (c) 2018 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Creator Agreement, located
+// here: https://id.magicleap.com/creator-terms
+//
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+#include "benchmarks.h"
+
+#include <app_framework/node.h>
+#include <app_framework/registry.h>
+#include <app_framework/components/camera_component.h>
+#include <app_framework/components/renderable_component.h>
+#include <app_framework/material/pbr_material.h>
+#include <app_framework/render/gpu_timer.h>
+#include <app_framework/render/mesh.h>
+#include <app_framework/render/renderer.h>
+#include <app_framework/render/vertex_layout.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <ml_logging.h>
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace ml::app_framework;
+
+namespace {
+
+const int32_t kTargetSize = 1024;
+// Rings and segments of each sphere, about 260k vertices
+const uint32_t kSphereSegments = 512;
+// Spheres in a kGridSize x kGridSize grid, enough to make the vertex fetch dominate
+const int32_t kGridSize = 4;
+const size_t kWarmupFrames = 10;
+const size_t kMeasuredFrames = 100;
+
+struct SphereData {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> tex_coords;
+  std::vector<uint32_t> indices;
+};
+
+SphereData CreateSphere(uint32_t segments) {
+  SphereData sphere;
+  for (uint32_t ring = 0; ring <= segments; ++ring) {
+    const float theta = glm::pi<float>() * ring / segments;
+    for (uint32_t segment = 0; segment <= segments; ++segment) {
+      const float phi = 2.f * glm::pi<float>() * segment / segments;
+      const glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+      sphere.positions.push_back(normal * 0.2f);
+      sphere.normals.push_back(normal);
+      sphere.tex_coords.push_back(glm::vec2(static_cast<float>(segment) / segments,
+                                            static_cast<float>(ring) / segments));
+    }
+  }
+  for (uint32_t ring = 0; ring < segments; ++ring) {
+    for (uint32_t segment = 0; segment < segments; ++segment) {
+      const uint32_t first = ring * (segments + 1) + segment;
+      const uint32_t second = first + segments + 1;
+      sphere.indices.insert(sphere.indices.end(), {first, second, first + 1, second, second + 1, first + 1});
+    }
+  }
+  return sphere;
+}
+
+// Average GPU time of a frame of the scene, in milliseconds
+double MeasureFrames(Renderer &renderer, const std::shared_ptr<Node> &root) {
+  GpuTimer timer;
+  uint64_t total_ns = 0;
+  size_t measured = 0;
+  for (size_t frame = 0; frame < kWarmupFrames + kMeasuredFrames; ++frame) {
+    renderer.Visit(root);
+    for (const auto &child : root->GetChildren()) {
+      renderer.Visit(child);
+    }
+    timer.Begin();
+    renderer.Render();
+    timer.End();
+    glFinish();
+    uint64_t elapsed_ns = 0;
+    if (timer.Poll(elapsed_ns) && frame >= kWarmupFrames) {
+      total_ns += elapsed_ns;
+      ++measured;
+    }
+  }
+  return measured ? 1e-6 * total_ns / measured : 0.0;
+}
+
+}  // namespace
+
+void RunVertexFormatBenchmarks() {
+  GLuint textures[2] = {};
+  glGenTextures(2, textures);
+  glBindTexture(GL_TEXTURE_2D, textures[0]);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, kTargetSize, kTargetSize);
+  glBindTexture(GL_TEXTURE_2D, textures[1]);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, kTargetSize, kTargetSize);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  auto color = std::make_shared<Texture>(GL_TEXTURE_2D, textures[0], kTargetSize, kTargetSize, true);
+  auto depth = std::make_shared<Texture>(GL_TEXTURE_2D, textures[1], kTargetSize, kTargetSize, true);
+  auto render_target = std::make_shared<RenderTarget>(color, depth, 0, 0);
+
+  auto material = std::make_shared<PBRMaterial>();
+  material->SetHasNormals(true);
+  while (!material->IsReady()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  const SphereData sphere = CreateSphere(kSphereSegments);
+  const struct {
+    const char *name;
+    VertexLayout layout;
+  } layouts[] = {
+      {"float", VertexLayout()},
+      {"quantized", VertexLayout::Quantized()},
+  };
+
+  for (const auto &layout : layouts) {
+    auto mesh = std::make_shared<Mesh>(Buffer::Category::Static, GL_UNSIGNED_INT, layout.layout);
+    mesh->UpdateVertices(sphere.positions.data(), sphere.normals.data(), sphere.tex_coords.data(),
+                         sphere.positions.size());
+    mesh->UpdateIndices(sphere.indices.data(), sphere.indices.size());
+
+    auto root = std::make_shared<Node>();
+    auto camera = std::make_shared<CameraComponent>();
+    camera->SetRenderTarget(render_target);
+    camera->SetViewport(glm::vec4(0.f, 0.f, kTargetSize, kTargetSize));
+    camera->SetProjectionMatrix(glm::perspective(glm::radians(50.f), 1.f, 0.1f, 50.f));
+    auto camera_node = std::make_shared<Node>();
+    camera_node->AddComponent(camera);
+    root->AddChild(camera_node);
+    for (int32_t x = 0; x < kGridSize; ++x) {
+      for (int32_t y = 0; y < kGridSize; ++y) {
+        auto node = std::make_shared<Node>();
+        node->AddComponent(std::make_shared<RenderableComponent>(mesh, material));
+        node->SetLocalTranslation(glm::vec3(0.5f * (x - 0.5f * (kGridSize - 1)), 0.5f * (y - 0.5f * (kGridSize - 1)),
+                                            -3.f));
+        root->AddChild(node);
+      }
+    }
+
+    Renderer renderer;
+    const double frame_ms = MeasureFrames(renderer, root);
+    const double buffer_mb = mesh->GetBufferSize() / (1024.0 * 1024.0);
+    ML_LOG(Info, "vertex_formats: %s, %u bytes per vertex, %.2f MB of vertex and index buffers, %zu vertices",
+           layout.name, layout.layout.GetStride(), buffer_mb, sphere.positions.size());
+    if (frame_ms <= 0.0) {
+      ML_LOG(Warning, "vertex_formats: no GPU timer results, GL_TIME_ELAPSED queries unsupported?");
+      continue;
+    }
+    // Every vertex is fetched at least once per sphere, the post-transform cache hides the rest
+    const double fetched_mb = kGridSize * kGridSize * sphere.positions.size() * layout.layout.GetStride() /
+                              (1024.0 * 1024.0);
+    ML_LOG(Info, "vertex_formats: %s, %dx%d frame of %d spheres %.3f ms GPU, at least %.1f MB of vertices fetched",
+           layout.name, kTargetSize, kTargetSize, kGridSize * kGridSize, frame_ms, fetched_mb);
+  }
+}
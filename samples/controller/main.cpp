@@ -12,6 +12,7 @@
 #include <app_framework/application.h>
 #include <app_framework/convert.h>
 #include <app_framework/ml_macros.h>
+#include <app_framework/perception_recorder.h>
 #include <app_framework/toolset.h>
 
 #include <gflags/gflags.h>
@@ -87,7 +88,7 @@ public:
 
   void OnUpdate(float) override {
     MLInputControllerState controller_states[MLInput_MaxControllers];
-    UNWRAP_MLRESULT(MLInputGetControllerState(input_tracker_, controller_states));
+    UNWRAP_MLRESULT(recorder_.GetControllerState(input_tracker_, controller_states));
     for (size_t i = 0; i < input_nodes_.size(); ++i) {
       if (controller_states[i].is_connected) {
         GetRoot()->AddChild(input_nodes_[i].controller);
@@ -125,6 +126,7 @@ public:
   }
 
 private:
+  ml::app_framework::PerceptionRecorder &recorder_ = ml::app_framework::PerceptionRecorder::GetInstance();
   struct ControllerVisual {
     std::shared_ptr<ml::app_framework::Node> controller;
     std::shared_ptr<ml::app_framework::Node> touch;
@@ -13,6 +13,7 @@
 #include <app_framework/convert.h>
 #include <app_framework/gui.h>
 #include <app_framework/ml_macros.h>
+#include <app_framework/perception_recorder.h>
 #include <app_framework/toolset.h>
 
 #include <gflags/gflags.h>
@@ -118,11 +119,11 @@ public:
     MLPerceptionGetSnapshot(&snapshot);
 
     MLTransform head_transform = {};
-    MLSnapshotGetTransform(snapshot, &head_static_data_.coord_frame_head, &head_transform);
+    recorder_.GetTransform(snapshot, &head_static_data_.coord_frame_head, &head_transform);
 
     if (config_.handtracking_pipeline_enabled) {
       ResetDrawFlags();
-      MLResult d = MLHandTrackingGetDataEx(hand_tracker_, &data);
+      MLResult d = recorder_.GetHandTrackingData(hand_tracker_, &data);
       if (d != MLResult_Ok) {
         return;
       }
@@ -148,14 +149,14 @@ public:
         MLTransform lt = {};
         MLTransform rt = {};
         if (left_draw_[i]) {
-          MLSnapshotGetTransform(snapshot, &hand_static_data_.left_frame[i].frame_id, &lt);
+          recorder_.GetTransform(snapshot, &hand_static_data_.left_frame[i].frame_id, &lt);
           left_keypoints_[i]->SetWorldTranslation(ml::app_framework::to_glm(lt.position));
           left_keypoints_[i]->SetWorldRotation(ml::app_framework::to_glm(lt.rotation));
           left_keypoints_[i]->SetLocalScale(kKeypointCubeScale);
         }
 
         if (right_draw_[i]) {
-          MLSnapshotGetTransform(snapshot, &hand_static_data_.right_frame[i].frame_id, &rt);
+          recorder_.GetTransform(snapshot, &hand_static_data_.right_frame[i].frame_id, &rt);
           right_keypoints_[i]->SetWorldTranslation(ml::app_framework::to_glm(rt.position));
           right_keypoints_[i]->SetWorldRotation(ml::app_framework::to_glm(rt.rotation));
           right_keypoints_[i]->SetLocalScale(kKeypointCubeScale);
@@ -165,8 +166,8 @@ public:
       // Get the transforms for hand centers for positioning of the text
       MLTransform l_hand_center = {};
       MLTransform r_hand_center = {};
-      MLSnapshotGetTransform(snapshot, &hand_static_data_.left.hand_center.frame_id, &l_hand_center);
-      MLSnapshotGetTransform(snapshot, &hand_static_data_.right.hand_center.frame_id, &r_hand_center);
+      recorder_.GetTransform(snapshot, &hand_static_data_.left.hand_center.frame_id, &l_hand_center);
+      recorder_.GetTransform(snapshot, &hand_static_data_.right.hand_center.frame_id, &r_hand_center);
       MLPerceptionReleaseSnapshot(snapshot);
 
       std::stringstream label;
@@ -223,6 +224,7 @@ public:
   }
 
 private:
+  ml::app_framework::PerceptionRecorder &recorder_ = ml::app_framework::PerceptionRecorder::GetInstance();
   std::shared_ptr<ml::app_framework::Node> l_pose_text_;
   std::shared_ptr<ml::app_framework::Node> r_pose_text_;
   MLTransform l_last_hand_center_ = {};
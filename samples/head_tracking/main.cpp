@@ -11,6 +11,7 @@
 // %BANNER_END%
 #include <app_framework/application.h>
 #include <app_framework/ml_macros.h>
+#include <app_framework/perception_recorder.h>
 #include <app_framework/toolset.h>
 #include <gflags/gflags.h>
 
@@ -90,7 +91,7 @@ public:
     UNWRAP_MLRESULT(MLPerceptionGetSnapshot(&snapshot));
 
     MLTransform head_transform = {};
-    UNWRAP_MLRESULT(MLSnapshotGetTransform(snapshot, &head_static_data_.coord_frame_head, &head_transform));
+    UNWRAP_MLRESULT(recorder_.GetTransform(snapshot, &head_static_data_.coord_frame_head, &head_transform));
     UNWRAP_MLRESULT(MLPerceptionReleaseSnapshot(snapshot));
   }
 
@@ -99,6 +100,7 @@ public:
   }
 
 private:
+  ml::app_framework::PerceptionRecorder &recorder_ = ml::app_framework::PerceptionRecorder::GetInstance();
   MLHandle head_tracker_;
   MLHeadTrackingStaticData head_static_data_;
 
@@ -13,6 +13,8 @@
 #include <app_framework/convert.h>
 #include <app_framework/gui.h>
 #include <app_framework/ml_macros.h>
+#include <app_framework/perception_recorder.h>
+#include <app_framework/registry.h>
 #include <app_framework/toolset.h>
 #include <app_framework/components/magicleap_mesh_component.h>
 #include <app_framework/material/magicleap_mesh_visualization_material.h>
@@ -35,6 +37,7 @@
 #include <ml_meshing2.h>
 #include <ml_perception.h>
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstdlib>
 #include <unordered_map>
@@ -51,10 +54,17 @@ DEFINE_bool(IndexOrderCCW, false,
             "If set, winding order of indices will be be changed from clockwise to counter "
             "clockwise. This could be useful for face culling process in different engines.");
 
+DEFINE_bool(QuantizeNormals, true,
+            "If set, the normals are stored octahedral encoded in 32 bits per vertex instead of 3 floats.");
+
 DEFINE_int32(MLMeshingLOD, 1,
              "Level of detail of the block mesh.\n"
              "0:Minimum, 1: Medium, 2: Maximum");
 
+DEFINE_int32(MeshLods, 0,
+             "Levels of detail simplified from every block mesh on the device, each with half the triangles of the "
+             "previous one. Distant blocks are drawn with fewer triangles at the cost of CPU time per update.");
+
 DEFINE_double(fill_hole_length, 3.0, "Perimeter (in meters) of holes you wish to have filled.");
 DEFINE_double(disconnected_component_area, 0.5,
               "Any component that is disconnected from the main mesh and which has an area (in "
@@ -70,6 +80,10 @@ DEFINE_bool(DrawBlockBounds, false,
             "updated = orange"
             "unchanged = violet");
 
+DEFINE_double(GpuMemoryShedFraction, 0.9,
+              "Fraction of the GPU memory budget (--gpu_memory_budget_mb) above which new blocks are requested at the "
+              "minimum MLMeshingLOD, until the usage goes back under it.");
+
 namespace std {
 
 template <>
@@ -112,6 +126,17 @@ public:
                               (FLAGS_IndexOrderCCW ? MLMeshingFlags_IndexOrderCCW : 0);
     UNWRAP_MLRESULT(MLMeshingCreateClient(&meshing_client_, &meshing_settings_));
     meshing_lod_ = static_cast<MLMeshingLOD>(FLAGS_MLMeshingLOD);
+    gpu_memory_callback_ = ml::app_framework::Registry::GetInstance()->GetGpuMemoryTracker().AddThresholdCallback(
+        static_cast<float>(FLAGS_GpuMemoryShedFraction), [this](bool exceeded, uint64_t usage, uint64_t budget) {
+          if (exceeded) {
+            unshed_meshing_lod_ = meshing_lod_;
+            meshing_lod_ = MLMeshingLOD_Minimum;
+          } else {
+            meshing_lod_ = unshed_meshing_lod_;
+          }
+          ML_LOG(Warning, "GPU memory at %" PRIu64 " of %" PRIu64 " KB, meshing_lod_: %d", usage / 1024,
+                 budget / 1024, meshing_lod_);
+        });
     mesh_mat_ = std::make_shared<ml::app_framework::MagicLeapMeshVisualizationMaterial>();
     geom_shader_ = mesh_mat_->GetGeometryProgram();
 
@@ -170,6 +195,7 @@ public:
   }
 
   void OnStop() override {
+    ml::app_framework::Registry::GetInstance()->GetGpuMemoryTracker().RemoveThresholdCallback(gpu_memory_callback_);
     ml::app_framework::Gui::GetInstance().Cleanup();
     mesh_block_nodes_.clear();
     UNWRAP_MLRESULT(MLMeshingDestroyClient(&meshing_client_));
@@ -183,7 +209,7 @@ public:
       MLSnapshot *snapshot = nullptr;
       MLTransform head_transform = {};
       UNWRAP_MLRESULT(MLPerceptionGetSnapshot(&snapshot));
-      UNWRAP_MLRESULT(MLSnapshotGetTransform(snapshot, &head_static_data_.coord_frame_head, &head_transform));
+      UNWRAP_MLRESULT(recorder_.GetTransform(snapshot, &head_static_data_.coord_frame_head, &head_transform));
       UNWRAP_MLRESULT(MLPerceptionReleaseSnapshot(snapshot));
 
       request_extents_.center = head_transform.position;
@@ -209,7 +235,7 @@ public:
     // Poll mesh info result
     if (MLHandleIsValid(current_mesh_info_request_)) {
       MLMeshingMeshInfo mesh_info = {};
-      MLResult result = MLMeshingGetMeshInfoResult(meshing_client_, current_mesh_info_request_, &mesh_info);
+      MLResult result = recorder_.GetMeshInfoResult(meshing_client_, current_mesh_info_request_, &mesh_info);
 
       if (MLResult_Ok == result) {
         UpdateBlockRequests(mesh_info);
@@ -224,7 +250,7 @@ public:
     // Poll mesh result
     if (MLHandleIsValid(current_mesh_request_)) {
       MLMeshingMesh mesh = {};
-      MLResult result = MLMeshingGetMeshResult(meshing_client_, current_mesh_request_, &mesh);
+      MLResult result = recorder_.GetMeshResult(meshing_client_, current_mesh_request_, &mesh);
 
       if (MLResult_Ok == result) {
         UpdateBlocks(mesh);
@@ -249,6 +275,7 @@ public:
   };
 
 private:
+  ml::app_framework::PerceptionRecorder &recorder_ = ml::app_framework::PerceptionRecorder::GetInstance();
   void UpdateBlockRequests(const MLMeshingMeshInfo &mesh_info) {
     block_requests_.clear();
     for (size_t i = 0; i < mesh_info.data_count; ++i) {
@@ -261,9 +288,19 @@ private:
           std::shared_ptr<ml::app_framework::Node> new_block = std::make_shared<ml::app_framework::Node>();
           {
             using namespace ml::app_framework;
-            std::shared_ptr<MagicLeapMeshComponent> mesh_comp = std::make_shared<MagicLeapMeshComponent>();
+            const VertexLayout vertex_layout(
+                VertexLayout::PositionFormat::kFloat3,
+                FLAGS_QuantizeNormals ? VertexLayout::NormalFormat::kOctahedral16 : VertexLayout::NormalFormat::kFloat3,
+                VertexLayout::TexCoordFormat::kNone);
+            std::shared_ptr<MagicLeapMeshComponent> mesh_comp = std::make_shared<MagicLeapMeshComponent>(vertex_layout);
             std::shared_ptr<RenderableComponent> renderable =
                 std::make_shared<RenderableComponent>(mesh_comp->GetMesh(), mesh_mat_);
+            mesh_comp->SetLodCount(static_cast<size_t>(std::max(FLAGS_MeshLods, 0)));
+            mesh_comp->GetMesh()->SetMemoryLabel("meshing");
+            for (const auto &lod_mesh : mesh_comp->GetLodMeshes()) {
+              lod_mesh->SetMemoryLabel("meshing");
+            }
+            renderable->SetLods(mesh_comp->GetLodMeshes());
             new_block->AddComponent(renderable);
             new_block->AddComponent(mesh_comp);
             UpdateNodeRenderOption(new_block);
@@ -355,10 +392,15 @@ private:
     const auto &renderable = node->GetComponent<RenderableComponent>();
     if (!(meshing_settings_.flags & MLMeshingFlags_PointCloud)) {
       renderable->GetMaterial()->SetPolygonMode(GL_LINE);
-      renderable->GetMesh()->SetPrimitiveType(GL_TRIANGLES);
-    } else {
-      renderable->GetMesh()->SetPrimitiveType(GL_POINTS);
-      renderable->GetMesh()->SetPointSize(8);
+    }
+    for (size_t level = 0; level < renderable->GetLodCount(); ++level) {
+      const auto &mesh = renderable->GetLodMesh(level);
+      if (!(meshing_settings_.flags & MLMeshingFlags_PointCloud)) {
+        mesh->SetPrimitiveType(GL_TRIANGLES);
+      } else {
+        mesh->SetPrimitiveType(GL_POINTS);
+        mesh->SetPointSize(8);
+      }
     }
   }
 
@@ -424,6 +466,14 @@ private:
           }
         }
       }
+
+      ml::app_framework::Gui::GetInstance().DrawGpuMemoryPanel();
+
+      if (ImGui::CollapsingHeader("Buffers")) {
+        // Mesh blocks changing size often should mostly fit in the capacity their buffers already have
+        ImGui::Text("updates: %" PRIu64, ml::app_framework::Buffer::GetTotalUpdateCount());
+        ImGui::Text("reallocations: %" PRIu64, ml::app_framework::Buffer::GetTotalReallocationCount());
+      }
     }
     ImGui::End();
     ml::app_framework::Gui::GetInstance().EndUpdate();
@@ -434,6 +484,9 @@ private:
   MLHandle current_mesh_request_ = ML_INVALID_HANDLE;
   MLMeshingSettings meshing_settings_ = {};
   MLMeshingLOD meshing_lod_ = MLMeshingLOD_Medium;
+  // The LOD to go back to when the GPU memory usage drops under the threshold of gpu_memory_callback_
+  MLMeshingLOD unshed_meshing_lod_ = MLMeshingLOD_Medium;
+  uint32_t gpu_memory_callback_ = 0;
   MLMeshingExtents request_extents_ = {};
   std::vector<MLMeshingBlockRequest> block_requests_;
 
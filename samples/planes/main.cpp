@@ -12,6 +12,7 @@
 #include <app_framework/application.h>
 #include <app_framework/convert.h>
 #include <app_framework/ml_macros.h>
+#include <app_framework/perception_recorder.h>
 #include <app_framework/toolset.h>
 
 #include <gflags/gflags.h>
@@ -102,7 +103,7 @@ public:
       }
     } else {
       MLTransform head_transform = {};
-      UNWRAP_MLRESULT(MLSnapshotGetTransform(snapshot, &head_static_data_.coord_frame_head, &head_transform));
+      UNWRAP_MLRESULT(recorder_.GetTransform(snapshot, &head_static_data_.coord_frame_head, &head_transform));
       RequestPlanes(head_transform);
     }
 
@@ -112,6 +113,7 @@ public:
   }
 
 private:
+  ml::app_framework::PerceptionRecorder &recorder_ = ml::app_framework::PerceptionRecorder::GetInstance();
   class Ray
   {
   public:
@@ -159,7 +161,7 @@ private:
   }
 
   void HandleInput() {
-    UNWRAP_MLRESULT(MLInputGetControllerState(input_tracker_, input_state_));
+    UNWRAP_MLRESULT(recorder_.GetControllerState(input_tracker_, input_state_));
     // Using the first connected contoller
     const auto &state = input_state_[0];
     MLTransform controller_transform{state.orientation, state.position};
@@ -243,7 +245,7 @@ private:
   }
 
   void ReceivePlanesRequest() {
-    MLResult result = MLPlanesQueryGetResultsWithBoundaries(planes_tracker_, planes_request_, ml_planes_.data(), &num_planes_, nullptr);
+    MLResult result = recorder_.GetPlanesResults(planes_tracker_, planes_request_, ml_planes_.data(), &num_planes_, nullptr);
     if (MLResult_Ok == result) {
       ClearPlanes(planes_, num_planes_);
       for (size_t i = 0; i < num_planes_; ++i) {
@@ -264,7 +266,7 @@ private:
     MLPlaneBoundariesList boundaries_list;
 
     MLPlaneBoundariesListInit(&boundaries_list);
-    MLResult plane_query_result = MLPlanesQueryGetResultsWithBoundaries(planes_tracker_,
+    MLResult plane_query_result = recorder_.GetPlanesResults(planes_tracker_,
       planes_request_, &ml_planes_.front(), &num_planes_, &boundaries_list);
 
     if (plane_query_result == MLResult_Ok ) {
@@ -314,7 +316,7 @@ private:
 
       // Release memory for boundaries results
       if (FLAGS_RenderBoundaries && boundaries_list.plane_boundaries_count) {
-        MLResult plane_release_result = MLPlanesReleaseBoundariesList(planes_tracker_, &boundaries_list);
+        MLResult plane_release_result = recorder_.ReleasePlaneBoundaries(planes_tracker_, &boundaries_list);
         if (plane_release_result != MLResult_Ok) {
           ML_LOG(Error, "Releasing of boundaries list memory failed.");
         }
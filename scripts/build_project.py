@@ -26,6 +26,12 @@ def layout_package(build_args):
     fix_permissions(build_args.distdir)
 
 
+def compile_shaders(build_args):
+    print_step("Compiling shaders...")
+    app_framework_dir = os.path.join(os.path.dirname(os.path.realpath(__file__)), '..', 'app_framework')
+    subprocess.run([sys.executable, 'compile_shaders.py'], cwd=app_framework_dir, check=True)
+
+
 def build_packages(build_args):
     update_for_ccache(build_args.mabu_args, build_args.ccache)
     mabu_projects = list(get_area_projects(build_args))
@@ -75,6 +81,7 @@ def build(build_args, base_dir, project, dist_dir, packages, clean_rm_dirs=None)
 
     if build_args.build_deps:
         build_external_deps.main()
+    compile_shaders(build_args)
     build_packages(build_args)
     if not ('-c' in build_args.mabu_args or '--clean' in build_args.mabu_args):
         layout_package(build_args)